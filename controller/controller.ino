@@ -4,8 +4,6 @@
 // INCLUDES
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
-#include <QueueList.h>
-#include <Wire.h>
 
 
 
@@ -17,15 +15,34 @@
 #include "src/main_boschCom.h"
 #include "src/main_display.h"
 #include "src/main_stringBuilder.h"
+#include "src/main_timeline.h"
+#include "src/main_debugLog.h"
 #include "src/StoreD.h"
 #include "src/mfcCtrl.h"
 #include "src/valveCtrl.h"
 
 #include "src/ownlibs/serialCommunication.h"
+#include "src/ownlibs/startTrigger.h"
+#include "src/ownlibs/syncPulse.h"
+#include "src/ownlibs/memoryStats.h"
 
 void setup() {
+    //Freien RAM fuer den Stack-Hoechststand fuellen, bevor tiefere Aufrufe ihn benutzen
+    memoryStats->paintStack();
+
     // ERSTELLE SERIELLE VERBINDUNGEN
-    srl->setSerial(&Serial1, &Serial, &Serial2); //labview / debug / uart
+#if SERIAL_LABVIEW_USB
+    srl->addLabView(&Serial); //natives USB
+#endif
+#if SERIAL_LABVIEW_UART
+    srl->addLabView(&Serial1);
+#endif
+#if SERIAL_DEBUG_UART
+    srl->setDebug(&Serial1);
+#else
+    srl->setDebug(&Serial);
+#endif
+    srl->setUart(&Serial2); //MFC-Bus
 
     // ERSTELLE GEBRAUCHTE OBJEKTE
     io::Main_Display *main_display                        = new io::Main_Display();
@@ -34,6 +51,12 @@ void setup() {
     communication::Main_StringBuilder *main_stringBuilder = new communication::Main_StringBuilder();
     control::Main_MfcCtrl *main_mfcCtrl                   = new control::Main_MfcCtrl();
     control::Main_ValveCtrl *main_valveCtrl               = new control::Main_ValveCtrl();
+#if EVENT_TIMELINE_MERGED
+    control::Main_Timeline *main_timeline                 = new control::Main_Timeline();
+#endif
+#if SERIAL_DEBUG_BUFFERED
+    communication::Main_DebugLog *main_debugLog           = new communication::Main_DebugLog();
+#endif
 
     // TAUSCHE OBJEKTPOINTER ZWISCHEN OBJEKTEN AUS
     main_labCom->setMainMfcObjectPointer(main_mfcCtrl);
@@ -41,6 +64,12 @@ void setup() {
     main_labCom->setMainBoschObjectPointer(main_boschCom);
     main_labCom->setMainDisplayObjectPointer(main_display);
     main_labCom->setMainStringBuilderObjectPointer(main_stringBuilder);
+#if EVENT_TIMELINE_MERGED
+    main_labCom->setMainTimelineObjectPointer(main_timeline);
+
+    main_timeline->setMainMfcObjectPointer(main_mfcCtrl);
+    main_timeline->setMainValveObjectPointer(main_valveCtrl);
+#endif
     
     main_mfcCtrl->setMainDisplayObjectPointer(main_display);
     
@@ -49,17 +78,44 @@ void setup() {
     main_stringBuilder->setMainValveObjectPointer(main_valveCtrl);
     main_stringBuilder->setMainMfcObjectPointer(main_mfcCtrl);
     main_stringBuilder->setMainBoschObjectPointer(main_boschCom);
+    main_stringBuilder->setMainLabComObjectPointer(main_labCom);
+    main_stringBuilder->setMainDisplayObjectPointer(main_display);
+
+#if SD_PROGRAM_AUTOLOAD
+    //Messprogramm von der SD-Karte, ohne Datei wird wie bisher auf LabView gewartet
+    main_labCom->loadProgram(SD_PROGRAM_FILE);
+#endif
 
     // STARTE PSEUDOTHREADS
-    main_thread_list -> add_thread(main_display);
-    main_thread_list -> add_thread(main_labCom);
-    main_thread_list -> add_thread(main_boschCom);
-    main_thread_list -> add_thread(main_stringBuilder);
-    main_thread_list -> add_thread(main_mfcCtrl);
-    main_thread_list -> add_thread(main_valveCtrl);
+    //Die Namen erscheinen im Profil (<profile>, MTHREAD_PROFILE in mthread.h). Faellige Threads
+    //einer hoeheren Prioritaet (THREAD_PRIORITY_* in config.h) laufen vor denen der niedrigeren
+    main_thread_list -> add_thread(main_display, "Display", THREAD_PRIORITY_BACKGROUND);
+    main_thread_list -> add_thread(main_labCom, "LabCom", THREAD_PRIORITY_IO);
+    main_thread_list -> add_thread(main_boschCom, "BoschCom", THREAD_PRIORITY_ACQUISITION);
+    main_thread_list -> add_thread(main_stringBuilder, "StringBuilder", THREAD_PRIORITY_ACQUISITION); //tastet zum Messzeitpunkt ab
+    main_thread_list -> add_thread(main_stringBuilder->getStoreD(), "StoreD", THREAD_PRIORITY_IO); //schreibt volle Bloecke auf die SD-Karte
+    main_thread_list -> add_thread(main_mfcCtrl->getMfcBus(), "MfcBus", THREAD_PRIORITY_REALTIME); //sendet die Soll-Werte an die MFCs
+#if EVENT_TIMELINE_MERGED
+    main_thread_list -> add_thread(main_timeline, "Timeline", THREAD_PRIORITY_REALTIME); //ersetzt die Threads von MFCs und Ventilen
+#else
+    main_thread_list -> add_thread(main_mfcCtrl, "MfcCtrl", THREAD_PRIORITY_REALTIME);
+#endif
+#if !EVENT_TIMELINE_MERGED || VALVE_HARDWARE_TIMER
+    main_thread_list -> add_thread(main_valveCtrl, "ValveCtrl", THREAD_PRIORITY_REALTIME); //mit Hardware-Timer bleibt der Ventil-Thread auch bei der Zeitleiste aktiv
+#endif
+#if SERIAL_DEBUG_BUFFERED
+    main_thread_list -> add_thread(main_debugLog, "DebugLog", THREAD_PRIORITY_BACKGROUND); //gibt die gepufferten Debugausgaben aus
+#endif
 
     // ERSTELLE INTERRUPTS FUER TASTER
 
-    //Taster start
+    //Taster start, der Interrupt haelt nur den Zeitpunkt fest, main_labCom startet damit die Messung
+#if START_BUTTON
+    startTrigger->begin(START_BUTTON_PIN);
+#endif
+    //Synchronleitung zu weiteren Steuerungen, beim Slave haelt der Interrupt die Flanken der Pulse fest
+#if SYNC_MODE != SYNC_MODE_OFF
+    syncPulse->begin();
+#endif
     //Schalter Debug
 }
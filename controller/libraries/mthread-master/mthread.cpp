@@ -25,6 +25,19 @@ Thread::Thread()
 {
     mode = run_mode;
     kill_flag = false;
+    owner = NULL;
+    heap_index = 0;
+    deadline = 0;
+    max_latency = 0;
+    name = NULL;
+    priority = 0;
+#if MTHREAD_PROFILE
+    profile_calls = 0;
+    profile_total = 0;
+    profile_max = 0;
+    profile_max_gap = 0;
+    profile_last_call = 0;
+#endif
 }
 
 Thread::~Thread()
@@ -42,6 +55,8 @@ bool Thread::kill(bool force)
     if(force)
     {
         mode = kill_mode;
+        if(owner != NULL)
+            owner->reschedule(this);
         return true;
     }
 
@@ -52,6 +67,9 @@ bool Thread::kill(bool force)
     // Wake up the thread and request that it be killed:
     mode = run_mode;
     kill_flag = true;
+    if(owner != NULL)
+        owner->reschedule(this);
+    return true;
 
 }
 
@@ -77,6 +95,10 @@ bool Thread::resume()
 
     // Resume the Thread:
     mode = run_mode;
+
+    // A paused or sleeping Thread may be sorted far back in the heap:
+    if(owner != NULL)
+        owner->reschedule(this);
     return true;
 
 }
@@ -126,6 +148,115 @@ bool Thread::sleep_milli(unsigned long t)
 
 }
 
+bool Thread::sleep_until_micro(unsigned long t)
+{
+
+    // Fail unless the thread is currently running:
+    if(mode != run_mode)
+        return false;
+
+    // Set the sleep timeout, a time in the past means no wait at all:
+    mode = sleep_micro_mode;
+    stop_time = micros();
+    wait_time = ((long)(t - stop_time) > 0) ? t - stop_time : 0;
+    return true;
+
+}
+
+bool Thread::sleep_until_milli(unsigned long t)
+{
+
+    // Fail unless the thread is currently running:
+    if(mode != run_mode)
+        return false;
+
+    // Set the sleep timeout, a time in the past means no wait at all:
+    mode = sleep_milli_mode;
+    stop_time = millis();
+    wait_time = ((long)(t - stop_time) > 0) ? t - stop_time : 0;
+    return true;
+
+}
+
+unsigned long Thread::get_max_latency() const
+{
+    return max_latency;
+}
+
+void Thread::reset_max_latency()
+{
+    max_latency = 0;
+}
+
+const char *Thread::get_name() const
+{
+    return name;
+}
+
+unsigned Thread::get_priority() const
+{
+    return priority;
+}
+
+#if MTHREAD_PROFILE
+unsigned long Thread::get_profile_calls() const
+{
+    return profile_calls;
+}
+
+unsigned long long Thread::get_profile_time() const
+{
+    return profile_total / MTHREAD_PROFILE_TICKS_PER_US;
+}
+
+unsigned long Thread::get_profile_max() const
+{
+    return profile_max / MTHREAD_PROFILE_TICKS_PER_US;
+}
+#endif
+
+unsigned long Thread::next_deadline() const
+{
+    unsigned long now = micros();
+    unsigned long passed;
+
+    switch(mode)
+    {
+
+    case pause_mode:
+
+        // Only resume() wakes up a paused Thread:
+        return now + MTHREAD_MAX_WAIT;
+
+    case sleep_mode:
+    case sleep_milli_mode:
+
+        // micros() and millis() are based on the same counter, so the
+        // deadline in milliseconds can be converted directly:
+        passed = millis() - stop_time;
+        if(passed >= wait_time)
+            return now;
+        if(wait_time - passed > MTHREAD_MAX_WAIT / 1000)
+            return now + MTHREAD_MAX_WAIT;
+        return (stop_time + wait_time) * 1000UL;
+
+    case sleep_micro_mode:
+
+        passed = now - stop_time;
+        if(passed >= wait_time)
+            return now;
+        if(wait_time - passed > MTHREAD_MAX_WAIT)
+            return now + MTHREAD_MAX_WAIT;
+        return stop_time + wait_time;
+
+    default:
+
+        // Running Thread objects are due immediately:
+        return now;
+
+    }
+}
+
 bool Thread::loop()
 {
     return false;
@@ -139,7 +270,7 @@ bool Thread::call()
     case run_mode:
 
         // If the main loop completes destroy the Thread:
-        if(!loop())
+        if(!run_loop())
         {
             delete this;
             return false;
@@ -157,8 +288,13 @@ bool Thread::call()
         // Return to normal operation after the timeout expires:
         if(millis() - stop_time >= wait_time)
         {
+            unsigned long latency =
+                (millis() - stop_time - wait_time) * 1000UL;
+            if(latency > max_latency)
+                max_latency = latency;
+
             mode = run_mode;
-            if(!loop())
+            if(!run_loop())
             {
                 delete this;
                 return false;
@@ -172,8 +308,12 @@ bool Thread::call()
         // Return to normal operation after the timeout expires:
         if(micros() - stop_time >= wait_time)
         {
+            unsigned long latency = micros() - stop_time - wait_time;
+            if(latency > max_latency)
+                max_latency = latency;
+
             mode = run_mode;
-            if(!loop())
+            if(!run_loop())
             {
                 delete this;
                 return false;
@@ -182,6 +322,10 @@ bool Thread::call()
         }
         return true;
 
+    case kill_mode:
+    default:
+        break;
+
     }
 
     // The thread is either in kill mode or something really bad has
@@ -191,19 +335,50 @@ bool Thread::call()
 
 }
 
+bool Thread::run_loop()
+{
+#if MTHREAD_PROFILE
+    unsigned long now = micros();
+    if(profile_calls > 0 && now - profile_last_call > profile_max_gap)
+        profile_max_gap = now - profile_last_call;
+    profile_last_call = now;
+
+    // The counter differences stay valid across a wrap:
+    unsigned long start = MTHREAD_PROFILE_TICKS();
+    bool result = loop();
+    unsigned long ticks = MTHREAD_PROFILE_TICKS() - start;
+
+    profile_calls++;
+    profile_total += ticks;
+    if(ticks > profile_max)
+        profile_max = ticks;
+    return result;
+#else
+    return loop();
+#endif
+}
+
 ThreadList::ThreadList(bool keep)
 {
-    thread = NULL;
-    thread_count = 0;
-    thread_index = 0;
+    for(unsigned p = 0; p < MTHREAD_PRIORITIES; p++)
+        thread_count[p] = 0;
+    total_count = 0;
     keep_flag = keep;
+#if MTHREAD_PROFILE
+    profile_since = micros();
+#if defined(KINETISK)
+    // Start the cycle counter, it is not running after reset:
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+#endif
 }
 
 ThreadList::~ThreadList()
 {
-    for(unsigned i = 0; i < thread_count; i++)
-        delete thread[i];
-    free(thread);
+    for(unsigned p = 0; p < MTHREAD_PRIORITIES; p++)
+        for(unsigned i = 0; i < thread_count[p]; i++)
+            delete thread[p][i];
 }
 
 bool ThreadList::add_thread(Thread *t)
@@ -213,21 +388,184 @@ bool ThreadList::add_thread(Thread *t)
     if(t == NULL)
         return false;
 
-    // Allocate space in the list for the new thread:
-    Thread **new_thread =
-        (Thread **)realloc(thread,
-                           sizeof(Thread *) * (thread_count + 1));
-    if(new_thread == NULL)
+    // Check for space in the list:
+    if(total_count >= MTHREAD_MAX_THREADS)
         return false;
-    thread = new_thread;
 
-    // Append the new pointer to the list and update the thread count:
-    thread[thread_count] = t;
-    thread_count++;
+    // Append the new pointer to the heap of its priority class and
+    // update the thread count:
+    unsigned p = t->priority;
+    t->owner = this;
+    t->deadline = t->next_deadline();
+    t->heap_index = thread_count[p];
+    thread[p][thread_count[p]] = t;
+    thread_count[p]++;
+    total_count++;
+    sift_up(p, t->heap_index);
     return true;
 
 }
 
+bool ThreadList::add_thread(Thread *t, const char *name)
+{
+    if(t != NULL)
+        t->name = name;
+    return add_thread(t);
+}
+
+bool ThreadList::add_thread(Thread *t, const char *name, unsigned priority)
+{
+    if(t == NULL || priority >= MTHREAD_PRIORITIES)
+        return false;
+    t->priority = priority;
+    return add_thread(t, name);
+}
+
+void ThreadList::print_profile(Print *out)
+{
+#if MTHREAD_PROFILE
+    unsigned long elapsed = micros() - profile_since;
+    unsigned long long busy = 0;
+    for(unsigned i = 0; i < total_count; i++)
+    {
+        Thread *t = get_thread(i);
+        unsigned long long total = t->get_profile_time();
+        busy += total;
+
+        out->print(t->name != NULL ? t->name : "Thread");
+        out->print("\tprio: ");
+        out->print(t->priority);
+        out->print("\tcalls: ");
+        out->print(t->profile_calls);
+        out->print("\tsum: ");
+        out->print((unsigned long)total);
+        out->print(" us\tmax: ");
+        out->print(t->get_profile_max());
+        out->print(" us\tgap: ");
+        out->print(t->profile_max_gap);
+        out->print(" us\tlate: ");
+        out->print(t->max_latency);
+        out->print(" us\tload: ");
+        out->print(elapsed > 0 ? (unsigned long)(total * 1000 / elapsed) : 0UL);
+        out->println(" permille");
+    }
+
+    // Time outside of all Thread objects, mostly asleep in idle():
+    unsigned long long idle = busy < elapsed ? elapsed - busy : 0;
+    out->print("Idle\tsum: ");
+    out->print((unsigned long)idle);
+    out->print(" us\tload: ");
+    out->print(elapsed > 0 ? (unsigned long)(idle * 1000 / elapsed) : 0UL);
+    out->println(" permille");
+#else
+    out->println("mthread: MTHREAD_PROFILE is not enabled");
+#endif
+}
+
+void ThreadList::reset_profile()
+{
+#if MTHREAD_PROFILE
+    for(unsigned i = 0; i < total_count; i++)
+    {
+        Thread *t = get_thread(i);
+        t->profile_calls = 0;
+        t->profile_total = 0;
+        t->profile_max = 0;
+        t->profile_max_gap = 0;
+        t->max_latency = 0;
+    }
+    profile_since = micros();
+#endif
+}
+
+unsigned ThreadList::get_thread_count() const
+{
+    return total_count;
+}
+
+Thread *ThreadList::get_thread(unsigned i) const
+{
+    // The heaps of the classes one after the other:
+    unsigned p = 0;
+    while(i >= thread_count[p])
+        i -= thread_count[p++];
+    return thread[p][i];
+}
+
+unsigned long ThreadList::get_next_deadline() const
+{
+    // The roots of the heaps are the earliest deadlines of their class:
+    unsigned long now = micros();
+    unsigned long next = now + MTHREAD_MAX_WAIT;
+    for(unsigned p = 0; p < MTHREAD_PRIORITIES; p++)
+        if(thread_count[p] > 0 && (long)(thread[p][0]->deadline - next) < 0)
+            next = thread[p][0]->deadline;
+    return next;
+}
+
+void ThreadList::idle()
+{
+#if MTHREAD_IDLE && defined(KINETISK)
+    // Every interrupt ends WFI, SysTick at the latest after one
+    // millisecond.  SYST_CVR counts the CPU cycles down to it:
+    unsigned long until_tick = SYST_CVR / (F_CPU / 1000000);
+    if((long)(get_next_deadline() - micros()) > (long)(until_tick + MTHREAD_IDLE_MARGIN))
+        asm volatile("wfi");
+#endif
+}
+
+void ThreadList::reschedule(Thread *t)
+{
+    t->deadline = t->next_deadline();
+    sift_up(t->priority, t->heap_index);
+    sift_down(t->priority, t->heap_index);
+}
+
+void ThreadList::swap(unsigned p, unsigned a, unsigned b)
+{
+    Thread *temp = thread[p][a];
+    thread[p][a] = thread[p][b];
+    thread[p][b] = temp;
+    thread[p][a]->heap_index = a;
+    thread[p][b]->heap_index = b;
+}
+
+void ThreadList::sift_up(unsigned p, unsigned i)
+{
+
+    // Deadlines are compared by their difference to stay wrap-safe:
+    while(i > 0)
+    {
+        unsigned parent = (i - 1) / 2;
+        if((long)(thread[p][i]->deadline - thread[p][parent]->deadline) >= 0)
+            return;
+        swap(p, i, parent);
+        i = parent;
+    }
+
+}
+
+void ThreadList::sift_down(unsigned p, unsigned i)
+{
+    for(;;)
+    {
+        unsigned smallest = i;
+        unsigned left = 2 * i + 1;
+        unsigned right = left + 1;
+
+        if(left < thread_count[p] &&
+           (long)(thread[p][left]->deadline - thread[p][smallest]->deadline) < 0)
+            smallest = left;
+        if(right < thread_count[p] &&
+           (long)(thread[p][right]->deadline - thread[p][smallest]->deadline) < 0)
+            smallest = right;
+        if(smallest == i)
+            return;
+        swap(p, i, smallest);
+        i = smallest;
+    }
+}
+
 bool ThreadList::loop()
 {
 
@@ -236,37 +574,68 @@ bool ThreadList::loop()
         return false;
 
     // If nothing remains in the list, do nothing:
-    if(thread_count == 0)
+    if(total_count == 0)
         return keep_flag;
 
-    // Move on to the next thread if the current one doesn't finish.
-    if(thread[thread_index]->call())
+    // Only the root of each heap can be due.  The highest class with a
+    // due root runs, unless a lower one has waited longer than
+    // MTHREAD_MAX_STARVATION:
+    unsigned long now = micros();
+    int due = -1;
+    for(unsigned p = 0; p < MTHREAD_PRIORITIES; p++)
     {
-        thread_index++;
-        if(thread_index >= thread_count)
-            thread_index = 0;
+        if(thread_count[p] == 0)
+            continue;
+        long late = (long)(now - thread[p][0]->deadline);
+        if(late < 0)
+            continue;
+        if(due < 0)
+            due = p;
+        else if((unsigned long)late > MTHREAD_MAX_STARVATION)
+        {
+            due = p;
+            break;
+        }
+    }
+    if(due < 0)
+        return true;
+
+    // Call it and sort it back into the heap with its new deadline.
+    // The call may move it: resume() or kill() on itself reschedules
+    // it, threads added meanwhile are sifted in.  So it is looked up
+    // by pointer afterwards, not assumed to be at the root:
+    unsigned p = due;
+    Thread *t = thread[p][0];
+    if(t->call())
+    {
+        t->deadline = t->next_deadline();
+        sift_up(p, t->heap_index);
+        sift_down(p, t->heap_index);
         return true;
     }
 
-    // The Thread doesn't need to be called again - remove it from the
-    // list:
-    thread_count--;
-    for(unsigned i = thread_index; i < thread_count; i++)
-        thread[i] = thread[i + 1];
-    if(thread_index >= thread_count)
-        thread_index = 0;
+    // The Thread doesn't need to be called again and has deleted
+    // itself - find its slot by the pointer value and remove it from
+    // the heap:
+    unsigned i = 0;
+    while(i < thread_count[p] && thread[p][i] != t)
+        i++;
+    if(i == thread_count[p])
+        return true;
+    thread_count[p]--;
+    total_count--;
 
-    // If nothing remains in the list, free it and exit:
-    if(thread_count == 0)
-    {
-        free(thread);
-        thread = NULL;
+    // If nothing remains in the list, exit:
+    if(total_count == 0)
         return keep_flag;
-    }
 
-    // Re-allocate the list to reflect the missing thread:
-    thread = (Thread **)realloc(thread,
-                                sizeof(Thread *) * thread_count);
+    if(i < thread_count[p])
+    {
+        thread[p][i] = thread[p][thread_count[p]];
+        thread[p][i]->heap_index = i;
+        sift_up(p, i);
+        sift_down(p, thread[p][i]->heap_index);
+    }
     return true;
 
 }
@@ -280,7 +649,15 @@ void loop()
 
     // Call it:
     if(!main_thread_list->call())
+    {
         main_thread_list = NULL;
+        return;
+    }
+
+#if MTHREAD_IDLE
+    // Nothing due, sleep until the next interrupt:
+    main_thread_list->idle();
+#endif
 
 }
 
@@ -37,6 +37,65 @@
 /// \brief Default switch debounce time.
 #define DEFAULT_DEBOUNCE 50
 
+/// \brief Maximum distance (in microseconds) between the current time
+/// and the deadline a ThreadList stores for one of its threads.
+/// Longer sleeps are split up, so that the wrap-safe deadline
+/// comparisons stay valid.
+#define MTHREAD_MAX_WAIT 0x40000000UL
+
+/// \brief Maximum number of Thread objects in one ThreadList.  The
+/// list is a fixed array, so adding or removing threads never touches
+/// the heap.
+#ifndef MTHREAD_MAX_THREADS
+#define MTHREAD_MAX_THREADS 16
+#endif
+
+/// \brief Number of priority classes in a ThreadList, 0 is the
+/// highest.  Every class is a heap of its own, a due Thread of a
+/// higher class always runs before the due ones of lower classes.
+#ifndef MTHREAD_PRIORITIES
+#define MTHREAD_PRIORITIES 4
+#endif
+
+/// \brief Microseconds a due Thread of a lower class waits at most
+/// while higher classes keep running (e.g. a Thread that never
+/// sleeps).  After that it gets one call.
+#ifndef MTHREAD_MAX_STARVATION
+#define MTHREAD_MAX_STARVATION 20000UL
+#endif
+
+/// \brief Set to 1 to record how long each Thread's loop() runs (see
+/// ThreadList::print_profile()).  Costs two counter reads per call.
+#ifndef MTHREAD_PROFILE
+#define MTHREAD_PROFILE 0
+#endif
+
+/// \brief Set to 1 to sleep the core with WFI while no Thread of the
+/// main ThreadList is due (see ThreadList::idle()).  Only the Teensy
+/// 3.x sleeps, other targets keep polling.
+#ifndef MTHREAD_IDLE
+#define MTHREAD_IDLE 1
+#endif
+
+/// \brief Microseconds the core must stay awake before the earliest
+/// deadline: waking up and returning from loop() take this long.
+#ifndef MTHREAD_IDLE_MARGIN
+#define MTHREAD_IDLE_MARGIN 20
+#endif
+
+/// \brief Time base of the profiler: the cycle counter of the M4.
+/// Can be replaced by defining both macros before this header is
+/// included (e.g. in a host build).
+#if MTHREAD_PROFILE && !defined(MTHREAD_PROFILE_TICKS)
+#if defined(KINETISK)
+#define MTHREAD_PROFILE_TICKS() ARM_DWT_CYCCNT
+#define MTHREAD_PROFILE_TICKS_PER_US (F_CPU / 1000000)
+#else
+#define MTHREAD_PROFILE_TICKS() micros()
+#define MTHREAD_PROFILE_TICKS_PER_US 1
+#endif
+#endif
+
 class ThreadList;
 void loop(void);
 
@@ -132,6 +191,54 @@ public:
     /// \return true on success, false on failure.
     bool sleep_milli(unsigned long t);
 
+    /// \brief Puts the Thread to sleep until an absolute point in
+    /// time.  Works like sleep_micro(), but takes the time at which
+    /// the Thread is to be woken up (as returned by micros()).  If
+    /// the time has already passed, the Thread will be called again
+    /// as soon as possible.
+    /// \param t The time (micros()) the Thread is to be woken up at.
+    /// \return true on success, false on failure.
+    bool sleep_until_micro(unsigned long t);
+
+    /// \brief Puts the Thread to sleep until an absolute point in
+    /// time.  Works like sleep_milli(), but takes the time at which
+    /// the Thread is to be woken up (as returned by millis()).
+    /// \param t The time (millis()) the Thread is to be woken up at.
+    /// \return true on success, false on failure.
+    bool sleep_until_milli(unsigned long t);
+
+    /// \brief Returns the largest delay (in microseconds) between
+    /// the end of a sleep and the actual call of the Thread's loop().
+    /// This is the scheduling latency caused by the other Thread
+    /// objects in the same ThreadList.
+    /// \return The worst-case wake-up latency in microseconds.
+    unsigned long get_max_latency() const;
+
+    /// \brief Resets the value returned by get_max_latency().
+    void reset_max_latency();
+
+    /// \brief Returns the name given to ThreadList::add_thread().
+    /// \return The name, NULL if none was given.
+    const char *get_name() const;
+
+    /// \brief Returns the priority class given to
+    /// ThreadList::add_thread().
+    /// \return The class, 0 is the highest.
+    unsigned get_priority() const;
+
+#if MTHREAD_PROFILE
+    /// \brief Returns the number of loop() runs since the last
+    /// ThreadList::reset_profile().
+    unsigned long get_profile_calls() const;
+
+    /// \brief Returns the summed duration of all loop() runs in
+    /// microseconds.
+    unsigned long long get_profile_time() const;
+
+    /// \brief Returns the longest loop() run in microseconds.
+    unsigned long get_profile_max() const;
+#endif
+
 protected:
 
     /// \brief The Thread's main loop.  This function is to be
@@ -165,6 +272,17 @@ private:
     /// NOT be used again.  A new instance must first be created.
     bool call();
 
+    /// \brief Runs loop() once and, with MTHREAD_PROFILE, records
+    /// its duration and the time since the previous run.
+    /// \return The result of loop().
+    bool run_loop();
+
+    /// \brief Calculates the point in time (micros()) at which the
+    /// Thread needs to be called next.  Paused and long sleeping
+    /// Thread objects are limited to MTHREAD_MAX_WAIT.
+    /// \return The deadline in microseconds.
+    unsigned long next_deadline() const;
+
     /// \brief The time the thread was stopped at.
     unsigned long stop_time;
 
@@ -175,12 +293,56 @@ private:
     /// get_mode() function).
     Mode mode;
 
+    /// \brief The ThreadList the Thread has been added to (NULL if
+    /// it has not been added yet).
+    ThreadList *owner;
+
+    /// \brief The position of the Thread in the deadline heap of its
+    /// owner.
+    unsigned heap_index;
+
+    /// \brief The deadline (micros()) the Thread is sorted by in the
+    /// heap of its owner.
+    unsigned long deadline;
+
+    /// \brief The worst-case wake-up latency in microseconds.
+    unsigned long max_latency;
+
+    /// \brief The name of the Thread, used in the profile.
+    const char *name;
+
+    /// \brief The priority class, selects the heap in the owner.
+    unsigned priority;
+
+#if MTHREAD_PROFILE
+    /// \brief The number of loop() runs since the last reset.
+    unsigned long profile_calls;
+
+    /// \brief The summed duration of all loop() runs in ticks.
+    unsigned long long profile_total;
+
+    /// \brief The longest loop() run in ticks.
+    unsigned long profile_max;
+
+    /// \brief The longest time (in microseconds) between the starts
+    /// of two loop() runs, including sleeps.
+    unsigned long profile_max_gap;
+
+    /// \brief The start (micros()) of the last loop() run.
+    unsigned long profile_last_call;
+#endif
+
     friend class ThreadList;
     friend void loop(void);
 };
 
 /// \brief An object for running several Thread objects
-/// simultaneously.  A ThreadList object is a Thread in and of itself.
+/// simultaneously.  The Thread objects are kept in one binary min-heap
+/// per priority class, ordered by their next deadline, so a sleeping
+/// Thread costs nothing until it is due and a due Thread never waits
+/// for more than the loop() of the Thread called before it, plus the
+/// due Thread objects of higher classes.  Running Thread objects of
+/// one class are called round-robin.  A ThreadList object is a Thread in and of itself.
 /// This allows the creation of tiered ThreadList objects by placing a
 /// lower-priority ThreadList inside of a higher-priority ThreadList.
 /// \note DO NOT place a Thread in more than one ThreadList or more
@@ -205,9 +367,59 @@ public:
 
     /// \brief Adds a Thread to the ThreadList.
     /// \param t A pointer to the Thread to be added.
-    /// \return true on success, false on failure.
+    /// \return true on success, false if the list already holds
+    /// MTHREAD_MAX_THREADS threads.
     bool add_thread(Thread *t);
 
+    /// \brief Adds a named Thread to the ThreadList.
+    /// \param t A pointer to the Thread to be added.
+    /// \param name The name shown in the profile, must remain valid.
+    /// \return true on success, false on failure.
+    bool add_thread(Thread *t, const char *name);
+
+    /// \brief Adds a named Thread to a priority class of the
+    /// ThreadList.  Without a class a Thread is added to class 0.
+    /// \param t A pointer to the Thread to be added.
+    /// \param name The name shown in the profile, must remain valid.
+    /// \param priority The class, below MTHREAD_PRIORITIES.
+    /// \return true on success, false on failure.
+    bool add_thread(Thread *t, const char *name, unsigned priority);
+
+    /// \brief Prints one line per Thread in the list: loop() runs,
+    /// summed and longest run time, longest gap between two runs,
+    /// worst wake-up latency and share of the time since the last
+    /// reset_profile().  A last line "Idle" holds the time spent in no
+    /// Thread (sleeping and scheduling).  Only available with
+    /// MTHREAD_PROFILE.
+    /// \param out The output, e.g. the debug port.
+    void print_profile(Print *out);
+
+    /// \brief Clears the profile of all Thread objects in the list.
+    void reset_profile();
+
+    /// \brief Returns the number of Thread objects in the list.
+    unsigned get_thread_count() const;
+
+    /// \brief Returns a Thread of the list, in no particular order.
+    /// \param i The index, below get_thread_count().
+    /// \return A pointer to the Thread.
+    Thread *get_thread(unsigned i) const;
+
+    /// \brief Returns the earliest deadline (micros()) of the Thread
+    /// objects in the list, at most MTHREAD_MAX_WAIT ahead.  Nothing
+    /// in the list needs to run before this time unless a Thread is
+    /// resumed from outside (e.g. by an interrupt).
+    /// \return The deadline in microseconds.
+    unsigned long get_next_deadline() const;
+
+    /// \brief Sleeps the core with WFI until the next interrupt, if no
+    /// Thread in the list is due before the SysTick interrupt
+    /// (millis()) wakes it anyway.  Called by loop() for the main
+    /// ThreadList with MTHREAD_IDLE, does nothing on other targets.
+    /// A Thread resumed by an interrupt runs after the next SysTick at
+    /// the latest.
+    void idle();
+
 protected:
 
     /// \brief The main loop.
@@ -216,19 +428,50 @@ protected:
 
 private:
 
-    /// \brief An array of pointers to the Thread objects in the list.
-    Thread **thread;
+    /// \brief Recalculates the deadline of a Thread in the list after
+    /// its mode has been changed from outside of its loop() (e.g. by
+    /// resume() or kill()).
+    /// \param t A pointer to the Thread.
+    void reschedule(Thread *t);
+
+    /// \brief Moves a heap entry towards the root until the heap
+    /// order is restored.
+    /// \param p The priority class of the heap.
+    /// \param i The heap index of the entry.
+    void sift_up(unsigned p, unsigned i);
 
-    /// \brief The number of Thread objects in the list.
-    unsigned thread_count;
+    /// \brief Moves a heap entry towards the leaves until the heap
+    /// order is restored.
+    /// \param p The priority class of the heap.
+    /// \param i The heap index of the entry.
+    void sift_down(unsigned p, unsigned i);
 
-    /// \brief The index number of the active thread.
-    unsigned thread_index;
+    /// \brief Swaps two entries of the heap of a priority class.
+    void swap(unsigned p, unsigned a, unsigned b);
+
+    /// \brief Arrays of pointers to the Thread objects in the list,
+    /// one per priority class, each ordered as a binary min-heap by
+    /// their deadline.
+    Thread *thread[MTHREAD_PRIORITIES][MTHREAD_MAX_THREADS];
+
+    /// \brief The number of Thread objects per priority class.
+    unsigned thread_count[MTHREAD_PRIORITIES];
+
+    /// \brief The number of Thread objects in the list, at most
+    /// MTHREAD_MAX_THREADS.
+    unsigned total_count;
 
     /// \brief If true, the ThreadList will not destroy itself when it
     /// becomes empty.
     bool keep_flag;
 
+#if MTHREAD_PROFILE
+    /// \brief The time (micros()) of the last reset_profile().
+    unsigned long profile_since;
+#endif
+
+    friend class Thread;
+
 };
 
 /// \brief A pointer to the main ThreadList.
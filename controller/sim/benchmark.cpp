@@ -0,0 +1,960 @@
+// Benchmark der Steuerung auf dem PC: baut die Objekte wie controller.ino auf, spielt ein erzeugtes
+// Messprogramm ueber die (nachgebildete) USB-Schnittstelle ein, startet die Messung und beendet sie
+// mit <stop>. Mit --stream wird nur der Anfang vor <start> gesendet, der Rest waehrend der Messung
+// (Streaming-Modus), mit --capacity N haelt der Sender je Kanal hoechstens N Events vorraetig. Mit
+// --program steht das Programm samt <start> in SD_PROGRAM_FILE im Verzeichnis von --sd und wird beim
+// Booten von der Steuerung selbst gelesen (mit --stream der Rest nach <start> ebenfalls). Mit --ramp ms
+// wird jedes MFC-Event eine Rampe <R,...> vom vorherigen Wert ueber spacing ms mit Schritten von ms.
+// Mit --repeat N steht die Eventliste in einem Block <repeat,N,Programmdauer>, der N mal ausgefuehrt wird.
+// Mit --uptime s laeuft das Board vor setup() schon s Sekunden, z.B. bis kurz vor den Ueberlauf von
+// micros() (4295 s), den cmn::micros64() ausgleichen muss. Mit --runs N wird das Programm nach <stop>
+// noch N-1 mal mit <restart> wiederholt, mit --rearm stattdessen nach <rearm> jedes Mal neu eingelesen.
+// Mit --button startet der Taster (Interrupt am START_BUTTON_PIN) die Messung statt <start>. Mit
+// --download wird danach die letzte Messdatei von --sd mit <ls> und <get> geholt und verglichen,
+// einmal ganz und einmal ab der Mitte (Fortsetzen nach einem Abbruch). Zeile 0 des Headers gibt die
+// Events des vollsten Kanals an, mit --reject wird vorher ein Programm mit einem Event zu viel je Kanal
+// gesendet, das die Steuerung mit ERR_PROGRAM_TOO_LARGE ablehnen und bis <end> verwerfen muss.
+// Mit SYNC_MODE_SLAVE uebersetzt spielt der Benchmark den Master: Startpuls statt <start> und
+// Taktpulse am SYNC_PIN nach einer Uhr, die um --drift ppm schneller laeuft. Geprueft wird, wie weit
+// die nachgefuehrte Uhr vor jedem Taktpuls von der des Masters abweicht.
+// Die Zeiten der Eventliste (--spacing, --ramp) sind in EVENT_TIME_UNIT, standardmaessig ms.
+// Ausgegeben werden Durchsatz beim Einlesen, Rechenzeit je Event, Speicherbedarf und die
+// Schaltverzoegerung in virtueller Zeit. Uebersetzen mit sim/build.sh
+//
+// Aufruf: ./benchmark [--events N] [--mfc N] [--valves N] [--spacing ms] [--intervall ms]
+//                     [--scale x] [--binary] [--window N] [--stream] [--capacity N] [--sd Verzeichnis]
+//                     [--program] [--ramp ms] [--repeat N] [--uptime s] [--runs N] [--rearm] [--button]
+//                     [--download] [--reject] [--drift ppm] [--verbose]
+
+#include <Arduino.h>
+#include <SD.h>
+#include <SPI.h>
+#include <mthread.h>
+#include <algorithm>
+#include <vector>
+
+#include "../src/config.h"
+#include "../src/eventBuffer.h"
+#include "../src/ownlibs/arena.h"
+#include "../src/ownlibs/common.h"
+#include "../src/ownlibs/latencyStats.h"
+#include "../src/ownlibs/syncPulse.h"
+
+void setup(); //controller.ino
+
+//Einstellungen, siehe Aufruf
+static long amountEvents = 100000;
+static int amountMFC     = 16;
+static int amountValve   = 16;
+static long spacing      = 10;
+static int intervall     = 10;
+static double scale      = 10;
+static bool binary       = false;
+static int window        = -1; //Zeilen je Bestaetigung im Fenstermodus (<window,N>), -1: "ok" je Zeile
+static bool stream       = false;
+static long capacity     = 0; //Events je Kanal, die der Sender im Streaming-Modus vorraetig haelt, 0: Eventspeicher
+static bool program      = false;
+static long rampStep     = 0; //>0: MFC-Events als Rampen mit dieser Schrittweite
+static long repeat       = 1; //Durchlaeufe der Eventliste, >1: als Block <repeat,...>
+static double uptime     = 0; //s, virtuelle Zeit vor setup()
+static long runs         = 1; //Messungen mit demselben Programm
+static bool rearm        = false; //Wiederholung mit <rearm> und neuem Einlesen statt <restart>
+static bool button       = false; //Start mit dem Taster statt <start>
+static bool download     = false; //Messdatei nach der Messung mit <get> holen
+static bool reject       = false; //vorher ein zu grosses Programm, das abgelehnt werden muss
+static double drift      = 50; //ppm, um die die Uhr des gespielten Masters schneller laeuft (SYNC_MODE_SLAVE)
+static const char *sdDirectory = NULL;
+static bool verbose      = false;
+
+//Zustand, den die Ausgaben der Steuerung setzen
+static long okReplies = 0;
+static long errorReplies = 0;
+static bool stopped = false;
+static long readyReplies = 0; //"ready" nach dem Booten und nach <rearm>
+static long ackReplies = 0;
+static long ackedSequence = 0; //hoechste mit "ack" bestaetigte Nummer
+static char uploadReply[UPLOAD_LINE_SIZE + 1] = ""; //Antwort auf <upload>
+static char triggerReply[TRIGGER_LINE_SIZE + 1] = ""; //Antwort auf <trigger>
+static long takenEvents[MAX_AMOUNT_MFC + MAX_AMOUNT_VALVE]; //letzte Meldung "stream,abgelehnt,entnommen..."
+static long streamRejected = 0;
+static long streamReports = 0;
+static char listedFile[13] = ""; //Messdatei mit der hoechsten Nummer aus "file,Name,Bytes"
+static long listedSize = -1;
+static long listedFiles = -1;    //"files,N"
+static long rejectedReplies = 0; //Errorcode ERR_PROGRAM_TOO_LARGE
+static char eventsReply[EVENTS_LINE_SIZE + 1] = ""; //"events,..." nach <end>
+static char ramReply[MEMORY_LINE_SIZE + 1] = "";    //"ram,..."
+static char syncReply[SYNC_LINE_SIZE + 1] = "";     //Antwort auf <sync>
+static long syncErrors = 0; //Meldungen ERR_SYNC auf dem Debugport
+
+//Gibt auf der Konsole aus (fuer ThreadList::print_profile())
+class ConsolePrint : public Print {
+public:
+    virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static void labViewLine(const char line[]) {
+    if (strcmp(line, "ok") == 0)
+        okReplies++;
+    else if (strncmp(line, "ack,", 4) == 0) {
+        ackReplies++;
+        ackedSequence = atol(line + 4);
+    } else if (strncmp(line, "nak,", 4) == 0)
+        errorReplies++;
+    else if (strcmp(line, "stopped") == 0)
+        stopped = true;
+    else if (strcmp(line, "ready") == 0)
+        readyReplies++;
+    else if (strncmp(line, "upload,", 7) == 0)
+        snprintf(uploadReply, sizeof(uploadReply), "%s", line);
+    else if (strncmp(line, "trigger,", 8) == 0)
+        snprintf(triggerReply, sizeof(triggerReply), "%s", line);
+    else if (strncmp(line, "stream,", 7) == 0) {
+        const char *field = line + 7;
+        streamRejected = atol(field);
+        for (int i = 0; i < amountMFC + amountValve && (field = strchr(field, ',')) != NULL; i++)
+            takenEvents[i] = atol(++field);
+        streamReports++;
+    }
+    else if (strncmp(line, "file,", 5) == 0) {
+        const char *size = strchr(line + 5, ',');
+        int length = size ? size - (line + 5) : 0;
+        if (size && length < (int)sizeof(listedFile) && strncmp(line + 5, SD_FILE_PREFIX, strlen(SD_FILE_PREFIX)) == 0
+                && strncmp(line + 5, listedFile, length) > 0) {
+            snprintf(listedFile, sizeof(listedFile), "%.*s", length, line + 5);
+            listedSize = atol(size + 1);
+        }
+    }
+    else if (strncmp(line, "files,", 6) == 0)
+        listedFiles = atol(line + 6);
+    else if (strncmp(line, "events,", 7) == 0)
+        snprintf(eventsReply, sizeof(eventsReply), "%s", line);
+    else if (strncmp(line, "ram,", 4) == 0)
+        snprintf(ramReply, sizeof(ramReply), "%s", line);
+    else if (strncmp(line, "sync,", 5) == 0)
+        snprintf(syncReply, sizeof(syncReply), "%s", line);
+    else if (line[0] >= '1' && line[0] <= '9' && strchr(line, ',') == NULL)
+        errorReplies++; //Errorcode
+    //Errorcode als Zeile bzw. im Fenstermodus "nak,Nummer,Errorcode"
+    if (atol(strncmp(line, "nak,", 4) == 0 ? strrchr(line, ',') + 1 : line) == ERR_PROGRAM_TOO_LARGE)
+        rejectedReplies++;
+    if (verbose && strcmp(line, "ok") != 0)
+        printf("LabView: %s\n", line);
+}
+
+//Frames an LabView (Messwerte und Statistik mit TELEMETRY_DELTA_FRAMES, --download) laufen am
+//Zeilenparser vorbei. Nur SERIAL_BINARY_FILE wird ausgewertet und ab downloadOffset zusammengesetzt
+static bool downloading = false;
+static char labViewFrame[4 + 4 + SD_BLOCK_SIZE + 2];
+static int labViewFrameLength = 0; //empfangene Bytes des Frames, auch ueber labViewFrame hinaus
+static long labViewFrames = 0;     //uebersprungene Frames anderer Typen
+static std::vector<char> downloaded;
+static unsigned long downloadOffset = 0;
+static bool downloadEnded = false;
+static long downloadFrames = 0;
+static long downloadErrors = 0; //CRC, Frametyp oder Offset falsch
+static bool labViewByte(uint8_t c) {
+    //Textzeilen enthalten kein SERIAL_BINARY_SYNC
+    if (labViewFrameLength == 0 && c != SERIAL_BINARY_SYNC)
+        return false;
+    if (labViewFrameLength < (int)sizeof(labViewFrame))
+        labViewFrame[labViewFrameLength] = c;
+    labViewFrameLength++;
+    int payload = labViewFrameLength >= 4 ? (uint8_t)labViewFrame[2] | (uint8_t)labViewFrame[3] << 8 : 0;
+    if (labViewFrameLength < 4 || labViewFrameLength < 4 + payload + 2)
+        return true;
+    labViewFrameLength = 0;
+
+    if ((uint8_t)labViewFrame[1] != SERIAL_BINARY_FILE) {
+        labViewFrames++;
+        return true;
+    }
+    if (!downloading || payload < 4 || payload > 4 + SD_BLOCK_SIZE) {
+        downloadErrors++;
+        return true;
+    }
+
+    uint16_t crc = 0xFFFF;
+    for (int i = 1; i < 4 + payload; i++)
+        crc = cmn::crc16(crc, labViewFrame[i]);
+    uint16_t received = (uint8_t)labViewFrame[4 + payload] | (uint8_t)labViewFrame[5 + payload] << 8;
+    unsigned long offset = 0;
+    for (int i = 3; i >= 0; i--)
+        offset = offset << 8 | (uint8_t)labViewFrame[4 + i];
+    if (crc != received || offset != downloadOffset + downloaded.size())
+        downloadErrors++;
+    else if (payload == 4)
+        downloadEnded = true;
+    else
+        downloaded.insert(downloaded.end(), &labViewFrame[8], &labViewFrame[4 + payload]);
+    downloadFrames++;
+    return true;
+}
+
+static void debugLine(const char line[]) {
+    if (strstr(line, "Synchronisation") != NULL)
+        syncErrors++;
+    if (verbose || strncmp(line, "ERROR", 5) == 0)
+        printf("Debug: %s\n", line);
+}
+
+//MFCs am UART: bestaetigen jeden Soll-Wert sofort und melden ihn als Durchfluss zurueck
+static char mfcAdresses[MAX_AMOUNT_MFC][16];
+static int mfcValues[MAX_AMOUNT_MFC];
+
+static void replyMfc(int i, char command, const char value[]) {
+    char reply[32];
+    if (command == 'S') {
+        mfcValues[i] = atoi(value);
+        snprintf(reply, sizeof(reply), "%s:A\r\n", mfcAdresses[i]);
+    } else {
+        snprintf(reply, sizeof(reply), "%s:V%d\r\n", mfcAdresses[i], mfcValues[i]);
+    }
+    Serial2.feed(reply, strlen(reply));
+}
+
+static void uartLine(const char line[]) {
+    const char *separator = strchr(line, ':');
+    if (separator == NULL)
+        return;
+    int adressLength = separator - line;
+    for (int i = 0; i < amountMFC; i++) {
+        bool all = adressLength == 1 && line[0] == '*';
+        if (all || ((int)strlen(mfcAdresses[i]) == adressLength && strncmp(line, mfcAdresses[i], adressLength) == 0))
+            replyMfc(i, separator[1], separator + 2);
+    }
+}
+
+//Mit --program geht das Messprogramm in die Datei statt an die Schnittstelle
+static FILE *programOutput = NULL;
+static void feedBytes(const char data[], size_t length) {
+    if (programOutput != NULL)
+        fwrite(data, 1, length, programOutput);
+    else
+        Serial.feed(data, length);
+}
+
+static void feedLine(const char line[]) {
+    feedBytes(line, strlen(line));
+}
+
+//Im Fenstermodus beginnt jede Zeile mit ihrer Nummer, Frames werden nur gezaehlt
+static long sequence = 0;
+static void feedNumbered(const char line[]) {
+    if (window < 0) {
+        feedLine(line);
+        return;
+    }
+    char numbered[SERIAL_READ_MAX_LINE_SIZE + 16];
+    snprintf(numbered, sizeof(numbered), "<%ld,%s", ++sequence, line + 1);
+    feedLine(numbered);
+}
+static void feedFrame(char frame[], int type, int payload) {
+    feedBytes(frame, cmn::finishFrame(frame, type, payload));
+    sequence++;
+}
+
+//Events im Programm: reihum auf alle Kanaele, je Kanal alle spacing ms eines
+static void programEvent(long i, char *type, int *id, int *value, unsigned long *time) {
+    int channels = amountMFC + amountValve;
+    int channel = i % channels;
+    long step = i / channels;
+    *type = channel < amountMFC ? 'M' : 'V';
+    *id = channel < amountMFC ? channel : channel - amountMFC;
+    *value = *type == 'M' ? (step * 37) % 1000 : step % 2;
+    *time = 1000 + step * spacing;
+}
+
+//Event i als Datenstruktur, mit --ramp sind MFC-Events Rampen vom vorherigen Wert bis zu diesem
+static void programElement(long i, char *type, int *id, control::eventElement *event) {
+    programEvent(i, type, id, &event->value, &event->time);
+    event->rampStep = 0;
+    if (rampStep > 0 && *type == 'M') {
+        event->rampValue    = event->value;
+        event->rampDuration = spacing;
+        event->rampStep     = rampStep;
+        event->value        = 0;
+        if (i >= amountMFC + amountValve) {
+            char previousType;
+            int previousID;
+            unsigned long previousTime;
+            programEvent(i - amountMFC - amountValve, &previousType, &previousID, &event->value, &previousTime);
+        }
+        *type = 'R';
+    }
+}
+
+//Textzeile des Events i
+static void eventLine(long i, char line[], size_t size) {
+    char type;
+    int id;
+    control::eventElement event;
+    programElement(i, &type, &id, &event);
+    if (type == 'R')
+        snprintf(line, size, "<R,%d,%d,%d,%lu,%lu,%u>\n", id, event.value, event.rampValue, event.time,
+            event.rampDuration, event.rampStep);
+    else
+        snprintf(line, size, "<%c,%d,%d,%lu>\n", type, id, event.value, event.time);
+}
+
+//Dauer eines Durchlaufs der Eventliste, Periode des Blocks mit --repeat
+static unsigned long programPeriod() {
+    int channels = amountMFC + amountValve;
+    return (amountEvents + channels - 1) / channels * spacing;
+}
+
+//Anzahl der Schaltvorgaenge des ganzen Programms. Eine Rampe ueber spacing ms erzeugt ihre Schritte
+//bis zum naechsten Event des MFCs, die letzte auch den Zielwert
+static unsigned long dispatches = 0; //erwartete Schaltvorgaenge, siehe expectedDispatches()
+static unsigned long expectedDispatches() {
+    if (rampStep == 0)
+        return amountEvents * repeat;
+    long minStep = MFC_RAMP_MIN_STEP * 1000L / EVENT_TIME_UNIT; //wie MfcCtrl::setRamp()
+    long step = rampStep < minStep ? minStep : rampStep;
+    if (step > spacing)
+        step = spacing;
+    long steps = (spacing + step - 1) / step;
+    unsigned long dispatches = 0;
+    int channels = amountMFC + amountValve;
+    for (int channel = 0; channel < channels && channel < amountEvents; channel++) {
+        long events = (amountEvents - channel + channels - 1) / channels;
+        dispatches += channel < amountMFC ? events * steps + 1 : events;
+    }
+    return dispatches;
+}
+
+//Packt das ganze Programm wie die Eventspeicher der Steuerung (ohne Groessengrenze) und prueft, ob
+//die Events unveraendert (mit --repeat in jedem Durchlauf um die Periode verschoben) zurueckkommen.
+//Gibt die belegten Bytes zurueck, -1 bei einer Abweichung
+static long packedBytes() {
+    int channels = amountMFC + amountValve;
+    long bytes = 0;
+    for (int channel = 0; channel < channels; channel++) {
+        long events = (amountEvents - channel + channels - 1) / channels;
+        int valueBits = channel < amountMFC ? EVENT_VALUE_BITS_MFC : EVENT_VALUE_BITS_VALVE;
+        control::EventBuffer buffer;
+        int bufferBytes = events * control::EventBuffer::maxRampSize(valueBits) + 2 * EVENT_MAX_ENCODED_SIZE;
+        std::vector<uint8_t> memory(events > 0 ? bufferBytes : 0);
+        if (events <= 0 || !buffer.init(memory.data(), bufferBytes, valueBits))
+            continue;
+
+        control::eventElement event;
+        char type;
+        int id;
+        if (repeat > 1)
+            buffer.pushRepeat(repeat, programPeriod());
+        for (long i = channel; i < amountEvents; i += channels) {
+            programElement(i, &type, &id, &event);
+            buffer.push(event);
+        }
+        if (repeat > 1)
+            buffer.pushEndRepeat();
+        bytes += buffer.getUsed();
+        for (long pass = 0; pass < repeat; pass++) {
+            for (long i = channel; i < amountEvents; i += channels) {
+                programElement(i, &type, &id, &event);
+                event.time += pass * programPeriod();
+                control::eventElement popped = buffer.pop();
+                if (popped.value != event.value || popped.time != event.time || popped.rampStep != event.rampStep
+                        || (event.rampStep > 0 && (popped.rampValue != event.rampValue || popped.rampDuration != event.rampDuration)))
+                    return -1;
+            }
+        }
+        if (!buffer.isEmpty() || buffer.getPopped() != (unsigned long)events || buffer.getUsed() != 0)
+            return -1;
+    }
+    return bytes;
+}
+
+//Im Streaming-Modus gesendete Events, insgesamt und je Kanal
+static long fedEvents = 0;
+static long fedPerChannel[MAX_AMOUNT_MFC + MAX_AMOUNT_VALVE];
+static bool streamEnded = false;
+
+//Events des vollsten Kanals vor <start>, Angabe in Zeile 0 des Headers
+static long fullestChannel() {
+    int channels = amountMFC + amountValve;
+    long events = stream ? capacity * channels : amountEvents;
+    if (events > amountEvents)
+        events = amountEvents;
+    return (events + channels - 1) / channels;
+}
+
+//Sendet das Programm bis einschliesslich <end> bzw. im Streaming-Modus bis <stream>, dann nur die
+//ersten capacity Events je Kanal. 'declared' steht in Zeile 0 als Events des vollsten Kanals. Gibt
+//die Anzahl der Zeilen bzw. Frames zurueck, die mit "ok" beantwortet werden
+static long feedProgram(long declared) {
+    char line[SERIAL_READ_MAX_LINE_SIZE];
+    long replies = 0;
+    int channels = amountMFC + amountValve;
+
+    if (window >= 0) {
+        snprintf(line, sizeof(line), "<window,%d>\n", window);
+        feedLine(line);
+    }
+    snprintf(line, sizeof(line), "<%d,%d,%ld>\n", amountMFC, amountValve, declared);
+    feedNumbered(line);
+    char *out = line;
+    *out++ = '<';
+    for (int i = 0; i < amountMFC; i++) {
+        snprintf(mfcAdresses[i], sizeof(mfcAdresses[i]), "A%d", i);
+        out += sprintf(out, i > 0 ? ",%s" : "%s", mfcAdresses[i]);
+    }
+    strcpy(out, ">\n");
+    feedNumbered(line);
+    out = line;
+    *out++ = '<';
+    for (int i = 0; i < amountMFC; i++)
+        out += sprintf(out, i > 0 ? ",sim" : "sim");
+    strcpy(out, ">\n");
+    feedNumbered(line);
+    out = line;
+    *out++ = '<';
+    for (int i = 0; i < amountValve; i++) //Schieberegister und Expander zaehlen ihre Ausgaenge ab 0
+        out += sprintf(out, i > 0 ? ",%d" : "%d", VALVE_OUTPUT == VALVE_OUTPUT_GPIO ? 2 + i : i);
+    strcpy(out, ">\n");
+    feedNumbered(line);
+    snprintf(line, sizeof(line), "<%d>\n", intervall);
+    feedNumbered(line);
+    feedNumbered("<begin>\n");
+    replies += 6;
+
+    if (binary) {
+        feedNumbered("<binary>\n");
+        replies++;
+    } else if (repeat > 1) {
+        snprintf(line, sizeof(line), "<repeat,%ld,%lu>\n", repeat, programPeriod());
+        feedNumbered(line);
+        replies++;
+    }
+
+    long events = stream ? capacity * channels : amountEvents;
+    if (events > amountEvents)
+        events = amountEvents;
+    char frame[4 + SERIAL_READ_MAX_LINE_SIZE + 2];
+    int payload = 0;
+    for (long i = 0; i < events; i++) {
+        char type;
+        int id, value;
+        unsigned long time;
+        programEvent(i, &type, &id, &value, &time);
+        fedPerChannel[i % channels]++;
+
+        if (binary) {
+            char *record = &frame[4 + payload];
+            record = cmn::putLittleEndian(record, type, 1);
+            record = cmn::putLittleEndian(record, id, 1);
+            record = cmn::putLittleEndian(record, value, 2);
+            cmn::putLittleEndian(record, time, 4);
+            payload += SERIAL_BINARY_RECORD_SIZE;
+            if (payload + SERIAL_BINARY_RECORD_SIZE > SERIAL_READ_MAX_LINE_SIZE || i == events - 1) {
+                feedFrame(frame, SERIAL_BINARY_EVENTS, payload);
+                payload = 0;
+                replies++;
+            }
+        } else {
+            eventLine(i, line, sizeof(line));
+            feedNumbered(line);
+            replies++;
+        }
+    }
+
+    fedEvents = events;
+    if (repeat > 1) {
+        feedNumbered("<endrepeat>\n");
+        replies++;
+    }
+
+    //<stream> ersetzt <end>, nach dem Ende-Frame folgt es als Textzeile
+    if (binary) {
+        feedFrame(frame, SERIAL_BINARY_END, 0);
+        replies++;
+    }
+    if (stream) {
+        feedNumbered("<stream>\n");
+        replies++;
+    } else if (!binary) {
+        feedNumbered("<end>\n");
+        replies++;
+    }
+    return replies;
+}
+
+//Laedt waehrend der Messung nach, soweit der Kanal des naechsten Events nach der letzten Meldung
+//Platz hat, und beendet den Stream mit <end>
+static void feedStream() {
+    int channels = amountMFC + amountValve;
+    char line[SERIAL_READ_MAX_LINE_SIZE];
+    while (fedEvents < amountEvents) {
+        int channel = fedEvents % channels;
+        if (fedPerChannel[channel] - takenEvents[channel] >= capacity)
+            return;
+        eventLine(fedEvents, line, sizeof(line));
+        feedLine(line);
+        fedPerChannel[channel]++;
+        fedEvents++;
+    }
+    if (!streamEnded) {
+        feedLine("<end>\n");
+        streamEnded = true;
+    }
+}
+
+//SYNC_MODE_SLAVE: gespielter Master. Seine Uhr laeuft um 'drift' schneller, Taktpuls k liegt auf
+//seiner Uhr k * SYNC_PERIOD hinter dem Nullpunkt, START_LEAD hinter dem Startpuls
+static bool syncStarted = false;
+static unsigned long long syncStartEdge = 0; //Startpuls in virtueller Zeit
+static long syncIndex = 0;                   //naechster Taktpuls
+static long syncAlignMax = 0;                //groesste Abweichung der nachgefuehrten Uhr vor einem Taktpuls
+static unsigned long long masterToLocal(unsigned long long elapsed) {
+    return syncStartEdge + (unsigned long long)((START_LEAD + elapsed) / (1.0 + drift * 1e-6) + 0.5);
+}
+//Die Flanken kommen wie vom Master ohne Verzoegerung, auch wenn gerade loop() laeuft
+static void sendSyncPulse(unsigned long long time, unsigned long width) {
+    sim::scheduleEdge(SYNC_PIN, HIGH, time);
+    sim::scheduleEdge(SYNC_PIN, LOW, time + width);
+}
+static void sendSyncStart() {
+    syncStartEdge = sim::now();
+    syncIndex     = 0;
+    syncStarted   = true;
+    sendSyncPulse(syncStartEdge, SYNC_START_WIDTH);
+}
+//Zeitpunkt, zu dem der naechste Taktpuls geplant wird: eine halbe Periode vorher. Der Slave hat
+//dann den vorherigen ausgewertet, der naechste zeigt, wie weit er seitdem abgewichen ist
+static unsigned long long nextSyncAction() {
+    return masterToLocal((unsigned long long)syncIndex * SYNC_PERIOD) - SYNC_PERIOD / 2;
+}
+static void sendSyncPulses() {
+    if (!syncStarted || sim::now() < nextSyncAction())
+        return;
+    unsigned long long elapsed = (unsigned long long)syncIndex * SYNC_PERIOD;
+    if (syncIndex >= 2) {
+        long align = labs((long)(long long)(cmn::programMicros(syncStartEdge + START_LEAD, elapsed) - masterToLocal(elapsed)));
+        if (align > syncAlignMax)
+            syncAlignMax = align;
+    }
+    sendSyncPulse(masterToLocal(elapsed), SYNC_PULSE_WIDTH);
+    syncIndex++;
+}
+//Springt zum naechsten faelligen Thread, beim gespielten Master hoechstens bis zum naechsten Taktpuls
+static void skipToNext() {
+    if (main_thread_list == NULL)
+        return;
+    unsigned long deadline = main_thread_list->get_next_deadline();
+    if (syncStarted) {
+        unsigned long action = (unsigned long)nextSyncAction();
+        if ((long)(action - deadline) < 0)
+            deadline = action;
+    }
+    sim::skipTo(deadline);
+}
+
+//Laesst die Threads laufen, bis done() zutrifft oder die virtuelle Zeit limit (us) erreicht. Ist kein
+//Thread faellig, springt die Zeit zum naechsten. Gibt die Rechenzeit des PCs in ns zurueck
+static unsigned long long run(bool (*done)(), unsigned long long limit) {
+    unsigned long long hostStart = sim::hostNanos();
+    while (!done() && sim::now() < limit && main_thread_list != NULL) {
+        sendSyncPulses();
+        loop();
+        skipToNext();
+    }
+    return sim::hostNanos() - hostStart;
+}
+
+static long expectedReplies = 0;
+static bool uploadDone() {
+    if (window >= 0)
+        return ackedSequence >= sequence || errorReplies > 0;
+    return okReplies + errorReplies >= expectedReplies;
+}
+static bool uploadReplied() {
+    return uploadReply[0] != '\0';
+}
+static bool triggerReplied() {
+    return triggerReply[0] != '\0';
+}
+static bool stopDone() {
+    return stopped;
+}
+static bool rejectDone() { //nach dem abgelehnten Programm folgt "ready"
+    return readyReplies >= 2;
+}
+static bool listed() {
+    return listedFiles >= 0 || errorReplies > 0;
+}
+static bool downloadDone() {
+    return downloadEnded || errorReplies > 0;
+}
+static bool restarted() { //der Start setzt eventLatency zurueck
+    return eventLatency->getCount() < dispatches;
+}
+static bool syncReplied() {
+    return syncReply[0] != '\0';
+}
+static bool never() {
+    return false;
+}
+
+//Waehrend der Messung wird jeder Aufruf einzeln gemessen: ein Aufruf von loop() fuehrt genau einen
+//Thread aus, steigt dabei die Anzahl der Events, war es die Eventausfuehrung
+static unsigned long long dispatchTime = 0;
+static unsigned long long dispatchMax = 0;
+static unsigned long long runLimit = 0;
+static void runEvents() {
+    while (eventLatency->getCount() < dispatches && sim::now() < runLimit && main_thread_list != NULL) {
+        if (stream && !program)
+            feedStream();
+        sendSyncPulses();
+        unsigned long before = eventLatency->getCount();
+        unsigned long long start = sim::hostNanos();
+        loop();
+        unsigned long long duration = sim::hostNanos() - start;
+        if (eventLatency->getCount() != before) {
+            dispatchTime += duration;
+            if (duration > dispatchMax)
+                dispatchMax = duration;
+        }
+        skipToNext();
+    }
+}
+
+static void usage() {
+    printf("Aufruf: benchmark [--events N] [--mfc N] [--valves N] [--spacing ms] [--intervall ms]\n");
+    printf("                  [--scale x] [--binary] [--window N] [--stream] [--capacity N] [--sd Verzeichnis]\n");
+    printf("                  [--program] [--ramp ms] [--repeat N] [--uptime s] [--runs N] [--rearm] [--button]\n");
+    printf("                  [--download] [--reject] [--drift ppm] [--verbose]\n");
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--events") == 0 && hasValue)
+            amountEvents = atol(argv[++i]);
+        else if (strcmp(argv[i], "--mfc") == 0 && hasValue)
+            amountMFC = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--valves") == 0 && hasValue)
+            amountValve = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--spacing") == 0 && hasValue)
+            spacing = atol(argv[++i]);
+        else if (strcmp(argv[i], "--intervall") == 0 && hasValue)
+            intervall = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scale") == 0 && hasValue)
+            scale = atof(argv[++i]);
+        else if (strcmp(argv[i], "--window") == 0 && hasValue)
+            window = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capacity") == 0 && hasValue)
+            capacity = atol(argv[++i]);
+        else if (strcmp(argv[i], "--ramp") == 0 && hasValue)
+            rampStep = atol(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && hasValue)
+            repeat = atol(argv[++i]);
+        else if (strcmp(argv[i], "--uptime") == 0 && hasValue)
+            uptime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && hasValue)
+            runs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--rearm") == 0)
+            rearm = true;
+        else if (strcmp(argv[i], "--sd") == 0 && hasValue)
+            sdDirectory = argv[++i];
+        else if (strcmp(argv[i], "--program") == 0)
+            program = true;
+        else if (strcmp(argv[i], "--button") == 0)
+            button = true;
+        else if (strcmp(argv[i], "--download") == 0)
+            download = true;
+        else if (strcmp(argv[i], "--reject") == 0)
+            reject = true;
+        else if (strcmp(argv[i], "--drift") == 0 && hasValue)
+            drift = atof(argv[++i]);
+        else if (strcmp(argv[i], "--binary") == 0)
+            binary = true;
+        else if (strcmp(argv[i], "--stream") == 0)
+            stream = true;
+        else if (strcmp(argv[i], "--verbose") == 0)
+            verbose = true;
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (amountMFC < 0 || amountMFC > MAX_AMOUNT_MFC || amountValve < 0 || amountValve > MAX_AMOUNT_VALVE
+            || amountMFC + amountValve == 0 || amountEvents < 1 || spacing < 1 || intervall < 1 || capacity < 0
+            || ((program || download) && sdDirectory == NULL) || (program && window >= 0) || rampStep < 0 || (rampStep > 0 && binary)
+            || repeat < 1 || (repeat > 1 && (binary || stream || rampStep > 0)) || uptime < 0
+            || runs < 1 || (runs > 1 && (stream || program)) || (button && program) || (reject && (stream || program))
+            || (SYNC_MODE == SYNC_MODE_SLAVE && (button || program)) || fabs(drift) > SYNC_MAX_DRIFT) {
+        usage();
+        return 1;
+    }
+    dispatches = expectedDispatches();
+
+    //Antwort "capacity,N", wie in Main_LabCom
+    long storeCapacity = EVENT_STORE_BYTES / (amountMFC + amountValve) /
+        control::EventBuffer::maxEventSize(amountMFC > 0 ? EVENT_VALUE_BITS_MFC : EVENT_VALUE_BITS_VALVE);
+    if (capacity == 0 || capacity > storeCapacity)
+        capacity = storeCapacity;
+
+    if (sdDirectory != NULL)
+        sim::setSdDirectory(sdDirectory);
+    if (program) {
+        //Programm, <start> und im Streaming-Modus die restlichen Events mit <end>
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", sdDirectory, SD_PROGRAM_FILE);
+        programOutput = fopen(path, "wb");
+        if (programOutput == NULL) {
+            printf("%s kann nicht angelegt werden\n", path);
+            return 1;
+        }
+        feedProgram(fullestChannel());
+        feedLine("<start>\n");
+        if (stream) {
+            char line[SERIAL_READ_MAX_LINE_SIZE];
+            for (long i = fedEvents; i < amountEvents; i++) {
+                eventLine(i, line, sizeof(line));
+                feedLine(line);
+            }
+            feedLine("<end>\n");
+        }
+        fclose(programOutput);
+        programOutput = NULL;
+    }
+
+    sim::skipTo((unsigned long long)(uptime * 1e6));
+    sim::setCpuScale(scale);
+    Serial.setLineHandler(labViewLine); //USB (SERIAL_LABVIEW_USB)
+    Serial.setByteHandler(labViewByte);
+    Serial1.setLineHandler(debugLine);  //SERIAL_DEBUG_UART
+    Serial2.setLineHandler(uartLine);
+
+    setup();
+    size_t heapSetup = sim::heapInUse();
+
+    //ABLEHNEN eines Programms, das nicht sicher in den Eventspeicher passt, vor dem eigentlichen
+    bool rejectOk = !reject;
+    if (reject) {
+        feedProgram(storeCapacity + 1);
+        run(rejectDone, sim::now() + 10000000ULL);
+        rejectOk = rejectedReplies == 1 && errorReplies == 1 && readyReplies == 2 && arena->getUsed() == 0;
+        okReplies     = 0;
+        errorReplies  = 0;
+        ackReplies    = 0;
+        sequence      = 0;
+        ackedSequence = 0;
+        fedEvents     = 0;
+        for (int i = 0; i < amountMFC + amountValve; i++)
+            fedPerChannel[i] = 0;
+    }
+
+    //EINLESEN, mit --program liest die Steuerung selbst und startet die Messung
+    unsigned long long uploadStart = sim::now();
+    unsigned long long uploadHost = 0;
+    if (!program) {
+        expectedReplies = feedProgram(fullestChannel());
+        uploadHost = run(uploadDone, ~0ULL);
+    }
+    unsigned long long uploadVirtual = sim::now() - uploadStart;
+    size_t heapUpload = sim::heapInUse();
+
+    //Zeitmessung der Steuerung: Zeilen, Events, Bytes, Header-, Events-, Ende-, Rechenzeit (us), ...
+    //Mit --program erst nach der Messung, vorher liest die Steuerung nur die Datei
+    if (!program) {
+        feedNumbered("<upload>\n");
+        run(uploadReplied, sim::now() + 1000000ULL);
+    }
+
+    //MESSUNG, jede Wiederholung beginnt nach dem bestaetigten <stop> der vorherigen
+    long steps = (amountEvents + amountMFC + amountValve - 1) / (amountMFC + amountValve);
+    unsigned long long runHost = 0;
+    unsigned long long runVirtual = 0;
+    unsigned long long reloadMax = 0; //virtuelle Zeit von <rearm> bis zum letzten "ok"
+    unsigned long fired = 0;
+    unsigned long firedTotal = 0;
+    unsigned long firedMin = ~0UL;
+    long stoppedRuns = 0;
+    for (long r = 0; r < runs; r++) {
+        if (r > 0 && rearm) {
+            unsigned long long reloadStart = sim::now();
+            feedLine("<rearm>\n");
+            okReplies     = 0;
+            sequence      = 0;
+            ackedSequence = 0;
+            expectedReplies = feedProgram(fullestChannel());
+            run(uploadDone, ~0ULL);
+            if (sim::now() - reloadStart > reloadMax)
+                reloadMax = sim::now() - reloadStart;
+        } else if (r > 0) {
+            feedLine("<restart>\n");
+        }
+        if (SYNC_MODE == SYNC_MODE_SLAVE) { //auch nach <restart>, sobald er gelesen ist
+            syncStarted = false; //der Master beendet seinen Takt mit dem naechsten Startpuls
+            if (r > 0 && !rearm)
+                run(never, sim::now() + 20000ULL);
+            sendSyncStart();
+        } else if (!program && (r == 0 || rearm)) {
+            if (button) //der Interrupt haelt nur den Zeitpunkt fest, LabCom startet beim naechsten Blick
+                sim::triggerInterrupt(START_BUTTON_PIN);
+            else
+                feedNumbered("<start>\n");
+        }
+        if (r > 0) //bis LabCom den Start gelesen hat, zaehlt eventLatency noch die vorherige Messung
+            run(restarted, sim::now() + 1000000ULL);
+
+        stopped  = false;
+        runLimit = sim::now() + (7000 * 1000ULL + (unsigned long long)steps * spacing * repeat * EVENT_TIME_UNIT);
+        unsigned long long runStart = sim::now();
+        unsigned long long runHostStart = sim::hostNanos();
+        runEvents();
+        runHost += sim::hostNanos() - runHostStart;
+        runVirtual += sim::now() - runStart;
+
+        //eventLatency wird bei jedem Start zurueckgesetzt
+        fired = eventLatency->getCount();
+        firedTotal += fired;
+        if (fired < firedMin)
+            firedMin = fired;
+
+        if (r == runs - 1) {
+            printf("\nProfil der Threads (Rechenzeit des PCs):\n");
+            ConsolePrint console;
+            main_thread_list->print_profile(&console);
+        }
+
+        //ENDE, die restlichen Messzeilen gehen noch hinaus
+        feedLine("<stop>\n");
+        run(stopDone, sim::now() + 10000000ULL);
+        if (stopped)
+            stoppedRuns++;
+    }
+    if (program) {
+        feedLine("<upload>\n");
+        run(uploadReplied, sim::now() + 1000000ULL);
+    }
+    //Startsignal, Nullpunkt und erstes Event der letzten Messung
+    feedLine("<trigger>\n");
+    run(triggerReplied, sim::now() + 1000000ULL);
+    feedLine("<sync>\n");
+    run(syncReplied, sim::now() + 1000000ULL);
+
+    //DOWNLOAD der Messdatei, ganz und ab der Mitte, verglichen mit der Datei im Verzeichnis
+    bool downloadOk = !download;
+    unsigned long long downloadTime = 0;
+    unsigned long resumeOffset = 0;
+    if (download) {
+        feedLine("<ls>\n");
+        run(listed, sim::now() + 1000000ULL);
+
+        std::vector<char> stored;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", sdDirectory, listedFile);
+        FILE *file = listedFile[0] != '\0' ? fopen(path, "rb") : NULL;
+        if (file != NULL) {
+            int c;
+            while ((c = fgetc(file)) != EOF)
+                stored.push_back(c);
+            fclose(file);
+        }
+
+        downloadOk = file != NULL && (long)stored.size() == listedSize;
+        resumeOffset = stored.size() / 2 + 7; //mitten in einem Block
+        for (int pass = 0; pass < 2 && downloadOk; pass++) {
+            downloadOffset = pass == 0 ? 0 : resumeOffset;
+            downloaded.clear();
+            downloadEnded = false;
+            downloading   = true;
+            char line[64];
+            snprintf(line, sizeof(line), "<get,%s,%lu>\n", listedFile, downloadOffset);
+            unsigned long long downloadStart = sim::now();
+            feedLine(line);
+            run(downloadDone, sim::now() + 60000000ULL);
+            if (pass == 0)
+                downloadTime = sim::now() - downloadStart;
+            downloading = false;
+            downloadOk = downloadEnded && downloadErrors == 0 && downloaded.size() == stored.size() - downloadOffset
+                && std::equal(downloaded.begin(), downloaded.end(), stored.begin() + downloadOffset);
+        }
+    }
+    unsigned long uploadFields[10] = {0};
+    const char *field = uploadReply;
+    for (int i = 0; i < 10 && (field = strchr(field, ',')) != NULL; i++)
+        uploadFields[i] = strtoul(++field, NULL, 10);
+    //"trigger,Quelle,Vorlauf,Vorbereitung,Erstes-Event"
+    char triggerSource = triggerReplied() ? triggerReply[8] : '-';
+    long triggerFields[3] = {0};
+    field = &triggerReply[8];
+    for (int i = 0; i < 3 && (field = strchr(field, ',')) != NULL; i++)
+        triggerFields[i] = strtol(++field, NULL, 10);
+
+    printf("\nProgramm: %ld Events, %d MFCs, %d Ventile, alle %ld ms, Messintervall %d ms, %s, Zeitfaktor %.1f\n",
+        amountEvents, amountMFC, amountValve, spacing, intervall, binary ? "binaer" : "Text", scale);
+    if (!program)
+        printf("Einlesen:   %.1f ms PC, %.1f ms virtuell, %.0f Events/s (PC), %ld ok, %ld ack bis %ld, %ld Fehler\n",
+            uploadHost / 1e6, uploadVirtual / 1e3, uploadHost > 0 ? amountEvents * 1e9 / uploadHost : 0.0, okReplies,
+            ackReplies, ackedSequence, errorReplies);
+    printf("Steuerung:  Header %.1f ms, Events %.1f ms, <end> %.1f ms, %lu Events/s, %lu Byte/s, %lu us je Zeile (virtuell)\n",
+        uploadFields[3] / 1e3, uploadFields[4] / 1e3, uploadFields[5] / 1e3, uploadFields[7], uploadFields[8], uploadFields[9]);
+    printf("Messung:    %.1f ms PC, %.1f ms virtuell, %lu von %lu Events ausgefuehrt%s\n",
+        runHost / 1e6, runVirtual / 1e3, fired, dispatches, stopped ? "" : ", <stop> nicht bestaetigt");
+    printf("Start:      Startsignal %c, Nullpunkt %ld us danach, Threads nach %ld us bereit, erstes Event %ld us verzoegert\n",
+        triggerSource, triggerFields[0], triggerFields[1], triggerFields[2]);
+    if (runs > 1)
+        printf("Wiederholt: %ld Messungen mit %s, je Messung mindestens %lu von %lu Events, %ld mit \"stopped\"%s\n",
+            runs, rearm ? "<rearm>" : "<restart>", firedMin, dispatches, stoppedRuns,
+            rearm ? "" : " (kein neues Einlesen)");
+    if (runs > 1 && rearm)
+        printf("Neu laden:  hoechstens %.1f ms virtuell, %ld mal \"ready\", Speicher %lu Byte (new/delete)\n",
+            reloadMax / 1e3, readyReplies, (unsigned long)sim::heapInUse());
+    if (stream)
+        printf("Streaming:  %ld Events vor <start>, je Kanal hoechstens %ld vorraetig, %ld Meldungen, %ld abgelehnt\n",
+            capacity * (amountMFC + amountValve) < amountEvents ? capacity * (amountMFC + amountValve) : amountEvents,
+            capacity, streamReports, streamRejected);
+    printf("Ausfuehren: %.0f ns je Event, laengster Aufruf %.1f us (PC)\n",
+        firedTotal > 0 ? (double)dispatchTime / firedTotal : 0.0, dispatchMax / 1e3);
+    printf("Speicher:   %lu Byte nach setup(), %lu nach dem Einlesen, Hoechststand %lu (new/delete)\n",
+        (unsigned long)heapSetup, (unsigned long)heapUpload, (unsigned long)sim::heapPeak());
+    printf("Arena:      %lu von %lu Byte belegt, %lu frei, Hoechststand %lu, %lu Fehlschlaege\n",
+        (unsigned long)arena->getUsed(), (unsigned long)arena->getCapacity(), (unsigned long)arena->getFree(),
+        (unsigned long)arena->getPeak(), arena->getFailed());
+    long packed = packedBytes();
+    printf("Eventspeicher: %ld Byte fuer das ganze Programm gepackt, %.2f Byte je Event (ungepackt %d), je Kanal %ld Events sicher\n",
+        packed, (double)packed / amountEvents, 8, storeCapacity); //ungepackt: int und unsigned long des Teensys
+    printf("Nach <end>: %s, %s\n", eventsReply, ramReply);
+    //"sync,Modus,Pulse,Abweichung,Groesste,Drift-ppb"
+    long syncFields[4] = {0};
+    field = &syncReply[5];
+    for (int i = 0; i < 4 && (field = strchr(field, ',')) != NULL; i++)
+        syncFields[i] = strtol(++field, NULL, 10);
+    bool syncOk = SYNC_MODE == SYNC_MODE_OFF || (SYNC_MODE == SYNC_MODE_MASTER && syncFields[0] > 0)
+        || (syncFields[0] >= 2 && syncAlignMax < SYNC_MAX_ERROR && syncErrors == 0);
+    if (SYNC_MODE == SYNC_MODE_SLAVE)
+        printf("Synchron:   %ld Taktpulse, letzte Abweichung %ld us, groesste %ld us, Drift %.3f ppm (Master %+.3f ppm), vor dem Puls hoechstens %ld us daneben, %s\n",
+            syncFields[0], syncFields[1], syncFields[2], -syncFields[3] / 1000.0, drift, syncAlignMax, syncOk ? "ok" : "FEHLER");
+
+    else if (SYNC_MODE == SYNC_MODE_MASTER)
+        printf("Synchron:   Master, %ld Taktpulse ausgegeben, %s\n", syncFields[0], syncOk ? "ok" : "FEHLER");
+    if (reject)
+        printf("Abgelehnt:  %ld mal %d fuer %ld Events je Kanal, %s\n", rejectedReplies, ERR_PROGRAM_TOO_LARGE,
+            storeCapacity + 1, rejectOk ? "danach \"ready\"" : "FEHLER");
+    printf("Ausgaben:   LabView %llu Byte (%ld Frames), SD %llu Byte, %lu Pinwechsel, %lu Byte an Schieberegister\n",
+        Serial.getBytesWritten(), labViewFrames, sim::sdBytesWritten(), sim::pinToggles(), VALVE_SHIFT_SPI.transferred);
+    if (download)
+        printf("Download:   %s, %ld Byte, %.1f ms virtuell, %ld Frames, fortgesetzt ab %lu, %s\n",
+            listedFile, listedSize, downloadTime / 1e3, downloadFrames, resumeOffset,
+            downloadOk ? "stimmt mit der Datei ueberein" : "FEHLER");
+    printf("Schaltverzoegerung (virtuell): Min %ld us, Max %ld us, Mittel %ld us\n",
+        eventLatency->getMin(), eventLatency->getMax(), eventLatency->getMean());
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        if (eventLatency->getBucket(i) == 0)
+            continue;
+        if (i == 0)
+            printf("    < 1 us: %lu\n", eventLatency->getBucket(i));
+        else if (i == LATENCY_BUCKETS - 1)
+            printf("  >= %ld us: %lu\n", 1L << (i - 1), eventLatency->getBucket(i));
+        else
+            printf("  < %ld us: %lu\n", 1L << i, eventLatency->getBucket(i));
+    }
+    //<restart> kommt von LabView, auch wenn der erste Start mit dem Taster war
+    bool startOk = triggerSource == (SYNC_MODE == SYNC_MODE_SLAVE ? 'S' : (runs > 1 && !rearm) ? 'L' : button ? 'T' : program ? 'F' : 'L');
+    return firedMin >= dispatches && stoppedRuns == runs && errorReplies == 0 && streamRejected == 0 && packed >= 0
+        && startOk && downloadOk && rejectOk && syncOk && eventsReply[0] != '\0' ? 0 : 2;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Uebersetzt die Steuerung mit der Nachbildung in sim/hal fuer den PC und erzeugt sim/benchmark.
+# Es werden dieselben Quellen wie auf dem Teensy verwendet (controller.ino, src, mthread), nur ohne
+# KINETISK. Moegliche Variablen: CXX (Compiler), CXXFLAGS (zusaetzliche Optionen)
+#
+# Aufruf: sh build.sh && ./benchmark --events 100000
+
+set -e
+cd "$(dirname "$0")"
+
+CXX=${CXX:-g++}
+FLAGS="-std=gnu++14 -O2 -g -Wall"
+# ARDUINO: mthread bindet Arduino.h ein, MTHREAD_PROFILE: Rechenzeit je Thread, SIM_EVENT_STORE_BYTES: Eventspeicher
+DEFS="-DARDUINO=10800 -DMTHREAD_PROFILE=1 -DSIM_EVENT_STORE_BYTES=2097152"
+INCLUDES="-Ihal -I../libraries/mthread-master"
+
+SOURCES="benchmark.cpp hal/arduino.cpp hal/sd.cpp ../libraries/mthread-master/mthread.cpp ../src/*.cpp ../src/ownlibs/*.cpp"
+
+# controller.ino wird als C++ uebersetzt, wie es die Arduino-IDE tut
+$CXX $FLAGS $DEFS $INCLUDES $CXXFLAGS -x c++ -include Arduino.h ../controller.ino -x none $SOURCES -o benchmark
+echo "sim/benchmark erstellt"
@@ -0,0 +1,157 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Nachbildung der Arduino-/Teensy-Schnittstellen fuer die Simulation auf dem PC (siehe sim/build.sh).
+// Es wird nur nachgebildet, was controller/src und mthread verwenden. Die Zeit ist virtuell: sie
+// laeuft mit der Rechenzeit des PCs (mal sim::setCpuScale()) und springt, wenn kein Thread faellig
+// ist, direkt zum naechsten Zeitpunkt (sim::skipTo()). Es wird ohne KINETISK uebersetzt, also mit
+// den Pfaden ohne Hardware-Timer, CMSIS und I2C-Interrupt.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.1415926535897932384626433832795
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define F_CPU 180000000
+#define F(x) (x)
+#define B00010000 16
+#define B00100000 32
+#define B01000000 64
+#define SIM_PINS 64
+#define SIM_EDGES 8
+#define NUM_DIGITAL_PINS SIM_PINS
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+namespace sim {
+    //Virtuelle Zeit in us seit dem Start der Simulation
+    unsigned long long now();
+    //Die Zeit laeuft mit der Rechenzeit des PCs mal scale (z.B. 10, wenn der Teensy 10x langsamer ist)
+    void setCpuScale(double scale);
+    //Springt vorwaerts auf time (micros()), falls dieser Zeitpunkt noch nicht erreicht ist
+    void skipTo(unsigned long time);
+    //Monotone Zeit des PCs in ns, Zeitbasis des Profilers
+    unsigned long long hostNanos();
+    //Mit new belegter Speicher, aktuell und Hoechststand
+    size_t heapInUse();
+    size_t heapPeak();
+    //Zustand eines Pins (digitalWrite) und Anzahl der Schaltvorgaenge
+    int pinState(int pin);
+    unsigned long pinToggles();
+    //Loest den mit attachInterrupt() eingerichteten Interrupt eines Pins aus (z.B. den Taster)
+    void triggerInterrupt(int pin);
+    //Setzt den Pin zum Zeitpunkt time (now()) auf value und loest seinen Interrupt aus. Er laeuft beim
+    //ersten micros() danach, sieht dort aber genau time, wie bei einem Interrupt ohne Verzoegerung.
+    //Hoechstens SIM_EDGES Flanken in zeitlicher Reihenfolge
+    void scheduleEdge(int pin, int value, unsigned long long time);
+}
+
+//Profiler von mthread misst mit der Zeit des PCs, die virtuelle Zeit steht waehrend eines loop()
+#define MTHREAD_PROFILE_TICKS() sim::hostNanos()
+#define MTHREAD_PROFILE_TICKS_PER_US 1000
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void attachInterrupt(uint8_t interrupt, void (*function)(void), int mode);
+void interrupts();
+void noInterrupts();
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh);
+#define digitalPinToInterrupt(p) (p)
+
+//Nur die Konstruktoren, die in controller/src vorkommen
+class String {
+public:
+    String(const char *s = "") { strncpy(this->text, s, sizeof(this->text) - 1); this->text[sizeof(this->text) - 1] = '\0'; }
+    const char *c_str() const { return this->text; }
+private:
+    char text[64];
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) { size_t n = 0; while (size--) n += this->write(*buffer++); return n; }
+    size_t write(const char *s) { return this->write((const uint8_t *)s, strlen(s)); }
+    virtual int availableForWrite() { return 0; }
+    size_t print(const String &s) { return this->write(s.c_str()); }
+    size_t print(const char s[]) { return this->write(s); }
+    size_t print(char c) { return this->write((uint8_t)c); }
+    size_t print(unsigned char v, int base = 10) { return this->print((unsigned long)v, base); }
+    size_t print(int v, int base = 10) { return this->print((long)v, base); }
+    size_t print(unsigned int v, int base = 10) { return this->print((unsigned long)v, base); }
+    size_t print(long v, int base = 10) { char t[24]; snprintf(t, sizeof(t), base == 16 ? "%lx" : "%ld", v); return this->write(t); }
+    size_t print(unsigned long v, int base = 10) { char t[24]; snprintf(t, sizeof(t), base == 16 ? "%lx" : "%lu", v); return this->write(t); }
+    size_t print(double v, int digits = 2) { char t[32]; snprintf(t, sizeof(t), "%.*f", digits, v); return this->write(t); }
+    size_t println() { return this->write("\r\n"); }
+    template <typename T> size_t println(T v) { size_t n = this->print(v); return n + this->println(); }
+    template <typename T> size_t println(T v, int base) { size_t n = this->print(v, base); return n + this->println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+
+// Serielle Schnittstelle: Eingaben kommen aus feed(), Ausgaben werden gezaehlt und zeilenweise an
+// einen optionalen Empfaenger gegeben. Die Ausgabe wartet nie (availableForWrite() ist immer gross)
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial();
+    ~HardwareSerial();
+    void begin(unsigned long baud) {}
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    virtual int availableForWrite() { return 4096; }
+    operator bool() { return true; }
+
+    //Haengt length Zeichen an die Eingabe an
+    void feed(const char data[], size_t length);
+    //Zeichen, die noch nicht gelesen wurden
+    size_t pending();
+    //Wird mit jeder ausgegebenen Zeile (ohne Zeilenende) aufgerufen
+    void setLineHandler(void (*handler)(const char line[]));
+    //Erhaelt vorher jedes Byte, gibt er true zurueck, gehoert es zu keiner Zeile (Binaerframes)
+    void setByteHandler(bool (*handler)(uint8_t c));
+    unsigned long long getBytesWritten() { return this->bytesWritten; }
+private:
+    char *input;
+    size_t inputSize;
+    size_t inputLength;
+    size_t inputPosition;
+    char line[1024];
+    size_t lineLength;
+    void (*lineHandler)(const char line[]);
+    bool (*byteHandler)(uint8_t c);
+    unsigned long long bytesWritten;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif
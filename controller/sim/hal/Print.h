@@ -0,0 +1,6 @@
+#ifndef SIM_PRINT_H
+#define SIM_PRINT_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SIM_SD_H
+#define SIM_SD_H
+
+#include "Arduino.h"
+
+// SD-Karte fuer die Simulation: Dateien landen im Verzeichnis von sim::setSdDirectory() und werden
+// von dort gelesen (Messprogramm, <get>), ohne Verzeichnis werden die Daten nur gezaehlt und es gibt
+// keine Dateien zum Lesen. Nachgebildet ist nur, was StoreD, ProgramFile und FileTransfer verwenden.
+
+#define SD_CHIP_SELECT_PIN 10
+#define SPI_FULL_SPEED 0
+#define O_READ 0x01
+#define O_WRITE 0x02
+#define O_CREAT 0x10
+#define O_EXCL 0x20
+#define DIR_IS_FILE(entry) (true)
+
+namespace sim {
+    //Verzeichnis fuer die Dateien der Karte, NULL verwirft die Daten
+    void setSdDirectory(const char path[]);
+    //Auf die Karte geschriebene Bytes
+    unsigned long long sdBytesWritten();
+}
+
+typedef struct {
+    uint8_t name[11]; //8.3-Format ohne Punkt, mit Leerzeichen aufgefuellt
+    uint32_t fileSize;
+} dir_t;
+
+class Sd2Card;
+
+class SdVolume {
+public:
+    bool init(Sd2Card *card) { return true; }
+};
+
+class SdFile {
+public:
+    SdFile();
+    bool openRoot(SdVolume *volume) { return true; }
+    void rewind() { this->dirIndex = 0; }
+    //Dateien im Verzeichnis von sim::setSdDirectory(), deren Namen ins 8.3-Format passen
+    int8_t readDir(dir_t *entry);
+    bool open(SdFile *directory, const char name[], uint8_t flags);
+    bool createContiguous(SdFile *directory, const char name[], uint32_t size);
+    bool contiguousRange(uint32_t *beginBlock, uint32_t *endBlock);
+    bool remove();
+    bool truncate(uint32_t length);
+    bool sync();
+    bool close();
+    size_t write(const uint8_t *buffer, size_t size);
+    int16_t read(void *buffer, uint16_t size);
+    bool seekSet(uint32_t position);
+    uint32_t fileSize() const;
+private:
+    FILE *file;
+    uint32_t size; //createContiguous()
+    long dirIndex; //naechster Eintrag von readDir()
+
+    friend class Sd2Card;
+};
+
+class Sd2Card {
+public:
+    bool init(uint8_t speed, uint8_t chipSelect) { return true; }
+    //Mehrblock-Schreiben geht in die zuletzt mit createContiguous() angelegte Datei
+    bool writeStart(uint32_t block, uint32_t count);
+    bool writeData(const uint8_t *data);
+    bool writeStop() { return true; }
+    //Bloecke gibt es nur fuer die zuletzt angelegte Datei, nicht zum Lesen
+    bool readBlock(uint32_t block, uint8_t *data) { return false; }
+};
+
+#endif
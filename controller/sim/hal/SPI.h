@@ -0,0 +1,31 @@
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+// SPI ohne Geraete: die Schieberegister der Ventile (VALVE_OUTPUT_SHIFT_REGISTER) nehmen jedes
+// Byte an, gezaehlt werden nur die uebertragenen Bytes
+class SPISettings {
+public:
+    SPISettings() {}
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {}
+};
+
+class SPIClass {
+public:
+    void begin() {}
+    void setMOSI(uint8_t pin) {}
+    void setSCK(uint8_t pin) {}
+    void beginTransaction(SPISettings settings) {}
+    uint8_t transfer(uint8_t data) { this->transferred++; return 0; }
+    void endTransaction() {}
+    unsigned long transferred = 0;
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1; //eigener Bus der Schieberegister (VALVE_SHIFT_SPI)
+
+#endif
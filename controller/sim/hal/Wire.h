@@ -0,0 +1,25 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+// I2C ohne Geraete: Display und Boschsensor bestaetigen jede Uebertragung, gelesen wird 0
+class TwoWire : public Stream {
+public:
+    void begin() {}
+    void setClock(uint32_t clock) {}
+    void beginTransmission(uint8_t adress) {}
+    uint8_t endTransmission(uint8_t stop = 1) { return 0; }
+    uint8_t requestFrom(uint8_t adress, uint8_t length, uint8_t stop = 1) { this->rxLength = length; return length; }
+    virtual size_t write(uint8_t c) { return 1; }
+    using Print::write;
+    virtual int available() { return this->rxLength; }
+    virtual int read() { if (this->rxLength == 0) return -1; this->rxLength--; return 0; }
+    virtual int peek() { return this->rxLength > 0 ? 0 : -1; }
+private:
+    int rxLength = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
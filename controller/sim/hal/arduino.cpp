@@ -0,0 +1,265 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include "SPI.h"
+
+#include <new>
+#include <time.h>
+
+//////////////////// ZEIT ////////////////////
+
+static unsigned long long hostStart = 0;
+static unsigned long long skipped = 0; //uebersprungene Leerlaufzeit in us
+static double cpuScale = 1.0;
+static void fireEdges();
+static bool inEdge = false;         //Interrupt einer geplanten Flanke laeuft
+static unsigned long long edgeTime; //seine Zeit
+
+namespace sim {
+    unsigned long long hostNanos() {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (unsigned long long)t.tv_sec * 1000000000ULL + t.tv_nsec;
+    }
+
+    unsigned long long now() {
+        if (hostStart == 0)
+            hostStart = hostNanos();
+        return (unsigned long long)((hostNanos() - hostStart) * cpuScale / 1000.0) + skipped;
+    }
+
+    void setCpuScale(double scale) {
+        //Die bisherige Zeit bleibt erhalten, nur der weitere Verlauf aendert sich
+        unsigned long long current = now();
+        cpuScale = scale;
+        hostStart = hostNanos();
+        skipped = current;
+    }
+
+    void skipTo(unsigned long time) {
+        long ahead = (long)(time - micros());
+        if (ahead > 0)
+            skipped += ahead;
+    }
+}
+
+unsigned long millis() {
+    return sim::now() / 1000;
+}
+
+unsigned long micros() {
+    if (inEdge)
+        return edgeTime;
+    fireEdges();
+    return sim::now();
+}
+
+void delay(unsigned long ms) {
+    sim::skipTo(micros() + ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::skipTo(micros() + us);
+}
+
+//////////////////// PINS ////////////////////
+
+static int pins[SIM_PINS];
+static unsigned long toggles = 0;
+static void (*interruptHandlers[SIM_PINS])(void);
+
+static struct {
+    int pin;
+    int value;
+    unsigned long long time;
+} edges[SIM_EDGES];
+static int edgeCount = 0;
+
+static void fireEdges() {
+    while (edgeCount > 0 && edges[0].time <= sim::now()) {
+        int pin = edges[0].pin;
+        edgeTime = edges[0].time;
+        digitalWrite(pin, edges[0].value);
+        edgeCount--;
+        memmove(&edges[0], &edges[1], edgeCount * sizeof(edges[0]));
+
+        inEdge = true;
+        sim::triggerInterrupt(pin);
+        inEdge = false;
+    }
+}
+
+namespace sim {
+    int pinState(int pin) {
+        return pin >= 0 && pin < SIM_PINS ? pins[pin] : 0;
+    }
+
+    unsigned long pinToggles() {
+        return toggles;
+    }
+
+    void triggerInterrupt(int pin) {
+        if (pin >= 0 && pin < SIM_PINS && interruptHandlers[pin] != NULL)
+            interruptHandlers[pin]();
+    }
+
+    void scheduleEdge(int pin, int value, unsigned long long time) {
+        if (edgeCount >= SIM_EDGES || pin < 0 || pin >= SIM_PINS)
+            return;
+        edges[edgeCount].pin   = pin;
+        edges[edgeCount].value = value;
+        edges[edgeCount].time  = time;
+        edgeCount++;
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= SIM_PINS)
+        return;
+    if (pins[pin] != (value ? 1 : 0))
+        toggles++;
+    pins[pin] = value ? 1 : 0;
+}
+
+int digitalRead(uint8_t pin) {
+    return sim::pinState(pin);
+}
+
+void analogWrite(uint8_t pin, int value) {}
+void attachInterrupt(uint8_t interrupt, void (*function)(void), int mode) {
+    //digitalPinToInterrupt() ist die Pinnummer
+    if (interrupt < SIM_PINS)
+        interruptHandlers[interrupt] = function;
+}
+void interrupts() {}
+void noInterrupts() {}
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+    return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+//////////////////// SPEICHER ////////////////////
+
+static size_t heapUsed = 0;
+static size_t heapMax = 0;
+
+namespace sim {
+    size_t heapInUse() {
+        return heapUsed;
+    }
+
+    size_t heapPeak() {
+        return heapMax;
+    }
+}
+
+//Vor jedem Block steht seine Groesse (16 Byte, damit die Ausrichtung erhalten bleibt)
+static void *allocate(size_t size) {
+    size_t *block = (size_t *)malloc(size + 16);
+    if (block == NULL)
+        throw std::bad_alloc();
+    block[0] = size;
+    heapUsed += size;
+    if (heapUsed > heapMax)
+        heapMax = heapUsed;
+    return (char *)block + 16;
+}
+
+static void release(void *ptr) {
+    if (ptr == NULL)
+        return;
+    size_t *block = (size_t *)((char *)ptr - 16);
+    heapUsed -= block[0];
+    free(block);
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *ptr) noexcept { release(ptr); }
+void operator delete[](void *ptr) noexcept { release(ptr); }
+void operator delete(void *ptr, size_t size) noexcept { release(ptr); }
+void operator delete[](void *ptr, size_t size) noexcept { release(ptr); }
+
+//////////////////// SERIELL ////////////////////
+
+HardwareSerial::HardwareSerial() {
+    this->input = NULL;
+    this->inputSize = 0;
+    this->inputLength = 0;
+    this->inputPosition = 0;
+    this->lineLength = 0;
+    this->lineHandler = NULL;
+    this->byteHandler = NULL;
+    this->bytesWritten = 0;
+}
+HardwareSerial::~HardwareSerial() {
+    free(this->input);
+}
+
+int HardwareSerial::available() {
+    return this->inputLength - this->inputPosition;
+}
+
+int HardwareSerial::read() {
+    if (this->inputPosition >= this->inputLength)
+        return -1;
+    return (unsigned char)this->input[this->inputPosition++];
+}
+
+int HardwareSerial::peek() {
+    if (this->inputPosition >= this->inputLength)
+        return -1;
+    return (unsigned char)this->input[this->inputPosition];
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    this->bytesWritten++;
+    if (this->byteHandler != NULL && this->byteHandler(c))
+        return 1;
+    if (c == '\n' || this->lineLength >= sizeof(this->line) - 1) {
+        while (this->lineLength > 0 && this->line[this->lineLength - 1] == '\r')
+            this->lineLength--;
+        this->line[this->lineLength] = '\0';
+        if (this->lineHandler != NULL)
+            this->lineHandler(this->line);
+        this->lineLength = 0;
+    } else {
+        this->line[this->lineLength++] = c;
+    }
+    return 1;
+}
+
+void HardwareSerial::feed(const char data[], size_t length) {
+    //Gelesene Zeichen werden verworfen, bevor der Puffer wachsen muss
+    if (this->inputPosition > 0) {
+        memmove(this->input, &this->input[this->inputPosition], this->inputLength - this->inputPosition);
+        this->inputLength -= this->inputPosition;
+        this->inputPosition = 0;
+    }
+    if (this->inputLength + length > this->inputSize) {
+        this->inputSize = (this->inputLength + length) * 2;
+        this->input = (char *)realloc(this->input, this->inputSize);
+    }
+    memcpy(&this->input[this->inputLength], data, length);
+    this->inputLength += length;
+}
+
+size_t HardwareSerial::pending() {
+    return this->inputLength - this->inputPosition;
+}
+
+void HardwareSerial::setLineHandler(void (*handler)(const char line[])) {
+    this->lineHandler = handler;
+}
+
+void HardwareSerial::setByteHandler(bool (*handler)(uint8_t c)) {
+    this->byteHandler = handler;
+}
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+TwoWire Wire;
+SPIClass SPI;
+SPIClass SPI1;
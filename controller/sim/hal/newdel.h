@@ -0,0 +1,8 @@
+#ifndef SIM_NEWDEL_H
+#define SIM_NEWDEL_H
+
+// new und delete kommen von der Standardbibliothek, sim/hal/arduino.cpp ersetzt sie, um den
+// belegten Speicher zu zaehlen
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,151 @@
+#include "SD.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *sdDirectory = NULL;
+static unsigned long long sdBytes = 0;
+static SdFile *rawTarget = NULL; //Ziel von Sd2Card::writeData()
+
+namespace sim {
+    void setSdDirectory(const char path[]) {
+        sdDirectory = path;
+    }
+
+    unsigned long long sdBytesWritten() {
+        return sdBytes;
+    }
+}
+
+SdFile::SdFile() {
+    this->file     = NULL;
+    this->size     = 0;
+    this->dirIndex = 0;
+}
+
+int8_t SdFile::readDir(dir_t *entry) {
+    if (sdDirectory == NULL)
+        return 0;
+    DIR *directory = opendir(sdDirectory);
+    if (directory == NULL)
+        return -1;
+
+    //Die Position wird als Anzahl gelesener Eintraege gefuehrt, das Verzeichnis jedes Mal neu geoeffnet
+    int8_t result = 0;
+    struct dirent *item;
+    for (long index = 0; result == 0 && (item = readdir(directory)) != NULL; index++) {
+        if (index < this->dirIndex)
+            continue;
+        this->dirIndex = index + 1;
+
+        const char *dot = strchr(item->d_name, '.');
+        int baseLength = dot ? dot - item->d_name : strlen(item->d_name);
+        int extLength  = dot ? strlen(dot + 1) : 0;
+        char path[512];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", sdDirectory, item->d_name);
+        if (baseLength == 0 || baseLength > 8 || extLength > 3 || stat(path, &info) != 0 || !S_ISREG(info.st_mode))
+            continue;
+
+        memset(entry->name, ' ', sizeof(entry->name));
+        memcpy(entry->name, item->d_name, baseLength);
+        if (dot)
+            memcpy(&entry->name[8], dot + 1, extLength);
+        entry->fileSize = info.st_size;
+        result = sizeof(dir_t);
+    }
+    closedir(directory);
+    return result;
+}
+
+bool SdFile::open(SdFile *directory, const char name[], uint8_t flags) {
+    this->size = 0;
+    if (sdDirectory != NULL) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", sdDirectory, name);
+        this->file = fopen(path, (flags & O_WRITE) ? "wb" : "rb");
+        return this->file != NULL;
+    }
+    return (flags & O_WRITE) != 0;
+}
+
+bool SdFile::createContiguous(SdFile *directory, const char name[], uint32_t size) {
+    if (!this->open(directory, name, O_CREAT | O_WRITE))
+        return false;
+    this->size = size;
+    rawTarget = this;
+    return true;
+}
+
+bool SdFile::contiguousRange(uint32_t *beginBlock, uint32_t *endBlock) {
+    //nur die mit createContiguous() angelegte Datei, gelesen wird ueber das Dateisystem
+    if (this->size == 0)
+        return false;
+    *beginBlock = 0;
+    *endBlock = this->size / 512 - 1;
+    return true;
+}
+
+bool SdFile::remove() {
+    return this->close();
+}
+
+bool SdFile::truncate(uint32_t length) {
+    if (this->file != NULL) {
+        fflush(this->file);
+        return ftruncate(fileno(this->file), length) == 0;
+    }
+    return true;
+}
+
+bool SdFile::sync() {
+    if (this->file != NULL)
+        fflush(this->file);
+    return true;
+}
+
+bool SdFile::close() {
+    if (this->file != NULL)
+        fclose(this->file);
+    this->file = NULL;
+    if (rawTarget == this)
+        rawTarget = NULL;
+    return true;
+}
+
+size_t SdFile::write(const uint8_t *buffer, size_t size) {
+    sdBytes += size;
+    if (this->file != NULL)
+        return fwrite(buffer, 1, size, this->file);
+    return size;
+}
+
+int16_t SdFile::read(void *buffer, uint16_t size) {
+    if (this->file == NULL)
+        return -1;
+    return fread(buffer, 1, size, this->file);
+}
+
+bool SdFile::seekSet(uint32_t position) {
+    return this->file != NULL && fseek(this->file, position, SEEK_SET) == 0;
+}
+
+uint32_t SdFile::fileSize() const {
+    if (this->file == NULL)
+        return 0;
+    long position = ftell(this->file);
+    fseek(this->file, 0, SEEK_END);
+    long size = ftell(this->file);
+    fseek(this->file, position, SEEK_SET);
+    return size;
+}
+
+bool Sd2Card::writeStart(uint32_t block, uint32_t count) {
+    return rawTarget != NULL;
+}
+
+bool Sd2Card::writeData(const uint8_t *data) {
+    rawTarget->write(data, 512);
+    return true;
+}
@@ -2,63 +2,390 @@
 
 namespace storage {
     StoreD::StoreD() {
+        this->cardReady        = false;
+        this->cardShared       = false;
+        this->nextFilenumber   = 1;
+        this->rawRequested     = false;
+        this->fileBytes        = 0;
+        this->fileHeaderLength = 0;
 
+        this->ready           = false;
+        this->armed           = false;
+        this->activeBlock     = 0;
+        this->fillLevel       = 0;
+        this->flushPending    = false;
+        this->blocksSinceSync = 0;
+        this->syncPending     = false;
+        this->rawMode         = false;
+        this->bytesStored     = 0;
+
+        this->blocksWritten     = 0;
+        this->maxWriteLatency   = 0;
+        this->totalWriteLatency = 0;
+        this->overruns          = 0;
     }
     StoreD::~StoreD() {
 
     }
-    void StoreD::detFilenumber(int filenumber, char filename){
-      /*filenumber = 1;
-      if (filenumber != 1) {
-        while (SD.exists(filename)) {
-          filenumber++;
+
+    bool StoreD::begin() {
+        if (this->cardReady)
+            return true;
+
+        if (!this->card.init(SPI_FULL_SPEED, SD_CS_PIN) || !this->volume.init(&this->card) || !this->root.openRoot(&this->volume)) {
+            srl->errorln("ERROR - SD-Karte nicht gefunden");
+            return false;
+        }
+
+        //Einziger Durchlauf durch das Verzeichnis: hoechste vorhandene Nummer suchen. Namen stehen
+        //im 8.3-Format ohne Punkt im Eintrag, z.B. "LOG00012BIN"
+        int prefixLength = strlen(SD_FILE_PREFIX);
+        long highest = 0;
+        dir_t entry;
+        this->root.rewind();
+        while (this->root.readDir(&entry) > 0) {
+            if (!DIR_IS_FILE(&entry) || memcmp(entry.name, SD_FILE_PREFIX, prefixLength) != 0)
+                continue;
+
+            long number = 0;
+            int i = prefixLength;
+            for (; i < 8 && entry.name[i] >= '0' && entry.name[i] <= '9'; i++)
+                number = number * 10 + (entry.name[i] - '0');
+            if (i == 8 && number > highest)
+                highest = number;
+        }
+        this->nextFilenumber = highest + 1;
+        this->cardReady = true;
+
+        srl->info("SD: naechste Dateinummer ");
+        srl->infoln(this->nextFilenumber);
+        return true;
+    }
+
+    bool StoreD::openForReading(SdFile *file, const char name[]) {
+        if (!this->begin())
+            return false;
+        return file->open(&this->root, name, O_READ);
+    }
+
+    bool StoreD::readDir(dir_t *entry, bool first) {
+        if (!this->begin())
+            return false;
+        if (first)
+            this->root.rewind();
+        while (this->root.readDir(entry) > 0) {
+            if (DIR_IS_FILE(entry))
+                return true;
+        }
+        return false;
+    }
+
+    bool StoreD::readBlock(uint32_t block, uint8_t data[]) {
+        return this->cardReady && this->card.readBlock(block, data);
+    }
+
+    bool StoreD::isBusy() {
+        return this->armed || this->ready;
+    }
+
+    void StoreD::setCardShared(bool shared) {
+        this->cardShared = shared;
+    }
+
+    void StoreD::setFileHeader(const char data[], int length) {
+        if (length > SD_FILE_HEADER_MAX_SIZE)
+            length = SD_FILE_HEADER_MAX_SIZE;
+        memcpy(this->fileHeader, data, length);
+        this->fileHeaderLength = length;
+    }
+
+    bool StoreD::arm(int intervall) {
+        if (this->armed)
+            return true;
+        if (!this->begin())
+            return false;
+
+        this->rawRequested = intervall <= SD_RAW_STREAMING_INTERVALL && !this->cardShared;
+        if (!this->openFile())
+            return false;
+
+        this->armed = true;
+        return true;
+    }
+
+    void StoreD::disarm() {
+        if (!this->armed)
+            return;
+        this->armed = false;
+
+        //Die Datei ist noch leer und wird nicht aufgehoben
+        if (this->rawMode) {
+            this->card.writeStop();
+            this->rawFile.remove();
+            this->rawMode = false;
+        } else {
+            this->dataFile.remove();
+        }
+    }
+
+    bool StoreD::start(int intervall) {
+        if (!this->arm(intervall))
+            return false;
+
+        //Der Dateikopf enthaelt die Startzeit und wird erst jetzt geschrieben
+        this->armed = false;
+        this->beginFile();
+        this->ready = true;
+        return true;
+    }
+
+    bool StoreD::openFile() {
+        if (this->nextFilenumber > SD_FILE_MAX_NUMBER) {
+            srl->errorln("ERROR - Keine freie Dateinummer auf der SD-Karte");
+            return false;
         }
-    }*/
+
+        //8.3-Name: Praefix, Nummer mit Nullen auf 8 Zeichen, Endung (ohne sprintf)
+        char filename[13];
+        memcpy(filename, SD_FILE_PREFIX, sizeof(SD_FILE_PREFIX) - 1);
+        char *out = cmn::formatZeroPadded(&filename[sizeof(SD_FILE_PREFIX) - 1], this->nextFilenumber, 8 - (int)(sizeof(SD_FILE_PREFIX) - 1));
+        memcpy(out, SD_BINARY_RECORDS ? ".BIN" : ".TXT", 5);
+        this->nextFilenumber++; //auch eine nicht nutzbare Nummer wird nicht erneut versucht
+
+        this->rawMode = false;
+        if (this->rawRequested && !this->startRaw(filename))
+            srl->infoln("SD: Direktes Schreiben nicht moeglich, nutze Dateisystem");
+
+        if (!this->rawMode) {
+            //O_EXCL: eine vorhandene Datei wird nie ueberschrieben
+            if (!this->dataFile.open(&this->root, filename, O_CREAT | O_EXCL | O_WRITE)) {
+                srl->error("ERROR - Datei kann nicht geoeffnet werden: ");
+                srl->errorln(filename);
+                return false;
+            }
+            this->blocksSinceSync = 0;
+            this->syncPending     = false;
+            srl->info("SD: Speichere in ");
+            srl->infoln(filename);
+        }
+        return true;
     }
 
-    void StoreD::detDecplaces(int decplaces, int decplaceshelp){
-      /*decplaces = 1;
-      decplaceshelp = filenumber;
-      while (decplaceshelp > 10) {
-        decplaceshelp = decplaceshelp % 10;
-        decplaces++;
-      }
-      filename[9 + decplaces] = "file";// + filenumber + ".txt";*/
+    void StoreD::beginFile() {
+        this->fileBytes = 0;
+        this->append(this->fileHeader, this->fileHeaderLength);
     }
 
-// LOOP EXISTIERT HIER NICHT MEHR !
-/*    bool StoreD::loop(bool button,char filename, int filenumber, int decplaces, File myFile){
+    void StoreD::closeFile() {
+        if (this->flushPending) {
+            this->writeBlock(1 - this->activeBlock, SD_BLOCK_SIZE);
+            this->flushPending = false;
+        }
+        if (this->fillLevel > 0) { //angefangener Block, einziger Schreibzugriff, der nicht ausgerichtet ist
+            this->writeBlock(this->activeBlock, this->fillLevel);
+            this->fillLevel = 0;
+        }
+        this->syncPending = false; //close() aktualisiert das Verzeichnis ohnehin
+        if (this->rawMode)
+            this->stopRaw();
+        else
+            this->dataFile.close();
+    }
+
+    bool StoreD::startRaw(const char filename[]) {
+        //Datei wird vollstaendig vorab belegt, damit waehrend der Messung keine FAT-Zugriffe noetig sind
+        if (!this->rawFile.createContiguous(&this->root, filename, MAX_SD_FILE_SIZE)) {
+            srl->error("ERROR - Zusammenhaengende Datei kann nicht angelegt werden: ");
+            srl->errorln(filename);
+            return false;
+        }
+
+        uint32_t beginBlock;
+        this->rawFile.contiguousRange(&beginBlock, &this->rawEndBlock);
+        this->rawBlock = beginBlock;
+
+        //Ein einziger Mehrblock-Schreibvorgang ueber die ganze Datei, die Karte loescht die Bloecke vorab
+        if (!this->card.writeStart(beginBlock, this->rawEndBlock - beginBlock + 1)) {
+            srl->errorln("ERROR - Mehrblock-Schreiben nicht moeglich");
+            this->rawFile.remove();
+            return false;
+        }
+
+        this->rawMode     = true;
+        this->bytesStored = 0;
+
+        srl->info("SD: Streame direkt in ");
+        srl->infoln(filename);
+        return true;
+    }
+
+    void StoreD::stopRaw() {
+        this->card.writeStop();
+
+        //Vorab belegte Datei auf die geschriebenen Daten kuerzen, nicht benoetigte Cluster werden frei
+        this->rawFile.truncate(this->bytesStored);
+        this->rawFile.close();
+        this->rawMode = false;
+    }
+
+    bool StoreD::write(const char data[], int length) {
+        if (!this->ready)
+            return false;
+
+        //Pruefe vorab, ob alles passt, damit keine halben Datensaetze entstehen
+        int freeSpace = SD_BLOCK_SIZE - this->fillLevel;
+        if (!this->flushPending)
+            freeSpace += SD_BLOCK_SIZE;
+        if (length > freeSpace) {
+            this->overruns++;
+            return false;
+        }
+
+        //Datei voll: Wechsel auf die naechste Datei. Passiert nur an Grenzen zwischen zwei write()-Aufrufen,
+        //Datensaetze werden also nie geteilt. Blockiert den Aufrufer einmal je MAX_SD_FILE_SIZE
+        if (this->fileBytes + length > MAX_SD_FILE_SIZE) {
+            this->closeFile();
+            if (!this->openFile()) {
+                this->ready = false;
+                return false;
+            }
+            this->beginFile();
+        }
+
+        this->append(data, length);
+        return true;
+    }
+
+    bool StoreD::writeFinal(const char data[], int length) {
+        if (!this->ready)
+            return false;
+
+        while (length > 0) {
+            //der volle Block wird sofort geschrieben, statt auf den Thread zu warten
+            if (this->flushPending) {
+                this->writeBlock(1 - this->activeBlock, SD_BLOCK_SIZE);
+                this->flushPending = false;
+            }
+            int part = SD_BLOCK_SIZE - this->fillLevel;
+            if (part > length)
+                part = length;
+            this->append(data, part);
+            data   += part;
+            length -= part;
+        }
+        return true;
+    }
+
+    void StoreD::append(const char data[], int length) {
+        this->fileBytes += length;
+
+        while (length > 0) {
+            int part = SD_BLOCK_SIZE - this->fillLevel;
+            if (part > length)
+                part = length;
+
+            memcpy(&this->blocks[this->activeBlock][this->fillLevel], data, part);
+            this->fillLevel += part;
+            data   += part;
+            length -= part;
+
+            if (this->fillLevel == SD_BLOCK_SIZE) { //Block voll, wechsle auf den anderen
+                this->flushPending = true;
+                this->activeBlock  = 1 - this->activeBlock;
+                this->fillLevel    = 0;
+                this->resume(); //Thread schreibt den vollen Block
+            }
+        }
+    }
+
+    void StoreD::stop() {
+        if (!this->ready)
+            return;
+
+        this->closeFile();
+        this->ready = false;
+
+        srl->info("SD: Bloecke geschrieben: ");
+        srl->info(this->blocksWritten);
+        srl->info(", max. ");
+        srl->info(this->getMaxWriteLatency());
+        srl->info(" us, Mittel ");
+        srl->info(this->getAverageWriteLatency());
+        srl->info(" us, verworfen: ");
+        srl->infoln(this->overruns);
+    }
+
+    unsigned long StoreD::getBlocksWritten() {
+        return this->blocksWritten;
+    }
+
+    unsigned long StoreD::getMaxWriteLatency() {
+        return this->maxWriteLatency;
+    }
+
+    unsigned long StoreD::getAverageWriteLatency() {
+        if (this->blocksWritten == 0)
+            return 0;
+        return this->totalWriteLatency / this->blocksWritten;
+    }
+
+    unsigned long StoreD::getOverruns() {
+        return this->overruns;
+    }
+
+    void StoreD::writeBlock(int blockIndex, int length) {
+        unsigned long writeStart = micros();
+
+        if (this->rawMode) {
+            if (this->rawBlock > this->rawEndBlock) { //Datei voll, Daten werden verworfen
+                this->overruns++;
+                return;
+            }
+            //Ein angefangener letzter Block wird mit Nullen aufgefuellt, die Dateigroesse schneidet sie ab
+            if (length < SD_BLOCK_SIZE)
+                memset(&this->blocks[blockIndex][length], 0, SD_BLOCK_SIZE - length);
+
+            this->card.writeData((const uint8_t *)this->blocks[blockIndex]);
+            this->rawBlock++;
+            this->bytesStored += length;
+        } else {
+            this->dataFile.write((const uint8_t *)this->blocks[blockIndex], length);
+
+            //Dateigroesse regelmaessig im Verzeichnis aktualisieren, damit bei Stromausfall nur
+            //die letzten Bloecke verloren gehen. Das sync() macht der Thread in einem eigenen
+            //Durchlauf, dazwischen laufen die hoeheren Prioritaeten
+            this->blocksSinceSync++;
+            if (this->blocksSinceSync >= SD_SYNC_BLOCKS) {
+                this->syncPending     = true;
+                this->blocksSinceSync = 0;
+            }
+        }
+
+        unsigned long latency = micros() - writeStart;
+        this->blocksWritten++;
+        this->totalWriteLatency += latency;
+        if (latency > this->maxWriteLatency)
+            this->maxWriteLatency = latency;
+    }
+
+    bool StoreD::loop() {
         //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
         if (kill_flag)
             return false;
 
-        SD.begin();
-
-        if (button) { //TODO: setzen von button durch Tastendruck
-          //TODO: auf Display anzeigen, dass gespeichert wird
-          if (!SD.exists(filename)) {
-            myFile = SD.open(filename, FILE_WRITE);
-          }
-          if ((MAX_SD_FILE_SIZE - myFile.size() > SERIAL_READ_MAX_LINE_SIZE)) {
-            myFile.println(hier Daten) ;
-          }
-          else {
-            myFile.close();
-            filenumber++;
-            filename[] = "file";// + filenumber + ".txt";
-            myFile = SD.open(filename, FILE_WRITE);
-            myFile.println(hier Daten);
-          }
-        }
-        else {
-          if (SD.exists(filename)) { //wenn gespeichert wurde und jetzt nicht mehr, soll die geöffnete Datei geschlossen werden
-            myFile.close();
-            filenumber++; //auch wenn MAX_SD_FILE_SIZE noch nicht erreicht, beginne neue Datei beim erneuten Starten
-          }
-          //else: keine laufende Messung && keine geöffnete Datei -> mache nichts
-        }
-
-        //Serial.println("loop called");
+        //Je Durchlauf nur ein Schreibzugriff: erst der Block, im naechsten Durchlauf das sync()
+        if (this->ready && this->flushPending) {
+            this->writeBlock(1 - this->activeBlock, SD_BLOCK_SIZE);
+            this->flushPending = false;
+            if (this->syncPending)
+                return true;
+        } else if (this->ready && this->syncPending) {
+            this->dataFile.sync();
+            this->syncPending = false;
+        }
+
+        //Bis zum naechsten vollen Block gibt es nichts zu tun, write() weckt den Thread wieder auf
+        this->pause();
         return true;
-    }*/
+    }
 }
@@ -7,26 +7,115 @@
 #include <SD.h>
 
 #include "config.h"
+#include "ownlibs/common.h"
+#include "ownlibs/serialCommunication.h"
 
 namespace storage {
-    class StoreD {
+    // Speichert die Messdaten auf der SD-Karte. Daten werden in einen von zwei Bloecken zu je
+    // SD_BLOCK_SIZE Bytes geschrieben. Ist ein Block voll, wird er vom Thread als Ganzes auf die
+    // Karte geschrieben, waehrenddessen wird der andere Block gefuellt. Volle, ausgerichtete Bloecke
+    // umgehen den Cache der SD-Bibliothek, es gibt kein Lesen-Aendern-Schreiben.
+    // Jede Messung beginnt eine neue Datei SD_FILE_PREFIX + fuenfstellige Nummer. Die Nummer wird
+    // beim Booten in einem einzigen Durchlauf durch das Verzeichnis bestimmt und danach nur hochgezaehlt.
+    // Erreicht eine Datei MAX_SD_FILE_SIZE, wird in der naechsten Datei weitergeschrieben.
+    class StoreD : public Thread {
     public:
         //Defaultconstructor
         StoreD();
         //Destructor
         ~StoreD();
-        //falls neue Messung gestartet wird und Dateien von voriger Messung auf SD, starte bei chronologisch logischer filenumber
-        void detFilenumber(int filenumber, char filename);
-        //bestimme Dezimalstellen von filenumber
-        void detDecplaces(int decplaces, int decplaceshelp);
+        //Initialisiert die SD-Karte und bestimmt die naechste freie Dateinummer. Wird beim Booten
+        //aufgerufen und von arm() wiederholt, solange keine Karte gefunden wurde
+        bool begin();
+        //Oeffnet eine Datei im Hauptverzeichnis zum Lesen (Messprogramm). Gibt false zurueck, wenn
+        //keine Karte vorhanden ist oder die Datei fehlt
+        bool openForReading(SdFile *file, const char name[]);
+        //Liest den naechsten Dateieintrag des Hauptverzeichnisses (Verzeichnisse und Datentraeger-
+        //namen werden uebersprungen), 'first' beginnt von vorne. Gibt false am Ende zurueck
+        bool readDir(dir_t *entry, bool first);
+        //Liest einen Block direkt von der Karte, am Cache der SD-Bibliothek vorbei (zusammenhaengende
+        //Dateien, siehe SdFile::contiguousRange())
+        bool readBlock(uint32_t block, uint8_t data[]);
+        //Eine Messdatei ist mit arm() geoeffnet oder wird geschrieben, die Karte ist belegt
+        bool isBusy();
+        //Die Karte wird waehrend der Messung auch gelesen, dann wird nicht direkt auf die Karte
+        //geschrieben (ein Mehrblock-Schreibvorgang darf nicht unterbrochen werden)
+        void setCardShared(bool shared);
+        //Legt Daten fest, die am Anfang jeder Datei stehen (auch nach dem Wechsel auf die naechste Datei)
+        void setFileHeader(const char data[], int length);
+        //Oeffnet vor dem Start eine neue, leere Datei, damit start() nicht auf die Karte warten muss.
+        //Gibt false zurueck, wenn das nicht moeglich ist. Bei kurzen Messintervallen
+        //(<= SD_RAW_STREAMING_INTERVALL) wird direkt auf die Karte gestreamt
+        bool arm(int intervall);
+        //Loescht die mit arm() geoeffnete Datei wieder, wenn nicht gestartet wurde
+        void disarm();
+        //Beginnt die Datei mit dem Dateikopf, ohne arm() wird sie erst hier geoeffnet. Gibt false
+        //zurueck, wenn das nicht moeglich ist
+        bool start(int intervall);
+        //Haengt Daten an den aktiven Block an. Gibt false zurueck, wenn kein Platz ist, weil der
+        //andere Block noch nicht geschrieben wurde. Die Daten werden dann komplett verworfen
+        bool write(const char data[], int length);
+        //Wie write(), wartet aber auf das Schreiben voller Bloecke, statt Daten zu verwerfen. Fuer den
+        //Abschluss der Datei (z.B. Statistik am Dateiende), blockiert den Aufrufer. Kein Dateiwechsel
+        bool writeFinal(const char data[], int length);
+        //Schreibt die restlichen Daten und schliesst die Datei
+        void stop();
+        //Statistik ueber das Schreiben der Bloecke, Zeiten in us
+        unsigned long getBlocksWritten();
+        unsigned long getMaxWriteLatency();
+        unsigned long getAverageWriteLatency();
+        unsigned long getOverruns(); //Anzahl verworfener Schreibaufrufe
+    protected:
+        //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
+        bool loop();
     private:
-        bool button;
-        //bool button_before;
-        char filename;
-        int filenumber;
-        int decplaces;
-        int decplaceshelp;
-        File myFile;
+        //Schreibt einen Block auf die Karte und erfasst die benoetigte Zeit
+        void writeBlock(int blockIndex, int length);
+        //Kopiert Daten in die Bloecke, der Platz muss vorher geprueft sein
+        void append(const char data[], int length);
+        //Oeffnet die Datei mit der naechsten Nummer
+        bool openFile();
+        //Schreibt den Dateikopf an den Anfang der geoeffneten Datei
+        void beginFile();
+        //Schreibt alle gepufferten Daten und schliesst die Datei
+        void closeFile();
+        //Legt eine zusammenhaengende Datei mit MAX_SD_FILE_SIZE an und beginnt einen Mehrblock-Schreibvorgang
+        bool startRaw(const char filename[]);
+        //Beendet den Mehrblock-Schreibvorgang und kuerzt die Datei auf die geschriebenen Daten
+        void stopRaw();
+
+        bool cardReady;
+        long nextFilenumber;
+        bool rawRequested; //Messintervall erlaubt direktes Schreiben
+        bool cardShared;   //setCardShared()
+        unsigned long fileBytes; //Bytes in der aktuellen Datei, inklusive Dateikopf
+        char fileHeader[SD_FILE_HEADER_MAX_SIZE];
+        int fileHeaderLength;
+        SdFile dataFile;
+
+        bool ready;
+        bool armed; //Datei mit arm() geoeffnet, aber noch nicht gestartet
+        char blocks[2][SD_BLOCK_SIZE];
+        int activeBlock;   //Block, der gerade gefuellt wird
+        int fillLevel;     //belegte Bytes im aktiven Block
+        bool flushPending; //der andere Block ist voll und wartet auf das Schreiben
+        unsigned int blocksSinceSync;
+        bool syncPending;  //sync() steht aus, wird im naechsten Durchlauf von loop() gemacht
+
+        //Eigene Instanzen, da SDClass Karte und Volume nicht herausgibt (direktes Schreiben, Verzeichnis)
+        Sd2Card card;
+        SdVolume volume;
+        SdFile root;
+        bool rawMode;
+        SdFile rawFile;
+        uint32_t rawBlock;       //naechster Block auf der Karte
+        uint32_t rawEndBlock;    //letzter Block der Datei
+        unsigned long bytesStored; //Nutzdaten in der Datei, wird beim Beenden als Dateigroesse gesetzt
+
+        unsigned long blocksWritten;
+        unsigned long maxWriteLatency;
+        unsigned long totalWriteLatency;
+        unsigned long overruns;
     };
 }
 
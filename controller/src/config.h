@@ -7,20 +7,226 @@
 #define SERIAL_DEBUG_BAUDRATE 115200
 #define SERIAL_UART_BAUDRATE 115200
 
+//Schnittstellen zu LabView (siehe ownlibs/serialLink.h), auch beide gleichzeitig. Natives USB (Serial)
+//laeuft unabhaengig von der Baudrate mit voller USB-Geschwindigkeit, der UART (Serial1) z.B. ueber
+//einen USB-Seriell-Wandler. Debugausgaben duerfen nicht auf einer Schnittstelle von LabView liegen,
+//sie koennen sonst zwischen die Teile einer Messzeile geraten
+#define SERIAL_LABVIEW_USB 1
+#define SERIAL_LABVIEW_UART 0
+#define SERIAL_DEBUG_UART 1 //1: Debugausgaben auf Serial1, 0: auf USB
+#if SERIAL_LABVIEW_UART && SERIAL_DEBUG_UART
+#error "SERIAL_LABVIEW_UART und SERIAL_DEBUG_UART belegen beide Serial1"
+#endif
+#if SERIAL_LABVIEW_USB && !SERIAL_DEBUG_UART
+#error "SERIAL_LABVIEW_USB und Debugausgaben (SERIAL_DEBUG_UART 0) belegen beide USB"
+#endif
+#define SERIAL_LINK_MAX_PORTS 2
+
+//Stufen der Debugausgabe. Stufen oberhalb von LOG_LEVEL werden beim Kompilieren entfernt
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1 //Fehler, Produktivbetrieb
+#define LOG_LEVEL_INFO 2 //zusaetzlich Ablauf (Objekte erstellt, Header, Start, ...)
+#define LOG_LEVEL_TRACE 3 //zusaetzlich jedes Event, Laborbetrieb
+#define LOG_LEVEL LOG_LEVEL_TRACE
+
+#define SERIAL_DEBUG_BUFFERED 1 //1: Debugausgaben werden gepuffert und von Main_DebugLog im Hintergrund ausgegeben
+#define SERIAL_DEBUG_BUFFER_SIZE 4096 //bytes, muss eine Zweierpotenz sein
+#define SERIAL_DEBUG_DRAIN_INTERVALL 10 //ms, Pause von Main_DebugLog bei leerem Puffer
+#define SERIAL_DEBUG_DRAIN_SLICE 256 //bytes, die Main_DebugLog hoechstens je Durchlauf ausgibt
+
 #define SERIAL_READ_TIMEOUT 1000 //Zeit in ms, die eine Zeilenuebertragung maximal beanspruchen darf
+#define SERIAL_POLL_INTERVALL 1000 //us, Schlaf von Main_LabCom ohne wartende Zeichen, der Empfangspuffer muss so lange reichen
 #define SERIAL_READ_MAX_LINE_SIZE 512 //Maximale Laenge einer uebertragenenen Zeile
-#define SERIAL_READ_MAX_BLOCK_SIZE 16 //Maximale Laenge eines Eintrages (Zerlegter Uebertragungsstring)
-#define SERIAL_READ_MAX_BLOCK_AMOUNT 32 //Maximale Anzahl an Eintraegen pro Zeile
+#define SERIAL_READ_MAX_BLOCK_SIZE 16 //Maximale Laenge eines Eintrages inkl. '\0' (Zerlegter Uebertragungsstring)
+#define SERIAL_READ_MAX_BLOCK_AMOUNT (MAX_AMOUNT_VALVE > 32 ? MAX_AMOUNT_VALVE : 32) //Maximale Anzahl an Eintraegen pro Zeile, die Pins aller Ventile muessen passen
+
+#define LABCOM_COMMAND_SLOTS 128 //Plaetze der Hashtabelle fuer die Befehle von LabView, ein Vielfaches der Befehle (kollisionsfrei)
+
+//Gleitendes Fenster beim Einlesen, wird mit <window,N> aktiviert: Zeilen tragen eine Sequenznummer,
+//statt "ok" je Zeile wird kumulativ mit "ack,Nummer" bestaetigt, Fehler mit "nak,Nummer,Errorcode"
+#define SERIAL_WINDOW_ACK_EVERY 16 //Zeilen je Bestaetigung, wenn <window> ohne Anzahl gesendet wird
+#define SERIAL_WINDOW_ACK_DELAY 5 //ms ohne neue Zeile, nach denen die bisherigen Zeilen bestaetigt werden
+#define SERIAL_WINDOW_BYTES 1024 //Bytes, die der Sender hoechstens unbestaetigt senden darf (Empfangspuffer)
+
+//Binaerprotokoll fuer die Events, wird mit <binary> nach <begin> aktiviert
+//Frame: Sync, Typ, Laenge (2 Byte), Nutzdaten (max. SERIAL_READ_MAX_LINE_SIZE), CRC16 (2 Byte), little endian
+#define SERIAL_BINARY_SYNC 0xA5 //Startbyte jedes Frames
+#define SERIAL_BINARY_EVENTS 0x01 //Frametyp: Block aus Eventdatensaetzen
+#define SERIAL_BINARY_END 0x02 //Frametyp: Ende der Eventuebertragung, entspricht <end>
+#define SERIAL_BINARY_RECORD_SIZE 8 //Eventdatensatz: Typ ('M'/'V'), ID, Wert (int16), Zeit (uint32)
+#define SERIAL_BINARY_KEYFRAME 0x10 //Frametyp an LabView: Messwerte aller Kanaele
+#define SERIAL_BINARY_DELTA 0x11 //Frametyp an LabView: nur die seit dem letzten Frame geaenderten Kanaele
+#define SERIAL_BINARY_DROPPED 0x12 //Frametyp an LabView: Zaehler verworfener Frames
+#define SERIAL_BINARY_LATENCY 0x13 //Frametyp an LabView: Schaltverzoegerung eines MFCs/Ventils, Antwort auf <latency>
+#define SERIAL_BINARY_STREAM 0x14 //Frametyp an LabView: abgelehnte und je MFC/Ventil entnommene Events im Streaming-Modus
+#define SERIAL_BINARY_FILE 0x15 //Frametyp an LabView: Offset (uint32) und bis zu SD_BLOCK_SIZE Bytes einer Datei, Antwort auf <get>
 
 #define MAX_AMOUNT_MFC 16
-#define MAX_AMOUNT_VALVE 16
+#define MAX_AMOUNT_VALVE 16 //hoechstens 64, ueber 16 Ventile wird die Ventilmaske breiter (siehe sdRecord.h)
+
+//MFC-Bus am UART (siehe mfcBus.h)
+#define MFC_BUS_MAX_IN_FLIGHT 16 //gleichzeitig offene Befehle (je MFC hoechstens einer), 1 falls sich Antworten auf dem Bus stoeren
+#define MFC_BUS_TIMEOUT 20 //ms bis zur Antwort eines MFCs
+#define MFC_BUS_RETRIES 2 //Wiederholungen, danach wird der Befehl verworfen und ERR_MFC_NO_RESPONSE angezeigt
+#define MFC_BUS_COMMAND_SIZE 32 //Zeichen je Befehl bzw. Antwort
+#define MFC_BUS_POLL_INTERVALL 1 //ms, Abfrage der Antworten, solange Befehle offen sind
+#define MFC_BUS_READBACK 1 //1: gemessener Durchfluss wird abgefragt und statt des Soll-Wertes gespeichert/gesendet
+#define MFC_BUS_BROADCAST_READ 0 //1: ein Befehl fragt alle MFCs ab, nur wenn alle MFCs am Bus ihn unterstuetzen
+#define MFC_BUS_MAX_LOAD 50 //Prozent der UART-Uebertragungsrate, die Abfragen hoechstens belegen
+#define MFC_BUS_READ_BYTES 20 //Zeichen je Abfrage (Befehl und Antwort), Grundlage der Lastbegrenzung
+#define MFC_BUS_POLL_MAX_PERIOD 1000 //ms, seltenste Abfrage eines MFCs, der nicht antwortet
+#define MFC_RAMP_MIN_STEP 10 //ms, kleinster Abstand der Zwischenwerte einer Rampe (<R,...>)
+
+//I2C-Bus fuer Boschsensor und Display (siehe ownlibs/i2cBus.h)
+#define I2C_BUS_CLOCK 100000 //Hz, 100000 oder 400000
+#define I2C_BUS_QUEUE_SIZE 8 //wartende Transaktionen je Prioritaet
+#define I2C_BUS_MAX_LENGTH 8 //Bytes, die eine Transaktion hoechstens schreibt. Begrenzt die Wartezeit des Sensors auf das Display
+#define LCD_I2C_TRANSACTIONS 8 //Transaktionen, die das Display gleichzeitig eingereiht haben darf, hoechstens I2C_BUS_QUEUE_SIZE
+#define LCD_I2C_QUEUE_SIZE 128 //Zeichen und Befehle, die auf das Display warten koennen (ein volles Neuzeichnen sind ca. 90)
+#define BOSCH_I2C_ADRESS 0x28 //Adresse des Sensors am I2C-Bus
+#define BOSCH_DATA_REGISTER 0x00 //Register, ab dem der Messwert gelesen wird
+#define BOSCH_READ_LENGTH 2 //Bytes des Messwertes, big endian
+#define BOSCH_SAMPLE_INTERVALL 1 //ms, der Sensor wird unabhaengig vom Messintervall mit dieser Rate gelesen
+#define BOSCH_SAMPLE_BUFFER_SIZE 64 //Messwerte mit Zeitstempel, die auf den StringBuilder warten koennen
+//Zusammenfassung aller Messwerte eines Messintervalls zu einem Wert je Zeile
+#define BOSCH_REDUCE_MEAN 0 //Mittelwert
+#define BOSCH_REDUCE_MINMAX 1 //Minimum und Maximum, zwei Spalten
+#define BOSCH_REDUCE_LAST 2 //letzter Messwert
+#define BOSCH_REDUCTION BOSCH_REDUCE_MEAN
+#define BOSCH_VALUES (BOSCH_REDUCTION == BOSCH_REDUCE_MINMAX ? 2 : 1) //Bosch-Spalten je Zeile
+
+//Filter fuer Messwertstroeme vor der Zusammenfassung (siehe ownlibs/sampleFilter.h)
+#define FILTER_NONE 0
+#define FILTER_MOVING_AVERAGE 1 //gleitender Mittelwert ueber ..._FILTER_LENGTH Werte
+#define FILTER_BIQUAD_LOWPASS 2 //Tiefpass 2. Ordnung mit ..._FILTER_CUTOFF
+#define FILTER_FIR 3 //Tiefpass mit ..._FILTER_LENGTH Koeffizienten und ..._FILTER_CUTOFF
+#define FILTER_MAX_LENGTH 32 //Koeffizienten
+#define BOSCH_FILTER FILTER_NONE
+#define BOSCH_FILTER_LENGTH 8
+#define BOSCH_FILTER_CUTOFF 50 //Hz, muss unter der halben Abtastrate (1000 / BOSCH_SAMPLE_INTERVALL) liegen
+#define MFC_FLOW_FILTER FILTER_NONE //gemessener Durchfluss (MFC_BUS_READBACK)
+#define MFC_FLOW_FILTER_LENGTH 4
+#define MFC_FLOW_FILTER_CUTOFF 1 //Hz, Abtastrate ist das Abfrageintervall des MfcBus
+
+#define EVENT_TIMELINE_MERGED 0 //1: alle Events werden nach <end> zu einer Zeitleiste zusammengefuehrt und von Main_Timeline ausgefuehrt
+//Groesse des Eventspeichers in Bytes, wird beim Header gleichmaessig auf alle MFCs und Ventile aufgeteilt.
+//Die Events werden gepackt abgelegt (siehe EventBuffer), ein MFC-Event belegt meist 3-4, ein Ventil-Event 1-2 Byte.
+//Die Simulation auf dem PC (sim/build.sh) setzt einen groesseren Speicher fuer lange Messprogramme
+#if defined(SIM_EVENT_STORE_BYTES)
+#define EVENT_STORE_BYTES SIM_EVENT_STORE_BYTES
+#else
+#define EVENT_STORE_BYTES 131072
+#endif
+#define STREAM_REPORT_INTERVALL 100 //ms, Mindestabstand der Meldung "stream,..." (entnommene Events) im Streaming-Modus
+#define EVENT_REPEAT_DEPTH 2 //hoechstens ineinander verschachtelte Bloecke <repeat,N,Periode> ... <endrepeat>
+//Einheit der Zeiten in der Eventliste (Zeit, Dauer und Schritt der Rampen, Periode) in us. 1000: ms,
+//kleinere Werte erlauben feinere Zeiten, die Programmdauer ist auf 2^32 Einheiten begrenzt
+#define EVENT_TIME_UNIT 1000
+//Die MFC- und Ventil-Objekte, ihre Eventspeicher und Filter liegen in einem statischen Speicher (ownlibs/arena.h),
+//dessen Groesse sich aus MAX_AMOUNT_MFC, MAX_AMOUNT_VALVE und EVENT_STORE_BYTES ergibt
+#define ARENA_ALIGN 8 //Bytes, Ausrichtung jeder Anforderung, muss eine Zweierpotenz sein
+//Stack-Hoechststand fuer <memory> (siehe ownlibs/memoryStats.h): der freie RAM wird beim Booten mit einem Muster gefuellt
+#define MEMORY_PAINT_PATTERN 0xA5A5A5A5UL //Fuellmuster, ein ueberschriebenes Wort gehoerte einmal zum Stack
+#define MEMORY_STACK_MARGIN 256 //Bytes unter dem Stack von setup(), die beim Fuellen frei bleiben
+
+//Ausgang der Ventile (siehe valveOutput.h): eigene Pins des Teensy, eine Kette aus Schieberegistern
+//am SPI oder Portexpander am I2C-Bus. Bei den beiden letzten sind die Pins im Header die Nummern der Ausgaenge
+#define VALVE_OUTPUT_GPIO 0
+#define VALVE_OUTPUT_SHIFT_REGISTER 1 //74HC595, 8 Ausgaenge je Baustein
+#define VALVE_OUTPUT_EXPANDER 2 //MCP23017, 16 Ausgaenge je Baustein
+#define VALVE_OUTPUT VALVE_OUTPUT_GPIO
+#define VALVE_SHIFT_LATCH_PIN 9 //Uebernahme (RCLK) der Schieberegister
+#define VALVE_SHIFT_SPI SPI1 //eigener SPI der Kette, die SD-Karte (Sd2Card) belegt SPI an den Pins 11 und 13
+#define VALVE_SHIFT_DATA_PIN 21 //MOSI1 der Kette (SER), Pin 0 gehoert Serial1
+#define VALVE_SHIFT_CLOCK_PIN 20 //SCK1 der Kette (SRCLK)
+#define VALVE_SHIFT_CLOCK 4000000 //Hz, Takt des SPI, 48 Ausgaenge brauchen damit 12 us
+#define VALVE_EXPANDER_ADDRESS 0x20 //I2C-Adresse des ersten Expanders, die weiteren folgen direkt
+#define VALVE_EXPANDER_TRANSACTIONS 4 //gleichzeitig eingereihte Transaktionen je Expander, mindestens 2
+#define VALVE_OUTPUT_RETRY 200 //us, nach denen eine nicht eingereihte Ausgabe wiederholt wird
+
+//Ventile werden auf dem Teensy 3.x aus einem Timer-Interrupt ueber den Ausgang geschaltet. Die Expander
+//schreibt erst der I2C-Interrupt nach dem Einreihen, sie schalten immer aus dem Thread
+#if defined(KINETISK) && VALVE_OUTPUT != VALVE_OUTPUT_EXPANDER
+#define VALVE_HARDWARE_TIMER 1
+#else
+#define VALVE_HARDWARE_TIMER 0
+#endif
+#define VALVE_TIMER_INTERVALL 50 //us, Abstand der Timer-Interrupts, bestimmt die Genauigkeit der Schaltzeit
+#define VALVE_TIMER_MAX_PORTS 5 //Anzahl an GPIO-Ports (A-E beim Teensy 3.6)
+#define VALVE_TIMER_QUEUE_SIZE 32 //vorberechnete Schaltschritte, muss eine Zweierpotenz sein
 
 #define MAX_SD_FILE_SIZE 52428800 //bytes, entspricht 50 MB
+#define SD_CS_PIN SD_CHIP_SELECT_PIN //Chipselect der SD-Karte, Standard der SD-Bibliothek
+#define SD_FILE_PREFIX "LOG" //Dateien heissen LOG00001.BIN, LOG00002.BIN, ... (bzw. .TXT), jede Messung beginnt eine neue Datei
+#define SD_FILE_MAX_NUMBER 99999 //ergibt sich aus den 8 Zeichen des Dateinamens
+#define SD_BLOCK_SIZE 512 //bytes, Sektorgroesse der Karte. StoreD schreibt nur ganze Bloecke
+#define SD_SYNC_BLOCKS 64 //Nach so vielen Bloecken wird die Dateigroesse im Verzeichnis aktualisiert
+#define SD_PROGRAM_FILE "PROGRAM.TXT" //Messprogramm im Protokoll von LabView (Text und Binaerframes), wird in Bloecken von SD_BLOCK_SIZE gelesen
+#define SD_PROGRAM_AUTOLOAD 1 //1: SD_PROGRAM_FILE wird beim Booten gelesen, falls es vorhanden ist
+#define SD_TRANSFER_SLICE 8 //Bloecke, die LabCom bei <get> hoechstens je Durchlauf sendet
+#define SD_BINARY_RECORDS 1 //1: Messdaten werden binaer gespeichert (siehe sdRecord.h), 0: Textzeilen
+#define SD_RECORD_VERSION 1
+#define SD_RECORD_TYPE_SIZE 16 //Zeichen je MFC-Typ im Dateikopf
+#define SD_FILE_HEADER_MAX_SIZE (16 + MAX_AMOUNT_MFC * SD_RECORD_TYPE_SIZE) //sdFileHeader und Typnamen
+#define STRINGBUILDER_WIDTH_TIME 10 //Mindestbreite der Spalten in der Textzeile (rechtsbuendig, mit Tabulator getrennt)
+#define STRINGBUILDER_WIDTH_VALUE 6
+#define STRINGBUILDER_LINE_SIZE (12 * (1 + MAX_AMOUNT_MFC + BOSCH_VALUES) + 2 * MAX_AMOUNT_VALVE + 2) //reicht auch, wenn jede Zahl 11 Zeichen hat
+//Verhalten, wenn LabView die Messzeilen nicht schnell genug abnimmt (SD speichert unabhaengig davon jede Zeile)
+#define TELEMETRY_DROP_OLDEST 0 //aelteste wartende Zeile verwerfen, LabView bekommt die aktuellsten Werte
+#define TELEMETRY_DROP_NEWEST 1 //neue Zeile verwerfen, wartende Zeilen bleiben lueckenlos
+#define TELEMETRY_DECIMATE 2 //ab halbvoller Warteschlange nur jede TELEMETRY_DECIMATE_FACTOR-te Zeile uebernehmen
+#define TELEMETRY_POLICY TELEMETRY_DROP_OLDEST
+#define TELEMETRY_QUEUE_SIZE 16 //Zeilen, muss eine Zweierpotenz sein
+#define TELEMETRY_DECIMATE_FACTOR 4
+#define TELEMETRY_DELTA_FRAMES 0 //1: Messwerte gehen als Binaerframes an LabView, mit Keyframe und Deltaframes
+#define TELEMETRY_KEYFRAME_INTERVALL 50 //Messtakte, nach denen wieder ein Keyframe gesendet wird
+#define TELEMETRY_REPORT_INTERVALL 1000 //ms, Mindestabstand der Meldung verworfener Zeilen an LabView
+//Schaltverzoegerung (Ist- minus Soll-Zeit) je MFC/Ventil und gesamt (siehe ownlibs/latencyStats.h)
+#define LATENCY_BUCKETS 20 //Histogrammfaecher: < 1 us, dann je Zweierpotenz, das letzte nimmt alles ab 2^18 us (262 ms) auf
+#define LATENCY_RECORD_SIZE (20 + 4 * LATENCY_BUCKETS) //Bytes je Statistik im Binaerformat (SD-Dateiende, Frame an LabView)
+#define LATENCY_LINE_SIZE (16 + 12 * (4 + LATENCY_BUCKETS)) //Zeichen je Statistik als Textzeile
+#define UPLOAD_LINE_SIZE (8 + 12 * 10) //Zeichen der Antwort auf <upload> (siehe ownlibs/uploadStats.h)
+#define ARENA_LINE_SIZE (8 + 12 * 4) //Zeichen der Antwort auf <memory> (siehe ownlibs/arena.h)
+#define MEMORY_LINE_SIZE (4 + 12 * 4) //Zeichen der Zeile "ram,..." der Antwort auf <memory> (siehe ownlibs/memoryStats.h)
+#define EVENTS_LINE_SIZE (7 + 12 * 4) //Zeichen der Zeile "events,..." der Antwort auf <memory>
+#define TRIGGER_LINE_SIZE (12 + 12 * 3) //Zeichen der Antwort auf <trigger> (siehe ownlibs/startTrigger.h)
+#define SYNC_LINE_SIZE (8 + 12 * 4) //Zeichen der Antwort auf <sync> (siehe ownlibs/syncPulse.h)
+#define SD_RAW_STREAMING_INTERVALL 10 //ms, bis zu diesem Messintervall wird eine zusammenhaengende Datei (MAX_SD_FILE_SIZE) angelegt und direkt auf die Karte geschrieben
 
 #define DISPLAY_SIZE_WIDTH 20
 #define DISPLAY_SIZE_HEIGHT 4
 #define DISPLAY_REDRAW_INTERVALL 50 //Bestimmt Häufigkeit der Bildaktualisierung, Errors ausgenommen
 
+//Start der Messung per Taster oder <start> (siehe ownlibs/startTrigger.h). Nach <end> legen die Objekte
+//ihre ersten Events und die Messdatei vorab an, der Start setzt dann nur noch den Nullpunkt
+#define START_BUTTON 1 //1: Taster am START_BUTTON_PIN startet die Messung wie <start>
+#define START_BUTTON_PIN 24 //Taster gegen GND, interner Pullup, fallende Flanke
+#define START_LEAD 5000 //us vom Startsignal bis zum Nullpunkt der Messung, muss SERIAL_POLL_INTERVALL und Main_LabCom::start() abdecken
+
+//Mehrere Steuerungen an einem Messprogramm (siehe ownlibs/syncPulse.h). Der Master gibt am SYNC_PIN den
+//Start und danach einen Takt aus, die Slaves starten mit dem Startpuls und fuehren ihre Uhr am Takt nach.
+//Jede Steuerung erhaelt ihren Teil des Programms (eigene MFCs und Ventile) wie eine einzelne
+#define SYNC_MODE_OFF 0
+#define SYNC_MODE_MASTER 1
+#define SYNC_MODE_SLAVE 2
+#define SYNC_MODE SYNC_MODE_OFF //SYNC_MODE_OFF: einzelne Steuerung, SYNC_MODE_MASTER: gibt Start und Takt vor, SYNC_MODE_SLAVE: folgt dem Master
+#define SYNC_PIN 25 //Synchronleitung aller Steuerungen (gemeinsames GND), Ausgang beim Master, Eingang bei den Slaves
+#define SYNC_PERIOD 100000 //us zwischen zwei Taktpulsen, der erste liegt auf dem Nullpunkt
+#define SYNC_PULSE_WIDTH 5 //us, Breite eines Taktpulses
+#define SYNC_START_WIDTH 200 //us, Breite des Startpulses, ein Slave erkennt ihn an mehr als der halben Breite
+#define SYNC_RATE_GAIN_SHIFT 2 //der Slave fuehrt die Drift seiner Uhr je Puls um 1/2^N der gemessenen Abweichung nach
+#define SYNC_MAX_DRIFT 1000 //ppm, Begrenzung der nachgefuehrten Drift (Quarze weichen um etwa 10-50 ppm ab)
+#define SYNC_MAX_ERROR 100 //us Abweichung eines Taktpulses von der nachgefuehrten Uhr, ab der ein Slave ERR_SYNC meldet
+#define SYNC_TIMEOUT_PULSES 3 //ausgebliebene Taktpulse, nach denen ein Slave ERR_SYNC meldet
+
+//Prioritaetsklassen der Pseudothreads (siehe MTHREAD_PRIORITIES in mthread.h), 0 ist die hoechste.
+//Ein faelliger Thread laeuft vor allen faelligen Threads niedrigerer Klassen, nach MTHREAD_MAX_STARVATION
+//aber auch, wenn die hoeheren noch nicht fertig sind
+#define THREAD_PRIORITY_REALTIME 0 //Ventile, MFCs, Zeitleiste
+#define THREAD_PRIORITY_ACQUISITION 1 //Boschsensor, Messzeilen
+#define THREAD_PRIORITY_IO 2 //SD-Karte, LabView
+#define THREAD_PRIORITY_BACKGROUND 3 //Display, Debugausgaben
+
 #define ERR_1000_TIME 1500
 #define ERR_5000_TIME 604800000 //1 Woche
 
@@ -29,7 +235,25 @@
 #define ERR_SERIAL_READ_WRONG_LINE_BEGIN 1001
 #define ERR_SERIAL_READ_WRONG_LINE_ENDING 1002
 #define ERR_SERIAL_READ_TIMEOUT 1003
+#define ERR_SERIAL_BINARY_CRC 1004
+#define ERR_SERIAL_BINARY_FRAME 1005
+#define ERR_SERIAL_READ_MAX_BLOCK_SIZE 1006
+#define ERR_SERIAL_READ_MAX_BLOCK_AMOUNT 1007
+#define ERR_SD_INIT 1008
+#define ERR_MFC_NO_RESPONSE 1009
+#define ERR_SERIAL_SEQUENCE 1010
+#define ERR_STREAM_UNAVAILABLE 1011
+#define ERR_SD_PROGRAM 1012
+#define ERR_EVENT_REPEAT 1013
+#define ERR_RESTART 1014
+#define ERR_START_LATE 1015
+#define ERR_SD_TRANSFER 1016
+#define ERR_SERIAL_ARGUMENTS 1017
+#define ERR_PROGRAM_TOO_LARGE 1018
+#define ERR_SYNC 1019
 
 #define ERR_SERIAL_UNDEFINED_INDEX 5000
+#define ERR_EVENT_STORE_FULL 5001
+#define ERR_ARENA_FULL 5002
 
 #endif
@@ -25,6 +25,102 @@ namespace io {
             "                    ",
             "    Serial Read     ",
             "      Timeout       "
+        },
+        {
+            "     ERROR 1004     ",
+            "                    ",
+            "   Binaerframe:     ",
+            "   CRC ungueltig    "
+        },
+        {
+            "     ERROR 1005     ",
+            "                    ",
+            "   Binaerframe:     ",
+            "  Inhalt ungueltig  "
+        },
+        {
+            "     ERROR 1006     ",
+            "                    ",
+            "  Max Eintraglaenge ",
+            "   ueberschritten   "
+        },
+        {
+            "     ERROR 1007     ",
+            "                    ",
+            "   Zu viele Eintr.  ",
+            "    in der Zeile    "
+        },
+        {
+            "     ERROR 1008     ",
+            "                    ",
+            "    SD-Karte nicht  ",
+            "     verfuegbar     "
+        },
+        {
+            "     ERROR 1009     ",
+            "                    ",
+            "   MFC antwortet    ",
+            "       nicht        "
+        },
+        {
+            "     ERROR 1010     ",
+            "                    ",
+            "  Sequenznummer     ",
+            "  fehlt/ungueltig   "
+        },
+        {
+            "     ERROR 1011     ",
+            "                    ",
+            "   Streaming nicht  ",
+            "      moeglich      "
+        },
+        {
+            "     ERROR 1012     ",
+            "                    ",
+            "  Messprogramm auf  ",
+            "  SD nicht gefunden "
+        },
+        {
+            "     ERROR 1013     ",
+            "                    ",
+            " Wiederholungsblock ",
+            "     ungueltig      "
+        },
+        {
+            "     ERROR 1014     ",
+            "                    ",
+            "  Neustart derzeit  ",
+            "   nicht moeglich   "
+        },
+        {
+            "     ERROR 1015     ",
+            "                    ",
+            " Start dauerte mehr ",
+            "  als START_LEAD    "
+        },
+        {
+            "     ERROR 1016     ",
+            "                    ",
+            " Dateiuebertragung  ",
+            "  nicht moeglich    "
+        },
+        {
+            "     ERROR 1017     ",
+            "                    ",
+            " Falsche Argumente  ",
+            "     im Befehl      "
+        },
+        {
+            "     ERROR 1018     ",
+            "                    ",
+            " Programm zu gross  ",
+            " fuer Eventspeicher "
+        },
+        {
+            "     ERROR 1019     ",
+            "                    ",
+            "  Synchronisation   ",
+            "  mit Master fehlt  "
         }
     };
 
@@ -34,6 +130,18 @@ namespace io {
             "                    ",
             "     Zugriff auf    ",
             "   undefinierte ID  "
+        },
+        {
+            "     ERROR 5001     ",
+            "                    ",
+            "   Eventspeicher    ",
+            "        voll        "
+        },
+        {
+            "     ERROR 5002     ",
+            "                    ",
+            "  Objektspeicher    ",
+            "        voll        "
         }
     };
 }
@@ -0,0 +1,357 @@
+#include "eventBuffer.h"
+
+//Wertbreite, bis zu der der Wert mit im ersten Byte des Zeitabstands steht
+#define EVENT_INLINE_VALUE_BITS 6
+//Arten der Markierungen
+#define EVENT_MARK_RAMP 0
+#define EVENT_MARK_REPEAT 1
+#define EVENT_MARK_END_REPEAT 2
+
+namespace control {
+    EventBuffer::EventBuffer() {
+        this->buffer     = NULL;
+        this->capacity   = 0;
+        this->valueBits  = 0;
+        this->head       = 0;
+        this->used       = 0;
+        this->read       = 0;
+        this->size       = 0;
+        this->pushedTime = 0;
+        this->poppedTime = 0;
+        this->offset     = 0;
+        this->popped     = 0;
+        this->pending    = 0;
+        this->pushDepth  = 0;
+        this->depth      = 0;
+    }
+    EventBuffer::~EventBuffer() {
+
+    }
+
+    bool EventBuffer::init(uint8_t memory[], int capacity, int valueBits) {
+        if (this->buffer != NULL || memory == NULL || valueBits < 1 || valueBits > 16)
+            return false;
+        //Ein Eintrag, der den Ring genau fuellt, haette den Abstand 0 von seinem Anfang zum Ende. Die
+        //Rampe ist der groesste Eintrag, auch groesser als die Markierungen der Bloecke
+        if (capacity <= maxRampSize(valueBits))
+            return false;
+
+        this->buffer    = memory;
+        this->capacity  = capacity;
+        this->valueBits = valueBits;
+        return true;
+    }
+
+    int EventBuffer::maxEventSize(int valueBits) {
+        //Zeiten sind ms seit dem Start und passen immer in 32 Bit
+        int inlineBits = valueBits <= EVENT_INLINE_VALUE_BITS ? valueBits : 0;
+        int valueBytes = inlineBits > 0 ? 0 : (valueBits + 7) / 8;
+        return valueBytes + 1 + (32 - (7 - inlineBits) + 6) / 7;
+    }
+
+    int EventBuffer::maxRampSize(int valueBits) {
+        //Kennung und Art, Event, Zielwert, Dauer (32 Bit) und Schrittweite (16 Bit)
+        int valueBytes = (valueBits + 7) / 8;
+        return valueBytes + 1 + maxEventSize(valueBits) + valueBytes + (32 + 6) / 7 + (16 + 6) / 7;
+    }
+
+    int EventBuffer::limitValue(int value) const {
+        //der kleinste Wert ist die Kennung der Markierungen
+        int maxValue = (1 << (this->valueBits - 1)) - 1;
+        if (value > maxValue)
+            return maxValue;
+        if (value < -maxValue)
+            return -maxValue;
+        return value;
+    }
+
+    void EventBuffer::putValue(uint8_t data[], int *length, int value) const {
+        for (int i = 0; i < (this->valueBits + 7) / 8; i++)
+            data[(*length)++] = (value >> (8 * i)) & 0xFF;
+    }
+
+    void EventBuffer::putVarint(uint8_t data[], int *length, uint32_t value) const {
+        //je 7 Bit, das oberste Bit zeigt ein weiteres Byte an
+        while (value >= 0x80) {
+            data[(*length)++] = (value & 0x7F) | 0x80;
+            value >>= 7;
+        }
+        data[(*length)++] = value;
+    }
+
+    void EventBuffer::putMark(uint8_t data[], int *length, uint8_t kind) const {
+        if (this->valueBits <= EVENT_INLINE_VALUE_BITS) {
+            //Abstand mit weiterem Byte, das keine Bits mehr enthaelt, entsteht bei Events nie
+            data[(*length)++] = 0x80;
+            data[(*length)++] = 0x00;
+        } else {
+            this->putValue(data, length, -(1 << (this->valueBits - 1)));
+        }
+        data[(*length)++] = kind;
+    }
+
+    int EventBuffer::encode(const eventElement &event, uint8_t data[]) const {
+        int length = 0;
+        uint32_t delta = event.time > this->pushedTime ? event.time - this->pushedTime : 0;
+
+        if (this->valueBits <= EVENT_INLINE_VALUE_BITS) {
+            int value    = event.value;
+            int maxValue = (1 << this->valueBits) - 1;
+            if (value != 0 && (value < 0 || value > maxValue))
+                value = maxValue;
+
+            //erstes Byte: Wert und die untersten Bits des Abstands
+            int firstBits = 7 - this->valueBits;
+            data[length] = value | ((delta & ((1 << firstBits) - 1)) << this->valueBits);
+            delta >>= firstBits;
+            if (delta == 0)
+                return length + 1;
+            data[length++] |= 0x80;
+            this->putVarint(data, &length, delta);
+            return length;
+        }
+
+        bool ramp = event.rampStep > 0;
+        if (ramp)
+            this->putMark(data, &length, EVENT_MARK_RAMP);
+        this->putValue(data, &length, this->limitValue(event.value));
+        this->putVarint(data, &length, delta);
+        if (ramp) {
+            this->putValue(data, &length, this->limitValue(event.rampValue));
+            this->putVarint(data, &length, event.rampDuration);
+            this->putVarint(data, &length, event.rampStep);
+        }
+        return length;
+    }
+
+    int EventBuffer::positionAt(int offset) const {
+        int position = this->head + offset;
+        return position >= this->capacity ? position - this->capacity : position;
+    }
+
+    uint8_t EventBuffer::nextByte(int *position) const {
+        uint8_t data = this->buffer[*position];
+        if (++(*position) >= this->capacity)
+            *position = 0;
+        return data;
+    }
+
+    int EventBuffer::getValue(int *position) const {
+        int value = 0;
+        for (int i = 0; i < (this->valueBits + 7) / 8; i++)
+            value |= this->nextByte(position) << (8 * i);
+        if (value & (1 << (this->valueBits - 1))) //Vorzeichen erweitern
+            value -= 1 << this->valueBits;
+        return value;
+    }
+
+    uint32_t EventBuffer::getVarint(int *position, uint32_t value, int shift) const {
+        uint8_t data;
+        do {
+            data   = this->nextByte(position);
+            value |= (uint32_t)(data & 0x7F) << shift;
+            shift += 7;
+        } while (data & 0x80);
+        return value;
+    }
+
+    int EventBuffer::readMark(int *position) const {
+        int next = *position;
+        if (this->valueBits <= EVENT_INLINE_VALUE_BITS) {
+            //auf 0x80 folgt bei einem Event immer mindestens ein weiteres Byte
+            if (this->nextByte(&next) != 0x80 || this->nextByte(&next) != 0x00)
+                return -1;
+        } else if (this->getValue(&next) != -(1 << (this->valueBits - 1))) {
+            return -1;
+        }
+        int kind = this->nextByte(&next);
+        *position = next;
+        return kind;
+    }
+
+    int EventBuffer::decode(int position, unsigned long lastTime, eventElement *event) const {
+        int start = position;
+        uint32_t delta;
+
+        event->rampValue    = 0;
+        event->rampDuration = 0;
+        event->rampStep     = 0;
+
+        if (this->valueBits <= EVENT_INLINE_VALUE_BITS) {
+            uint8_t data = this->nextByte(&position);
+            event->value = data & ((1 << this->valueBits) - 1);
+            delta = (data & 0x7F) >> this->valueBits;
+            if (data & 0x80)
+                delta = this->getVarint(&position, delta, 7 - this->valueBits);
+        } else {
+            bool ramp = this->readMark(&position) == EVENT_MARK_RAMP;
+            event->value = this->getValue(&position);
+            delta = this->getVarint(&position, 0, 0);
+            if (ramp) {
+                event->rampValue    = this->getValue(&position);
+                event->rampDuration = this->getVarint(&position, 0, 0);
+                event->rampStep     = this->getVarint(&position, 0, 0);
+            }
+        }
+
+        event->time = lastTime + delta;
+        return position >= start ? position - start : position + this->capacity - start;
+    }
+
+    bool EventBuffer::append(const uint8_t data[], int length) {
+        if (this->used + length > this->capacity)
+            return false;
+
+        //Schreibposition liegt 'used' Bytes hinter dem aeltesten Byte
+        int tail = this->positionAt(this->used);
+        for (int i = 0; i < length; i++) {
+            this->buffer[tail] = data[i];
+            if (++tail >= this->capacity)
+                tail = 0;
+        }
+        this->used += length;
+        return true;
+    }
+
+    bool EventBuffer::push(const eventElement &event) {
+        uint8_t data[EVENT_MAX_ENCODED_SIZE];
+        if (!this->append(data, this->encode(event, data)))
+            return false;
+
+        if (event.time > this->pushedTime)
+            this->pushedTime = event.time;
+        this->size++;
+        return true;
+    }
+
+    bool EventBuffer::pushRepeat(unsigned long count, unsigned long period) {
+        if (this->pushDepth >= EVENT_REPEAT_DEPTH || count == 0)
+            return false;
+
+        uint8_t data[EVENT_MAX_ENCODED_SIZE];
+        int length = 0;
+        this->putMark(data, &length, EVENT_MARK_REPEAT);
+        this->putVarint(data, &length, count);
+        this->putVarint(data, &length, period);
+        if (!this->append(data, length))
+            return false;
+
+        this->pushDepth++;
+        this->advance(); //Leseposition steht evtl. schon am Ende
+        return true;
+    }
+
+    bool EventBuffer::pushEndRepeat() {
+        if (this->pushDepth == 0)
+            return false;
+
+        uint8_t data[EVENT_MAX_ENCODED_SIZE];
+        int length = 0;
+        this->putMark(data, &length, EVENT_MARK_END_REPEAT);
+        if (!this->append(data, length))
+            return false;
+
+        this->pushDepth--;
+        this->advance();
+        return true;
+    }
+
+    int EventBuffer::getOpenRepeats() const {
+        return this->pushDepth;
+    }
+
+    void EventBuffer::advance() {
+        while (this->read < this->used) {
+            int start    = this->positionAt(this->read);
+            int position = start;
+            int kind     = this->readMark(&position);
+
+            if (kind == EVENT_MARK_REPEAT) {
+                repeatFrame *frame = &this->frames[this->depth++];
+                frame->count     = this->getVarint(&position, 0, 0);
+                frame->period    = this->getVarint(&position, 0, 0);
+                frame->iteration = 0;
+                frame->startTime = this->poppedTime;
+                frame->hasEvents = false;
+                this->read += position >= start ? position - start : position + this->capacity - start;
+                frame->start = this->read;
+            } else if (kind == EVENT_MARK_END_REPEAT) {
+                repeatFrame *frame = &this->frames[this->depth - 1];
+                if (frame->hasEvents && frame->iteration + 1 < frame->count) {
+                    //naechster Durchlauf: dieselben Events, um die Periode verschoben
+                    frame->iteration++;
+                    this->offset    += frame->period;
+                    this->poppedTime = frame->startTime;
+                    this->read       = frame->start;
+                } else { //ein Block ohne Events dieses Kanals wird nur einmal durchlaufen
+                    this->offset -= frame->iteration * frame->period;
+                    this->depth--;
+                    this->read += position >= start ? position - start : position + this->capacity - start;
+                }
+            } else {
+                break;
+            }
+        }
+
+        //Ausserhalb der Bloecke wird alles Gelesene frei
+        if (this->depth == 0 && this->read > 0) {
+            this->head    = this->positionAt(this->read);
+            this->used   -= this->read;
+            this->read    = 0;
+            this->size   -= this->pending;
+            this->popped += this->pending;
+            this->pending = 0;
+        }
+    }
+
+    eventElement EventBuffer::pop() {
+        eventElement event;
+        this->read      += this->decode(this->positionAt(this->read), this->poppedTime, &event);
+        this->poppedTime = event.time;
+        event.time      += this->offset;
+
+        //Wiederholte Events sind schon gezaehlt
+        bool repeated = false;
+        for (int i = 0; i < this->depth; i++) {
+            this->frames[i].hasEvents = true;
+            if (this->frames[i].iteration > 0)
+                repeated = true;
+        }
+        if (!repeated)
+            this->pending++;
+
+        this->advance();
+        return event;
+    }
+
+    eventElement EventBuffer::peek() const {
+        eventElement event;
+        this->decode(this->positionAt(this->read), this->poppedTime, &event);
+        event.time += this->offset;
+        return event;
+    }
+
+    bool EventBuffer::isEmpty() const {
+        return this->read >= this->used;
+    }
+
+    bool EventBuffer::isFull() const {
+        return this->used + maxEventSize(this->valueBits) > this->capacity;
+    }
+
+    int EventBuffer::count() const {
+        return this->size;
+    }
+
+    int EventBuffer::getCapacity() const {
+        return this->capacity;
+    }
+
+    int EventBuffer::getUsed() const {
+        return this->used;
+    }
+
+    unsigned long EventBuffer::getPopped() const {
+        return this->popped;
+    }
+}
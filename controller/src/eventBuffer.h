@@ -0,0 +1,134 @@
+#ifndef EVENTBUFFER_H
+#define EVENTBUFFER_H
+
+#include <Arduino.h>
+#include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
+
+#include "eventElement.h"
+#include "config.h"
+
+//Hoechstens belegte Bytes eines Events (Rampe mit 16 Bit breiten Werten)
+#define EVENT_MAX_ENCODED_SIZE 20
+//Breite der gespeicherten Werte je Geraetetyp
+#define EVENT_VALUE_BITS_MFC 16 //Soll-Wert als int16, wie in den Binaerframes und im stateSnapshot
+#define EVENT_VALUE_BITS_VALVE 1 //auf/zu
+
+namespace control {
+    // Ringpuffer mit fester Groesse fuer die Events eines MFCs oder Ventils. Der Speicher
+    // wird einmalig beim Verarbeiten des Headers als zusammenhaengender Block uebergeben (aus
+    // der Arena), weder push() noch pop() fordern Speicher an oder geben ihn frei.
+    // Die Events werden gepackt abgelegt: die Zeit als Abstand zum vorherigen Event (7 Bit
+    // je Byte, das oberste Bit zeigt ein weiteres Byte an), der Wert mit 'valueBits' Bits.
+    // Werte bis 6 Bit (Ventile) stehen mit im ersten Byte des Abstands, breitere Werte (MFCs)
+    // als ganze Bytes (little endian) davor. Ein Ventil-Event mit weniger als 64 ms Abstand
+    // belegt so 1 Byte, ein MFC-Event mit weniger als 128 ms 3 Byte statt je 8 Byte.
+    // Markierungen beginnen mit einer Kennung, die kein Event ergibt (kleinster breiter Wert
+    // bzw. 0x80 0x00), gefolgt von ihrer Art: Rampe (nur breite Werte: Event, Zielwert, Dauer,
+    // Schrittweite), Beginn (Anzahl, Periode) und Ende eines Wiederholungsblocks.
+    // Innerhalb eines Blocks liest pop() die Events erneut, um die Periode verschoben, der
+    // Speicher des Blocks wird erst nach dem letzten Durchlauf frei.
+    // Kopien teilen sich den Speicher: eine zugewiesene Kopie stellt die Leseposition von damals
+    // wieder her, solange seitdem nichts angehaengt wurde (Wiederholung der Messung, <restart>).
+    class EventBuffer {
+    public:
+        //Defaultconstructor
+        EventBuffer();
+        //Destructor
+        ~EventBuffer();
+        //Legt die Events mit 'valueBits' Bits breiten Werten in den 'capacity' Bytes ab 'memory' ab,
+        //der Speicher gehoert weiter dem Aufrufer. Gibt false zurueck, wenn 'memory' NULL ist,
+        //der Puffer schon angelegt wurde oder 'capacity' nicht groesser als maxRampSize() ist
+        bool init(uint8_t memory[], int capacity, int valueBits);
+        //Haengt ein Event hinten an, gibt false zurueck, wenn der Puffer voll ist. Die Events
+        //muessen zeitlich sortiert sein, ein frueheres Event bekommt die Zeit des vorherigen.
+        //Werte ausserhalb von 'valueBits' werden begrenzt (Ventile: jeder Wert ausser 0 ist 1).
+        //Rampen (rampStep > 0) werden nur bei breiten Werten gespeichert
+        bool push(const eventElement &event);
+        //Beginnt einen Block, der 'count' mal im Abstand von 'period' ms ausgefuehrt wird. Die
+        //Events darin haben die Zeiten des ersten Durchlaufs. Gibt false zurueck, wenn der Puffer
+        //voll ist oder schon EVENT_REPEAT_DEPTH Bloecke offen sind
+        bool pushRepeat(unsigned long count, unsigned long period);
+        //Schliesst den innersten Block, gibt false zurueck, wenn keiner offen oder der Puffer voll ist
+        bool pushEndRepeat();
+        //Anzahl der mit pushRepeat() begonnenen und noch nicht geschlossenen Bloecke
+        int getOpenRepeats() const;
+        //Entnimmt das aelteste Event. Darf nur aufgerufen werden, wenn der Puffer nicht leer ist
+        eventElement pop();
+        //Gibt das aelteste Event zurueck, ohne es zu entnehmen
+        eventElement peek() const;
+        //Gibt an, ob keine Events mehr zu lesen sind
+        bool isEmpty() const;
+        //Gibt an, ob moeglicherweise kein weiteres Event mehr Platz hat
+        bool isFull() const;
+        //Anzahl der gespeicherten Events (die eines Blocks einfach)
+        int count() const;
+        //Groesse des Speichers in Bytes
+        int getCapacity() const;
+        //Von den gespeicherten Events belegte Bytes
+        int getUsed() const;
+        //Anzahl der seit init() freigegebenen Events, laeuft im Streaming-Modus ueber die
+        //Kapazitaet hinaus. Die Events eines Blocks zaehlen einfach, nach seinem letzten Durchlauf
+        unsigned long getPopped() const;
+        //Groesster Platzbedarf eines Events mit 'valueBits' Bits breiten Werten in Bytes
+        static int maxEventSize(int valueBits);
+        //Groesster Platzbedarf einer Rampe, nur fuer breite Werte (MFCs)
+        static int maxRampSize(int valueBits);
+    private:
+        //Offener Wiederholungsblock beim Lesen
+        typedef struct repeatFrameStruct {
+            int start;                //Bytes hinter head, an denen der erste Eintrag des Blocks steht
+            unsigned long count;      //Durchlaeufe insgesamt
+            unsigned long iteration;  //aktueller Durchlauf ab 0
+            unsigned long period;
+            unsigned long startTime;  //Zeit vor dem Block, ohne Verschiebung
+            bool hasEvents;
+        } repeatFrame;
+
+        //Packt ein Event nach 'data', gibt die Anzahl Bytes zurueck
+        int encode(const eventElement &event, uint8_t data[]) const;
+        //Haengt die Kennung einer Markierung der Art 'kind' an 'data' an
+        void putMark(uint8_t data[], int *length, uint8_t kind) const;
+        //Kopiert 'length' Bytes ans Ende des Rings, gibt false zurueck, wenn sie nicht passen
+        bool append(const uint8_t data[], int length);
+        //Liest das Event an 'position' (mit der Zeit 'lastTime' des vorherigen), gibt die
+        //Anzahl Bytes zurueck
+        int decode(int position, unsigned long lastTime, eventElement *event) const;
+        //Gibt die Art der Markierung an 'position' zurueck und setzt 'position' hinter die
+        //Kennung, bei einem Event -1 (ohne 'position' zu veraendern)
+        int readMark(int *position) const;
+        //Verarbeitet die Blockmarkierungen an der Leseposition, bis dort ein Event steht oder
+        //alles gelesen ist, und gibt abgeschlossene Bytes frei
+        void advance();
+        //Position 'offset' Bytes hinter head
+        int positionAt(int offset) const;
+        //Gibt das Byte an 'position' zurueck und rueckt sie im Ring weiter
+        uint8_t nextByte(int *position) const;
+        //Begrenzt einen breiten Wert, ohne die Kennung der Markierungen zu erreichen
+        int limitValue(int value) const;
+        //Haengt einen breiten Wert bzw. eine Zahl mit 7 Bit je Byte an 'data' an
+        void putValue(uint8_t data[], int *length, int value) const;
+        void putVarint(uint8_t data[], int *length, uint32_t value) const;
+        //Liest einen breiten Wert bzw. die restlichen Bytes einer Zahl, von der schon 'shift'
+        //Bits in 'value' stehen
+        int getValue(int *position) const;
+        uint32_t getVarint(int *position, uint32_t value, int shift) const;
+
+        uint8_t *buffer;
+        int capacity;
+        int valueBits;
+        int head; //Index des ersten noch belegten Bytes
+        int used; //belegte Bytes
+        int read; //Bytes hinter head, die schon gelesen wurden (Leseposition)
+        int size; //Anzahl gespeicherter Events
+        unsigned long pushedTime; //Zeit des zuletzt angehaengten Events
+        unsigned long poppedTime; //Zeit des zuletzt entnommenen Events, ohne Verschiebung
+        unsigned long offset;     //Verschiebung der Zeiten durch die laufenden Bloecke
+        unsigned long popped;
+        unsigned long pending; //gelesene Events des ersten Durchlaufs, die noch belegt sind
+        int pushDepth; //offene Bloecke beim Schreiben
+        int depth;     //offene Bloecke beim Lesen
+        repeatFrame frames[EVENT_REPEAT_DEPTH];
+    };
+}
+
+#endif
@@ -4,7 +4,12 @@
 namespace control {
     typedef struct eventElementStruct {
         int value;
-        unsigned long time;
+        unsigned long time; //relativ zum Start, alle Zeiten in EVENT_TIME_UNIT (config.h, Standard ms)
+        //Rampe (nur MFCs, rampStep > 0): ab 'time' alle 'rampStep' ein Zwischenwert, linear
+        //von 'value' bis 'rampValue' nach 'rampDuration'. rampStep 0: Sprung auf 'value'
+        int rampValue;
+        unsigned long rampDuration;
+        unsigned int rampStep;
     } eventElement;
 
 }
@@ -0,0 +1,147 @@
+#include "fileTransfer.h"
+
+namespace storage {
+    //Name eines Eintrags im 8.3-Format ("LOG00012BIN") als "LOG00012.BIN"
+    static void formatName(const dir_t *entry, char name[]) {
+        int n = 0;
+        for (int i = 0; i < 8 && entry->name[i] != ' '; i++)
+            name[n++] = entry->name[i];
+        if (entry->name[8] != ' ') {
+            name[n++] = '.';
+            for (int i = 8; i < 11 && entry->name[i] != ' '; i++)
+                name[n++] = entry->name[i];
+        }
+        name[n] = '\0';
+    }
+
+    FileTransfer::FileTransfer() {
+        this->storeD      = NULL;
+        this->opened      = false;
+        this->contiguous  = false;
+        this->beginBlock  = 0;
+        this->size        = 0;
+        this->position    = 0;
+        this->frameLength = 0;
+        this->sendOffset  = 0;
+    }
+    FileTransfer::~FileTransfer() {
+        if (this->opened)
+            this->file.close();
+    }
+
+    void FileTransfer::list(StoreD *storeD, Print *output) {
+        dir_t entry;
+        char name[13];
+        int count = 0;
+        for (bool found = storeD->readDir(&entry, true); found; found = storeD->readDir(&entry, false)) {
+            formatName(&entry, name);
+            output->print("file,");
+            output->print(name);
+            output->print(",");
+            output->println((unsigned long)entry.fileSize);
+            count++;
+        }
+        output->print("files,");
+        output->println(count);
+    }
+
+    bool FileTransfer::open(StoreD *storeD, const char name[], unsigned long offset, Print *output) {
+        this->close(output);
+        if (!storeD->openForReading(&this->file, name))
+            return false;
+        this->size = this->file.fileSize();
+        if (offset > this->size) {
+            this->file.close();
+            return false;
+        }
+
+        uint32_t endBlock;
+        this->storeD     = storeD;
+        this->opened     = true;
+        this->position   = offset;
+        this->contiguous = this->file.contiguousRange(&this->beginBlock, &endBlock);
+        return true;
+    }
+
+    void FileTransfer::close(Print *output) {
+        //ein abgeschnittener Frame wuerde LabView aus dem Takt bringen
+        this->finishFrame(output);
+        if (this->opened)
+            this->file.close();
+        this->opened = false;
+    }
+
+    bool FileTransfer::isActive() {
+        return this->opened || this->frameLength > 0;
+    }
+
+    bool FileTransfer::isInFrame() {
+        return this->sendOffset > 0;
+    }
+
+    void FileTransfer::finishFrame(Print *output) {
+        if (this->frameLength > 0)
+            output->write((const uint8_t *)&this->frame[this->sendOffset], this->frameLength - this->sendOffset);
+        this->frameLength = 0;
+        this->sendOffset  = 0;
+    }
+
+    bool FileTransfer::fill() {
+        char *data = &this->frame[8];
+        cmn::putLittleEndian(&this->frame[4], this->position, 4);
+
+        int length = 0;
+        if (this->position < this->size) {
+            //nach dem Fortsetzen endet der erste Frame an der Blockgrenze, danach nur ganze Bloecke
+            unsigned long blockOffset = this->position % SD_BLOCK_SIZE;
+            length = SD_BLOCK_SIZE - blockOffset;
+            if ((unsigned long)length > this->size - this->position)
+                length = this->size - this->position;
+
+            if (this->contiguous && blockOffset == 0 && length == SD_BLOCK_SIZE) {
+                if (!this->storeD->readBlock(this->beginBlock + this->position / SD_BLOCK_SIZE, (uint8_t *)data))
+                    return false;
+            } else if (!this->file.seekSet(this->position) || this->file.read(data, length) != length) {
+                return false;
+            }
+        }
+
+        this->frameLength = cmn::finishFrame(this->frame, SERIAL_BINARY_FILE, 4 + length);
+        this->sendOffset  = 0;
+        if (length == 0) { //Ende-Frame, die Datei wird nicht mehr gebraucht
+            this->file.close();
+            this->opened = false;
+        }
+        this->position += length;
+        return true;
+    }
+
+    bool FileTransfer::send(Print *output) {
+        for (int blocks = 0; blocks < SD_TRANSFER_SLICE; blocks++) {
+            if (this->frameLength == 0) {
+                if (!this->opened)
+                    return true;
+                if (!this->fill()) {
+                    srl->errorln("ERROR - Datei auf der SD-Karte nicht lesbar");
+                    this->close(output);
+                    return false;
+                }
+            }
+
+            int space = output->availableForWrite();
+            if (space <= 0)
+                return true;
+            int length = this->frameLength - this->sendOffset;
+            if (length > space)
+                length = space;
+
+            output->write((const uint8_t *)&this->frame[this->sendOffset], length);
+            this->sendOffset += length;
+            if (this->sendOffset < this->frameLength) //Rest im naechsten Durchlauf
+                return true;
+            this->frameLength = 0;
+            this->sendOffset  = 0;
+        }
+        return true;
+    }
+}
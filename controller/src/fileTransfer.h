@@ -0,0 +1,62 @@
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "config.h"
+#include "StoreD.h"
+#include "ownlibs/common.h"
+#include "ownlibs/serialCommunication.h"
+
+namespace storage {
+    // Uebertraegt Dateien der SD-Karte an LabView (<ls>, <get,Datei,Offset>). Eine Datei wird in
+    // Frames SERIAL_BINARY_FILE zu je einem Block von SD_BLOCK_SIZE Bytes gesendet, jeder mit
+    // seinem Offset in der Datei. Der Block wird direkt in den Frame gelesen, bei zusammenhaengenden
+    // Dateien (direkt geschriebene Messdateien) am Cache der SD-Bibliothek vorbei von der Karte.
+    // Ein Frame ohne Daten mit der Dateigroesse als Offset schliesst die Uebertragung ab. Nach einem
+    // Abbruch setzt LabView mit <get> ab dem ersten fehlenden Offset fort.
+    // Die Karte gehoert StoreD, waehrend einer Messung wird nichts uebertragen.
+    class FileTransfer {
+    public:
+        //Defaultconstructor
+        FileTransfer();
+        //Destructor
+        ~FileTransfer();
+        //Sendet "file,Name,Bytes" fuer jede Datei im Hauptverzeichnis und danach "files,Anzahl"
+        void list(StoreD *storeD, Print *output);
+        //Oeffnet 'name' ueber die Karte von storeD und sendet ab 'offset'. Eine laufende Uebertragung
+        //wird abgeloest, ihr angefangener Frame vorher noch vollstaendig gesendet. Gibt false zurueck,
+        //wenn die Datei fehlt oder 'offset' hinter ihrem Ende liegt
+        bool open(StoreD *storeD, const char name[], unsigned long offset, Print *output);
+        //Bricht die Uebertragung ab (angefangener Frame wird noch gesendet)
+        void close(Print *output);
+        //Es wird gerade eine Datei uebertragen
+        bool isActive();
+        //Ein Frame ist erst teilweise gesendet, andere Ausgaben muessen warten
+        bool isInFrame();
+        //Sendet den Rest eines angefangenen Frames, blockiert dafuer den Aufrufer
+        void finishFrame(Print *output);
+        //Sendet bis zu SD_TRANSFER_SLICE Bloecke, nur so viel wie die Schnittstelle ohne Warten
+        //aufnimmt. Der Rest eines Frames folgt im naechsten Aufruf. Gibt false zurueck, wenn die
+        //Datei nicht gelesen werden konnte, die Uebertragung ist dann beendet
+        bool send(Print *output);
+    private:
+        //Liest den Block ab 'position' in den Frame, gibt false bei einem Lesefehler zurueck
+        bool fill();
+
+        StoreD *storeD;
+        SdFile file;
+        bool opened;
+        bool contiguous;       //Datei liegt in aufeinanderfolgenden Bloecken ab beginBlock
+        uint32_t beginBlock;
+        unsigned long size;
+        unsigned long position; //Offset des naechsten Frames
+
+        char frame[4 + 4 + SD_BLOCK_SIZE + 2];
+        int frameLength; //0: kein Frame in Arbeit
+        int sendOffset;  //bereits gesendete Bytes des Frames
+    };
+}
+
+#endif
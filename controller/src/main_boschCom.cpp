@@ -4,42 +4,192 @@ namespace communication {
     Main_BoschCom::Main_BoschCom() {
         this->ready = false;
         this->currentValue = 0;
+        this->valueTime = 0;
+        this->errors = 0;
+        this->measuring = false;
+        this->intervall = BOSCH_SAMPLE_INTERVALL;
+        this->sampleIntervall = BOSCH_SAMPLE_INTERVALL;
+
+        this->readIndex = 0;
+        this->writeIndex = 0;
+        this->count = 0;
+        memset(&this->lastRecord, 0, sizeof(this->lastRecord));
+
+        this->filter = new SampleFilter(BOSCH_SAMPLE_BUFFER_SIZE);
+        this->filter->begin(BOSCH_FILTER, BOSCH_FILTER_LENGTH, BOSCH_FILTER_CUTOFF, 1000.0f / BOSCH_SAMPLE_INTERVALL);
+
+        //Register setzen, danach den Messwert lesen
+        this->transaction.adress = BOSCH_I2C_ADRESS;
+        this->transaction.txData[0] = BOSCH_DATA_REGISTER;
+        this->transaction.txLength = 1;
+        this->transaction.rxData = this->rxData;
+        this->transaction.rxLength = BOSCH_READ_LENGTH;
+        this->transaction.status = I2C_IDLE;
+
+        i2cBus->begin();
     }
     Main_BoschCom::~Main_BoschCom() {
+        delete this->filter;
 
     }
 
     void Main_BoschCom::setIntervall(int intervall) {
         this->intervall = intervall;
+        this->sampleIntervall = intervall < BOSCH_SAMPLE_INTERVALL ? intervall : BOSCH_SAMPLE_INTERVALL;
+
+        srl->info("BoschCom: Intervall gesetzt auf: ");
+        srl->infoln(this->intervall);
+        srl->info("BoschCom: Sensor wird gelesen alle (ms): ");
+        srl->infoln(this->sampleIntervall);
 
-        srl->print('D', "BoschCom: Intervall gesetzt auf: ");
-        srl->println('D', this->intervall);
+        //Abtastrate hat sich evtl. geaendert
+        this->filter->begin(BOSCH_FILTER, BOSCH_FILTER_LENGTH, BOSCH_FILTER_CUTOFF, 1000.0f / this->sampleIntervall);
     }
 
-    void Main_BoschCom::start(unsigned long time) {
+    void Main_BoschCom::start(uint64_t time) {
         this->ready = true;
         this->lastTime = time;
+
+        //Werte einer vorherigen Messung verwerfen
+        this->readIndex = this->writeIndex;
+        this->count = 0;
+        this->filter->reset();
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->resume();
     }
 
     int Main_BoschCom::getCurrentValue() {
         return this->currentValue;
     }
 
+    void Main_BoschCom::readRecord(boschRecord *record) {
+        this->processSamples();
+
+        if (this->count == 0) {
+            //kein neuer Messwert, z.B. weil der Sensor nicht antwortet
+            *record = this->lastRecord;
+            record->count = 0;
+            return;
+        }
+
+#if BOSCH_REDUCTION == BOSCH_REDUCE_MINMAX
+        record->values[0] = this->minimum;
+        record->values[1] = this->maximum;
+#elif BOSCH_REDUCTION == BOSCH_REDUCE_LAST
+        record->values[0] = this->last;
+#else
+        record->values[0] = this->sum / (long long)this->count;
+#endif
+        record->count = this->count;
+        record->time  = this->lastSampleTime;
+
+        this->lastRecord = *record;
+        this->count = 0;
+    }
+
+    void Main_BoschCom::pushSample(int32_t value, unsigned long time) {
+        //Kommt der StringBuilder nicht nach, gehen die Werte nicht verloren, sondern vorab in die Zusammenfassung ein
+        if (this->writeIndex - this->readIndex >= BOSCH_SAMPLE_BUFFER_SIZE)
+            this->processSamples();
+
+        boschSample *sample = &this->samples[this->writeIndex % BOSCH_SAMPLE_BUFFER_SIZE];
+        sample->time  = time;
+        sample->value = value;
+        this->writeIndex++;
+    }
+
+    void Main_BoschCom::processSamples() {
+        int amount = this->writeIndex - this->readIndex;
+        if (amount == 0)
+            return;
+
+        if (!this->filter->isActive()) {
+            for (int i = 0; i < amount; i++) {
+                boschSample *sample = &this->samples[(this->readIndex + i) % BOSCH_SAMPLE_BUFFER_SIZE];
+                this->accumulate(sample->value, sample->time);
+            }
+        } else {
+            //alle wartenden Werte als ein Block, der Filter rechnet vektorisiert
+            float in[BOSCH_SAMPLE_BUFFER_SIZE];
+            float out[BOSCH_SAMPLE_BUFFER_SIZE];
+            for (int i = 0; i < amount; i++)
+                in[i] = this->samples[(this->readIndex + i) % BOSCH_SAMPLE_BUFFER_SIZE].value;
+            this->filter->process(in, out, amount);
+            for (int i = 0; i < amount; i++)
+                this->accumulate(lroundf(out[i]), this->samples[(this->readIndex + i) % BOSCH_SAMPLE_BUFFER_SIZE].time);
+        }
+        this->readIndex = this->writeIndex;
+    }
+
+    void Main_BoschCom::accumulate(int32_t value, unsigned long time) {
+        if (this->count == 0) {
+            this->sum     = 0;
+            this->minimum = value;
+            this->maximum = value;
+        }
+        this->sum += value;
+        if (value < this->minimum)
+            this->minimum = value;
+        if (value > this->maximum)
+            this->maximum = value;
+        this->last = value;
+        this->lastSampleTime = time;
+        this->count++;
+    }
+
+    unsigned long Main_BoschCom::getValueTime() {
+        return this->valueTime;
+    }
+
+    unsigned long Main_BoschCom::getErrors() {
+        return this->errors;
+    }
+
 
     bool Main_BoschCom::loop() {
         //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
         if (kill_flag)
             return false;
 
-        if (this->ready) {
-            if (millis() >= this->lastTime) {
-                //Lese Sensor aus, speichere in this->currentValue;
-                //srl->print('D', millis());
-                //srl->println('D', " Messe Boschsensor ...");
+        //Vor dem Start gibt es nichts zu tun, start() weckt den Thread wieder auf
+        if (!this->ready) {
+            this->pause();
+            return true;
+        }
 
+        //Ergebnis der laufenden Abfrage uebernehmen
+        if (this->measuring && this->transaction.status != I2C_PENDING) {
+            this->measuring = false;
+            if (this->transaction.status == I2C_DONE) {
+                long value = 0;
+                for (int i = 0; i < BOSCH_READ_LENGTH; i++) {
+                    value = (value << 8) | this->rxData[i];
+                }
+                this->currentValue = value;
+                this->valueTime = this->transaction.timestamp;
+                this->pushSample(value, this->valueTime);
+            } else {
+                //der letzte gueltige Wert bleibt stehen
+                this->errors++;
+            }
+        }
 
-                this->lastTime += this->intervall;
+        if (cmn::micros64() >= this->lastTime) {
+            //Ist die vorherige Abfrage noch nicht fertig, faellt diese Messung aus
+            if (!this->measuring && i2cBus->submit(&this->transaction, true)) {
+                this->measuring = true;
             }
+
+            this->lastTime += this->sampleIntervall * 1000ULL;
+        }
+
+        if (this->measuring) {
+            //Die Abfrage dauert einige hundert us, danach das Ergebnis abholen
+            this->sleep_milli(1);
+        } else {
+            //Schlafe bis zur naechsten Messung
+            this->sleep_until_micro(cmn::wakeMicros(this->lastTime));
         }
 
         return true;
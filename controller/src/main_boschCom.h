@@ -5,30 +5,89 @@
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
 
+#include "config.h"
+#include "ownlibs/i2cBus.h"
+#include "ownlibs/sampleFilter.h"
 #include "ownlibs/serialCommunication.h"
+#include "ownlibs/common.h"
 
 namespace communication {
+    //Ein Messwert des Sensors
+    typedef struct boschSampleStruct {
+        unsigned long time; //micros() beim Abschluss der Uebertragung
+        int32_t value;
+    } boschSample;
+
+    //Zusammenfassung aller Messwerte eines Messintervalls, siehe BOSCH_REDUCTION
+    typedef struct boschRecordStruct {
+        int32_t values[BOSCH_VALUES]; //Mittelwert bzw. letzter Wert, bei BOSCH_REDUCE_MINMAX Minimum und Maximum
+        unsigned int count;           //Messwerte im Intervall, 0: keine neuen Werte, values stammen aus dem vorherigen Intervall
+        unsigned long time;           //Zeitstempel des letzten Messwertes
+    } boschRecord;
+
+    // Liest den Boschsensor alle BOSCH_SAMPLE_INTERVALL ms ueber den I2C-Bus, unabhaengig vom
+    // Messintervall. Die Abfrage wird mit Vorrang vor dem Display eingereiht, der Thread wartet
+    // nicht auf den Bus. Jeder Messwert traegt den Zeitpunkt, zu dem die Uebertragung im
+    // Interrupt abgeschlossen wurde, und kommt in einen Ringpuffer. Der StringBuilder holt je
+    // Zeile mit readRecord() alle seitdem gemessenen Werte als einen zusammengefassten Datensatz ab,
+    // zuvor laufen sie als ein Block durch den Filter (BOSCH_FILTER).
     class Main_BoschCom : public Thread {
     public:
         //Defaultconstructor
         Main_BoschCom();
         //Destructor
         ~Main_BoschCom();
-        //setzt Messintervall
+        //setzt Messintervall. Ist es kuerzer als BOSCH_SAMPLE_INTERVALL, wird mit dem Messintervall gelesen
         void setIntervall(int intervall);
         //aktiviert den Sensor, startet Messung
-        void start(unsigned long time);
+        void start(uint64_t time);
         //gibt aktuellen Messwert des Sensors zurueck
         int getCurrentValue();
+        //Fasst alle Messwerte seit dem letzten Aufruf nach BOSCH_REDUCTION zusammen und entfernt sie aus dem Puffer
+        void readRecord(boschRecord *record);
+        //gibt den Zeitpunkt (micros()) zurueck, zu dem der aktuelle Messwert gelesen wurde
+        unsigned long getValueTime();
+        //Anzahl fehlgeschlagener Abfragen
+        unsigned long getErrors();
     protected:
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
+        //Legt einen Messwert im Ringpuffer ab. Ist er voll, werden die wartenden Werte vorher zusammengefasst
+        void pushSample(int32_t value, unsigned long time);
+        //Filtert alle wartenden Messwerte als einen Block (BOSCH_FILTER) und nimmt sie in die Zusammenfassung auf
+        void processSamples();
+        //Nimmt einen Messwert in die laufende Zusammenfassung auf
+        void accumulate(int32_t value, unsigned long time);
+
         int intervall;
+        int sampleIntervall;
         bool ready;
-        unsigned long lastTime;
+        uint64_t lastTime; //naechste Abfrage (cmn::micros64())
 
         int currentValue;
+        unsigned long valueTime;
+        unsigned long errors;
+
+        i2cTransaction transaction;
+        uint8_t rxData[BOSCH_READ_LENGTH];
+        bool measuring; //Abfrage ist eingereiht oder laeuft
+
+        boschSample samples[BOSCH_SAMPLE_BUFFER_SIZE];
+        //Indizes laufen frei und werden modulo BOSCH_SAMPLE_BUFFER_SIZE verwendet
+        unsigned int readIndex;
+        unsigned int writeIndex;
+
+        //laufende Zusammenfassung des aktuellen Messintervalls
+        long long sum;
+        int32_t minimum;
+        int32_t maximum;
+        int32_t last;
+        unsigned int count;
+        unsigned long lastSampleTime;
+        boschRecord lastRecord; //wird wiederholt, wenn im Intervall kein Messwert kam
+
+        SampleFilter *filter;
     };
 }
 
@@ -0,0 +1,26 @@
+#include "main_debugLog.h"
+
+namespace communication {
+    Main_DebugLog::Main_DebugLog() {
+
+    }
+    Main_DebugLog::~Main_DebugLog() {
+
+    }
+
+    bool Main_DebugLog::loop() {
+        //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
+        if (kill_flag)
+            return false;
+
+        srl->drainDebug();
+
+        //Ist der Sendepuffer der Schnittstelle voll, wird es nach 1ms erneut versucht
+        if (srl->isDebugPending())
+            this->sleep_milli(1);
+        else
+            this->sleep_milli(SERIAL_DEBUG_DRAIN_INTERVALL);
+
+        return true;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef MAIN_DEBUGLOG_H
+#define MAIN_DEBUGLOG_H
+
+#include <Arduino.h>
+#include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
+#include <mthread.h>
+
+#include "ownlibs/serialCommunication.h"
+#include "config.h"
+
+namespace communication {
+    // Gibt die gepufferten Debugausgaben (SERIAL_DEBUG_BUFFERED) im Hintergrund aus. Pro Durchlauf
+    // wird nur so viel geschrieben, wie die Schnittstelle ohne Warten annimmt
+    class Main_DebugLog : public Thread {
+    public:
+        //Defaultconstructor
+        Main_DebugLog();
+        //Destructor
+        ~Main_DebugLog();
+    protected:
+        //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
+        bool loop();
+    };
+}
+
+#endif
@@ -10,6 +10,16 @@ namespace io {
         this->amountValve     = 0;
 
         this->ready           = false;
+        this->showingMessage  = false;
+        this->countsDirty     = true;
+        this->eventDirty      = true;
+        this->shownSeconds    = 0;
+
+        //Zeile 1 ist immer leer
+        for (int i = 0; i < DISPLAY_SIZE_HEIGHT; i++) {
+            memset(this->displayText[i], ' ', DISPLAY_SIZE_WIDTH);
+            this->displayText[i][DISPLAY_SIZE_WIDTH] = '\0';
+        }
 
         this->lastEvent_type  = 'x';
         this->lastEvent_id    = 5;
@@ -41,7 +51,7 @@ namespace io {
                 error_1000[arrayIndex][3]
             );
 
-            this->afterErrorTime = millis() + ERR_1000_TIME;
+            this->afterErrorTime = cmn::micros64() + ERR_1000_TIME * 1000ULL;
         } else
 
         if (errorNumber >= 5000 && errorNumber < 6000) {
@@ -55,8 +65,14 @@ namespace io {
                 error_5000[arrayIndex][3]
             );
 
-            this->afterErrorTime = millis() + ERR_5000_TIME;
+            this->afterErrorTime = cmn::micros64() + ERR_5000_TIME * 1000ULL;
         }
+
+        //nach dem Error werden alle Felder neu gezeichnet
+        this->showingMessage = true;
+
+        //wecke den Thread, damit er bis zum Ende der Erroranzeige schlaeft
+        this->resume();
     }
 
     void Main_Display::boardIsReady() {
@@ -68,9 +84,18 @@ namespace io {
         );
     }
 
+    void Main_Display::reset() {
+        this->ready       = false;
+        this->amountMFC   = 0;
+        this->amountValve = 0;
+        this->countsDirty = true;
+        this->boardIsReady();
+    }
+
     void Main_Display::header_started(int amountMFC, int amountValve) {
         this->amountMFC   = amountMFC;
         this->amountValve = amountValve;
+        this->countsDirty = true;
 
         this->display->updateDisplayMatrix(
             "   DATEN GESTARTET  ",
@@ -89,16 +114,25 @@ namespace io {
         );
     }
 
-    void Main_Display::event_finished() {
+    void Main_Display::event_finished(long moreEvents, unsigned long freeBytes) {
+        //"+Events:     nnnnnnn", "RAM frei:  nnnnnnn B"
+        char events[DISPLAY_SIZE_WIDTH + 1];
+        char memory[DISPLAY_SIZE_WIDTH + 1];
+        memcpy(events, "+Events:", 8);
+        *cmn::formatInt(&events[8], moreEvents, DISPLAY_SIZE_WIDTH - 8) = '\0';
+        memcpy(memory, "RAM frei:", 9);
+        char *out = cmn::formatInt(&memory[9], freeBytes, DISPLAY_SIZE_WIDTH - 11);
+        memcpy(out, " B", 3);
+
         this->display->updateDisplayMatrix(
             " EVENTLISTE KOMPLETT",
-            "                    ",
             "   Warte auf Start  ",
-            "     der Messung    "
+            events,
+            memory
         );
     }
 
-    void Main_Display::start(unsigned long startTime) {
+    void Main_Display::start(uint64_t startTime) {
         this->startTime = startTime;
         this->ready     = true;
 
@@ -110,7 +144,11 @@ namespace io {
         );
 
         //setze diese Meldung als Error, um Displayuasgabe fuer Zeit zu sperren
-        this->afterErrorTime = millis() + 500;
+        this->afterErrorTime = cmn::micros64() + 500000ULL;
+        this->showingMessage = true;
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->resume();
     }
 
     void Main_Display::setLastEvent (char type, int id, int value, unsigned int time) {
@@ -118,12 +156,53 @@ namespace io {
         this->lastEvent_id    = id;
         this->lastEvent_value = value;
         this->lastEvent_time  = time;
+
+        //nur beim ersten Event seit dem letzten Zeichnen wecken, weitere Events warten mit
+        if (!this->eventDirty) {
+            this->eventDirty = true;
+            if (this->ready)
+                this->resume();
+        }
     }
 
     void Main_Display::setLastEvent_id (int id) {
         this->lastEvent_id  = id;
     }
 
+    void Main_Display::renderCounts() {
+        //"         #M:nn #V:nn"
+        char *out = this->displayText[0];
+        memcpy(out, "         #M:", 12);
+        out = cmn::formatZeroPadded(out + 12, this->amountMFC, 2);
+        memcpy(out, " #V:", 4);
+        out = cmn::formatZeroPadded(out + 4, this->amountValve, 2);
+        *out = '\0';
+    }
+
+    void Main_Display::renderTime(unsigned long seconds) {
+        //"LAUFZEIT:DD:HH:MM:SS"
+        memcpy(this->displayText[2], "LAUFZEIT:", 9);
+        cmn::getTimeString(seconds * 1000, &this->displayText[2][9]);
+    }
+
+    void Main_Display::renderEvent() {
+        //"Tnn-wwww-DD:HH:MM:SS", zu lange Werte werden am Rand abgeschnitten
+        char buffer[48];
+        char *out = buffer;
+        *out++ = this->lastEvent_type;
+        out = cmn::formatZeroPadded(out, this->lastEvent_id, 2);
+        *out++ = '-';
+        out = cmn::formatZeroPadded(out, this->lastEvent_value, 4);
+        *out++ = '-';
+        cmn::getTimeString(this->lastEvent_time, out);
+
+        size_t length = strlen(buffer);
+        if (length > DISPLAY_SIZE_WIDTH)
+            length = DISPLAY_SIZE_WIDTH;
+        memcpy(this->displayText[3], buffer, length);
+        this->displayText[3][length] = '\0';
+    }
+
 
 
 
@@ -133,36 +212,61 @@ namespace io {
         if (kill_flag)
             return false;
 
-        if (millis() >= this->afterErrorTime) { //Errors haben Vorrang und blockieren Ausgabe
-            this->display->backlight_setColor(255,255,255);
-
-            if (this->ready && millis() >= this->lastPrint + DISPLAY_REDRAW_INTERVALL) {
-                //Erstelle String der letzten Event Zeit
-                char lastEventTime_string[12];
-                cmn::getTimeString(this->lastEvent_time, lastEventTime_string);
-
-                //Erstelle String der aktuellen Laufzeit, relativ zum Messstart
-                char currentTime_string[12];
-                cmn::getTimeString(millis() - this->startTime, currentTime_string);
-
-                //Baue Anzeigetext
-                char displayText [DISPLAY_SIZE_HEIGHT][DISPLAY_SIZE_WIDTH +1]; //TODO: Eins groesser, da '\0'
-                sprintf(displayText[0], "         #M:%02d #V:%02d\0", this->amountMFC, this->amountValve);
-                sprintf(displayText[1], "                    \0");
-                sprintf(displayText[2], "LAUFZEIT:%s", currentTime_string);
-                sprintf(displayText[3], "%c%02d-%04d-%s", this->lastEvent_type, this->lastEvent_id, this->lastEvent_value, lastEventTime_string);
-
-                this->display->updateDisplayMatrix(
-                    displayText[0],
-                    displayText[1],
-                    displayText[2],
-                    displayText[3]
-                );
-
-                this->lastPrint = millis();
+        uint64_t now = cmn::micros64();
+        if (now >= this->afterErrorTime) { //Errors haben Vorrang und blockieren Ausgabe
+            //Error bzw. Startmeldung ist abgelaufen, alle Felder neu zeichnen
+            bool redrawAll = this->showingMessage;
+            if (redrawAll) {
+                this->display->backlight_setColor(255,255,255);
+                this->showingMessage = false;
+            }
+
+            if (this->ready) {
+                unsigned long seconds = now > this->startTime ? (now - this->startTime) / 1000000 : 0;
+                bool timeDirty = seconds != this->shownSeconds;
+                bool eventDue  = this->eventDirty && now >= this->lastPrint + DISPLAY_REDRAW_INTERVALL * 1000ULL;
+
+                if (redrawAll || timeDirty || eventDue) {
+                    if (redrawAll || this->countsDirty)
+                        this->renderCounts();
+                    if (redrawAll || timeDirty)
+                        this->renderTime(seconds);
+                    if (redrawAll || this->eventDirty)
+                        this->renderEvent();
+                    this->countsDirty  = false;
+                    this->eventDirty   = false;
+                    this->shownSeconds = seconds;
+
+                    //vergleicht zeilenweise und reiht nur geaenderte Zeichen ein
+                    this->display->updateDisplayMatrix(
+                        this->displayText[0],
+                        this->displayText[1],
+                        this->displayText[2],
+                        this->displayText[3]
+                    );
+
+                    this->lastPrint = now;
+                }
             }
         }
 
+        //Das Display uebertraegt im Hintergrund. Solange Zeichen warten, wird jede ms nachgereicht,
+        //sonst bis zum Ende der Erroranzeige, zur naechsten Sekunde oder bis ein wartendes Event
+        //gezeichnet werden darf geschlafen. Ohne laufende Messung wird pausiert, bis throwError()
+        //oder start() den Thread wecken
+        if (this->display->update()) {
+            this->sleep_milli(1);
+        } else if (cmn::micros64() < this->afterErrorTime) {
+            this->sleep_until_micro(cmn::wakeMicros(this->afterErrorTime));
+        } else if (this->ready) {
+            uint64_t wakeTime = this->startTime + (this->shownSeconds + 1) * 1000000ULL;
+            if (this->eventDirty && this->lastPrint + DISPLAY_REDRAW_INTERVALL * 1000ULL < wakeTime)
+                wakeTime = this->lastPrint + DISPLAY_REDRAW_INTERVALL * 1000ULL;
+            this->sleep_until_micro(cmn::wakeMicros(wakeTime));
+        } else {
+            this->pause();
+        }
+
         return true;
     }
 }
@@ -4,7 +4,6 @@
 #include <Arduino.h>
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
-#include <Wire.h>
 
 #include "ownlibs/lcd_I2C.h"
 #include "ownlibs/serialCommunication.h"
@@ -13,6 +12,11 @@
 #include "errors.h"
 
 namespace io {
+    // Anzeige auf dem LCD. Waehrend der Messung besteht die Anzeige aus Feldern (Anzahl MFC/Ventile,
+    // Laufzeit, letztes Event), die nur neu formatiert werden, wenn sie sich geaendert haben:
+    // setLastEvent() und header_started() markieren ihr Feld, die Laufzeit jede volle Sekunde.
+    // Der Thread schlaeft bis zur naechsten Sekunde bzw. bis ein Feld markiert wird, Events werden
+    // hoechstens alle DISPLAY_REDRAW_INTERVALL ms gezeichnet.
     class Main_Display : public Thread {
     public:
         //Defaultconstructor
@@ -27,10 +31,13 @@ namespace io {
         void header_started(int amountMFC, int amountValve);
         //Zeige an, dass Header vollstanedig + Event-Uebertragung gestartet
         void event_started();
-        //Zeige an, dass Event-Uebertragung dertig und Mess-Start erwartet wird
-        void event_finished();
+        //Zeige an, dass Event-Uebertragung dertig und Mess-Start erwartet wird, mit dem Platz fuer
+        //weitere Events je Kanal und dem freien RAM in Bytes
+        void event_finished(long moreEvents, unsigned long freeBytes);
         //Messung gestartet, beginne Live-Ausgabe
-        void start(unsigned long startTime);
+        void start(uint64_t startTime);
+        //Beendet die Live-Ausgabe und zeigt wieder "Board bereit" (<rearm>)
+        void reset();
         //setze letzt ausgefuehrtes Event zur Displayausgabe
         void setLastEvent(char type, int id, int value, unsigned int time);
 
@@ -40,12 +47,25 @@ namespace io {
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
-        unsigned long afterErrorTime;
-        unsigned long lastPrint;
-        unsigned long startTime;
+        //Formatieren die Felder in displayText, ohne sprintf
+        void renderCounts();
+        void renderTime(unsigned long seconds);
+        void renderEvent();
+
+        //Zeitpunkte in cmn::micros64(), auch eine Woche Erroranzeige (ERR_5000_TIME) laeuft nicht ueber
+        uint64_t afterErrorTime;
+        uint64_t lastPrint;
+        uint64_t startTime;
         int amountMFC;
         int amountValve;
         bool ready;
+        bool showingMessage; //Error oder Startmeldung verdeckt die Felder
+
+        //Anzeigetext waehrend der Messung, jede Zeile ist ein Feld
+        char displayText[DISPLAY_SIZE_HEIGHT][DISPLAY_SIZE_WIDTH + 1];
+        bool countsDirty;
+        bool eventDirty;
+        unsigned long shownSeconds; //angezeigte Laufzeit in s
 
         //lastEvent-Variablen
         char lastEvent_type;
@@ -1,13 +1,55 @@
 #include "main_labCom.h"
+#include "ownlibs/commandTable.h"
 
 namespace communication {
     Main_LabCom::Main_LabCom() {
+        this->link  = srl->getStream('L');
+        this->input = this->link;
+
         this->reading = true;
         this->sending = false;
 
+        this->reportedDropped   = 0;
+        this->reportedDecimated = 0;
+        this->lastReportTime    = 0;
+        this->latencyRequested  = false;
+        this->uploadRequested   = false;
+        this->memoryRequested   = false;
+        this->triggerRequested  = false;
+        this->syncRequested     = false;
+        this->listRequested     = false;
+        this->stopping          = false;
+
+        this->streaming            = false;
+        this->streamRejected       = 0;
+        this->reportedTaken        = 0;
+        this->reportedRejected     = 0;
+        this->lastStreamReportTime = 0;
+        this->streamHeld           = false;
+        this->repeatDepth          = 0;
+
+        this->windowed        = false;
+        this->windowAckEvery  = SERIAL_WINDOW_ACK_EVERY;
+        this->sequence        = 0;
+        this->unacked         = 0;
+        this->lastLineTime    = 0;
+
         this->headerLineCounter = 0;
+        this->eventCapacity   = 0;
+        this->restartable     = false;
+        this->startArmed      = false;
+        this->programRejected = false;
 
-        srl->println('D', "LabCom erstellt.");
+        this->bufferCharIndex = 0;
+        this->lineInProgress  = false;
+        this->discardLine     = false;
+        this->lineStartTime   = 0;
+        this->receivedBytes   = 0;
+
+        this->binaryMode = false;
+        this->frameState = FRAME_SYNC;
+
+        srl->infoln("LabCom erstellt.");
         srl->println('L', "ready"); //Sende Startbefehl an LabView
     }
     Main_LabCom::~Main_LabCom() {
@@ -35,89 +77,466 @@ namespace communication {
         this->main_stringBuilder = main_stringBuilder;
     }
 
-    int Main_LabCom::readLine() { //TODO Serial.labview hier
-        this->bufferCharIndex = 0; //setze index auf Startposition zurueck
-        unsigned long startTime = millis();
-
-        //Lese so lange, bis Zeile vollstaendig empfangen wurde, oder Timeout erreicht wurde (Main-Thread wird blockiert)
-        while(millis() < startTime + SERIAL_READ_TIMEOUT) {
-            if (Serial.available() > 0) { //Lese Daten, wenn vorhanden
-                this->inDataBuffer[this->bufferCharIndex] = Serial.read(); //Serial.read() gibt einen einzelnen Char zurueck
-
-                //UEBERPRUEFUNG
-                if (this->bufferCharIndex == 0) {
-                    if (this->inDataBuffer[this->bufferCharIndex] != '<') { //erstes Zeichen muss oeffnender Tag sein
-                        if (this->inDataBuffer[this->bufferCharIndex] == '\n') //Sortiere Strings ohne Inhalt aus
-                            return -1;
-
-                        srl->println('D', "ERROR - Falscher Zeilenbeginn");
-                        //lese String dennoch bis Zum Ende um mehrfache "Falscher Beginn" Meldung zu verhindern
-                        char searchForEnd = ' ';
-                        while (searchForEnd != '\n') {
-                            searchForEnd = Serial.read();
-                        }
-                        return ERR_SERIAL_READ_WRONG_LINE_BEGIN;
-                    }
+    void Main_LabCom::setMainTimelineObjectPointer(control::Main_Timeline *main_timeline) {
+        this->main_timeline = main_timeline;
+    }
+
+    bool Main_LabCom::loadProgram(const char name[]) {
+        if (!this->programFile.open(this->main_stringBuilder->getStoreD(), name))
+            return false;
+
+        srl->info("Lese Messprogramm von der SD-Karte: ");
+        srl->info(name);
+        srl->info(" (");
+        srl->info(this->programFile.getSize());
+        srl->infoln(" Bytes)");
+        return true;
+    }
+
+    void Main_LabCom::selectInput() {
+        if (this->programFile.isOpen() && this->programFile.isFinished() && !this->lineInProgress
+                && this->frameState == FRAME_SYNC) {
+            srl->info("Messprogramm gelesen: ");
+            srl->info(this->programFile.getPosition());
+            srl->infoln(" Bytes");
+            this->programFile.close();
+        }
+
+        if (!this->programFile.isOpen()) {
+            this->input = this->link;
+        } else if (this->reading) {
+            //Vor dem Start nur die Datei, Zeilen von LabView wuerden sich mit dem Header vermischen
+            this->input = &this->programFile;
+        } else {
+            //Waehrend der Messung hat LabView Vorrang (z.B. <stop>). Die Zeilen der Datei sind immer
+            //vollstaendig gelesen, eine begonnene Zeile stammt also von LabView
+            bool linkBusy = this->lineInProgress || this->discardLine || this->link->available() > 0;
+            this->input = (linkBusy || this->streamHeld) ? this->link : (Stream *)&this->programFile;
+        }
+    }
+
+    int Main_LabCom::readLine() {
+        //Timeout wird als Zustand geprueft, statt auf die restlichen Zeichen zu warten
+        if ((this->lineInProgress || this->discardLine) && millis() - this->lineStartTime >= SERIAL_READ_TIMEOUT) {
+            this->lineInProgress = false;
+            if (this->discardLine) { //verworfene Zeile ohne Ende, kein weiterer Fehler
+                this->discardLine = false;
+                return 0;
+            }
+            this->inDataBuffer[this->bufferCharIndex] = '\0';
+            srl->error("ERROR - Timeout: ");
+            srl->errorln(this->inDataBuffer);
+            return ERR_SERIAL_READ_TIMEOUT; //Timeout
+        }
+
+        //Lese nur die bereits empfangenen Zeichen, der Rest folgt beim naechsten Aufruf (Main-Thread wird nicht blockiert)
+        while (this->input->available() > 0) {
+            char inChar = this->input->read(); //read() gibt einen einzelnen Char zurueck
+            this->receivedBytes++;
+
+            //Nach einem Fehler wird der Rest der Zeile verworfen, um Folgefehler zu verhindern
+            if (this->discardLine) {
+                if (inChar == '\n')
+                    this->discardLine = false;
+                continue;
+            }
+
+            if (!this->lineInProgress) { //neue Zeile beginnt
+                this->bufferCharIndex = 0; //setze index auf Startposition zurueck
+                this->lineStartTime   = millis();
+                this->lineInProgress  = true;
+            }
+            this->inDataBuffer[this->bufferCharIndex] = inChar;
+
+            //UEBERPRUEFUNG
+            if (this->bufferCharIndex == 0) {
+                if (inChar != '<') { //erstes Zeichen muss oeffnender Tag sein
+                    this->lineInProgress = false;
+                    if (inChar == '\n') //Sortiere Strings ohne Inhalt aus
+                        return -1;
+
+                    srl->errorln("ERROR - Falscher Zeilenbeginn");
+                    //verwerfe String dennoch bis Zum Ende um mehrfache "Falscher Beginn" Meldung zu verhindern
+                    this->discardLine = true;
+                    return ERR_SERIAL_READ_WRONG_LINE_BEGIN;
                 }
-                if (this->inDataBuffer[this->bufferCharIndex] == '\n') { //Zeile zuende
-                    if (this->inDataBuffer[this->bufferCharIndex -1] != '>') { //vorheriges Zeichen muss schliessender Tag sein
-                        srl->println('D', "ERROR - Falsches Zeilenende");
-                        return ERR_SERIAL_READ_WRONG_LINE_ENDING;
-                    } else { //vollstaendiger String abgeschlossen
-                        this->inDataBuffer[this->bufferCharIndex +1] = '\0';
-                        srl->println('D', "");
-                        srl->print('D', "Eingabestring akzeptiert: ");
-                        srl->print('D', this->inDataBuffer);
-                        return 1;
-                    }
+            }
+            if (inChar == '\n') { //Zeile zuende
+                this->lineInProgress = false;
+                if (this->inDataBuffer[this->bufferCharIndex -1] != '>') { //vorheriges Zeichen muss schliessender Tag sein
+                    srl->errorln("ERROR - Falsches Zeilenende");
+                    return ERR_SERIAL_READ_WRONG_LINE_ENDING;
+                } else { //vollstaendiger String abgeschlossen
+                    this->inDataBuffer[this->bufferCharIndex +1] = '\0';
+                    srl->traceln("");
+                    srl->trace("Eingabestring akzeptiert: ");
+                    srl->trace(this->inDataBuffer);
+                    return 1;
                 }
+            }
 
-                this->bufferCharIndex++;
-                if (this->bufferCharIndex == SERIAL_READ_MAX_LINE_SIZE) {
-                    return ERR_SERIAL_READ_MAX_STRING_SIZE;
-                    srl->println('D', "ERROR - Eingabestring zu lang");
-                }
+            this->bufferCharIndex++;
+            if (this->bufferCharIndex >= SERIAL_READ_MAX_LINE_SIZE -1) { //Platz fuer '\0' freihalten
+                srl->errorln("ERROR - Eingabestring zu lang");
+                this->lineInProgress = false;
+                this->discardLine    = true;
+                return ERR_SERIAL_READ_MAX_STRING_SIZE;
             }
         }
-        srl->print('D', "ERROR - Timeout: ");
-        srl->println('D', this->inDataBuffer);
-        return ERR_SERIAL_READ_TIMEOUT; //Timeout
+        return 0; //Zeile noch nicht vollstaendig
     }
 
     int Main_LabCom::splitLine() {
-        int currentCharIndex = 0;
+        int currentCharIndex = 1; //Zeichen 0 ist zu ignorieren ('<')
         int endCharIndex = this->bufferCharIndex -1; //da letztes Zeichen '>' ist
 
-        //Schleife, die durch die Ziel-Array-Indexe navigiert
-        for (int arrayIndex = 0; arrayIndex < SERIAL_READ_MAX_BLOCK_AMOUNT; arrayIndex++) {
-            //Schleife, die durch die Char-Positionen eines Ziel-Array-Eintrags navigiert
-            for (int arrayCharIndex = 0; arrayCharIndex < SERIAL_READ_MAX_BLOCK_SIZE; arrayCharIndex++) {
-                currentCharIndex++; //Wird anfangs um 1 erhoet, Zeichen 1 ist zu ignorieren ('<')
+        this->fieldAmount = 0;
+        while (true) {
+            if (this->fieldAmount == SERIAL_READ_MAX_BLOCK_AMOUNT) {
+                srl->errorln("ERROR - Zu viele Eintraege");
+                return ERR_SERIAL_READ_MAX_BLOCK_AMOUNT;
+            }
+
+            //Ueberspringe Leerzeichen am Anfang des Eintrags
+            while (currentCharIndex < endCharIndex && this->inDataBuffer[currentCharIndex] == ' ') {
+                currentCharIndex++;
+            }
+            int fieldBegin = currentCharIndex;
+
+            //Suche das Ende des Eintrags (',' oder '>')
+            while (currentCharIndex < endCharIndex && this->inDataBuffer[currentCharIndex] != ',') {
+                currentCharIndex++;
+            }
+            int fieldEnd = currentCharIndex;
+
+            //Entferne Leerzeichen am Ende des Eintrags
+            while (fieldEnd > fieldBegin && this->inDataBuffer[fieldEnd -1] == ' ') {
+                fieldEnd--;
+            }
+
+            if (fieldEnd - fieldBegin >= SERIAL_READ_MAX_BLOCK_SIZE) { //Platz fuer '\0' wie bei den Zielen (z.B. MFC-Adresse)
+                srl->errorln("ERROR - Eintrag zu lang");
+                return ERR_SERIAL_READ_MAX_BLOCK_SIZE;
+            }
+
+            bool lastField = (currentCharIndex == endCharIndex);
+            this->inDataBuffer[fieldEnd] = '\0'; //ersetzt ',', '>' oder ein Leerzeichen
+            this->inDataFields[this->fieldAmount] = &this->inDataBuffer[fieldBegin];
+            this->fieldAmount++;
+
+            if (lastField)
+                break;
+            currentCharIndex++; //Ueberspringe ','
+        }
+
+        //Fehlende Eintraege sind leer, statt auf Reste der vorherigen Zeile zu zeigen
+        for (int i = this->fieldAmount; i < SERIAL_READ_MAX_BLOCK_AMOUNT; i++) {
+            this->inDataFields[i] = (char *)"";
+        }
+        return 1;
+    }
+
+    int Main_LabCom::readFrame() {
+        //Timeout wie bei readLine(), beginnt mit dem Startbyte
+        if (this->frameState != FRAME_SYNC && millis() - this->lineStartTime >= SERIAL_READ_TIMEOUT) {
+            this->frameState = FRAME_SYNC;
+            srl->errorln("ERROR - Timeout Binaerframe");
+            return ERR_SERIAL_READ_TIMEOUT;
+        }
+
+        while (this->input->available() > 0) {
+            uint8_t inByte = this->input->read();
+            this->receivedBytes++;
 
-                if (this->inDataBuffer[currentCharIndex] == ',') { //Eintrag zu ende
-                    this->inDataArray[arrayIndex][arrayCharIndex] = '\0';
-                    cmn::trim(this->inDataArray[arrayIndex]);
+            switch (this->frameState) {
+                case FRAME_SYNC: //Bytes vor dem Startbyte werden ignoriert
+                    if (inByte == SERIAL_BINARY_SYNC) {
+                        this->lineStartTime = millis();
+                        this->frameCrc      = 0xFFFF;
+                        this->frameState    = FRAME_TYPE;
+                    }
                     break;
-                }
+                case FRAME_TYPE:
+                    this->frameType  = inByte;
+                    this->frameCrc   = cmn::crc16(this->frameCrc, inByte);
+                    this->frameState = FRAME_LENGTH_LOW;
+                    break;
+                case FRAME_LENGTH_LOW:
+                    this->frameLength = inByte;
+                    this->frameCrc    = cmn::crc16(this->frameCrc, inByte);
+                    this->frameState  = FRAME_LENGTH_HIGH;
+                    break;
+                case FRAME_LENGTH_HIGH:
+                    this->frameLength |= (int)inByte << 8;
+                    this->frameCrc     = cmn::crc16(this->frameCrc, inByte);
+                    if (this->frameLength > SERIAL_READ_MAX_LINE_SIZE) {
+                        srl->errorln("ERROR - Binaerframe zu lang");
+                        this->frameState = FRAME_SYNC;
+                        return ERR_SERIAL_READ_MAX_STRING_SIZE;
+                    }
+                    this->bufferCharIndex = 0;
+                    this->frameState = (this->frameLength > 0) ? FRAME_PAYLOAD : FRAME_CRC_LOW;
+                    break;
+                case FRAME_PAYLOAD:
+                    this->inDataBuffer[this->bufferCharIndex] = inByte;
+                    this->bufferCharIndex++;
+                    this->frameCrc = cmn::crc16(this->frameCrc, inByte);
+                    if (this->bufferCharIndex == this->frameLength)
+                        this->frameState = FRAME_CRC_LOW;
+                    break;
+                case FRAME_CRC_LOW:
+                    this->receivedCrc = inByte;
+                    this->frameState  = FRAME_CRC_HIGH;
+                    break;
+                case FRAME_CRC_HIGH:
+                    this->receivedCrc |= (uint16_t)inByte << 8;
+                    this->frameState   = FRAME_SYNC;
+                    if (this->receivedCrc != this->frameCrc) {
+                        srl->errorln("ERROR - CRC des Binaerframes ungueltig");
+                        return ERR_SERIAL_BINARY_CRC;
+                    }
+                    return 1;
+            }
+        }
+        return 0; //Frame noch nicht vollstaendig
+    }
 
-                if (currentCharIndex == endCharIndex) { //Zeilenende erreicht
-                    this->inDataArray[arrayIndex][arrayCharIndex] = '\0';
-                    cmn::trim(this->inDataArray[arrayIndex]);
-                    return arrayIndex +1; //Index und Groesse sind immer um 1 verschieden
-                }
+    int Main_LabCom::processFrame() {
+        if (this->programRejected) //Events eines abgelehnten Programms werden verworfen
+            return this->frameType == SERIAL_BINARY_END ? this->rearm() : 1;
+
+        if (this->frameType == SERIAL_BINARY_EVENTS) {
+            if (this->frameLength % SERIAL_BINARY_RECORD_SIZE != 0)
+                return ERR_SERIAL_BINARY_FRAME;
 
-                this->inDataArray[arrayIndex][arrayCharIndex] = this->inDataBuffer[currentCharIndex];
+            //Datensaetze werden byteweise gelesen, damit die Ausrichtung im Puffer keine Rolle spielt
+            int errCode = 1;
+            for (int offset = 0; offset < this->frameLength; offset += SERIAL_BINARY_RECORD_SIZE) {
+                const uint8_t *record = (const uint8_t *)&this->inDataBuffer[offset];
+                control::eventElement event;
+                event.value    = (int16_t)(record[2] | (record[3] << 8));
+                event.time     = (unsigned long)record[4] | ((unsigned long)record[5] << 8) |
+                                 ((unsigned long)record[6] << 16) | ((unsigned long)record[7] << 24);
+                event.rampStep = 0;
+
+                int result = (char)record[0] == 'R' ? ERR_SERIAL_BINARY_FRAME //Rampen nur als Textzeile
+                                                    : this->storeEvent((char)record[0], record[1], event);
+                if (result != 1) //restliche Events werden trotzdem gespeichert, gemeldet wird der letzte Fehler
+                    errCode = result;
             }
+            return errCode;
+        } else if (this->frameType == SERIAL_BINARY_END) {
+            this->finishEvents();
+            return 1;
+        }
+        return ERR_SERIAL_BINARY_FRAME;
+    }
+
+    int Main_LabCom::storeEvent(char type, int id, const control::eventElement &event) {
+        bool stored;
+        if (type == 'M') { //MFC
+            if (id < 0 || id >= this->amount_MFC)
+                return ERR_SERIAL_UNDEFINED_INDEX;
+            stored = this->main_mfcCtrl->setEvent(id, event.value, event.time);
+        } else if (type == 'R') { //Rampe eines MFCs
+            if (id < 0 || id >= this->amount_MFC)
+                return ERR_SERIAL_UNDEFINED_INDEX;
+            stored = this->main_mfcCtrl->setRamp(id, event.value, event.rampValue, event.time, event.rampDuration, event.rampStep);
+        } else if (type == 'V') { //Ventil
+            if (id < 0 || id >= this->amount_valve)
+                return ERR_SERIAL_UNDEFINED_INDEX;
+            stored = this->main_valveCtrl->setEvent(id, event.value, event.time);
+        } else {
+            return ERR_SERIAL_BINARY_FRAME;
+        }
+
+        if (!stored)
+            return ERR_EVENT_STORE_FULL;
+        if (this->reading) //nachgeladene Events zaehlen nicht zum Einlesen (<upload>)
+            this->upload.addEvents(1);
+        return 1;
+    }
+
+    bool Main_LabCom::parseEvent(char *type, int *id, control::eventElement *event) {
+        *type = this->inDataFields[0][0];
+        if ((*type != 'M' && *type != 'V' && *type != 'R') || this->inDataFields[0][1] != '\0')
+            return false;
+
+        *id          = atoi(this->inDataFields[1]); //MFC-/Ventil-ID
+        event->value = atoi(this->inDataFields[2]); //value bzw. Startwert
+        if (*type == 'R') {
+            event->rampValue    = atoi(this->inDataFields[3]);
+            event->time         = strtoul(this->inDataFields[4], NULL, 0);
+            event->rampDuration = strtoul(this->inDataFields[5], NULL, 0);
+            event->rampStep     = strtoul(this->inDataFields[6], NULL, 0);
+        } else {
+            event->time     = strtoul(this->inDataFields[3], NULL, 0); //time (unsigned long)
+            event->rampStep = 0;
+        }
+        return true;
+    }
+
+    int Main_LabCom::beginRepeat(unsigned long count, unsigned long period) {
+        if (count == 0 || period == 0 || this->repeatDepth >= EVENT_REPEAT_DEPTH) {
+            srl->errorln("ERROR - Wiederholungsblock ungueltig oder zu tief verschachtelt");
+            return ERR_EVENT_REPEAT;
+        }
+
+        this->repeatDepth++;
+        bool stored = this->main_mfcCtrl->setRepeat(count, period);
+        stored &= this->main_valveCtrl->setRepeat(count, period);
+        return stored ? 1 : this->rejectRepeat();
+    }
+
+    int Main_LabCom::endRepeat() {
+        if (this->repeatDepth == 0) {
+            srl->errorln("ERROR - <endrepeat> ohne <repeat>");
+            return ERR_EVENT_REPEAT;
+        }
+
+        this->repeatDepth--;
+        bool stored = this->main_mfcCtrl->endRepeat();
+        stored &= this->main_valveCtrl->endRepeat();
+        return stored ? 1 : this->rejectRepeat();
+    }
+
+    int Main_LabCom::rejectRepeat() {
+        //Die Bloecke der Kanaele passen nicht mehr zusammen, ein spaeteres <endrepeat> wuerde in
+        //einem Kanal den falschen Block schliessen
+        srl->errorln("ERROR - Wiederholungsblock passt nicht in den Eventspeicher, Zeilen bis <end> werden verworfen");
+        this->programRejected = true;
+        this->repeatDepth     = 0;
+        return ERR_EVENT_STORE_FULL;
+    }
+
+    int Main_LabCom::closeRepeats() {
+        if (this->repeatDepth == 0)
+            return 1;
+
+        srl->errorln("ERROR - Wiederholungsblock ohne <endrepeat>");
+        while (this->repeatDepth > 0) {
+            this->endRepeat();
         }
+        return ERR_EVENT_REPEAT;
     }
 
-    void Main_LabCom::start() {
-        //Aendere Seriellen Modus
+    void Main_LabCom::finishEvents() {
+        this->upload.finishPhase(UploadStats::UPLOAD_EVENTS, micros());
+        srl->infoln("Uebertragung abgeschlossen.");
+
+        //Nach der Eventliste wird wieder im Textformat gelesen (<start>)
+        this->binaryMode = false;
+
+        //Stand der Eventlisten fuer <restart>, bevor die Zeitleiste die ersten Events entnimmt
+        this->main_mfcCtrl->markProgram();
+        this->main_valveCtrl->markProgram();
+        this->restartable = true;
+
+#if EVENT_TIMELINE_MERGED
+        //fuehre alle Eventlisten zu einer Zeitleiste zusammen
+        this->main_timeline->build();
+#endif
+
+        this->arm();
+
+        //Sage Display, dass Event-Uebertragung abgeschlossen ist, mit dem Platz fuer weitere Events.
+        //LabView bekommt dasselbe wie auf <memory>
+        unsigned long eventBytes, moreTotal;
+        int maxEventBytes, moreEach;
+        this->measureEventStores(&eventBytes, &maxEventBytes, &moreEach, &moreTotal);
+        this->main_display->event_finished(moreEach, memoryStats->getFree());
+        this->memoryRequested = true;
+
+        this->headerLineCounter = 7;
+        this->upload.finishPhase(UploadStats::UPLOAD_END, micros());
+    }
+
+    int Main_LabCom::beginStream() {
+#if EVENT_TIMELINE_MERGED
+        //Die Zeitleiste wird einmalig nach <end> aufgebaut und kann keine Events nachladen
+        srl->errorln("ERROR - Streaming mit EVENT_TIMELINE_MERGED nicht moeglich");
+        return ERR_STREAM_UNAVAILABLE;
+#else
+        //nachgeladene Events ueberschreiben die ausgefuehrten, <restart> ist danach nicht moeglich
+        this->restartable      = false;
+        this->streaming        = true;
+        this->streamRejected   = 0;
+        this->reportedTaken    = 0;
+        this->reportedRejected = 0;
+        this->main_mfcCtrl->setStreaming(true);
+        this->main_valveCtrl->setStreaming(true);
+        this->arm(); //Ventile ohne Events warten jetzt auf nachgeladene
+        srl->infoln("Streaming-Modus aktiviert.");
+        return 1;
+#endif
+    }
+
+    void Main_LabCom::sendStreamReport(Print *output) {
+        int amountMFC   = this->main_mfcCtrl->getAmountMFC();
+        int amountValve = this->main_valveCtrl->getAmountValve();
+#if TELEMETRY_DELTA_FRAMES
+        char frame[4 + 4 * (1 + MAX_AMOUNT_MFC + MAX_AMOUNT_VALVE) + 2];
+        char *out = cmn::putLittleEndian(&frame[4], this->streamRejected, 4);
+        for (int i = 0; i < amountMFC; i++)
+            out = cmn::putLittleEndian(out, this->main_mfcCtrl->getMFC(i)->getTakenEvents(), 4);
+        for (int i = 0; i < amountValve; i++)
+            out = cmn::putLittleEndian(out, this->main_valveCtrl->getValve(i)->getTakenEvents(), 4);
+        output->write((const uint8_t *)frame, cmn::finishFrame(frame, SERIAL_BINARY_STREAM, out - &frame[4]));
+#else
+        output->print("stream,");
+        output->print(this->streamRejected);
+        for (int i = 0; i < amountMFC; i++) {
+            output->print(",");
+            output->print(this->main_mfcCtrl->getMFC(i)->getTakenEvents());
+        }
+        for (int i = 0; i < amountValve; i++) {
+            output->print(",");
+            output->print(this->main_valveCtrl->getValve(i)->getTakenEvents());
+        }
+        output->println();
+#endif
+    }
+
+    void Main_LabCom::arm() {
+        //Die Messdatei belegt ab hier die Karte
+        this->fileTransfer.close(srl->getType('L'));
+        this->main_mfcCtrl->arm();
+        this->main_valveCtrl->arm();
+        //das Messprogramm wird evtl. waehrend der Messung noch von der Karte gelesen
+        this->main_stringBuilder->getStoreD()->setCardShared(this->programFile.isOpen());
+        this->main_stringBuilder->arm();
+
+        startTrigger->clear();
+        syncPulse->clear();
+        this->startArmed = true;
+    }
+
+    void Main_LabCom::start(char source, uint64_t triggerTime) {
+        //Aendere Seriellen Modus, waehrend der Messung gibt es keine Bestaetigungen mehr. Die
+        //Bestaetigung gilt auch der Zeile mit <start>, sie wird erst nach dem Befehl gezaehlt
+        if (this->windowed)
+            this->sendAck();
         this->reading = false;
         this->sending = true;
+        this->windowed = false;
+
+        //Schaltverzoegerung wird ab dieser Messung erfasst, die Objekte setzen ihre eigene beim Start zurueck
+        eventLatency->reset();
+        //Profil der Threads (MTHREAD_PROFILE) ab dem Start der Messung
+        main_thread_list->reset_profile();
+
+#if SYNC_MODE == SYNC_MODE_MASTER
+        //Die Slaves setzen ihren Nullpunkt hinter die Flanke des Startpulses, sie gilt daher auch hier
+        //als Startsignal (beim Taster etwas spaeter als der Druck)
+        triggerTime = syncPulse->sendStart();
+#endif
+        this->startArmed = false;
 
-        //Fuege 1000ms zum Start hinzu, um Verzoegerungen durch die Startanzeige zu vermindern
-        unsigned long startTime = millis() + 1000;
+        //Erste Events und Messdatei liegen seit arm() bereit, bis zum Nullpunkt werden nur noch die
+        //Startzeiten gesetzt. Alle Threads planen ab diesem Nullpunkt mit cmn::micros64()
+        uint64_t startTime = startTrigger->trigger(source, triggerTime);
+        //Takt des Masters bzw. Nachfuehren der Uhr des Slaves, erster Taktpuls auf dem Nullpunkt
+        syncPulse->start(startTime);
 
         //starte MFCs
         this->main_mfcCtrl->start(startTime);
@@ -125,6 +544,11 @@ namespace communication {
         //starte Ventile
         this->main_valveCtrl->start(startTime);
 
+#if EVENT_TIMELINE_MERGED
+        //starte Zeitleiste, sie fuehrt die Events der MFCs und Ventile aus
+        this->main_timeline->start(startTime);
+#endif
+
         //starte Boschsensor
         this->main_boschCom->start(startTime);
 
@@ -134,13 +558,536 @@ namespace communication {
         //starte Stringbuilder (und damit SD)
         this->main_stringBuilder->start(startTime);
 
-        srl->print('D', "[Zeit: ");
-        srl->print('D', startTime);
-        srl->println('D', "] Messung gestartet.");
+        //Die Schaltverzoegerung des ersten Events meldet <trigger>
+        startTrigger->started(cmn::micros64());
+        if (startTrigger->isLate()) {
+            srl->errorln("ERROR - Start dauerte laenger als START_LEAD");
+            this->main_display->throwError(ERR_START_LATE);
+        }
+
+        srl->info("[Zeit: ");
+        srl->info((unsigned long)(startTime / 1000));
+        srl->info("] Messung gestartet, Startsignal ");
+        srl->info(source);
+        srl->info(" vor ");
+        srl->info((unsigned long)(cmn::micros64() - triggerTime));
+        srl->infoln(" us.");
+    }
+
+    void Main_LabCom::stop() {
+        //Events laufen weiter, es werden nur keine Messwerte mehr erfasst
+        this->main_stringBuilder->stop();
+        this->stopping = true;
+
+        srl->info("[Zeit: ");
+        srl->info(millis());
+        srl->infoln("] Messung beendet.");
+    }
+
+    int Main_LabCom::restart() {
+        if (this->sending || !this->restartable || this->headerLineCounter != 7) {
+            srl->errorln("ERROR - Neustart nur nach <end> bzw. <stop> ohne Streaming");
+            return ERR_RESTART;
+        }
+
+        //Eventlisten auf den Stand von <end>, die Zeitleiste entnimmt ihre ersten Events neu
+        this->main_mfcCtrl->rewind();
+        this->main_valveCtrl->rewind();
+#if EVENT_TIMELINE_MERGED
+        this->main_timeline->reset();
+        this->main_timeline->build();
+#endif
+        syncPulse->stop();
+        this->arm();
+        srl->infoln("Messprogramm wird wiederholt.");
+#if SYNC_MODE == SYNC_MODE_SLAVE
+        srl->infoln("Warte auf den Startpuls des Masters.");
+#else
+        this->start(this->input == &this->programFile ? 'F' : 'L', cmn::micros64());
+#endif
+        return 1;
+    }
+
+    int Main_LabCom::rearm() {
+        if (this->sending) {
+            srl->errorln("ERROR - Neuer Header erst nach <stop>");
+            return ERR_RESTART;
+        }
+
+        //Eine schon angelegte Messdatei wird nicht mehr gebraucht, die Objekte werden zerstoert,
+        //danach ist ihr Speicher in der Arena wieder frei
+        this->main_stringBuilder->disarm();
+        this->main_mfcCtrl->reset();
+        this->main_valveCtrl->reset();
+#if EVENT_TIMELINE_MERGED
+        this->main_timeline->reset();
+#endif
+        arena->reset();
+        if (this->programFile.isOpen())
+            this->programFile.close();
+
+        //Zustand wie nach dem Booten, der naechste Header folgt
+        this->reading           = true;
+        this->stopping          = false;
+        this->streaming         = false;
+        this->streamHeld        = false;
+        this->repeatDepth       = 0;
+        this->windowed          = false;
+        this->unacked           = 0;
+        this->binaryMode        = false;
+        this->frameState        = FRAME_SYNC;
+        this->headerLineCounter = 0;
+        this->amount_MFC        = 0;
+        this->amount_valve      = 0;
+        this->eventCapacity     = 0;
+        this->restartable       = false;
+        this->startArmed        = false;
+        this->programRejected   = false;
+        syncPulse->stop();
+
+        this->main_display->reset();
+        srl->infoln("Bereit fuer einen neuen Header.");
+        srl->println('L', "ready");
+        return 1;
+    }
+
+    void Main_LabCom::measureEventStores(unsigned long *used, int *maxUsed, int *moreEach, unsigned long *moreTotal) {
+        *used      = 0;
+        *maxUsed   = 0;
+        *moreEach  = 0;
+        *moreTotal = 0;
+        int mfcEventSize   = control::EventBuffer::maxEventSize(EVENT_VALUE_BITS_MFC);
+        int valveEventSize = control::EventBuffer::maxEventSize(EVENT_VALUE_BITS_VALVE);
+        for (int i = 0; i < this->main_mfcCtrl->getAmountMFC() + this->main_valveCtrl->getAmountValve(); i++) {
+            bool mfc = i < this->main_mfcCtrl->getAmountMFC();
+            int bytes, more;
+            if (mfc) {
+                control::MfcCtrl *mfcCtrl = this->main_mfcCtrl->getMFC(i);
+                bytes = mfcCtrl->getEventBytes();
+                more  = mfcCtrl->getFreeEventBytes() / mfcEventSize;
+            } else {
+                control::ValveCtrl *valveCtrl = this->main_valveCtrl->getValve(i - this->main_mfcCtrl->getAmountMFC());
+                bytes = valveCtrl->getEventBytes();
+                more  = valveCtrl->getFreeEventBytes() / valveEventSize;
+            }
+
+            *used      += bytes;
+            *moreTotal += more;
+            if (bytes > *maxUsed)
+                *maxUsed = bytes;
+            if (i == 0 || more < *moreEach)
+                *moreEach = more;
+        }
+    }
+
+    void Main_LabCom::sendLatency(Print *output, LatencyStats *stats, char type, int id) {
+#if TELEMETRY_DELTA_FRAMES
+        char frame[4 + LATENCY_RECORD_SIZE + 2];
+        stats->serialize(&frame[4], type, id);
+        output->write((const uint8_t *)frame, cmn::finishFrame(frame, SERIAL_BINARY_LATENCY, LATENCY_RECORD_SIZE));
+#else
+        char line[LATENCY_LINE_SIZE];
+        output->write((const uint8_t *)line, stats->format(line, type, id) - line);
+#endif
+    }
+
+    int Main_LabCom::takeSequence() {
+        //sequence ist bereits die erwartete Nummer, ohne gueltige Nummer gilt der Fehler ihr
+        char *end;
+        unsigned long number = strtoul(this->inDataFields[0], &end, 10);
+        if (end == this->inDataFields[0] || *end != '\0') {
+            srl->errorln("ERROR - Sequenznummer fehlt");
+            return ERR_SERIAL_SEQUENCE;
+        }
+
+        for (int i = 0; i < this->fieldAmount - 1; i++)
+            this->inDataFields[i] = this->inDataFields[i + 1];
+        this->fieldAmount--;
+        this->inDataFields[this->fieldAmount] = (char *)"";
+
+        if (number < this->sequence) { //Wiederholung einer schon verarbeiteten Zeile, wird still verworfen
+            this->sequence--;
+            return -1;
+        }
+        if (number > this->sequence) { //Zeilen dazwischen fehlen, der Sender muss ab der erwarteten wiederholen
+            srl->errorln("ERROR - Sequenznummer uebersprungen");
+            this->sendError(ERR_SERIAL_SEQUENCE);
+            this->sequence--; //die Zeile wird verworfen, die erwartete Nummer bleibt
+            return -1;
+        }
+        return 1;
+    }
+
+    void Main_LabCom::acknowledge() {
+        if (this->input == &this->programFile) //niemand wartet darauf
+            return;
+        if (!this->windowed) {
+            srl->println('L', "ok");
+            return;
+        }
+        this->unacked++;
+        this->lastLineTime = millis();
+        if (this->windowAckEvery > 0 && this->unacked >= this->windowAckEvery)
+            this->sendAck();
+    }
+
+    void Main_LabCom::sendError(int errCode) {
+        //ErrorCode wird auf Display angezeigt
+        this->main_display->throwError(errCode);
+        if (!this->windowed) {
+            srl->println('L', errCode); //Sende Errorcode an LabView
+            return;
+        }
+        //Vorherige Zeilen zuerst bestaetigen, damit "nak" eindeutig der fehlerhaften Zeile gilt
+        if (this->unacked > 0) {
+            srl->print('L', "ack,");
+            srl->println('L', this->sequence - 1);
+            this->unacked = 0;
+        }
+        srl->print('L', "nak,");
+        srl->print('L', this->sequence);
+        srl->print('L', ",");
+        srl->println('L', errCode);
+    }
+
+    void Main_LabCom::sendAck() {
+        srl->print('L', "ack,");
+        srl->println('L', this->sequence);
+        this->unacked = 0;
+    }
+
+    bool Main_LabCom::setNewLine(const char newLine[], int length) {
+        unsigned long lost = this->telemetry.getDropped() + this->telemetry.getDecimated();
+        this->telemetry.push(newLine, length);
+        if (this->sending) //Thread schlaeft evtl. bis zum naechsten Blick auf die Schnittstellen
+            this->resume();
+        return this->telemetry.getDropped() + this->telemetry.getDecimated() == lost;
+    }
+
+    //////////////////// BEFEHLE ////////////////////
+
+    // Befehlstabelle von Main_LabCom. Der Zugriff auf die privaten Handler ist nur ueber diese
+    // Klasse moeglich (friend), die Hashtabelle entsteht beim Uebersetzen
+    struct LabComCommands {
+        typedef CommandEntry<Main_LabCom::CommandHandler> entry;
+        //Auch nach einem abgelehnten Programm, dessen Zeilen bis <end> verworfen werden
+        static constexpr uint16_t ALWAYS   = Main_LabCom::COMMAND_READING | Main_LabCom::COMMAND_RUNNING | Main_LabCom::COMMAND_REJECTED;
+        static constexpr uint16_t REJECTED = Main_LabCom::COMMAND_REJECTED;
+
+        static constexpr entry list[] = {
+            //Name        Zustaende                                                                Eintraege Zahlen   Handler
+            {"M",         Main_LabCom::COMMAND_EVENTS | Main_LabCom::COMMAND_STREAMING,            4, 4, 0x0E,    &Main_LabCom::commandEvent},
+            {"V",         Main_LabCom::COMMAND_EVENTS | Main_LabCom::COMMAND_STREAMING,            4, 4, 0x0E,    &Main_LabCom::commandEvent},
+            {"R",         Main_LabCom::COMMAND_EVENTS | Main_LabCom::COMMAND_STREAMING,            7, 7, 0x7E,    &Main_LabCom::commandEvent},
+            {"begin",     Main_LabCom::COMMAND_BEGIN,                                              1, 1, 0,       &Main_LabCom::commandBegin},
+            {"repeat",    Main_LabCom::COMMAND_EVENTS,                                             3, 3, 0x06,    &Main_LabCom::commandRepeat},
+            {"endrepeat", Main_LabCom::COMMAND_EVENTS,                                             1, 1, 0,       &Main_LabCom::endRepeat},
+            {"binary",    Main_LabCom::COMMAND_EVENTS | REJECTED,                                  1, 1, 0,       &Main_LabCom::commandBinary},
+            {"end",       Main_LabCom::COMMAND_EVENTS | Main_LabCom::COMMAND_STREAMING | REJECTED, 1, 1, 0,       &Main_LabCom::commandEnd},
+            {"stream",    Main_LabCom::COMMAND_EVENTS | Main_LabCom::COMMAND_ARMED | REJECTED,     1, 1, 0,       &Main_LabCom::commandStream},
+            {"start",     Main_LabCom::COMMAND_ARMED,                                              1, 1, 0,       &Main_LabCom::commandStart},
+            {"latency",   ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandLatency},
+            {"memory",    ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandMemory},
+            {"trigger",   ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandTrigger},
+            {"sync",      ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandSync},
+            {"upload",    ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandUpload},
+            {"profile",   ALWAYS,                                                                  1, 2, 0,       &Main_LabCom::commandProfile},
+            {"window",    Main_LabCom::COMMAND_READING,                                            1, 2, 0x02,    &Main_LabCom::commandWindow},
+            {"load",      Main_LabCom::COMMAND_FIRST_LINE,                                         2, 2, 0,       &Main_LabCom::commandLoad},
+            {"stop",      ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandStop},
+            {"restart",   ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::restart},
+            {"rearm",     ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::rearm},
+            {"reset",     ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::rearm},
+            {"ls",        ALWAYS,                                                                  1, 1, 0,       &Main_LabCom::commandList},
+            {"get",       ALWAYS,                                                                  2, 3, 0x04,    &Main_LabCom::commandGet}
+        };
+        static constexpr CommandSlots<LABCOM_COMMAND_SLOTS> slots = buildCommandSlots<LABCOM_COMMAND_SLOTS>(list);
+        static_assert(slots.seed < COMMAND_HASH_SEEDS, "Befehle ohne kollisionsfreie Verteilung, LABCOM_COMMAND_SLOTS erhoehen");
+
+        //Zeile 0 des Headers: MFC- und Ventilanzahl, optional die Events des vollsten Kanals
+        static constexpr entry amounts = {"", Main_LabCom::COMMAND_FIRST_LINE, 2, 3, 0x07, NULL};
+
+        //Headerzeilen 0-4, nach ihrer Position statt nach einem Befehl
+        static constexpr Main_LabCom::HeaderHandler headerLines[] = {
+            &Main_LabCom::headerAmounts,   //ZEILE 0: MFC+Ventilanzahl
+            &Main_LabCom::headerAdresses,  //ZEILE 1: MFC-Adressen
+            &Main_LabCom::headerTypes,     //ZEILE 2: MFC-Typen
+            &Main_LabCom::headerPins,      //ZEILE 3: Ventil-Pins
+            &Main_LabCom::headerIntervall  //ZEILE 4: Messaufloesung
+        };
+    };
+    constexpr LabComCommands::entry LabComCommands::list[];
+    constexpr CommandSlots<LABCOM_COMMAND_SLOTS> LabComCommands::slots;
+    constexpr LabComCommands::entry LabComCommands::amounts;
+    constexpr Main_LabCom::HeaderHandler LabComCommands::headerLines[];
+
+    uint16_t Main_LabCom::commandState() {
+        if (this->programRejected)
+            return COMMAND_REJECTED;
+        if (this->reading)
+            return 1 << this->headerLineCounter;
+        return this->streaming ? (COMMAND_RUNNING | COMMAND_STREAMING) : COMMAND_RUNNING;
+    }
+
+    int Main_LabCom::dispatchLine() {
+        const LabComCommands::entry *command = findCommand(LabComCommands::list, LabComCommands::slots, this->inDataFields[0]);
+        if (command == NULL || !(command->states & this->commandState()))
+            return 0;
+        if (!checkCommandFields(command, this->inDataFields, this->fieldAmount)) {
+            srl->error("ERROR - Falsche Argumente fuer <");
+            srl->error(command->name);
+            srl->errorln(">");
+            return ERR_SERIAL_ARGUMENTS;
+        }
+        return (this->*command->handler)();
+    }
+
+    int Main_LabCom::headerAmounts() {
+        //z.B. <stream> nach dem Ende-Frame eines abgelehnten Programms ist kein Header
+        if (!checkCommandFields(&LabComCommands::amounts, this->inDataFields, this->fieldAmount)) {
+            srl->errorln("ERROR - Zeile 0 des Headers erwartet <MFCs,Ventile> bzw. <MFCs,Ventile,Events>");
+            return ERR_SERIAL_ARGUMENTS;
+        }
+
+        this->amount_MFC   = atoi(this->inDataFields[0]);
+        this->amount_valve = atoi(this->inDataFields[1]);
+
+        //Der Eventspeicher wird gleichmaessig auf alle Objekte verteilt und hier einmalig angelegt
+        int eventBytes = 0;
+        if (this->amount_MFC + this->amount_valve > 0) {
+            eventBytes = EVENT_STORE_BYTES / (this->amount_MFC + this->amount_valve);
+            this->eventCapacity = eventBytes / control::EventBuffer::maxEventSize(
+                this->amount_MFC > 0 ? EVENT_VALUE_BITS_MFC : EVENT_VALUE_BITS_VALVE);
+        }
+
+        //Teile LabView mit, wie viele Events pro MFC/Ventil sicher Platz haben. Die Events
+        //werden gepackt gespeichert, mit kleinen Zeitabstaenden passen deutlich mehr
+        srl->print('L', "capacity,");
+        srl->println('L', this->eventCapacity);
+
+        //Optional die Events des Kanals mit den meisten: passen sie nicht sicher, wird das Programm
+        //abgelehnt, bevor Objekte angelegt und Events uebertragen werden
+        if (this->inDataFields[2][0] != '\0' && strtoul(this->inDataFields[2], NULL, 0) > (unsigned long)this->eventCapacity) {
+            srl->errorln("ERROR - Messprogramm passt nicht in den Eventspeicher, Zeilen bis <end> werden verworfen");
+            this->programRejected = true;
+            return ERR_PROGRAM_TOO_LARGE;
+        }
+
+        //erstelle MFC-Objekte in der main_mfcCtrl und Ventil-Objekte in der main_valveCtrl.
+        //Passen nicht alle in die Arena, gelten nur die erstellten
+        bool created = this->main_mfcCtrl->createMFC(this->amount_MFC, eventBytes);
+        created = this->main_valveCtrl->createValve(this->amount_valve, eventBytes) && created;
+        if (!created) {
+            this->amount_MFC   = this->main_mfcCtrl->getAmountMFC();
+            this->amount_valve = this->main_valveCtrl->getAmountValve();
+            this->sendError(ERR_ARENA_FULL);
+        }
+        srl->info("Arena: ");
+        srl->info((unsigned long)arena->getUsed());
+        srl->info(" von ");
+        srl->info((unsigned long)arena->getCapacity());
+        srl->infoln(" Bytes belegt");
+
+        //sage Display, dass Uebertragung gestartet wurde
+        this->main_display->header_started(this->amount_MFC, this->amount_valve);
+        return 1;
+    }
+
+    int Main_LabCom::headerAdresses() {
+        this->main_mfcCtrl->setAdresses(this->inDataFields);
+        return 1;
+    }
+
+    int Main_LabCom::headerTypes() {
+        this->main_mfcCtrl->setTypes(this->inDataFields);
+        return 1;
+    }
+
+    int Main_LabCom::headerPins() {
+        this->main_valveCtrl->setPins(this->inDataFields);
+        return 1;
+    }
+
+    int Main_LabCom::headerIntervall() {
+        //StringBuilder, sowie BoschCom arbeiten mit dem selben Intervall
+        //Ersterer ist jedoch um eine halbe Periode in der Zeit verschoben
+        this->main_boschCom->setIntervall(atoi(this->inDataFields[0]));
+        this->main_stringBuilder->setIntervall(atoi(this->inDataFields[0]));
+        this->main_mfcCtrl->getMfcBus()->setPollIntervall(atoi(this->inDataFields[0])); //Durchfluss je Messtakt
+        return 1;
+    }
+
+    int Main_LabCom::commandBegin() {
+        srl->infoln("Header vollstaendig.");
+        this->upload.finishPhase(UploadStats::UPLOAD_HEADER, micros());
+
+        //Sage Display, dass Header vollstaendig und Events beginnen
+        this->main_display->event_started();
+
+        this->headerLineCounter = 6;
+        return 1;
+    }
+
+    int Main_LabCom::commandEvent() {
+        char type;
+        int id;
+        control::eventElement event;
+        this->parseEvent(&type, &id, &event);
+        int errCode = this->storeEvent(type, id, event);
+        if (this->reading)
+            return errCode;
+
+        //Streaming-Modus: Aus der Datei wird gewartet, bis der Kanal Platz hat. LabView erkennt
+        //abgelehnte Events an der naechsten Meldung "stream,..."
+        if (errCode == ERR_EVENT_STORE_FULL && this->input == &this->programFile) {
+            this->streamHeld = true;
+            this->heldType   = type;
+            this->heldID     = id;
+            this->heldEvent  = event;
+        } else if (errCode != 1) {
+            this->streamRejected++;
+            this->main_display->throwError(errCode);
+        }
+        return 1;
+    }
+
+    int Main_LabCom::commandRepeat() {
+        //Events bis <endrepeat> werden wiederholt
+        return this->beginRepeat(strtoul(this->inDataFields[1], NULL, 0), strtoul(this->inDataFields[2], NULL, 0));
     }
 
-    void Main_LabCom::setNewLine(char newLine[]) {
-        //TODO!
+    int Main_LabCom::commandBinary() {
+        //restliche Events kommen als Binaerframes, die keine Bloecke kennen
+        int errCode = this->closeRepeats();
+        srl->infoln("Binaermodus fuer Events aktiviert.");
+        this->binaryMode = true;
+        this->frameState = FRAME_SYNC;
+        return errCode;
+    }
+
+    int Main_LabCom::commandEnd() {
+        if (this->programRejected) //bereit fuer das naechste Programm
+            return this->rearm();
+        if (!this->reading) {
+            //Streaming-Modus: die Eventlisten enden, sobald die gespeicherten Events ausgefuehrt sind
+            this->streaming = false;
+            this->main_mfcCtrl->setStreaming(false);
+            this->main_valveCtrl->setStreaming(false);
+            srl->infoln("Streaming beendet.");
+            return 1;
+        }
+
+        //Am Ende wechselt labCom in den Sende-Modus
+        int errCode = this->closeRepeats();
+        if (errCode != 1)
+            this->sendError(errCode);
+        if (this->programRejected) //ein Block passte nicht mehr
+            return this->rearm();
+        this->finishEvents();
+        return 1;
+    }
+
+    int Main_LabCom::commandStream() {
+        if (this->programRejected)
+            return this->rearm();
+
+        //Wie <end>, weitere Events folgen waehrend der Messung. Nach Binaerframes (Ende-Frame)
+        //ist die Eventliste schon abgeschlossen
+        if (this->headerLineCounter == 6) {
+            int errCode = this->closeRepeats();
+            if (errCode != 1)
+                this->sendError(errCode);
+            if (this->programRejected)
+                return this->rearm();
+            this->finishEvents();
+        }
+        return this->beginStream();
+    }
+
+    int Main_LabCom::commandStart() {
+#if SYNC_MODE == SYNC_MODE_SLAVE
+        //der Slave startet nur mit dem Startpuls, sonst laege sein Nullpunkt neben dem des Masters
+        srl->errorln("ERROR - Slave startet mit dem Startpuls des Masters, nicht mit <start>");
+        return ERR_SYNC;
+#endif
+        this->start(this->input == &this->programFile ? 'F' : 'L', cmn::micros64());
+        return 1;
+    }
+
+    int Main_LabCom::commandLatency() {
+        this->latencyRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandMemory() {
+        this->memoryRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandTrigger() {
+        this->triggerRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandSync() {
+        this->syncRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandUpload() {
+        this->uploadRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandProfile() {
+        //Laufzeit der Threads auf den Debugport, mit <profile,reset> wird danach neu gezaehlt
+        main_thread_list->print_profile(srl->getType('D'));
+        if (strcmp(this->inDataFields[1], "reset") == 0)
+            main_thread_list->reset_profile();
+        return 1;
+    }
+
+    int Main_LabCom::commandWindow() {
+        //Folgende Zeilen beginnen mit ihrer Sequenznummer, Antwort "window,Zeilen je ack,Bytes"
+        this->windowed        = true;
+        this->windowAckEvery  = (this->inDataFields[1][0] != '\0') ? atoi(this->inDataFields[1]) : SERIAL_WINDOW_ACK_EVERY;
+        this->sequence        = 0; //erste Zeile danach hat die Nummer 1
+        this->unacked         = 0;
+        srl->print('L', "window,");
+        srl->print('L', this->windowAckEvery);
+        srl->print('L', ",");
+        srl->println('L', SERIAL_WINDOW_BYTES);
+        return 1;
+    }
+
+    int Main_LabCom::commandLoad() {
+        //Header und Events folgen aus der Datei statt von LabView
+        if (this->programFile.isOpen() || !this->loadProgram(this->inDataFields[1]))
+            return ERR_SD_PROGRAM;
+        return 1;
+    }
+
+    int Main_LabCom::commandStop() {
+        if (this->sending && !this->stopping)
+            this->stop();
+        return 1;
+    }
+
+    int Main_LabCom::commandList() {
+        //Die Karte ist ab arm() bis zum Ende der Messung belegt
+        if (this->sending || this->main_stringBuilder->getStoreD()->isBusy())
+            return ERR_SD_TRANSFER;
+        this->listRequested = true;
+        return 1;
+    }
+
+    int Main_LabCom::commandGet() {
+        //<get,Datei,Offset>
+        storage::StoreD *storeD = this->main_stringBuilder->getStoreD();
+        if (this->sending || storeD->isBusy()
+                || !this->fileTransfer.open(storeD, this->inDataFields[1], strtoul(this->inDataFields[2], NULL, 10), srl->getType('L')))
+            return ERR_SD_TRANSFER;
+        return 1;
     }
 
     //////////////////// MAINLOOP ////////////////////
@@ -150,121 +1097,236 @@ namespace communication {
         if (kill_flag)
             return false;
 
-        // Im Lesemodus wird, wenn ein String verfügbar ist (Serial.available() ), der String
-        // vollstaendig eingelesen und, sofern kein Fehler aufgetreten ist, anschließend in ein Array zerteilt.
+        // Im Lesemodus werden die verfuegbaren Zeichen (input->available() ) eingelesen. Ist die Zeile
+        // vollstaendig und kein Fehler aufgetreten, wird sie anschließend in ein Array zerteilt.
         // Je nach headerLineCounter (Zeile im Header) wird dieses Array an eine anderen Stelle weiter
         // verarbeitet.
-        if (this->reading) { //Empfange Messprogramm
-            if (Serial.available() > 0) { //TODO Serial.labiew hier
-                int errCode = this->readLine();
-                if (errCode == 1) { //Funktion wird ausgefuerhrt und bei Erfolg in If gegangen
-                    //Der Header muss einzeln verarbeitet werden, daher gibt es einen headerLineCounter,
-                    //der die erwartete Zeile speichert
-                    int arraySize = this->splitLine();
-
-                    srl->println('L', "ok"); //Sende 'Befehl ok' an LabView
-
-                    //TODO In jedem Schritt Ueberpruefungen, ob das Erwartete eingetroffen ist
-                    switch (this->headerLineCounter) {
-                        case 0: //ZEILE 0: MFC+Ventilanzahl
-                            this->amount_MFC   = atoi(this->inDataArray[0]);
-                            this->amount_valve = atoi(this->inDataArray[1]);
-
-                            //erstelle MFC-Objekte in der main_mfcCtrl
-                            this->main_mfcCtrl->createMFC(this->amount_MFC);
-
-                            //erstelle Ventil-Objekte in der main_valveCtrl
-                            this->main_valveCtrl->createValve(this->amount_valve);
-
-                            //sage Display, dass Uebertragung gestartet wurde
-                            this->main_display->header_started(this->amount_MFC, this->amount_valve);
-
-                            this->headerLineCounter = 1;
-                            break; //Bei Switch-Case-Strukturen ist ein 'break' noetig um einen else-if-Effekt zu erhalten
-                        case 1: //ZEILE 1: MFC-Adressen
-                            this->main_mfcCtrl->setAdresses(this->inDataArray);
-
-                            this->headerLineCounter = 2;
-                            break;
-                        case 2: //ZEILE 2: MFC-Typen
-                            this->main_mfcCtrl->setTypes(this->inDataArray);
-
-                            this->headerLineCounter = 3;
-                            break;
-                        case 3: //ZEILE 3: Ventil-Pins
-                            this->main_valveCtrl->setPins(this->inDataArray);
-
-                            this->headerLineCounter = 4;
-                            break;
-                        case 4: //ZEILE 4: Messaufloesung wird gesetzt
-                            //StringBuilder, sowie BoschCom arbeiten mit dem selben Intervall
-                            //Ersterer ist jedoch um eine halbe Periode in der Zeit verschoben
-                            this->main_boschCom->setIntervall(atoi(this->inDataArray[0]));
-                            this->main_stringBuilder->setIntervall(atoi(this->inDataArray[0]));
-
-                            this->headerLineCounter = 5;
-                            break;
-                        case 5: //ZEILE 5: Letzte Zeile, hier wird ein 'begin' erwartet
-                            if (strcmp(this->inDataArray[0], "begin") == 0) {
-                                srl->println('D', "Header vollstaendig.");
-
-                                //Sage Display, dass Header vollstaendig und Events beginnen
-                                this->main_display->event_started();
-
-                                this->headerLineCounter = 6;
-                            }
-                            break;
-                        case 6: //ZEILE 6: Eventliste
-                            if (strcmp(this->inDataArray[0], "M") == 0) { //MFC
-                                if (atoi(this->inDataArray[1]) < this->amount_MFC) {
-                                    this->main_mfcCtrl->setEvent(
-                                        atoi(this->inDataArray[1]), //MFC-ID
-                                        atoi(this->inDataArray[2]), //value
-                                        strtoul(this->inDataArray[3], NULL, 0) //time (unsigned long)
-                                    );
-                                } else {
-                                    this->main_display->throwError(ERR_SERIAL_UNDEFINED_INDEX);
-                                    srl->println('L', ERR_SERIAL_UNDEFINED_INDEX); //Sende Errorcode an LabView
-                                }
-                            } else if (strcmp(this->inDataArray[0], "V") == 0) { //Ventil
-                                if (atoi(this->inDataArray[1]) < this->amount_valve) {
-                                    this->main_valveCtrl->setEvent(
-                                        atoi(this->inDataArray[1]), //Ventil-ID
-                                        atoi(this->inDataArray[2]), //value
-                                        strtoul(this->inDataArray[3], NULL, 0) //time (unsigned long)
-                                    );
-                                } else {
-                                    this->main_display->throwError(ERR_SERIAL_UNDEFINED_INDEX);
-                                    srl->println('L', ERR_SERIAL_UNDEFINED_INDEX); //Sende Errorcode an LabView
-                                }
-                            }
-
-                            else if (strcmp(this->inDataArray[0], "end") == 0) { //Am ende wechselt labCom in den Sende-Modus
-                                srl->println('D', "Uebertragung abgeschlossen.");
-
-                                //Sage Display, dass Event-Uebertragung abgeschlossen ist
-                                this->main_display->event_finished();
-
-                                this->headerLineCounter = 7;
-                            }
-                            break;
-                        case 7: //ZEILE 7: Warte auf Start (kann auch durch Button aufgerufen werden)
-                            if (strcmp(this->inDataArray[0], "start") == 0) {
-                                this->start();
-                            }
-                            break;
-                    }
-                } else if (errCode > 1) {
-                    //ErrorCode wird auf Display angezeigt
-                    this->main_display->throwError(errCode);
-                    srl->println('L', errCode); //Sende Errorcode an LabView
-                } //else -1: Keine Eingabe vorhanden (leerer String)
+        this->selectInput();
+        //Antworten duerfen einen Frame der Dateiuebertragung nicht unterbrechen
+        if (this->fileTransfer.isInFrame() && this->input->available() > 0)
+            this->fileTransfer.finishFrame(srl->getType('L'));
+
+        //Fuer <upload> wird die Rechenzeit beim Einlesen gemessen, bis zum Ende der Eventliste
+        bool uploading = this->reading && this->headerLineCounter < 7;
+        unsigned long busyStart = micros();
+        unsigned long bytesBefore = this->receivedBytes;
+        if (uploading && this->headerLineCounter == 0 && !this->lineInProgress && this->input->available() > 0)
+            this->upload.begin(busyStart); //erstes Zeichen eines neuen Programms
+
+#if SYNC_MODE == SYNC_MODE_SLAVE
+        //Der Slave startet mit dem Startpuls des Masters, auch nach <restart>
+        uint64_t pulseTime;
+        if (this->startArmed && syncPulse->takeStart(&pulseTime))
+            this->start('S', pulseTime);
+#elif START_BUTTON
+        //Den Zeitpunkt des Tasterdrucks haelt der Interrupt fest, er gilt nur in der Startbereitschaft
+        uint64_t pressTime;
+        if (this->reading && this->headerLineCounter == 7 && startTrigger->take(&pressTime))
+            this->start('T', pressTime);
+#endif
+        //Taktpulse auswerten (Slave) bzw. ausgeben (Master ohne Timer)
+        if (!syncPulse->update()) {
+            srl->errorln("ERROR - Synchronisation mit dem Master verloren");
+            this->main_display->throwError(ERR_SYNC);
+        }
+
+        if (this->reading && this->binaryMode) { //Empfange Events als Binaerframes
+            int errCode = this->readFrame();
+            if (errCode == 1) //vollstaendiger Frame mit gueltiger CRC
+                errCode = this->processFrame();
+
+            if (errCode > 0) {
+                this->upload.addLine();
+                this->sequence++; //Frames sind im Fenstermodus fortlaufend nummeriert
+            }
+            if (errCode == 1) {
+                this->acknowledge(); //Sende 'Frame ok' an LabView
+            } else if (errCode > 1) {
+                this->sendError(errCode);
+            } //else 0: Frame noch unvollstaendig
+        } else if (this->reading) { //Empfange Messprogramm
+            //readLine() liest nur vorhandene Zeichen und muss fuer den Timeout auch ohne neue Daten laufen
+            int errCode = this->readLine();
+            if (errCode == 1) //vollstaendige Zeile wird in ihre Eintraege zerlegt
+                errCode = this->splitLine();
+            if (errCode > 0) {
+                this->upload.addLine();
+                this->sequence++; //erwartete Nummer, takeSequence() prueft sie
+            }
+            if (errCode == 1 && this->windowed)
+                errCode = this->takeSequence();
+
+            if (errCode == 1) { //Funktion wird ausgefuerhrt und bei Erfolg in If gegangen
+                //Der Header muss einzeln verarbeitet werden, daher gibt es einen headerLineCounter,
+                //der die erwartete Zeile speichert. Im Fenstermodus wird erst nach dem Befehl bestaetigt,
+                //damit eine Zeile nicht zugleich mit "ack" und "nak" gemeldet wird
+                bool windowed = this->windowed; //<window>, <start> und <rearm> wechseln den Modus
+                if (!windowed)
+                    this->acknowledge(); //Sende 'Befehl ok' an LabView
+
+                //Befehle schlagen in der Befehlstabelle nach, ob sie in der erwarteten Zeile gelten.
+                //Die Zeilen 0-4 des Headers sind keine Befehle und werden nach ihrer Position verarbeitet
+                //Nach einem abgelehnten Programm werden auch die Zeilen des Headers verworfen
+                int commandErrCode = this->dispatchLine();
+                if (commandErrCode == 0 && this->headerLineCounter < 5 && !this->programRejected) {
+                    commandErrCode = (this->*LabComCommands::headerLines[this->headerLineCounter])();
+                    if (commandErrCode == 1)
+                        this->headerLineCounter++;
+                }
+                if (commandErrCode > 1)
+                    this->sendError(commandErrCode);
+                else if (windowed && this->windowed)
+                    this->acknowledge();
+            } else if (errCode > 1) {
+                this->sendError(errCode);
+            } //else 0: Zeile noch unvollstaendig, -1: Keine Eingabe vorhanden (leerer String) bzw. Zeile verworfen
+        } else { //Waehrend und nach der Messung werden nur noch Befehle angenommen
+            //Zurueckgehaltenes Event der Datei, einmal je Durchlauf
+            if (this->streamHeld && this->storeEvent(this->heldType, this->heldID, this->heldEvent) != ERR_EVENT_STORE_FULL)
+                this->streamHeld = false;
+
+            int errCode = this->readLine();
+            if (errCode == 1)
+                errCode = this->splitLine();
+
+            if (errCode == 1) {
+                errCode = this->dispatchLine();
+                if (errCode == 0)
+                    srl->errorln("ERROR - Unbekannter Befehl waehrend der Messung");
             }
+
+            //Waehrend des Sendens keine Antwort an LabView, sie koennte eine begonnene Messzeile unterbrechen
+            if (errCode > 1 && this->sending)
+                this->main_display->throwError(errCode);
+            else if (errCode > 1)
+                this->sendError(errCode);
         }
 
+        //Bestaetigung im Fenstermodus spaetestens nach einer Pause des Senders und mit <end>
+        if (this->windowed && this->unacked > 0
+                && (this->headerLineCounter == 7 || millis() - this->lastLineTime >= SERIAL_WINDOW_ACK_DELAY))
+            this->sendAck();
+
+        if (uploading && this->receivedBytes != bytesBefore)
+            this->upload.addInput(this->receivedBytes - bytesBefore, micros() - busyStart);
+
         if (this->sending) { //Sende Messwerte parallel zur Messung
+            Print *labView = srl->getType('L');
+            this->telemetry.drain(labView);
 
+            //Verworfene Zeilen melden, nur zwischen zwei Zeilen und wenn die Schnittstelle Platz hat
+            unsigned long dropped   = this->telemetry.getDropped();
+            unsigned long decimated = this->telemetry.getDecimated();
+            if ((dropped != this->reportedDropped || decimated != this->reportedDecimated)
+                    && !this->telemetry.isInLine() && labView->availableForWrite() >= 48
+                    && millis() - this->lastReportTime >= TELEMETRY_REPORT_INTERVALL) {
+#if TELEMETRY_DELTA_FRAMES
+                char frame[4 + 8 + 2];
+                char *out = cmn::putLittleEndian(&frame[4], dropped, 4);
+                cmn::putLittleEndian(out, decimated, 4);
+                labView->write((const uint8_t *)frame, cmn::finishFrame(frame, SERIAL_BINARY_DROPPED, 8));
+#else
+                labView->print("dropped,");
+                labView->print(dropped);
+                labView->print(",decimated,");
+                labView->println(decimated);
+#endif
+                this->reportedDropped   = dropped;
+                this->reportedDecimated = decimated;
+                this->lastReportTime    = millis();
+            }
+
+            //Fortschritt im Streaming-Modus, LabView berechnet daraus den freien Eventspeicher
+            if (this->streaming && !this->telemetry.isInLine()
+                    && millis() - this->lastStreamReportTime >= STREAM_REPORT_INTERVALL) {
+                unsigned long taken = 0;
+                for (int i = 0; i < this->main_mfcCtrl->getAmountMFC(); i++)
+                    taken += this->main_mfcCtrl->getMFC(i)->getTakenEvents();
+                for (int i = 0; i < this->main_valveCtrl->getAmountValve(); i++)
+                    taken += this->main_valveCtrl->getValve(i)->getTakenEvents();
+                if (taken != this->reportedTaken || this->streamRejected != this->reportedRejected) {
+                    this->sendStreamReport(labView);
+                    this->reportedTaken    = taken;
+                    this->reportedRejected = this->streamRejected;
+                }
+                this->lastStreamReportTime = millis();
+            }
+
+            //Nach <stop> endet das Senden, sobald die letzte Messzeile ausgegeben ist
+            if (this->stopping && !this->telemetry.isPending()) {
+                this->sending  = false;
+                this->stopping = false;
+                srl->println('L', "stopped");
+            }
+        }
+
+        //Datei an LabView (<get>), zwischen den Messungen
+        if (this->fileTransfer.isActive() && !this->sending && !this->fileTransfer.send(srl->getType('L')))
+            this->sendError(ERR_SD_TRANSFER);
+
+        //Statistik gesamt, dann je MFC und Ventil, zwischen zwei Messzeilen bzw. Frames der Datei.
+        //Blockiert, bis alles gesendet ist
+        bool lineFree = !this->telemetry.isInLine() && !this->fileTransfer.isInFrame();
+        if (this->latencyRequested && lineFree) {
+            Print *labView = srl->getType('L');
+            this->sendLatency(labView, eventLatency, 'G', 0);
+            for (int i = 0; i < this->main_mfcCtrl->getAmountMFC(); i++)
+                this->sendLatency(labView, this->main_mfcCtrl->getMFC(i)->getLatency(), 'M', i);
+            for (int i = 0; i < this->main_valveCtrl->getAmountValve(); i++)
+                this->sendLatency(labView, this->main_valveCtrl->getValve(i)->getLatency(), 'V', i);
+            this->latencyRequested = false;
         }
+        if (this->uploadRequested && lineFree) {
+            char line[UPLOAD_LINE_SIZE];
+            srl->getType('L')->write((const uint8_t *)line, this->upload.format(line) - line);
+            this->uploadRequested = false;
+        }
+        if (this->memoryRequested && lineFree) {
+            Print *labView = srl->getType('L');
+            char line[ARENA_LINE_SIZE + MEMORY_LINE_SIZE + EVENTS_LINE_SIZE];
+            char *out = arena->format(line);
+            out = memoryStats->format(out);
+
+            //"events,Belegt,Hoechste Belegung eines Kanals,Weitere je Kanal,Weitere insgesamt"
+            unsigned long eventBytes, moreTotal;
+            int maxEventBytes, moreEach;
+            this->measureEventStores(&eventBytes, &maxEventBytes, &moreEach, &moreTotal);
+            memcpy(out, "events,", 7);
+            out = cmn::formatInt(&out[7], eventBytes, 0);
+            *out++ = ',';
+            out = cmn::formatInt(out, maxEventBytes, 0);
+            *out++ = ',';
+            out = cmn::formatInt(out, moreEach, 0);
+            *out++ = ',';
+            out = cmn::formatInt(out, moreTotal, 0);
+            *out++ = '\n';
+            labView->write((const uint8_t *)line, out - line);
+            this->memoryRequested = false;
+        }
+        if (this->triggerRequested && lineFree) {
+            char line[TRIGGER_LINE_SIZE];
+            bool fired = eventLatency->getCount() > 0;
+            srl->getType('L')->write((const uint8_t *)line, startTrigger->format(line, fired, eventLatency->getFirst()) - line);
+            this->triggerRequested = false;
+        }
+        if (this->syncRequested && lineFree) {
+            char line[SYNC_LINE_SIZE];
+            srl->getType('L')->write((const uint8_t *)line, syncPulse->format(line) - line);
+            this->syncRequested = false;
+        }
+        if (this->listRequested && lineFree) {
+            this->fileTransfer.list(this->main_stringBuilder->getStoreD(), srl->getType('L'));
+            this->listRequested = false;
+        }
+
+        //Ohne wartende Zeichen und Ausgaben wird erst nach SERIAL_POLL_INTERVALL wieder gelesen, bis dahin
+        //halten die Empfangspuffer die Zeichen. Die Zeitgrenzen oben (ms) verschieben sich dadurch kaum
+        bool busy = this->input->available() > 0 || this->link->available() > 0 || this->streamHeld
+            || (this->sending && this->telemetry.isPending()) || (!this->sending && this->fileTransfer.isActive())
+            || this->latencyRequested || this->uploadRequested || this->memoryRequested || this->triggerRequested
+            || this->syncRequested || this->listRequested;
+        if (!busy)
+            this->sleep_micro(SERIAL_POLL_INTERVALL);
 
         return true;
     }
@@ -5,15 +5,25 @@
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
 
+#include "ownlibs/arena.h"
 #include "ownlibs/common.h"
 
 #include "ownlibs/serialCommunication.h"
+#include "ownlibs/telemetryQueue.h"
+#include "ownlibs/latencyStats.h"
+#include "ownlibs/uploadStats.h"
+#include "ownlibs/startTrigger.h"
+#include "ownlibs/syncPulse.h"
+#include "ownlibs/memoryStats.h"
 #include "config.h"
 #include "main_mfcCtrl.h"
 #include "main_valveCtrl.h"
 #include "main_display.h"
 #include "main_boschCom.h"
 #include "main_stringBuilder.h"
+#include "main_timeline.h"
+#include "programFile.h"
+#include "fileTransfer.h"
 
 namespace communication {
     // an die MFCs werden absolutwerte uerbtragen. Diese basieren auf der Zeit, die gespeichert
@@ -39,22 +49,148 @@ namespace communication {
         //Gebe Adresse des Stringbuilders an LabCom
         void setMainStringBuilderObjectPointer(communication::Main_StringBuilder *main_stringBuilder);
 
-        //setze neue Zeile zur Uebertragung an LabView
-        void setNewLine(char newLine[]);
+        //Gebe Adresse der Zeitleiste an LabCom (nur bei EVENT_TIMELINE_MERGED)
+        void setMainTimelineObjectPointer(control::Main_Timeline *main_timeline);
+
+        //Liest das Messprogramm aus einer Datei der SD-Karte statt von LabView (beim Booten mit
+        //SD_PROGRAM_AUTOLOAD, oder <load,Datei>). Vor dem Start wird nur die Datei gelesen, danach
+        //(Streaming-Modus) abwechselnd mit LabView. Gibt false zurueck, wenn die Datei fehlt
+        bool loadProgram(const char name[]);
+
+        //setze neue Zeile zur Uebertragung an LabView. Sie wird in die Warteschlange kopiert und in
+        //loop() ausgegeben, blockiert also nie (der Thread wird dafuer geweckt). Gibt false zurueck,
+        //wenn dabei eine Zeile verworfen wurde
+        bool setNewLine(const char newLine[], int length);
     protected:
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
-        //Diese Funktion wird zu Programmstart mehrmals ausgefuehrt, bis die kompletten Daten
-        //eingetroffen sind. Sie liefert bei erfolgreicher Ausfuehrung 1, ansonsten
-        //einen Errorcode mit einer Fehlermeldung in der Konsole
+        //Diese Funktion wird in jedem Durchlauf ausgefuehrt und liest nur die bereits empfangenen
+        //Zeichen, eine Zeile kann sich ueber mehrere Aufrufe erstrecken. Sie liefert 1, wenn eine
+        //Zeile vollstaendig ist, 0 solange sie unvollstaendig ist, -1 bei einer leeren Zeile,
+        //ansonsten einen Errorcode mit einer Fehlermeldung in der Konsole
         int readLine();
-        //Eingetroffene und vollstaendige Zeile wird an Kommata zerlegt und in Array gespeichert.
-        //Gibt nach vollstaendiger Durchfuehrung die Anzahl an Eintraegen im Array zurueck.
+        //Eingetroffene und vollstaendige Zeile wird an Kommata zerlegt. Die Eintraege werden nicht
+        //kopiert: Leerzeichen werden uebersprungen, das Trennzeichen durch '\0' ersetzt und der Beginn
+        //in inDataFields gespeichert. Gibt 1 zurueck (Anzahl in fieldAmount), ansonsten einen Errorcode
         int splitLine();
+        //Binaeres Gegenstueck zu readLine(): liest die bereits empfangenen Bytes eines Frames und
+        //prueft die CRC. Liefert 1, wenn ein Frame vollstaendig ist, 0 solange er unvollstaendig
+        //ist, ansonsten einen Errorcode. Die Nutzdaten liegen danach in inDataBuffer
+        int readFrame();
+        //Verarbeitet einen vollstaendigen Frame, liefert 1 bei Erfolg, ansonsten einen Errorcode
+        int processFrame();
+        //Speichert ein Event beim MFC/Ventil ('M'/'V') bzw. eine Rampe eines MFCs ('R'), gemeinsam
+        //fuer Text- und Binaerprotokoll. Liefert 1 bei Erfolg, ansonsten einen Errorcode
+        int storeEvent(char type, int id, const control::eventElement &event);
+        //Liest die zerlegte Eventzeile <M/V,ID,Wert,Zeit> bzw. <R,ID,Startwert,Zielwert,Zeit,Dauer,Schritt>.
+        //Gibt false zurueck, wenn die Zeile kein Event ist
+        bool parseEvent(char *type, int *id, control::eventElement *event);
+        //Schliesst die Eventuebertragung ab (<end>)
+        void finishEvents();
+        //Wiederholungsblock <repeat,Anzahl,Periode> bzw. <endrepeat> in den Eventlisten aller MFCs
+        //und Ventile. Liefert 1, ansonsten einen Errorcode
+        int beginRepeat(unsigned long count, unsigned long period);
+        int endRepeat();
+        //Schliesst vor <binary>, <end> und <stream> noch offene Bloecke. Liefert 1, wenn keiner
+        //offen war, ansonsten einen Errorcode
+        int closeRepeats();
+        //Ein Block passte nicht in alle Eventlisten: das Programm wird bis <end> verworfen,
+        //liefert ERR_EVENT_STORE_FULL
+        int rejectRepeat();
+        //Streaming-Modus (<stream> statt bzw. nach <end>): Events werden auch waehrend der Messung
+        //angenommen, bis zu <end>. Liefert 1, ansonsten einen Errorcode
+        int beginStream();
+        //Waehlt die Eingabe fuer readLine()/readFrame(): das Messprogramm der SD-Karte oder LabView
+        void selectInput();
+        //Meldet "stream,abgelehnt,entnommen (je MFC, dann je Ventil)" als Textzeile bzw. Frame
+        void sendStreamReport(Print *output);
+        //Bereitet den Start vor (nach <end>, <stream> und bei <restart>): die Objekte entnehmen ihre
+        //ersten Events und die Messdatei wird angelegt. Ein frueherer Tasterdruck bzw. Startpuls wird verworfen
+        void arm();
         //gibt Befehl zum Start der Threads von MFC und Ventil, uebergibt die Startzeit, welche als
-        //Nullpunkt dient
-        void start(); //TODO: evtl public machen, um von ausserhalb per Taster auszufuehren
+        //Nullpunkt dient. Sie liegt START_LEAD us hinter dem Startsignal 'triggerTime' (cmn::micros64())
+        //aus 'source' (siehe StartTrigger), beim Master hinter seinem Startpuls (siehe SyncPulse)
+        void start(char source, uint64_t triggerTime);
+        //beendet die Messung (<stop>): Messdatei wird mit der Schaltverzoegerung abgeschlossen, die
+        //wartenden Messzeilen werden noch gesendet, danach folgt "stopped"
+        void stop();
+        //Wiederholt das geladene Messprogramm (<restart>), nach <end> bzw. nach dem Ende des Sendens
+        //(<stop>). Nach dem Streaming-Modus nicht moeglich. Ein Slave wartet danach auf den Startpuls.
+        //Liefert 1, ansonsten einen Errorcode
+        int restart();
+        //Verwirft Messprogramm und Header (<rearm>, <reset>), MFCs und Ventile werden beim naechsten
+        //Header in derselben Arena neu erstellt. Antwortet wie nach dem Booten mit "ready". Waehrend
+        //des Sendens nicht moeglich, liefert dann einen Errorcode, ansonsten 1
+        int rearm();
+        //Zustaende der Befehlstabelle (LabComCommands in main_labCom.cpp): beim Einlesen ein Bit je
+        //Zeile (headerLineCounter), waehrend und nach der Messung RUNNING, im Streaming-Modus zusaetzlich STREAMING
+        enum commandStates {
+            COMMAND_FIRST_LINE = 0x0001, //ZEILE 0, vor dem Header
+            COMMAND_BEGIN      = 0x0020, //ZEILE 5, <begin>
+            COMMAND_EVENTS     = 0x0040, //ZEILE 6, Eventliste
+            COMMAND_ARMED      = 0x0080, //ZEILE 7, Warten auf den Start
+            COMMAND_READING    = 0x00FF, //jede Zeile beim Einlesen
+            COMMAND_RUNNING    = 0x0100,
+            COMMAND_STREAMING  = 0x0200,
+            COMMAND_REJECTED   = 0x0400  //Programm abgelehnt (ERR_PROGRAM_TOO_LARGE, Block ohne Platz), Zeilen bis <end> werden verworfen
+        };
+        //Handler eines Befehls, liefert 1 oder einen Errorcode. Die Argumente sind vorher gegen den
+        //Eintrag der Tabelle geprueft
+        typedef int (Main_LabCom::*CommandHandler)();
+        //Handler einer Headerzeile 0-4 (ohne Befehl, nach ihrer Position), liefert 1 oder einen Errorcode
+        typedef int (Main_LabCom::*HeaderHandler)();
+        friend struct LabComCommands;
+
+        //Zustand fuer die Befehlstabelle
+        uint16_t commandState();
+        //Sucht den ersten Eintrag der zerlegten Zeile in der Befehlstabelle und ruft dessen Handler
+        //auf, wenn der Befehl im aktuellen Zustand gilt und seine Argumente passen. Liefert 1, 0 wenn
+        //die Zeile kein solcher Befehl ist, ansonsten einen Errorcode (ERR_SERIAL_ARGUMENTS)
+        int dispatchLine();
+        //Headerzeilen: MFC+Ventilanzahl (optional mit den Events des vollsten Kanals, passen sie
+        //nicht, wird das Programm abgelehnt), MFC-Adressen, MFC-Typen, Ventil-Pins, Messaufloesung
+        int headerAmounts();
+        int headerAdresses();
+        int headerTypes();
+        int headerPins();
+        int headerIntervall();
+        //Handler der Befehlstabelle. Events (<M>, <V>, <R>) und <end> gelten in der Eventliste und
+        //im Streaming-Modus waehrend der Messung, dort ohne Antwort an LabView
+        int commandBegin();
+        int commandEvent();
+        int commandRepeat();
+        int commandBinary();
+        int commandEnd();
+        int commandStream();
+        int commandStart();
+        int commandLatency();
+        int commandMemory();
+        int commandTrigger();
+        int commandSync();
+        int commandUpload();
+        int commandProfile();
+        int commandWindow();
+        int commandLoad();
+        int commandStop();
+        int commandList();
+        int commandGet();
+        //Belegung der Eventspeicher aller MFCs und Ventile: belegte Bytes insgesamt und im vollsten Kanal,
+        //Events, die im Kanal mit dem wenigsten Platz bzw. in allen zusammen noch sicher Platz haben
+        void measureEventStores(unsigned long *used, int *maxUsed, int *moreEach, unsigned long *moreTotal);
+        //Sendet die Schaltverzoegerung einer Statistik als Textzeile bzw. Frame (TELEMETRY_DELTA_FRAMES)
+        void sendLatency(Print *output, LatencyStats *stats, char type, int id);
+        //Fenstermodus (<window>): nimmt die Sequenznummer aus dem ersten Eintrag und verschiebt die
+        //weiteren. Eine Luecke wird mit ERR_SERIAL_SEQUENCE fuer die erste fehlende Nummer gemeldet,
+        //die Zeile aber verarbeitet. Liefert 1, ansonsten einen Errorcode (keine Nummer)
+        int takeSequence();
+        //Antwort auf eine fehlerfreie Zeile bzw. einen Frame: "ok", im Fenstermodus nach
+        //windowAckEvery Zeilen "ack,Nummer" fuer alle Zeilen bis einschliesslich Nummer
+        void acknowledge();
+        //Antwort auf einen Fehler: Errorcode, im Fenstermodus "nak,Nummer,Errorcode"
+        void sendError(int errCode);
+        //Bestaetigt alle bisher verarbeiteten Zeilen im Fenstermodus
+        void sendAck();
 
         //Adressen der Ventil, MFC und Display Hauptobjekte zur Verteilung der Daten
         control::Main_MfcCtrl *main_mfcCtrl;
@@ -62,19 +198,81 @@ namespace communication {
         communication::Main_BoschCom *main_boschCom;
         io::Main_Display *main_display;
         communication::Main_StringBuilder *main_stringBuilder;
+        control::Main_Timeline *main_timeline;
 
         bool reading;
         bool sending;
 
+        //Messzeilen an LabView, Meldung verworfener Zeilen als "dropped,N,decimated,M"
+        TelemetryQueue telemetry;
+        unsigned long reportedDropped;
+        unsigned long reportedDecimated;
+        unsigned long lastReportTime;
+        bool latencyRequested; //Antwort auf <latency> folgt, sobald keine Messzeile unterbrochen wird
+        bool uploadRequested;  //ebenso fuer <upload>
+        bool memoryRequested;  //und <memory>
+        bool triggerRequested; //und <trigger>
+        bool syncRequested;    //und <sync>
+        bool listRequested;    //und <ls>
+        bool stopping;         //<stop> empfangen, restliche Messzeilen werden noch gesendet
+
+        int repeatDepth; //offene Wiederholungsbloecke der Eventliste
+
+        //Streaming-Modus, LabView laedt waehrend der Messung Events nach
+        bool streaming;
+        unsigned long streamRejected;   //waehrend der Messung abgelehnte Events
+        unsigned long reportedTaken;    //Summe der entnommenen Events bei der letzten Meldung
+        unsigned long reportedRejected;
+        unsigned long lastStreamReportTime;
+        //Event aus dem Messprogramm der SD-Karte, dessen Kanal voll ist. Die Datei wird erst weiter
+        //gelesen, wenn es gespeichert werden konnte
+        bool streamHeld;
+        control::eventElement heldEvent;
+        char heldType;
+        int heldID;
+
+        //Gleitendes Fenster beim Einlesen, bis zum Start der Messung
+        bool windowed;
+        int windowAckEvery;          //0: nur nach einer Pause, mit <end> und bei Fehlern
+        unsigned long sequence;      //Nummer der aktuellen bzw. letzten Zeile/des letzten Frames, ab 1
+        int unacked;                 //verarbeitete, noch nicht bestaetigte Zeilen
+        unsigned long lastLineTime;  //ms, letzte verarbeitete Zeile
+
+        Stream *input; //Eingabe von readLine()/readFrame(), link oder programFile
+        Stream *link;  //Verbindung zu LabView (srl->getStream('L')), USB und/oder UART
+        storage::ProgramFile programFile;
+        storage::FileTransfer fileTransfer; //<get>, nur zwischen den Messungen
+
         char inDataBuffer[SERIAL_READ_MAX_LINE_SIZE];
         int bufferCharIndex;
+        bool lineInProgress;         //Zeile begonnen, aber noch nicht vollstaendig
+        bool discardLine;            //Rest der fehlerhaften Zeile wird bis '\n' verworfen
+        unsigned long lineStartTime; //Empfang des ersten Zeichens, Basis fuer den Timeout
+        unsigned long receivedBytes; //von readLine()/readFrame() gelesen, fuer die Zeitmessung beim Einlesen
+
+        //Zeitmessung beim Einlesen des Messprogramms (<upload>)
+        UploadStats upload;
+
+        //Binaerprotokoll, Zustaende von readFrame()
+        enum frameStates {FRAME_SYNC, FRAME_TYPE, FRAME_LENGTH_LOW, FRAME_LENGTH_HIGH, FRAME_PAYLOAD, FRAME_CRC_LOW, FRAME_CRC_HIGH};
+        bool binaryMode;
+        frameStates frameState;
+        uint8_t frameType;
+        int frameLength;
+        uint16_t frameCrc;    //laufend berechnete CRC
+        uint16_t receivedCrc; //CRC aus dem Frame
 
-        char inDataArray [SERIAL_READ_MAX_BLOCK_AMOUNT][SERIAL_READ_MAX_BLOCK_SIZE];
+        char *inDataFields[SERIAL_READ_MAX_BLOCK_AMOUNT]; //zeigen in inDataBuffer, nicht gesetzte Eintraege auf ""
+        int fieldAmount;
         int headerLineCounter;
 
         //Header-Varablen:
         int amount_MFC;
         int amount_valve;
+        int eventCapacity; //Anzahl Events, die pro MFC/Ventil mindestens gespeichert werden koennen
+        bool restartable;  //Eventlisten seit <end> vollstaendig, <restart> moeglich
+        bool startArmed;   //arm() ist erfolgt, der Start steht noch aus (Slave: Startpuls des Masters)
+        bool programRejected; //Programm passt nicht (Zeile 0 oder ein Block), Zeilen bis <end> bzw. <stream> werden verworfen
     };
 }
 
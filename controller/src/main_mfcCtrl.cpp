@@ -2,52 +2,148 @@
 
 namespace control {
     Main_MfcCtrl::Main_MfcCtrl() {
+        this->ready = false;
         this->amount_MFC = -1;
         this->amount_of_finished_mfcs = 0;
+
+        this->mfcBus = new control::MfcBus(); //Erzeuge Bustreiber
     }
     Main_MfcCtrl::~Main_MfcCtrl() {
 
     }
 
-    void Main_MfcCtrl::createMFC(int amount) {
-        this->amount_MFC = amount;
+    bool Main_MfcCtrl::createMFC(int amount, int eventBytes) {
+        //mehr als MAX_AMOUNT_MFC MFCs haben in den Listen keinen Platz
+        bool created = amount <= MAX_AMOUNT_MFC;
+        this->amount_MFC = created ? amount : MAX_AMOUNT_MFC;
         for (int i = 0; i < this->amount_MFC; i++) {
-            this->mfc_list[i] = new control::MfcCtrl(i);
+            uint8_t *eventMemory = (uint8_t *)arena->allocate(eventBytes);
+            this->mfc_list[i] = eventMemory == NULL ? NULL : arena->create<control::MfcCtrl>(i, eventMemory, eventBytes);
+            if (this->mfc_list[i] == NULL) { //die bisher erstellten bleiben gueltig
+                this->amount_MFC = i;
+                created = false;
+                break;
+            }
             this->mfc_list[i]->setMainDisplayObjectPointer(main_display);
+            this->mfc_list[i]->setMfcBusObjectPointer(this->mfcBus);
+            this->mfcBus->addDevice(i, this->mfc_list[i]);
             this->mfc_continue_next_loop[i] = true;
         }
+        currentState->setAmountMFC(this->amount_MFC);
+        return created;
     }
 
-    void Main_MfcCtrl::setAdresses(char adresses[][SERIAL_READ_MAX_BLOCK_SIZE]) {
+    void Main_MfcCtrl::setAdresses(char *adresses[]) {
         for (int i = 0; i < this->amount_MFC; i++) {
             this->mfc_list[i]->setAdress(adresses[i]);
         }
     }
 
-    void Main_MfcCtrl::setTypes(char adresses[][SERIAL_READ_MAX_BLOCK_SIZE]) {
+    void Main_MfcCtrl::setTypes(char *adresses[]) {
         for (int i = 0; i < this->amount_MFC; i++) {
             this->mfc_list[i]->setType(adresses[i]);
         }
     }
 
-    void Main_MfcCtrl::setEvent(int mfcID, int value, unsigned long time) {
-        this->mfc_list[mfcID]->setEvent(value, time);
+    bool Main_MfcCtrl::setEvent(int mfcID, int value, unsigned long time) {
+        if (!this->mfc_list[mfcID]->setEvent(value, time))
+            return false;
+        if (this->ready) //Thread schlaeft evtl. bis zum naechsten bekannten Event
+            this->resume();
+        return true;
+    }
+
+    bool Main_MfcCtrl::setRamp(int mfcID, int startValue, int endValue, unsigned long time, unsigned long duration, unsigned int step) {
+        if (!this->mfc_list[mfcID]->setRamp(startValue, endValue, time, duration, step))
+            return false;
+        if (this->ready)
+            this->resume();
+        return true;
+    }
+
+    bool Main_MfcCtrl::setRepeat(unsigned long count, unsigned long period) {
+        bool stored = true;
+        for (int i = 0; i < this->amount_MFC; i++) {
+            stored &= this->mfc_list[i]->setRepeat(count, period);
+        }
+        return stored;
     }
 
-    void Main_MfcCtrl::start(unsigned long startTime) {
+    bool Main_MfcCtrl::endRepeat() {
+        bool stored = true;
+        for (int i = 0; i < this->amount_MFC; i++) {
+            stored &= this->mfc_list[i]->endRepeat();
+        }
+        return stored;
+    }
+
+    void Main_MfcCtrl::setStreaming(bool streaming) {
+        for (int i = 0; i < this->amount_MFC; i++) {
+            this->mfc_list[i]->setStreaming(streaming);
+        }
+        if (this->ready)
+            this->resume();
+    }
+
+    void Main_MfcCtrl::arm() {
+        //beim Start wird nur noch der Nullpunkt gesetzt
+        for (int i = 0; i < this->amount_MFC; i++) {
+            this->mfc_list[i]->loadFirstEvent();
+        }
+    }
+
+    void Main_MfcCtrl::start(uint64_t startTime) {
         for (int i = 0; i < this->amount_MFC; i++) {
             this->mfc_list[i]->start(startTime);
         }
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->ready = true;
+        this->resume();
     }
 
-    void Main_MfcCtrl::setMainDisplayObjectPointer(io::Main_Display *main_display) {
-        this->main_display = main_display;
+    void Main_MfcCtrl::markProgram() {
+        for (int i = 0; i < this->amount_MFC; i++) {
+            this->mfc_list[i]->markProgram();
+        }
+    }
+
+    void Main_MfcCtrl::rewind() {
+        //der Thread pausiert im naechsten Durchlauf bis zum Start
+        this->ready = false;
+        for (int i = 0; i < this->amount_MFC; i++) {
+            this->mfc_list[i]->rewind();
+            this->mfc_continue_next_loop[i] = true;
+        }
+        this->amount_of_finished_mfcs = 0;
     }
 
-    void Main_MfcCtrl::getMfcValueList(int *mfcValueList[]) {
+    void Main_MfcCtrl::reset() {
+        this->ready = false;
+        this->mfcBus->removeDevices();
         for (int i = 0; i < this->amount_MFC; i++) {
-            mfcValueList[i] = this->mfc_list[i]->getCurrentValue();
+            this->mfc_list[i]->~MfcCtrl(); //mit arena->create() angelegt, nie mit delete
         }
+        this->amount_MFC = -1;
+        this->amount_of_finished_mfcs = 0;
+        currentState->setAmountMFC(0);
+    }
+
+    void Main_MfcCtrl::setMainDisplayObjectPointer(io::Main_Display *main_display) {
+        this->main_display = main_display;
+        this->mfcBus->setMainDisplayObjectPointer(main_display);
+    }
+
+    int Main_MfcCtrl::getAmountMFC() {
+        return this->amount_MFC;
+    }
+
+    control::MfcCtrl *Main_MfcCtrl::getMFC(int mfcID) {
+        return this->mfc_list[mfcID];
+    }
+
+    control::MfcBus *Main_MfcCtrl::getMfcBus() {
+        return this->mfcBus;
     }
 
     bool Main_MfcCtrl::loop() {
@@ -55,6 +151,12 @@ namespace control {
         if (kill_flag)
             return false;
 
+        //Vor dem Start gibt es nichts zu tun, start() weckt den Thread wieder auf
+        if (!this->ready) {
+            this->pause();
+            return true;
+        }
+
         //Aufrufen der MFC.compute() Funktionen. Kann immer getan werden, hat erst Wirkung nach demsie mit MFC.start() aktiviert werden.
         for (int i = 0; i < this->amount_MFC; i++) {
             if (this->mfc_continue_next_loop[i]) {
@@ -62,18 +164,34 @@ namespace control {
 
                 if (!this->mfc_continue_next_loop[i]) {
                     this->amount_of_finished_mfcs++;
-                    srl->print('D', "Eventliste von MFC ");
-                    srl->print('D', i);
-                    srl->println('D', " abgearbeitet.");
+                    srl->trace("Eventliste von MFC ");
+                    srl->trace(i);
+                    srl->traceln(" abgearbeitet.");
                 }
             }
         }
 
-        //Beenden des Threads, wenn alle Events abgearbeitet sind
+        //Alle Events abgearbeitet: der Thread pausiert bis zum naechsten Start (<restart>)
         if (this->amount_MFC != -1 && this->amount_of_finished_mfcs >= this->amount_MFC) {
-            srl->println('D', "Alle MFCs abgearbeitet.");
-            return false;
+            srl->infoln("Alle MFCs abgearbeitet.");
+            srl->info("Maximale Weckverzoegerung: ");
+            srl->info(this->get_max_latency());
+            srl->infoln(" us");
+            this->ready = false;
+            this->pause();
+            return true;
+        }
+
+        //Schlafe bis zum naechsten faelligen Event (64 Bit, ohne Ueberlauf), hoechstens MTHREAD_MAX_WAIT
+        uint64_t nextEventTime = (uint64_t)-1;
+        for (int i = 0; i < this->amount_MFC; i++) {
+            if (this->mfc_continue_next_loop[i] && this->mfc_list[i]->hasEvent()) {
+                uint64_t eventTime = this->mfc_list[i]->getNextEventTime();
+                if (eventTime < nextEventTime)
+                    nextEventTime = eventTime;
+            }
         }
+        this->sleep_until_micro(cmn::wakeMicros(nextEventTime));
 
 
         return true;
@@ -7,7 +7,9 @@
 
 #include "config.h"
 #include "mfcCtrl.h"
+#include "mfcBus.h"
 #include "main_display.h"
+#include "ownlibs/arena.h"
 
 namespace control {
     // an die MFCs werden absolutwerte uerbtragen. Diese basieren auf der Zeit, die gespeichert
@@ -18,34 +20,61 @@ namespace control {
         Main_MfcCtrl();
         //Destructor
         ~Main_MfcCtrl();
-        //Funktion, die von LabCom aufgerufen wird. Sie erstellt MFC-Objekte
-        void createMFC(int amount);
+        //Funktion, die von LabCom aufgerufen wird. Sie erstellt MFC-Objekte in der Arena
+        //Jedes Objekt erhaelt einen Eventspeicher mit 'eventBytes' Bytes. Gibt false zurueck,
+        //wenn 'amount' MAX_AMOUNT_MFC uebersteigt oder die Arena voll ist
+        bool createMFC(int amount, int eventBytes);
         //Wird von LabCom aufgerufen und bekommt ein Array mit allen Adressen.
         //Adressen werden weiter an alle MFC-Objekte gegeben
-        void setAdresses(char adresses[][SERIAL_READ_MAX_BLOCK_SIZE]);
+        void setAdresses(char *adresses[]);
         //Wird von LabCom aufgerufen und bekommt ein Array mit allen Typen
         //Typen werden weiter an alle MFC-Objekte gegeben.
-        void setTypes(char adresses[][SERIAL_READ_MAX_BLOCK_SIZE]);
+        void setTypes(char *adresses[]);
         //Wird von LabCom aufgerufen und enthält Eventdaten. Wichtig ist hier, dass
         //dieser Aufruf immer nur fuer EIN MFC ist, daher ist die ID von Noeten
-        void setEvent(int mfcID, int value, unsigned long time);
+        //Gibt false zurueck, wenn der Eventspeicher des Objektes voll ist. Waehrend der Messung
+        //(Streaming-Modus) wird der Thread geweckt, damit er das Event beruecksichtigt
+        bool setEvent(int mfcID, int value, unsigned long time);
+        //Wie setEvent(), fuer eine Rampe (siehe MfcCtrl::setRamp())
+        bool setRamp(int mfcID, int startValue, int endValue, unsigned long time, unsigned long duration, unsigned int step);
+        //Beginnt bzw. schliesst einen Wiederholungsblock in den Eventlisten aller MFCs, gibt
+        //false zurueck, wenn ein Eventspeicher voll ist
+        bool setRepeat(unsigned long count, unsigned long period);
+        bool endRepeat();
+        //Streaming-Modus (<stream>) fuer alle MFCs, mit false (<end> waehrend der Messung) werden
+        //die Eventlisten beendet, sobald sie abgearbeitet sind
+        void setStreaming(bool streaming);
+        //Entnimmt vor dem Start die ersten Events aller MFCs (nach <end> bzw. <restart>)
+        void arm();
         //setzt die 'ready'-Variable der MFCs auf true. Außerdem wird der Nullpunkt der Steuerung gesetzt
-        void start(unsigned long startTime);
+        void start(uint64_t startTime);
+        //Merkt sich die vollstaendig uebertragenen Eventlisten (<end>) fuer rewind()
+        void markProgram();
+        //Haelt die Ansteuerung an und setzt die Eventlisten auf den Stand von markProgram()
+        //zurueck (<restart>), danach kann wieder gestartet werden
+        void rewind();
+        //Haelt die Ansteuerung an und zerstoert die MFC-Objekte (<rearm>). Ihr Speicher in der
+        //Arena wird danach von LabCom freigegeben, der naechste Header erstellt sie neu
+        void reset();
         //Gebe Adresse des Displayobjektes an die einzelnen MFCs, um zu kommunizieren
         void setMainDisplayObjectPointer(io::Main_Display *main_display);
-        //Diese Funktion wird vom StringBuilder aufgerufen und sammelt die Daten der MFCs
-        //um sie in den Ausgabestring zu schreiben
-        //Die Funktion fragt die einzelnen MFCs nach ihren Werten ab
-        void getMfcValueList(int *mfcValueList[]);
+        //Anzahl der erstellten MFCs (-1 vor dem Header)
+        int getAmountMFC();
+        //Gibt das MFC-Objekt mit der gegebenen ID zurueck
+        control::MfcCtrl *getMFC(int mfcID);
+        //Gibt den Bustreiber zurueck, damit sein Thread gestartet werden kann
+        control::MfcBus *getMfcBus();
     protected:
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
+        bool ready;
         int amount_MFC;
         control::MfcCtrl *mfc_list[MAX_AMOUNT_MFC]; //Hier werden die Adressen der MFC-Objekte gespeichert
         bool mfc_continue_next_loop[MAX_AMOUNT_MFC];
         int amount_of_finished_mfcs;
 
+        control::MfcBus *mfcBus; //Hier wird der Bustreiber gespeichert
         io::Main_Display *main_display;
     };
 }
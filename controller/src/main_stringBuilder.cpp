@@ -1,10 +1,17 @@
 #include "main_stringBuilder.h"
+#include "main_labCom.h"
 
 namespace communication {
     Main_StringBuilder::Main_StringBuilder() {
         this->ready = false;
+        this->lineLength = 0;
+        this->samplesSinceKeyframe = TELEMETRY_KEYFRAME_INTERVALL; //erster Frame ist ein Keyframe
+        this->frameSequence = 0;
+        //Ausgegeben wird der gemessene Durchfluss, sofern er vom Bus abgefragt wird, sonst der Soll-Wert
+        this->mfcColumn = MFC_BUS_READBACK ? this->snapshot.mfcFlows : this->snapshot.mfcValues;
 
         this->storeD = new storage::StoreD(); //Erzeuge StoreD Objekt
+        this->storeD->begin(); //Karte und Dateinummer einmalig beim Booten bestimmen
     }
     Main_StringBuilder::~Main_StringBuilder() {
 
@@ -13,13 +20,42 @@ namespace communication {
     void Main_StringBuilder::setIntervall(int intervall) {
         this->intervall = intervall;
 
-        srl->print('D', "StringBuilder: Intervall gesetzt auf: ");
-        srl->println('D', this->intervall);
+        srl->info("StringBuilder: Intervall gesetzt auf: ");
+        srl->infoln(this->intervall);
     }
 
-    void Main_StringBuilder::start(unsigned long time) {
+    void Main_StringBuilder::arm() {
+        this->storeD->arm(this->intervall);
+    }
+
+    void Main_StringBuilder::disarm() {
+        this->storeD->disarm();
+    }
+
+    void Main_StringBuilder::start(uint64_t time) {
         this->ready = true;
-        this->lastTime = time + this->intervall / 2; //addiere halbes Intervall um versetzt zur Messung zu speichern
+        this->startTime = time;
+        this->lastTime = time + (this->intervall / 2) * 1000ULL; //addiere halbes Intervall um versetzt zur Messung zu speichern
+
+#if SD_BINARY_RECORDS
+        this->writeSdHeader((unsigned long)(time / 1000));
+#endif
+        //Messung laeuft auch ohne SD-Karte weiter, es wird nur nicht gespeichert. Die Datei ist
+        //meist schon seit arm() offen, es wird nur der Dateikopf eingereiht
+        if (!this->storeD->start(this->intervall))
+            this->main_display->throwError(ERR_SD_INIT);
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->resume();
+    }
+
+    void Main_StringBuilder::stop() {
+        if (!this->ready)
+            return;
+        this->ready = false;
+
+        this->writeSdFooter();
+        this->storeD->stop();
     }
 
     void Main_StringBuilder::setMainValveObjectPointer(control::Main_ValveCtrl *main_valveCtrl) {
@@ -34,33 +70,235 @@ namespace communication {
         this->main_boschCom = main_boschCom;
     }
 
+    void Main_StringBuilder::setMainLabComObjectPointer(communication::Main_LabCom *main_labCom) {
+        this->main_labCom = main_labCom;
+    }
+
+    storage::StoreD *Main_StringBuilder::getStoreD() {
+        return this->storeD;
+    }
+
+    void Main_StringBuilder::setMainDisplayObjectPointer(io::Main_Display *main_display) {
+        this->main_display = main_display;
+    }
+
+    void Main_StringBuilder::writeSdHeader(unsigned long startTime) {
+        int amountMFC = this->main_mfcCtrl->getAmountMFC();
+        char buffer[SD_FILE_HEADER_MAX_SIZE];
+
+        storage::sdFileHeader header;
+        memset(&header, 0, sizeof(header));
+        strcpy(header.magic, "MSD");
+        header.version     = SD_RECORD_VERSION;
+        header.amountMFC   = amountMFC;
+        header.amountValve = this->main_valveCtrl->getAmountValve();
+        header.boschReduction = BOSCH_REDUCTION;
+        header.intervall   = this->intervall;
+        header.startTime   = startTime;
+        memcpy(buffer, &header, sizeof(header));
+
+        //Typnamen mit fester Laenge, nicht genutzte Zeichen sind '\0'
+        char *type = buffer + sizeof(header);
+        for (int i = 0; i < amountMFC; i++) {
+            memset(type, 0, SD_RECORD_TYPE_SIZE);
+            strncpy(type, this->main_mfcCtrl->getMFC(i)->getType(), SD_RECORD_TYPE_SIZE - 1);
+            type += SD_RECORD_TYPE_SIZE;
+        }
+
+        //StoreD schreibt den Kopf an den Anfang jeder Datei, auch nach dem Wechsel auf eine neue Datei
+        this->storeD->setFileHeader(buffer, type - buffer);
+    }
+
+    void Main_StringBuilder::writeSdFooter() {
+        int amountMFC   = this->main_mfcCtrl->getAmountMFC();
+        int amountValve = this->main_valveCtrl->getAmountValve();
+#if SD_BINARY_RECORDS
+        char record[LATENCY_RECORD_SIZE];
+        eventLatency->serialize(record, 'G', 0);
+        this->storeD->writeFinal(record, LATENCY_RECORD_SIZE);
+        for (int i = 0; i < amountMFC; i++) {
+            this->main_mfcCtrl->getMFC(i)->getLatency()->serialize(record, 'M', i);
+            this->storeD->writeFinal(record, LATENCY_RECORD_SIZE);
+        }
+        for (int i = 0; i < amountValve; i++) {
+            this->main_valveCtrl->getValve(i)->getLatency()->serialize(record, 'V', i);
+            this->storeD->writeFinal(record, LATENCY_RECORD_SIZE);
+        }
+
+        storage::sdFileFooter footer;
+        memset(&footer, 0, sizeof(footer));
+        footer.amountStats = 1 + amountMFC + amountValve;
+        footer.recordSize  = LATENCY_RECORD_SIZE;
+        footer.length      = footer.amountStats * LATENCY_RECORD_SIZE + sizeof(footer);
+        strcpy(footer.magic, "MSF");
+        this->storeD->writeFinal((const char *)&footer, sizeof(footer));
+#else
+        char text[LATENCY_LINE_SIZE];
+        this->storeD->writeFinal(text, eventLatency->format(text, 'G', 0) - text);
+        for (int i = 0; i < amountMFC; i++)
+            this->storeD->writeFinal(text, this->main_mfcCtrl->getMFC(i)->getLatency()->format(text, 'M', i) - text);
+        for (int i = 0; i < amountValve; i++)
+            this->storeD->writeFinal(text, this->main_valveCtrl->getValve(i)->getLatency()->format(text, 'V', i) - text);
+#endif
+    }
+
+    void Main_StringBuilder::buildLine(unsigned long time) {
+        //Spalten wie in example_StoreD.txt: Zeit, MFC1..n, Ven1..n, Bosch (bei BOSCH_REDUCE_MINMAX Minimum und Maximum)
+        char *out = cmn::formatInt(this->line, time, STRINGBUILDER_WIDTH_TIME);
+        for (int i = 0; i < this->snapshot.amountMFC; i++) {
+            *out++ = '\t';
+            out = cmn::formatInt(out, this->mfcColumn[i], STRINGBUILDER_WIDTH_VALUE);
+        }
+        for (int i = 0; i < this->snapshot.amountValve; i++) {
+            *out++ = '\t';
+            *out++ = (this->snapshot.valveMask >> i) & 1 ? '1' : '0';
+        }
+        for (int i = 0; i < BOSCH_VALUES; i++) {
+            *out++ = '\t';
+            out = cmn::formatInt(out, this->bosch.values[i], STRINGBUILDER_WIDTH_VALUE);
+        }
+        *out++ = '\n';
+        *out   = '\0';
+
+        this->lineLength = out - this->line;
+    }
+
+    void Main_StringBuilder::buildTelemetryFrame(unsigned long time) {
+        int amountMFC      = this->snapshot.amountMFC;
+        control::valveBits valveMask = this->snapshot.valveMask;
+        int valveBytes = storage::sdValveBytes(this->snapshot.amountValve);
+
+        //Nutzdaten beginnen hinter Sync, Typ und Laenge, siehe cmn::finishFrame()
+        char *out = cmn::putLittleEndian(&this->line[4], this->frameSequence++, 1);
+        out = cmn::putLittleEndian(out, time, 4);
+
+        uint8_t type;
+        if (this->samplesSinceKeyframe >= TELEMETRY_KEYFRAME_INTERVALL) {
+            type = SERIAL_BINARY_KEYFRAME;
+            this->samplesSinceKeyframe = 0;
+
+            out = cmn::putLittleEndian(out, amountMFC, 1);
+            out = cmn::putLittleEndian(out, this->snapshot.amountValve, 1);
+            for (int i = 0; i < amountMFC; i++)
+                out = cmn::putLittleEndian(out, this->mfcColumn[i], 2);
+            out = cmn::putLittleEndian(out, valveMask, valveBytes);
+            for (int i = 0; i < BOSCH_VALUES; i++)
+                out = cmn::putLittleEndian(out, this->bosch.values[i], 4);
+        } else {
+            type = SERIAL_BINARY_DELTA;
+            this->samplesSinceKeyframe++;
+
+            //Bit i: MFC i, Bit 16: Ventilmaske, Bit 17: Bosch, Bit 18: Bosch-Maximum (BOSCH_REDUCE_MINMAX).
+            //Die Werte folgen in dieser Reihenfolge
+            char *bitmapPos = out;
+            out += 4;
+            uint32_t bitmap = 0;
+            for (int i = 0; i < amountMFC; i++) {
+                if (this->mfcColumn[i] != this->lastMfcValueList[i]) {
+                    bitmap |= 1UL << i;
+                    out = cmn::putLittleEndian(out, this->mfcColumn[i], 2);
+                }
+            }
+            if (valveMask != this->lastValveMask) {
+                bitmap |= 1UL << 16;
+                out = cmn::putLittleEndian(out, valveMask, valveBytes);
+            }
+            for (int i = 0; i < BOSCH_VALUES; i++) {
+                if (this->bosch.values[i] != this->lastBosch[i]) {
+                    bitmap |= 1UL << (17 + i);
+                    out = cmn::putLittleEndian(out, this->bosch.values[i], 4);
+                }
+            }
+            cmn::putLittleEndian(bitmapPos, bitmap, 4);
+        }
+
+        for (int i = 0; i < amountMFC; i++)
+            this->lastMfcValueList[i] = this->mfcColumn[i];
+        this->lastValveMask = valveMask;
+        for (int i = 0; i < BOSCH_VALUES; i++)
+            this->lastBosch[i] = this->bosch.values[i];
+
+        this->lineLength = cmn::finishFrame(this->line, type, out - &this->line[4]);
+    }
+
+    void Main_StringBuilder::writeSdRecord(unsigned long time) {
+        uint8_t record[storage::sdRecordSize(MAX_AMOUNT_MFC, MAX_AMOUNT_VALVE)];
+        int index = 0;
+
+        //Werte werden byteweise abgelegt, unabhaengig von der Ausrichtung
+        record[index++] = time;
+        record[index++] = time >> 8;
+        record[index++] = time >> 16;
+        record[index++] = time >> 24;
+
+        for (int i = 0; i < this->snapshot.amountMFC; i++) {
+            record[index++] = this->mfcColumn[i];
+            record[index++] = this->mfcColumn[i] >> 8;
+        }
+
+        for (int i = 0; i < storage::sdValveBytes(this->snapshot.amountValve); i++)
+            record[index++] = this->snapshot.valveMask >> (8 * i);
+
+        for (int i = 0; i < BOSCH_VALUES; i++) {
+            int32_t bosch = this->bosch.values[i];
+            record[index++] = bosch;
+            record[index++] = bosch >> 8;
+            record[index++] = bosch >> 16;
+            record[index++] = bosch >> 24;
+        }
+
+        this->storeD->write((const char *)record, index);
+    }
+
     bool Main_StringBuilder::loop() {
         //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
         if (kill_flag)
             return false;
 
-        if (this->ready) {
-            if (millis() >= this->lastTime) {
-                //srl->print('D', millis());
-                //srl->println('D', " Gebe String mit Daten aus...");
-
-                // TODO
-                // baue String (frage Werte von MFCs, Ventilen und Boschsensor ab, nutze
-                // folgende Funktionen:
-                // this->main_mfcCtrl->getMfcValueList(&mfcValueList); //int[]     ; du kennst die Anzahl der Eintraege und kannst durch das Array durchiterieren
-                // this->main_valveCtrl->getValveValueList(&valveValueList); //int[] ; Funktion muss Pointer des Zielarrays uebergeben bekommen
-                // this->main_boschCom->getCurrentValue(); //int
-                // )
-                // Sende String an SD
-                // sende String an LabCom
-                // (Bei SD die Funktion aufrufen, die deine Loop ersetzt (this->storeD->...) // bei lab com this->main_labCom->setNewLine(string))
-
-                //addiere intervall zur letzten Zeit und NICHT zur aktuellen Zeit, um
-                //Zeitungenauigkeiten durch Verzoegerungen vorzubeugen
-                this->lastTime += this->intervall;
-            }
+        //Vor dem Start gibt es nichts zu tun, start() weckt den Thread wieder auf
+        if (!this->ready) {
+            this->pause();
+            return true;
         }
 
+        //beim Slave liegt der Messtakt auf der Uhr des Masters
+        uint64_t rowTime = cmn::programMicros(this->startTime, this->lastTime - this->startTime);
+        if (cmn::micros64() >= rowTime) {
+            unsigned long time = (this->lastTime - this->startTime) / 1000; //ms seit dem Start
+
+            //Ein Zustand fuer alle Ausgaben dieses Messtakts, auch wenn zwischendurch geschaltet wird
+            currentState->read(&this->snapshot);
+            //alle Sensorwerte seit der letzten Zeile als ein Datensatz
+            this->main_boschCom->readRecord(&this->bosch);
+
+#if TELEMETRY_DELTA_FRAMES
+            //Geht ein Frame verloren, kann LabView die folgenden Deltas nicht mehr anwenden, daher sofort ein Keyframe
+            this->buildTelemetryFrame(time);
+            if (!this->main_labCom->setNewLine(this->line, this->lineLength))
+                this->samplesSinceKeyframe = TELEMETRY_KEYFRAME_INTERVALL;
+#if !SD_BINARY_RECORDS
+            this->buildLine(time); //SD speichert weiterhin die Textzeile
+#endif
+#else
+            //Eine Zeile fuer beide Ziele, StoreD kopiert sie in seinen Block, LabCom in die Warteschlange
+            this->buildLine(time);
+            this->main_labCom->setNewLine(this->line, this->lineLength);
+#endif
+
+#if SD_BINARY_RECORDS
+            this->writeSdRecord(time);
+#else
+            this->storeD->write(this->line, this->lineLength);
+#endif
+
+            //addiere intervall zur letzten Zeit und NICHT zur aktuellen Zeit, um
+            //Zeitungenauigkeiten durch Verzoegerungen vorzubeugen
+            this->lastTime += this->intervall * 1000ULL;
+        }
+
+        //Schlafe bis zum naechsten Messtakt
+        this->sleep_until_micro(cmn::wakeMicros(cmn::programMicros(this->startTime, this->lastTime - this->startTime)));
+
         return true;
     }
 }
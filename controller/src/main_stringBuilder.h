@@ -6,14 +6,20 @@
 #include <mthread.h>
 
 #include "StoreD.h" //StoreD wird vom StringBuilder verwaltet und aufgerufen
+#include "sdRecord.h"
+#include "stateSnapshot.h"
 
 #include "main_valveCtrl.h" //Objekte zum Speichern der Objektpointer
 #include "main_mfcCtrl.h"
 #include "main_boschCom.h"
+#include "main_display.h"
 
+#include "ownlibs/common.h"
 #include "ownlibs/serialCommunication.h"
 
 namespace communication {
+    class Main_LabCom; //main_labCom.h bindet diese Datei ein
+
     class Main_StringBuilder : public Thread {
     public:
         //Defaultconstructor
@@ -23,25 +29,66 @@ namespace communication {
         //setze das Intervall, in welchem die Hauptschleife ausgefuert wird.
         //Zeit ist gleich der des Sensors
         void setIntervall(int intervall);
+        //Legt vor dem Start die Messdatei an (nach <end> bzw. <restart>), ein Fehler wird erst von
+        //start() gemeldet
+        void arm();
+        //Verwirft die mit arm() angelegte Messdatei, wenn nicht gestartet wurde (<rearm>)
+        void disarm();
         //aktiviere Klasse von LabCom aus, setzt die erste Intervallzeit
-        void start(unsigned long time);
+        void start(uint64_t time);
+        //beendet die Messung: schreibt die Schaltverzoegerung an das Dateiende und schliesst die Datei
+        void stop();
 
         //Uebergebe Objektpointer
         void setMainValveObjectPointer(control::Main_ValveCtrl *main_valveCtrl);
         void setMainMfcObjectPointer(control::Main_MfcCtrl *main_mfcCtrl);
         void setMainBoschObjectPointer(communication::Main_BoschCom *main_boschCom);
+        void setMainLabComObjectPointer(communication::Main_LabCom *main_labCom);
+        //Gibt das StoreD-Objekt zurueck, damit sein Thread gestartet werden kann
+        storage::StoreD *getStoreD();
+        //Setze Displayobjekt, um Fehler der SD-Karte anzuzeigen
+        void setMainDisplayObjectPointer(io::Main_Display *main_display);
     protected:
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
+        //Erstellt den Dateikopf des Binaerformats (Anzahl, Typen, Intervall, Startzeit) und uebergibt ihn an StoreD
+        void writeSdHeader(unsigned long startTime);
+        //Schreibt die Schaltverzoegerung (gesamt, je MFC und Ventil) an das Ende der Messdatei
+        void writeSdFooter();
+        //Baut die Textzeile mit den aktuellen Werten in einem Durchlauf in line auf, ohne String und sprintf
+        void buildLine(unsigned long time);
+        //Baut einen Keyframe oder, falls seit dem letzten Keyframe weniger als TELEMETRY_KEYFRAME_INTERVALL
+        //Messtakte vergangen sind, einen Deltaframe mit den geaenderten Kanaelen in line auf
+        void buildTelemetryFrame(unsigned long time);
+        //Schreibt einen binaeren Datensatz mit den aktuellen Werten aller MFCs, Ventile und des Sensors
+        void writeSdRecord(unsigned long time);
+
         bool ready;
-        unsigned long lastTime;
+        uint64_t startTime; //cmn::micros64()
+        uint64_t lastTime;  //naechster Messtakt
         int intervall;
 
+        //Textzeile, wird ohne Kopie an LabCom und StoreD uebergeben
+        char line[STRINGBUILDER_LINE_SIZE];
+        int lineLength;
+        control::stateSnapshot snapshot; //Zustand von MFCs und Ventilen im aktuellen Messtakt
+        int16_t *mfcColumn;              //Werte der MFC-Spalten, zeigt in snapshot
+        communication::boschRecord bosch; //zusammengefasste Sensorwerte des aktuellen Messtakts
+
+        //Deltaframes: Werte des letzten Frames, gegen die verglichen wird
+        int samplesSinceKeyframe;
+        uint8_t frameSequence; //laeuft mit jedem Frame hoch, LabView erkennt so verlorene Frames
+        int16_t lastMfcValueList[MAX_AMOUNT_MFC];
+        control::valveBits lastValveMask;
+        int32_t lastBosch[BOSCH_VALUES];
+
         storage::StoreD *storeD; //Hier wird das StoreD-Objekt gespeichert
         control::Main_ValveCtrl *main_valveCtrl;
         control::Main_MfcCtrl *main_mfcCtrl;
         communication::Main_BoschCom *main_boschCom;
+        communication::Main_LabCom *main_labCom;
+        io::Main_Display *main_display;
     };
 }
 
@@ -0,0 +1,163 @@
+#include "main_timeline.h"
+
+namespace control {
+    Main_Timeline::Main_Timeline() {
+        this->ready     = false;
+        this->startTime = 0;
+        this->heapSize  = 0;
+        this->valveMask   = 0;
+        this->valveValues = 0;
+    }
+    Main_Timeline::~Main_Timeline() {
+
+    }
+
+    void Main_Timeline::setMainMfcObjectPointer(control::Main_MfcCtrl *main_mfcCtrl) {
+        this->main_mfcCtrl = main_mfcCtrl;
+    }
+
+    void Main_Timeline::setMainValveObjectPointer(control::Main_ValveCtrl *main_valveCtrl) {
+        this->main_valveCtrl = main_valveCtrl;
+    }
+
+    void Main_Timeline::build() {
+        this->heapSize = 0;
+
+        //Jedes Objekt mit mindestens einem Event bekommt einen Eintrag
+        for (int i = 0; i < this->main_mfcCtrl->getAmountMFC(); i++) {
+            control::MfcCtrl *mfc = this->main_mfcCtrl->getMFC(i);
+            if (mfc->loadFirstEvent()) {
+                this->heap[this->heapSize].time = mfc->getNextEvent().time;
+                this->heap[this->heapSize].type = 'M';
+                this->heap[this->heapSize].id   = i;
+                this->heapSize++;
+            }
+        }
+#if !VALVE_HARDWARE_TIMER //sonst schaltet Main_ValveCtrl die Ventile ueber den Timer-Interrupt
+        for (int i = 0; i < this->main_valveCtrl->getAmountValve(); i++) {
+            control::ValveCtrl *valve = this->main_valveCtrl->getValve(i);
+            if (valve->loadFirstEvent()) {
+                this->heap[this->heapSize].time = valve->getNextEvent().time;
+                this->heap[this->heapSize].type = 'V';
+                this->heap[this->heapSize].id   = i;
+                this->heapSize++;
+            }
+        }
+#endif
+
+        //Heap von unten nach oben aufbauen
+        for (int i = this->heapSize / 2 - 1; i >= 0; i--) {
+            this->siftDown(i);
+        }
+
+        srl->info("Zeitleiste erstellt, Objekte mit Events: ");
+        srl->infoln(this->heapSize);
+    }
+
+    void Main_Timeline::start(uint64_t startTime) {
+        this->startTime = startTime;
+        this->ready     = true;
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->resume();
+    }
+
+    void Main_Timeline::reset() {
+        this->ready    = false;
+        this->heapSize = 0;
+    }
+
+    void Main_Timeline::siftDown(int i) {
+        while (true) {
+            int smallest = i;
+            int left     = 2 * i + 1;
+            int right    = left + 1;
+
+            if (left < this->heapSize && this->heap[left].time < this->heap[smallest].time)
+                smallest = left;
+            if (right < this->heapSize && this->heap[right].time < this->heap[smallest].time)
+                smallest = right;
+            if (smallest == i)
+                return;
+
+            timelineElement temp  = this->heap[i];
+            this->heap[i]         = this->heap[smallest];
+            this->heap[smallest]  = temp;
+            i = smallest;
+        }
+    }
+
+    void Main_Timeline::fireFirst() {
+        bool hasNext;
+        eventElement nextEvent;
+
+        if (this->heap[0].type == 'M') {
+            control::MfcCtrl *mfc = this->main_mfcCtrl->getMFC(this->heap[0].id);
+            hasNext   = mfc->fireNextEvent();
+            nextEvent = mfc->getNextEvent();
+        } else {
+            //geschaltet wird nach allen faelligen Events, mit einer Uebertragung fuer alle Ventile
+            control::ValveCtrl *valve = this->main_valveCtrl->getValve(this->heap[0].id);
+            valveBits bit = (valveBits)1 << this->heap[0].id;
+            this->valveMask  |= bit;
+            this->valveValues = valve->getNextEvent().value ? this->valveValues | bit : this->valveValues & ~bit;
+            hasNext   = valve->fireNextEvent();
+            nextEvent = valve->getNextEvent();
+        }
+
+        if (hasNext) {
+            this->heap[0].time = nextEvent.time;
+        } else { //Objekt ist fertig, letzter Eintrag rueckt an die Wurzel
+            srl->trace("Eventliste von ");
+            srl->trace(this->heap[0].type);
+            srl->trace(this->heap[0].id);
+            srl->traceln(" abgearbeitet.");
+
+            this->heapSize--;
+            this->heap[0] = this->heap[this->heapSize];
+        }
+        this->siftDown(0);
+    }
+
+    bool Main_Timeline::loop() {
+        //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
+        if (kill_flag)
+            return false;
+
+        //Vor dem Start gibt es nichts zu tun, start() weckt den Thread wieder auf
+        if (!this->ready) {
+            this->pause();
+            return true;
+        }
+
+        //Alle faelligen Events werden direkt nacheinander ausgefuehrt
+        while (this->heapSize > 0 && cmn::micros64() >= cmn::eventMicros(this->startTime, this->heap[0].time)) {
+            this->fireFirst();
+        }
+        if (this->valveMask) {
+            this->main_valveCtrl->writeValves(this->valveMask, this->valveValues);
+            this->valveMask   = 0;
+            this->valveValues = 0;
+        }
+        bool flushed = this->main_valveCtrl->flushValves();
+
+        //Alle Events abgearbeitet: der Thread pausiert bis zum naechsten Start (<restart>)
+        if (this->heapSize == 0 && flushed) {
+            srl->infoln("Zeitleiste abgearbeitet.");
+            srl->info("Maximale Weckverzoegerung: ");
+            srl->info(this->get_max_latency());
+            srl->infoln(" us");
+            this->ready = false;
+            this->pause();
+            return true;
+        }
+
+        //Schlafe bis zum naechsten Event, bzw. bis der Ausgang eine freie Transaktion haben sollte
+        uint64_t wakeTime = this->heapSize > 0 ? cmn::eventMicros(this->startTime, this->heap[0].time) : (uint64_t)-1;
+        if (!flushed && cmn::micros64() + VALVE_OUTPUT_RETRY < wakeTime)
+            wakeTime = cmn::micros64() + VALVE_OUTPUT_RETRY;
+        this->sleep_until_micro(cmn::wakeMicros(wakeTime));
+
+        return true;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef MAIN_TIMELINE_H
+#define MAIN_TIMELINE_H
+
+#include <Arduino.h>
+#include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
+#include <mthread.h>
+
+#include "config.h"
+#include "eventElement.h"
+#include "main_mfcCtrl.h"
+#include "main_valveCtrl.h"
+#include "ownlibs/serialCommunication.h"
+#include "ownlibs/common.h"
+
+namespace control {
+    //Eintrag der Zeitleiste: naechstes Event eines MFCs oder Ventils
+    typedef struct timelineElementStruct {
+        unsigned long time; //relativ zum Start (EVENT_TIME_UNIT)
+        char type; //'M' oder 'V'
+        int id;
+    } timelineElement;
+
+    // Optionaler Modus (EVENT_TIMELINE_MERGED in der config.h): Statt dass Main_MfcCtrl und
+    // Main_ValveCtrl in jedem Durchlauf alle Objekte abfragen, werden die Eventlisten nach <end>
+    // zu einer zeitlich sortierten Zeitleiste zusammengefuehrt. Die Zeitleiste ist ein Min-Heap
+    // ueber das jeweils naechste Event jedes Objektes, die Events selbst bleiben in den
+    // Ringpuffern der Objekte. Ein Durchlauf kostet so unabhaengig von der Anzahl an Kanaelen
+    // nur einen Vergleich, gleichzeitige Events werden direkt nacheinander ausgefuehrt.
+    class Main_Timeline : public Thread {
+    public:
+        //Defaultconstructor
+        Main_Timeline();
+        //Destructor
+        ~Main_Timeline();
+        //Uebergebe Objektpointer
+        void setMainMfcObjectPointer(control::Main_MfcCtrl *main_mfcCtrl);
+        void setMainValveObjectPointer(control::Main_ValveCtrl *main_valveCtrl);
+        //Fuehrt die Eventlisten aller MFCs und Ventile zusammen, wird nach <end> aufgerufen
+        void build();
+        //Setzt den Nullpunkt (cmn::micros64()) und startet die Abarbeitung
+        void start(uint64_t startTime);
+        //Haelt die Abarbeitung an und leert die Zeitleiste (<restart>, <rearm>), build() erstellt
+        //sie neu
+        void reset();
+    protected:
+        //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
+        bool loop();
+    private:
+        //Fuehrt das Event an der Wurzel aus und sortiert das Objekt mit seinem naechsten Event neu ein
+        void fireFirst();
+        //Stellt die Heap-Ordnung ab Index i (Richtung Blaetter) wieder her
+        void siftDown(int i);
+
+        bool ready;
+        uint64_t startTime;
+
+        timelineElement heap[MAX_AMOUNT_MFC + MAX_AMOUNT_VALVE];
+        int heapSize;
+
+        //Ventile, die in diesem Durchlauf faellig waren, werden zusammen geschaltet
+        valveBits valveMask;
+        valveBits valveValues;
+
+        control::Main_MfcCtrl *main_mfcCtrl;
+        control::Main_ValveCtrl *main_valveCtrl;
+    };
+}
+
+#endif
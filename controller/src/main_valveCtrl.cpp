@@ -2,73 +2,324 @@
 
 namespace control {
     Main_ValveCtrl::Main_ValveCtrl() {
+        this->ready = false;
+        this->streaming = false;
         this->amount_valve = -1;
         this->amount_of_finished_valves = 0;
+
+        this->output = control::createValveOutput();
+        this->output->begin();
+#if VALVE_HARDWARE_TIMER
+        this->valveTimer.setOutput(this->output);
+#endif
     }
     Main_ValveCtrl::~Main_ValveCtrl() {
-
+        delete this->output;
     }
 
-    void Main_ValveCtrl::createValve(int amount) {
-        this->amount_valve = amount;
+    bool Main_ValveCtrl::createValve(int amount, int eventBytes) {
+        //mehr als MAX_AMOUNT_VALVE Ventile haben in den Listen keinen Platz
+        bool created = amount <= MAX_AMOUNT_VALVE;
+        this->amount_valve = created ? amount : MAX_AMOUNT_VALVE;
         for (int i = 0; i < this->amount_valve; i++) {
-            this->valve_list[i] = new control::ValveCtrl(i);
+            uint8_t *eventMemory = (uint8_t *)arena->allocate(eventBytes);
+            this->valve_list[i] = eventMemory == NULL ? NULL : arena->create<control::ValveCtrl>(i, eventMemory, eventBytes);
+            if (this->valve_list[i] == NULL) { //die bisher erstellten bleiben gueltig
+                this->amount_valve = i;
+                created = false;
+                break;
+            }
             this->valve_list[i]->setMainDisplayObjectPointer(main_display);
             this->valve_continue_next_loop[i] = true;
         }
+        currentState->setAmountValve(this->amount_valve);
+        return created;
     }
 
-    void Main_ValveCtrl::setPins(char pins[][SERIAL_READ_MAX_BLOCK_SIZE]) {
+    void Main_ValveCtrl::setPins(char *pins[]) {
         for (int i = 0; i < this->amount_valve; i++) {
             this->valve_list[i]->setPin(atoi(pins[i])); //Uebergebe Pin-Nummer als Integer
+            if (!this->output->setPin(i, this->valve_list[i]->getPin())) {
+                srl->error("ERROR - Ventil ");
+                srl->error(i);
+                srl->errorln(": Ausgang ungueltig oder zu viele GPIO-Ports fuer den Hardware-Timer");
+            }
+        }
+    }
+
+    void Main_ValveCtrl::writeValves(valveBits mask, valveBits values) {
+        this->output->write(mask, values);
+    }
+
+    bool Main_ValveCtrl::flushValves() {
+        return this->output->flush();
+    }
+
+    bool Main_ValveCtrl::setEvent(int valveID, int value, unsigned long time) {
+        if (!this->valve_list[valveID]->setEvent(value, time))
+            return false;
+        if (this->ready) //Thread schlaeft evtl. bis zum naechsten bekannten Event
+            this->resume();
+        return true;
+    }
+
+    bool Main_ValveCtrl::setRepeat(unsigned long count, unsigned long period) {
+        bool stored = true;
+        for (int i = 0; i < this->amount_valve; i++) {
+            stored &= this->valve_list[i]->setRepeat(count, period);
+        }
+        return stored;
+    }
+
+    bool Main_ValveCtrl::endRepeat() {
+        bool stored = true;
+        for (int i = 0; i < this->amount_valve; i++) {
+            stored &= this->valve_list[i]->endRepeat();
         }
+        return stored;
     }
 
-    void Main_ValveCtrl::setEvent(int valveID, int value, unsigned long time) {
-        this->valve_list[valveID]->setEvent(value, time);
+    void Main_ValveCtrl::setStreaming(bool streaming) {
+        this->streaming = streaming;
+        for (int i = 0; i < this->amount_valve; i++) {
+            this->valve_list[i]->setStreaming(streaming);
+        }
+        if (this->ready)
+            this->resume();
+    }
+
+    void Main_ValveCtrl::arm() {
+        //beim Start wird nur noch der Nullpunkt gesetzt
+        for (int i = 0; i < this->amount_valve; i++) {
+#if VALVE_HARDWARE_TIMER
+            this->valve_continue_next_loop[i] = this->valve_list[i]->loadFirstEvent() || this->streaming;
+#else
+            this->valve_list[i]->loadFirstEvent();
+#endif
+        }
+
+#if VALVE_HARDWARE_TIMER
+        //die Zeiten der Warteschlange sind relativ, der Timer laeuft erst ab start()
+        this->fillValveTimer();
+#endif
     }
 
-    void Main_ValveCtrl::start(unsigned long startTime) {
+    void Main_ValveCtrl::start(uint64_t startTime) {
         for (int i = 0; i < this->amount_valve; i++) {
             this->valve_list[i]->start(startTime);
         }
+
+#if VALVE_HARDWARE_TIMER
+        //Erste Events stehen seit arm() in der Warteschlange
+        this->startTime = startTime;
+        this->valveTimer.start(startTime);
+#endif
+
+        //wecke den Thread, er pausiert bis zum Start
+        this->ready = true;
+        this->resume();
+    }
+
+    void Main_ValveCtrl::markProgram() {
+        for (int i = 0; i < this->amount_valve; i++) {
+            this->valve_list[i]->markProgram();
+        }
+    }
+
+    void Main_ValveCtrl::rewind() {
+        //der Thread pausiert im naechsten Durchlauf bis zum Start
+        this->ready = false;
+#if VALVE_HARDWARE_TIMER
+        this->valveTimer.stop();
+        this->valveTimer.clear();
+#endif
+        for (int i = 0; i < this->amount_valve; i++) {
+            this->valve_list[i]->rewind();
+            this->valve_continue_next_loop[i] = true;
+        }
+        this->amount_of_finished_valves = 0;
+    }
+
+    void Main_ValveCtrl::reset() {
+        this->ready = false;
+        this->streaming = false;
+#if VALVE_HARDWARE_TIMER
+        this->valveTimer.stop();
+        this->valveTimer.clear();
+#endif
+        this->output->clearPins();
+        for (int i = 0; i < this->amount_valve; i++) {
+            this->valve_list[i]->~ValveCtrl(); //mit arena->create() angelegt, nie mit delete
+        }
+        this->amount_valve = -1;
+        this->amount_of_finished_valves = 0;
+        currentState->setAmountValve(0);
     }
 
     void Main_ValveCtrl::setMainDisplayObjectPointer(io::Main_Display *main_display) {
         this->main_display = main_display;
     }
 
-    void Main_ValveCtrl::getValveValueList(int *valveValueList[]) {
+    int Main_ValveCtrl::getAmountValve() {
+        return this->amount_valve;
+    }
+
+    control::ValveCtrl *Main_ValveCtrl::getValve(int valveID) {
+        return this->valve_list[valveID];
+    }
+
+#if VALVE_HARDWARE_TIMER
+    void Main_ValveCtrl::fillValveTimer() {
+        //Im Streaming-Modus wartende Ventile nehmen nachgeladene Events auf, nach <end> sind sie abgearbeitet
         for (int i = 0; i < this->amount_valve; i++) {
-            valveValueList[i] = this->valve_list[i]->getCurrentValue();
+            if (this->valve_continue_next_loop[i] && !this->valve_list[i]->hasEvent())
+                this->valve_continue_next_loop[i] = this->valve_list[i]->loadFirstEvent() || this->streaming;
+        }
+
+        while (!this->valveTimer.isFull()) {
+            //Suche den fruehesten anstehenden Zeitpunkt
+            bool found = false;
+            unsigned long stepTime = 0;
+            for (int i = 0; i < this->amount_valve; i++) {
+                if (this->valve_continue_next_loop[i] && this->valve_list[i]->hasEvent()) {
+                    unsigned long eventTime = this->valve_list[i]->getNextEvent().time;
+                    if (!found || eventTime < stepTime) {
+                        stepTime = eventTime;
+                        found = true;
+                    }
+                }
+            }
+            if (!found) //alle Events liegen in der Warteschlange
+                return;
+
+            //Alle Ventile mit diesem Zeitpunkt schalten im selben Schritt
+            valveBits valveMask   = 0;
+            valveBits valveValues = 0;
+            for (int i = 0; i < this->amount_valve; i++) {
+                if (this->valve_continue_next_loop[i] && this->valve_list[i]->hasEvent()
+                        && this->valve_list[i]->getNextEvent().time == stepTime) {
+                    valveMask |= (valveBits)1 << i;
+                    if (this->valve_list[i]->getNextEvent().value)
+                        valveValues |= (valveBits)1 << i;
+                    this->valve_continue_next_loop[i] = this->valve_list[i]->loadNextEvent();
+                }
+            }
+            this->valveTimer.push(stepTime, valveMask, valveValues);
         }
     }
 
+    void Main_ValveCtrl::reportValveTimer() {
+        control::valveStep step;
+        while (this->valveTimer.popExecuted(&step)) {
+            for (int i = 0; i < this->amount_valve; i++) {
+                if ((step.valveMask >> i) & 1) {
+                    eventElement event;
+                    event.value = (step.valveValues >> i) & 1;
+                    event.time  = step.time;
+                    this->valve_list[i]->eventSwitched(event, step.switchTime);
+                }
+            }
+        }
+    }
+#endif
+
     bool Main_ValveCtrl::loop() {
         //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
         if (kill_flag)
             return false;
 
+        //Vor dem Start gibt es nichts zu tun, start() weckt den Thread wieder auf
+        if (!this->ready) {
+            this->pause();
+            return true;
+        }
+
+#if VALVE_HARDWARE_TIMER
+        //Geschaltet wird im Timer-Interrupt, der Thread meldet nur und fuellt nach
+        this->reportValveTimer();
+        this->fillValveTimer();
+
+        //Alle Events geschaltet und gemeldet: der Thread pausiert bis zum naechsten Start (<restart>)
+        unsigned long nextStepTime;
+        if (!this->valveTimer.getNextStepTime(&nextStepTime)) {
+            if (this->valveTimer.isEmpty() && this->streaming) {
+                //Warteschlange leer, setEvent() bzw. setStreaming() wecken den Thread wieder
+                this->pause();
+                return true;
+            }
+            if (this->valveTimer.isEmpty()) {
+                this->valveTimer.stop();
+                srl->infoln("Alle Ventile abgearbeitet.");
+                srl->info("Maximale Weckverzoegerung: ");
+                srl->info(this->get_max_latency());
+                srl->infoln(" us");
+                this->ready = false;
+                this->pause();
+                return true;
+            }
+            //letzter Schritt ist geschaltet, aber noch nicht gemeldet
+            return true;
+        }
+
+        //Schlafe bis kurz nach dem naechsten Schritt, der Interrupt hat ihn dann bereits geschaltet
+        this->sleep_until_micro(cmn::wakeMicros(cmn::eventMicros(this->startTime, nextStepTime) + VALVE_TIMER_INTERVALL));
+
+        return true;
+#else
+        //Alle faelligen Ventile werden zusammen mit einer Uebertragung geschaltet, danach einzeln gemeldet
+        uint64_t now = cmn::micros64();
+        valveBits dueMask   = 0;
+        valveBits dueValues = 0;
+        for (int i = 0; i < this->amount_valve; i++) {
+            if (this->valve_continue_next_loop[i] && this->valve_list[i]->isDue(now)) {
+                dueMask |= (valveBits)1 << i;
+                if (this->valve_list[i]->getNextEvent().value)
+                    dueValues |= (valveBits)1 << i;
+            }
+        }
+        if (dueMask)
+            this->output->write(dueMask, dueValues);
+        bool flushed = this->output->flush();
+
         //Aufrufen der Valve.compute() Funktionen. Kann immer getan werden, hat erst Wirkung nach demsie mit Valve.start() aktiviert werden.
         for (int i = 0; i < this->amount_valve; i++) {
             if (this->valve_continue_next_loop[i]) {
-                this->valve_continue_next_loop[i] = this->valve_list[i]->compute();
+                this->valve_continue_next_loop[i] = this->valve_list[i]->compute(now);
 
                 if (!this->valve_continue_next_loop[i]) {
                     this->amount_of_finished_valves++;
-                    srl->print('D', "Eventliste von Ventil ");
-                    srl->print('D', i);
-                    srl->println('D', " abgearbeitet.");
+                    srl->trace("Eventliste von Ventil ");
+                    srl->trace(i);
+                    srl->traceln(" abgearbeitet.");
                 }
             }
         }
 
-        //Beenden des Threads, wenn alle Events abgearbeitet sind
-        if (this->amount_valve != -1 && this->amount_of_finished_valves >= this->amount_valve) {
-            srl->println('D', "Alle Ventile abgearbeitet.");
-            return false;
+        //Alle Events abgearbeitet: der Thread pausiert bis zum naechsten Start (<restart>)
+        if (this->amount_valve != -1 && this->amount_of_finished_valves >= this->amount_valve && flushed) {
+            srl->infoln("Alle Ventile abgearbeitet.");
+            srl->info("Maximale Weckverzoegerung: ");
+            srl->info(this->get_max_latency());
+            srl->infoln(" us");
+            this->ready = false;
+            this->pause();
+            return true;
+        }
+
+        //Schlafe bis zum naechsten faelligen Event (64 Bit, ohne Ueberlauf), hoechstens MTHREAD_MAX_WAIT
+        uint64_t nextEventTime = (uint64_t)-1;
+        for (int i = 0; i < this->amount_valve; i++) {
+            if (this->valve_continue_next_loop[i] && this->valve_list[i]->hasEvent()) {
+                uint64_t eventTime = this->valve_list[i]->getNextEventTime();
+                if (eventTime < nextEventTime)
+                    nextEventTime = eventTime;
+            }
         }
+        if (!flushed && now + VALVE_OUTPUT_RETRY < nextEventTime) //Ausgang wartet auf eine freie Transaktion
+            nextEventTime = now + VALVE_OUTPUT_RETRY;
+        this->sleep_until_micro(cmn::wakeMicros(nextEventTime));
 
         return true;
+#endif
     }
 }
@@ -7,7 +7,10 @@
 
 #include "config.h"
 #include "valveCtrl.h"
+#include "valveTimer.h"
+#include "valveOutput.h"
 #include "main_display.h"
+#include "ownlibs/arena.h"
 
 namespace control {
     // an die Ventile werden absolutwerte uerbtragen. Diese basieren auf der Zeit, die gespeichert
@@ -18,26 +21,66 @@ namespace control {
         Main_ValveCtrl();
         //Destructor
         ~Main_ValveCtrl();
-        //Funktion, die von LabCom aufgerufen wird. Sie erstellt Valve-Objekte
-        void createValve(int amount);
+        //Funktion, die von LabCom aufgerufen wird. Sie erstellt Valve-Objekte in der Arena
+        //Jedes Objekt erhaelt einen Eventspeicher mit 'eventBytes' Bytes. Gibt false zurueck,
+        //wenn 'amount' MAX_AMOUNT_VALVE uebersteigt oder die Arena voll ist
+        bool createValve(int amount, int eventBytes);
         //Wird von LabCom aufgerufen und bekommt ein Array mit allen Pins.
-        //Adressen werden weiter an alle Valve-Objekte gegeben
-        void setPins(char adresses[][SERIAL_READ_MAX_BLOCK_SIZE]);
+        //Adressen werden weiter an alle Valve-Objekte und den Ausgang gegeben
+        void setPins(char *pins[]);
+        //Schaltet die Ventile aus 'mask' auf 'values' (Bit = Ventil-ID) mit einer Uebertragung
+        //(Main_Timeline, Schalten aus dem Thread)
+        void writeValves(valveBits mask, valveBits values);
+        //Wiederholt Ausgaben, die nicht sofort uebertragen werden konnten (siehe ValveOutput::flush())
+        bool flushValves();
         //Stellwerte fuer die MFCs koennen als Pseudoevents gesetzt werden. Die Ereignisse
-        //werden in einer Queue gespeichert und bei gegebenen Zeitpunkt ausgefuehrt
-        void setEvent(int valveID, int value, unsigned long time);
+        //werden in einem Ringpuffer gespeichert und bei gegebenen Zeitpunkt ausgefuehrt
+        //Gibt false zurueck, wenn der Eventspeicher des Objektes voll ist. Waehrend der Messung
+        //(Streaming-Modus) wird der Thread geweckt, damit er das Event beruecksichtigt
+        bool setEvent(int valveID, int value, unsigned long time);
+        //Beginnt bzw. schliesst einen Wiederholungsblock in den Eventlisten aller Ventile, gibt
+        //false zurueck, wenn ein Eventspeicher voll ist
+        bool setRepeat(unsigned long count, unsigned long period);
+        bool endRepeat();
+        //Streaming-Modus (<stream>) fuer alle Valves, mit false (<end> waehrend der Messung) werden
+        //die Eventlisten beendet, sobald sie abgearbeitet sind
+        void setStreaming(bool streaming);
+        //Entnimmt vor dem Start die ersten Events aller Ventile und fuellt damit die Warteschlange des
+        //Timers (nach <end>, <stream> bzw. <restart>)
+        void arm();
         //setzt die 'ready'-Variable der Valves auf true. Außerdem wird der Nullpunkt der Steuerung gesetzt
-        void start(unsigned long startTime);
+        void start(uint64_t startTime);
+        //Merkt sich die vollstaendig uebertragenen Eventlisten (<end>) fuer rewind()
+        void markProgram();
+        //Haelt die Ansteuerung an und setzt die Eventlisten auf den Stand von markProgram()
+        //zurueck (<restart>), danach kann wieder gestartet werden
+        void rewind();
+        //Haelt die Ansteuerung an und zerstoert die Ventil-Objekte (<rearm>). Ihr Speicher in der
+        //Arena wird danach von LabCom freigegeben, der naechste Header erstellt sie neu
+        void reset();
         //Gebe Adresse des Displayobjektes an die einzelnen Ventile, um zu kommunizieren
         void setMainDisplayObjectPointer(io::Main_Display *main_display);
-        //Diese Funktion wird vom StringBuilder aufgerufen und sammelt die Daten der Ventile
-        //um sie in den Ausgabestring zu schreiben
-        //Die Funktion fragt die einzelnen Ventile nach ihren Werten ab
-        void getValveValueList(int *valveValueList[]);
+        //Anzahl der erstellten Ventile (-1 vor dem Header)
+        int getAmountValve();
+        //Gibt das Ventil-Objekt mit der gegebenen ID zurueck
+        control::ValveCtrl *getValve(int valveID);
     protected:
         //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool loop();
     private:
+#if VALVE_HARDWARE_TIMER
+        //Rechnet anstehende Events in Schaltschritte fuer den Hardware-Timer um, bis dessen
+        //Warteschlange voll ist. Events mit gleichem Zeitpunkt werden zu einem Schritt zusammengefasst
+        void fillValveTimer();
+        //Meldet die vom Timer ausgefuehrten Schritte an die einzelnen Ventile
+        void reportValveTimer();
+
+        control::ValveTimer valveTimer;
+        uint64_t startTime; //cmn::micros64()
+#endif
+        control::ValveOutput *output; //VALVE_OUTPUT
+        bool ready;
+        bool streaming;
         int amount_valve;
         control::ValveCtrl *valve_list[MAX_AMOUNT_VALVE]; //Hier werden die Adressen der Valve-Objekte gespeichert
         bool valve_continue_next_loop[MAX_AMOUNT_VALVE];
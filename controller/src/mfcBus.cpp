@@ -0,0 +1,320 @@
+#include "mfcBus.h"
+#include "mfcCtrl.h"
+
+namespace control {
+    MfcBus::MfcBus() {
+        this->amountDevices = 0;
+        this->inFlight      = 0;
+        this->sendRead      = 0;
+        this->sendWrite     = 0;
+        this->replyIndex    = 0;
+        this->timeouts      = 0;
+        this->failures      = 0;
+        this->pollPeriod    = 0; //0: keine Abfragen bis setPollIntervall()
+        this->pollCursor    = 0;
+
+        for (int i = 0; i < MAX_AMOUNT_MFC; i++)
+            this->flowFilters[i] = NULL;
+
+        this->uart = srl->getStream('U');
+    }
+    MfcBus::~MfcBus() {
+        //die Filter liegen in der Arena und werden nicht freigegeben
+    }
+
+    void MfcBus::addDevice(int mfcID, control::MfcCtrl *mfc) {
+        this->devices[mfcID]      = mfc;
+        this->states[mfcID]       = DEVICE_IDLE;
+        this->valueChanged[mfcID] = false;
+        this->retries[mfcID]      = 0;
+        this->devicePeriod[mfcID] = 0;
+        this->nextPoll[mfcID]     = millis();
+#if MFC_BUS_READBACK && MFC_FLOW_FILTER != FILTER_NONE
+        //jede Antwort ist ein Block aus einem Wert, ohne Platz in der Arena bleibt der Durchfluss ungefiltert
+        if (this->flowFilters[mfcID] == NULL) {
+            float *state = (float *)arena->allocate(SAMPLE_FILTER_STATE(1) * sizeof(float));
+            if (state != NULL)
+                this->flowFilters[mfcID] = arena->create<SampleFilter>(1, state);
+        }
+#endif
+        if (mfcID >= this->amountDevices)
+            this->amountDevices = mfcID + 1;
+    }
+
+    void MfcBus::removeDevices() {
+        //offene Befehle werden nicht mehr zugeordnet, spaete Antworten verwirft processReply()
+        for (int i = 0; i < this->amountDevices; i++) {
+            if (this->flowFilters[i] != NULL)
+                this->flowFilters[i]->~SampleFilter(); //liegt in der Arena
+            this->flowFilters[i] = NULL;
+        }
+        this->amountDevices = 0;
+        this->inFlight      = 0;
+        this->sendRead      = 0;
+        this->sendWrite     = 0;
+        this->replyIndex    = 0;
+        this->pollPeriod    = 0;
+        this->pollCursor    = 0;
+    }
+
+    void MfcBus::setPollIntervall(int intervall) {
+#if MFC_BUS_READBACK
+        //Benoetigte Zeit, um alle MFCs abzufragen, ohne mehr als MFC_BUS_MAX_LOAD Prozent zu belegen
+        unsigned long bytesPerMilli = SERIAL_UART_BAUDRATE / 10000; //10 Bit je Zeichen
+        unsigned long minPeriod = (this->amountDevices * MFC_BUS_READ_BYTES * 100UL) / (bytesPerMilli * MFC_BUS_MAX_LOAD) + 1;
+#if MFC_BUS_BROADCAST_READ
+        minPeriod = (this->amountDevices * MFC_BUS_READ_BYTES / 2 * 100UL) / (bytesPerMilli * MFC_BUS_MAX_LOAD) + 1; //nur ein Befehl fuer alle
+#endif
+        this->pollPeriod = intervall;
+        if (this->pollPeriod < minPeriod)
+            this->pollPeriod = minPeriod;
+
+        for (int i = 0; i < this->amountDevices; i++) {
+            this->devicePeriod[i] = this->pollPeriod;
+            if (this->flowFilters[i] != NULL)
+                this->flowFilters[i]->begin(MFC_FLOW_FILTER, MFC_FLOW_FILTER_LENGTH, MFC_FLOW_FILTER_CUTOFF, 1000.0f / this->pollPeriod);
+        }
+
+        srl->info("MfcBus: Abfrageintervall ");
+        srl->info(this->pollPeriod);
+        srl->infoln(" ms");
+        this->resume();
+#endif
+    }
+
+    void MfcBus::setMainDisplayObjectPointer(io::Main_Display *main_display) {
+        this->main_display = main_display;
+    }
+
+    void MfcBus::setValue(int mfcID, int value) {
+        this->values[mfcID] = value;
+
+        if (this->states[mfcID] == DEVICE_IDLE) {
+            this->retries[mfcID] = 0;
+            this->enqueue(mfcID);
+        } else if (this->states[mfcID] == DEVICE_IN_FLIGHT || this->states[mfcID] == DEVICE_READING) {
+            this->valueChanged[mfcID] = true; //wird nach der Antwort gesendet
+        } //DEVICE_QUEUED: der neue Wert wird beim Senden genommen
+
+        this->resume(); //Thread sendet den Befehl
+    }
+
+    unsigned long MfcBus::getTimeouts() {
+        return this->timeouts;
+    }
+
+    unsigned long MfcBus::getFailures() {
+        return this->failures;
+    }
+
+    unsigned long MfcBus::getPollPeriod() {
+        return this->pollPeriod;
+    }
+
+    void MfcBus::enqueue(int mfcID) {
+        this->states[mfcID] = DEVICE_QUEUED;
+        this->sendQueue[this->sendWrite % MAX_AMOUNT_MFC] = mfcID;
+        this->sendWrite++;
+    }
+
+    void MfcBus::receive() {
+        while (this->uart->available() > 0) {
+            char inChar = this->uart->read();
+
+            if (inChar == '\n') {
+                this->reply[this->replyIndex] = '\0';
+                this->processReply(this->reply);
+                this->replyIndex = 0;
+            } else if (inChar != '\r' && this->replyIndex < MFC_BUS_COMMAND_SIZE - 1) {
+                this->reply[this->replyIndex++] = inChar;
+            } //zu lange Antworten werden abgeschnitten und passen dann zu keiner Adresse
+        }
+    }
+
+    void MfcBus::processReply(char reply[]) {
+        char *separator = strchr(reply, ':');
+        if (separator == NULL)
+            return;
+        *separator = '\0';
+
+        for (int i = 0; i < this->amountDevices; i++) {
+            if (this->states[i] == DEVICE_READING && strcmp(this->devices[i]->getAdress(), reply) == 0) {
+                if (separator[1] == 'V') {
+                    int flow = atoi(separator + 2);
+                    if (this->flowFilters[i] != NULL) {
+                        float in = flow;
+                        float out;
+                        this->flowFilters[i]->process(&in, &out, 1);
+                        flow = lroundf(out);
+                    }
+                    currentState->setMfcFlow(i, flow);
+                    this->devicePeriod[i] = this->pollPeriod; //MFC antwortet wieder im normalen Takt
+                }
+                this->finish(i);
+                return;
+            }
+            if (this->states[i] == DEVICE_IN_FLIGHT && strcmp(this->devices[i]->getAdress(), reply) == 0) {
+                if (strcmp(separator + 1, "A") == 0) {
+                    this->retries[i] = 0;
+                    this->finish(i);
+                } else { //Fehler des MFCs, wie ein Timeout behandeln
+                    this->sentTime[i] = millis() - MFC_BUS_TIMEOUT;
+                }
+                return;
+            }
+        }
+        //Antwort ohne offenen Befehl (z.B. nach einem Timeout verspaetet), wird ignoriert
+    }
+
+    void MfcBus::finish(int mfcID) {
+        this->inFlight--;
+        this->states[mfcID] = DEVICE_IDLE;
+        if (this->valueChanged[mfcID]) {
+            this->valueChanged[mfcID] = false;
+            this->retries[mfcID] = 0;
+            this->enqueue(mfcID);
+        }
+    }
+
+    void MfcBus::checkTimeouts() {
+        unsigned long now = millis();
+        for (int i = 0; i < this->amountDevices; i++) {
+            if ((this->states[i] != DEVICE_IN_FLIGHT && this->states[i] != DEVICE_READING) || now - this->sentTime[i] < MFC_BUS_TIMEOUT)
+                continue;
+
+            this->timeouts++;
+            if (this->states[i] == DEVICE_READING) { //Abfragen werden nicht wiederholt, der MFC wird seltener abgefragt
+#if !MFC_BUS_BROADCAST_READ
+                this->devicePeriod[i] *= 2;
+                if (this->devicePeriod[i] > MFC_BUS_POLL_MAX_PERIOD)
+                    this->devicePeriod[i] = MFC_BUS_POLL_MAX_PERIOD;
+                this->nextPoll[i] = this->sentTime[i] + this->devicePeriod[i];
+#endif
+                this->finish(i);
+                continue;
+            }
+
+            if (this->retries[i] < MFC_BUS_RETRIES) {
+                this->retries[i]++;
+                this->inFlight--;
+                this->valueChanged[i] = false; //der neueste Wert wird ohnehin gesendet
+                this->enqueue(i);
+            } else {
+                this->failures++;
+                srl->error("ERROR - MFC ");
+                srl->error(i);
+                srl->errorln(" antwortet nicht");
+                this->main_display->throwError(ERR_MFC_NO_RESPONSE);
+                this->finish(i);
+            }
+        }
+    }
+
+    void MfcBus::transmit() {
+        while (this->sendRead != this->sendWrite && this->inFlight < MFC_BUS_MAX_IN_FLIGHT) {
+            int mfcID = this->sendQueue[this->sendRead % MAX_AMOUNT_MFC];
+
+            char command[MFC_BUS_COMMAND_SIZE];
+            const char *adress = this->devices[mfcID]->getAdress();
+            int adressLength = strlen(adress);
+            memcpy(command, adress, adressLength);
+            char *out = &command[adressLength];
+            *out++ = ':';
+            *out++ = 'S';
+            out = cmn::formatInt(out, this->values[mfcID], 0);
+            *out++ = '\r';
+            *out++ = '\n';
+
+            int length = out - command;
+            if (this->uart->availableForWrite() < length) //Rest im naechsten Durchlauf
+                return;
+            this->uart->write((const uint8_t *)command, length);
+
+            this->sendRead++;
+            this->states[mfcID]   = DEVICE_IN_FLIGHT;
+            this->sentTime[mfcID] = millis();
+            this->inFlight++;
+        }
+    }
+
+    bool MfcBus::sendCommand(const char adress[], char command) {
+        char buffer[MFC_BUS_COMMAND_SIZE];
+        int adressLength = strlen(adress);
+        memcpy(buffer, adress, adressLength);
+        char *out = &buffer[adressLength];
+        *out++ = ':';
+        *out++ = command;
+        *out++ = '\r';
+        *out++ = '\n';
+
+        int length = out - buffer;
+        if (this->uart->availableForWrite() < length)
+            return false;
+        this->uart->write((const uint8_t *)buffer, length);
+        return true;
+    }
+
+    void MfcBus::poll() {
+        if (this->pollPeriod == 0 || this->sendRead != this->sendWrite) //Soll-Werte zuerst
+            return;
+
+        unsigned long now = millis();
+#if MFC_BUS_BROADCAST_READ
+        //Ein Befehl fuer alle, sobald alle MFCs frei sind und die Abfrage faellig ist
+        if ((long)(now - this->nextPoll[0]) < 0 || this->inFlight > 0)
+            return;
+        if (!this->sendCommand("*", 'R'))
+            return;
+        for (int i = 0; i < this->amountDevices; i++) {
+            this->states[i]   = DEVICE_READING;
+            this->sentTime[i] = now;
+            this->nextPoll[i] = now + this->pollPeriod;
+            this->inFlight++;
+        }
+#else
+        for (int n = 0; n < this->amountDevices && this->inFlight < MFC_BUS_MAX_IN_FLIGHT; n++) {
+            int i = this->pollCursor;
+            if (this->states[i] == DEVICE_IDLE && (long)(now - this->nextPoll[i]) >= 0) {
+                if (!this->sendCommand(this->devices[i]->getAdress(), 'R')) //Rest im naechsten Durchlauf
+                    return;
+                this->states[i]   = DEVICE_READING;
+                this->sentTime[i] = now;
+                this->nextPoll[i] = now + this->devicePeriod[i];
+                this->inFlight++;
+            }
+            this->pollCursor = (this->pollCursor + 1) % this->amountDevices;
+        }
+#endif
+    }
+
+    bool MfcBus::loop() {
+        //Gebe false zurueck um den Thread zu beenden. True bedeutet, dass der Thread weiter läuft
+        if (kill_flag)
+            return false;
+
+        this->receive();
+        this->checkTimeouts();
+        this->transmit();
+        this->poll();
+
+        //Solange Befehle offen oder eingereiht sind, wird regelmaessig nach Antworten gesehen.
+        //Sonst bis zur naechsten Abfrage, ohne Abfragen weckt setValue() den Thread wieder auf
+        if (this->inFlight > 0 || this->sendRead != this->sendWrite) {
+            this->sleep_milli(MFC_BUS_POLL_INTERVALL);
+        } else if (this->pollPeriod > 0 && this->amountDevices > 0) {
+            unsigned long nextTime = this->nextPoll[0];
+            for (int i = 1; i < this->amountDevices; i++) {
+                if ((long)(this->nextPoll[i] - nextTime) < 0)
+                    nextTime = this->nextPoll[i];
+            }
+            if ((long)(nextTime - millis()) > 0)
+                this->sleep_until_milli(nextTime);
+            else //faellig, aber die Schnittstelle war voll
+                this->sleep_milli(MFC_BUS_POLL_INTERVALL);
+        } else {
+            this->pause();
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef MFCBUS_H
+#define MFCBUS_H
+
+#include <Arduino.h>
+#include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
+#include <mthread.h>
+
+#include "config.h"
+#include "main_display.h"
+#include "ownlibs/arena.h"
+#include "ownlibs/common.h"
+#include "ownlibs/sampleFilter.h"
+#include "ownlibs/serialCommunication.h"
+
+namespace control {
+    class MfcCtrl; //mfcCtrl.h bindet diese Datei ein
+
+    // Treiber fuer die MFCs am UART (Typ 'U'). MFCs reihen neue Soll-Werte mit setValue() ein,
+    // der Thread sendet sie ohne zu warten direkt hintereinander und ordnet die Antworten ueber
+    // die Adresse zu. Je MFC ist hoechstens ein Befehl offen, insgesamt MFC_BUS_MAX_IN_FLIGHT.
+    // Bleibt die Antwort aus, wird der Befehl nach MFC_BUS_TIMEOUT bis zu MFC_BUS_RETRIES mal
+    // wiederholt. Ein langsamer oder defekter MFC haelt so die anderen nicht auf.
+    // Befehl:  <Adresse>:S<Soll-Wert>\r\n
+    // Antwort: <Adresse>:A\r\n (angenommen), alles andere gilt als Fehler und wird wiederholt
+    // Mit MFC_BUS_READBACK wird zwischen den Soll-Werten der gemessene Durchfluss abgefragt:
+    // Befehl:  <Adresse>:R\r\n bzw. *:R\r\n an alle (MFC_BUS_BROADCAST_READ)
+    // Antwort: <Adresse>:V<Durchfluss>\r\n
+    // Soll-Werte haben Vorrang. Das Abfrageintervall folgt dem Messintervall, wird aber so weit
+    // verlaengert, dass die Abfragen hoechstens MFC_BUS_MAX_LOAD Prozent des UART belegen. Ein MFC,
+    // der nicht antwortet, wird bis MFC_BUS_POLL_MAX_PERIOD immer seltener abgefragt.
+    // Der gemessene Durchfluss kann je MFC gefiltert werden (MFC_FLOW_FILTER).
+    class MfcBus : public Thread {
+    public:
+        //Defaultconstructor
+        MfcBus();
+        //Destructor
+        ~MfcBus();
+        //Meldet einen MFC am Bus an, seine Adresse wird beim Senden abgefragt
+        void addDevice(int mfcID, control::MfcCtrl *mfc);
+        //Meldet alle MFCs ab (<rearm>), die Filter in der Arena werden danach mit ihr freigegeben
+        void removeDevices();
+        //Reiht einen neuen Soll-Wert ein, blockiert nicht. Ist fuer den MFC bereits ein Befehl
+        //eingereiht oder offen, wird nur der neueste Wert gesendet
+        void setValue(int mfcID, int value);
+        //Setzt das Messintervall, alle MFCs werden moeglichst einmal je Intervall abgefragt
+        void setPollIntervall(int intervall);
+        //Setze Displayobjekt, um ausgefallene MFCs anzuzeigen
+        void setMainDisplayObjectPointer(io::Main_Display *main_display);
+        //Statistik
+        unsigned long getTimeouts(); //Befehle ohne rechtzeitige Antwort (inkl. Wiederholungen)
+        unsigned long getFailures(); //Befehle, die auch nach allen Wiederholungen fehlschlugen
+        unsigned long getPollPeriod(); //ms, tatsaechliches Abfrageintervall nach der Lastbegrenzung
+    protected:
+        //Die Loop wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
+        bool loop();
+    private:
+        enum deviceStates {DEVICE_IDLE, DEVICE_QUEUED, DEVICE_IN_FLIGHT, DEVICE_READING};
+
+        //Haengt einen MFC an die Sendereihenfolge an
+        void enqueue(int mfcID);
+        //Liest die bereits empfangenen Zeichen und wertet vollstaendige Antworten aus
+        void receive();
+        //Verarbeitet eine Antwortzeile (ohne Zeilenende)
+        void processReply(char reply[]);
+        //Beendet einen offenen Befehl, bei Bedarf wird der neuere Wert nachgesendet
+        void finish(int mfcID);
+        //Wiederholt oder verwirft Befehle, deren Antwort ausbleibt
+        void checkTimeouts();
+        //Sendet eingereihte Befehle, solange die Schnittstelle sie ohne Warten annimmt
+        void transmit();
+        //Sendet faellige Abfragen, solange keine Soll-Werte warten
+        void poll();
+        //Sendet einen Befehl ohne Wert (<Adresse>:<Befehl>). Gibt false zurueck, wenn die
+        //Schnittstelle ihn nicht ohne Warten annimmt
+        bool sendCommand(const char adress[], char command);
+
+        control::MfcCtrl *devices[MAX_AMOUNT_MFC];
+        int amountDevices;
+        deviceStates states[MAX_AMOUNT_MFC];
+        int values[MAX_AMOUNT_MFC];            //zu sendender (neuester) Soll-Wert
+        bool valueChanged[MAX_AMOUNT_MFC];     //neuer Wert, waehrend ein Befehl offen ist
+        unsigned long sentTime[MAX_AMOUNT_MFC];
+        int retries[MAX_AMOUNT_MFC];
+        int inFlight;
+
+        //Abfrage des Durchflusses
+        unsigned long pollPeriod;                //ms, fuer alle MFCs
+        unsigned long devicePeriod[MAX_AMOUNT_MFC]; //ms, verlaengert, wenn ein MFC nicht antwortet
+        unsigned long nextPoll[MAX_AMOUNT_MFC];
+        int pollCursor;                          //reihum, damit jeder MFC drankommt
+        SampleFilter *flowFilters[MAX_AMOUNT_MFC]; //MFC_FLOW_FILTER, NULL ohne Filter
+
+        //Sendereihenfolge, jeder MFC steht hoechstens einmal darin. Indizes laufen frei
+        uint8_t sendQueue[MAX_AMOUNT_MFC];
+        unsigned int sendRead;
+        unsigned int sendWrite;
+
+        char reply[MFC_BUS_COMMAND_SIZE];
+        int replyIndex;
+
+        unsigned long timeouts;
+        unsigned long failures;
+
+        Stream *uart;
+        io::Main_Display *main_display;
+    };
+}
+
+#endif
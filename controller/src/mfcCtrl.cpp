@@ -1,63 +1,138 @@
 #include "mfcCtrl.h"
 
 namespace control {
-    MfcCtrl::MfcCtrl(int id) {
+    MfcCtrl::MfcCtrl(int id, uint8_t eventMemory[], int eventBytes) {
         this->id = id;
 
+        //Eventspeicher wird einmalig uebergeben, danach wird nicht mehr allokiert
+        this->eventList.init(eventMemory, eventBytes, EVENT_VALUE_BITS_MFC);
+
         //setze defaultwerte für das "nextEvent"
-        this->nextEvent.value = -1;
-        this->nextEvent.time  = -1;
+        this->nextEvent.value    = -1;
+        this->nextEvent.time     = 0;
+        this->nextEvent.rampStep = 0;
 
+        this->ramping = false;
+        this->hasNext = false;
         this->ready = false;
+        this->streaming = false;
 
         this->currentValue = 0;
 
-        srl->print('D', "MFC ");
-        srl->print('D', this->id);
-        srl->println('D', " erstellt.");
+        srl->info("MFC ");
+        srl->info(this->id);
+        srl->infoln(" erstellt.");
     }
     MfcCtrl::~MfcCtrl() {
-        srl->print('D', "MFC ");
-        srl->print('D', this->id);
-        srl->println('D', " geloescht.");
+        srl->info("MFC ");
+        srl->info(this->id);
+        srl->infoln(" geloescht.");
     }
 
     void MfcCtrl::setType(char type[]) {
         strcpy(this->type, type);
 
-        srl->print('D', "MFC ");
-        srl->print('D', this->id);
-        srl->print('D', " Typ: ");
-        srl->println('D', this->type);
+        srl->info("MFC ");
+        srl->info(this->id);
+        srl->info(" Typ: ");
+        srl->infoln(this->type);
+    }
+
+    const char *MfcCtrl::getType() {
+        return this->type;
     }
 
     void MfcCtrl::setAdress(char adress[]) {
         strcpy(this->adress, adress);
 
-        srl->print('D', "MFC ");
-        srl->print('D', this->id);
-        srl->print('D', " Adresse: ");
-        srl->println('D', this->adress);
+        srl->info("MFC ");
+        srl->info(this->id);
+        srl->info(" Adresse: ");
+        srl->infoln(this->adress);
+    }
+
+    const char *MfcCtrl::getAdress() {
+        return this->adress;
+    }
+
+    void MfcCtrl::setMfcBusObjectPointer(control::MfcBus *mfcBus) {
+        this->mfcBus = mfcBus;
     }
 
-    void MfcCtrl::setEvent(int value, unsigned long time) {
+    bool MfcCtrl::setEvent(int value, unsigned long time) {
         eventElement newEvent; //Erstelle neue Datenstruktur
-        newEvent.value = value;
-        newEvent.time  = time;
+        newEvent.value    = value;
+        newEvent.time     = time;
+        newEvent.rampStep = 0;
 
-        srl->print('D', "MFC ");
-        srl->print('D', this->id);
-        srl->print('D', " Neues Event: ");
-        srl->print('D', newEvent.value);
-        srl->print('D', ", ");
-        srl->println('D', newEvent.time);
+        srl->trace("MFC ");
+        srl->trace(this->id);
+        srl->trace(" Neues Event: ");
+        srl->trace(newEvent.value);
+        srl->trace(", ");
+        srl->traceln(newEvent.time);
 
-        this->eventList.push(newEvent); //Speichere Datenstruktur in einer Liste
+        return this->eventList.push(newEvent); //Speichere Datenstruktur im Ringpuffer
     }
 
-    void MfcCtrl::start(unsigned long startTime) {
+    bool MfcCtrl::setRamp(int startValue, int endValue, unsigned long time, unsigned long duration, unsigned int step) {
+        //Ohne Dauer ist die Rampe ein Sprung auf den Zielwert
+        if (duration == 0)
+            return this->setEvent(endValue, time);
+        unsigned int minStep = MFC_RAMP_MIN_STEP * 1000UL / EVENT_TIME_UNIT; //MFC_RAMP_MIN_STEP ist in ms
+        if (step < minStep)
+            step = minStep;
+        if (step > duration)
+            step = duration;
+        if (step > 0xFFFF) //Schrittweite wird mit 16 Bit gespeichert
+            step = 0xFFFF;
+
+        eventElement newEvent;
+        newEvent.value        = startValue;
+        newEvent.time         = time;
+        newEvent.rampValue    = endValue;
+        newEvent.rampDuration = duration;
+        newEvent.rampStep     = step;
+
+        srl->trace("MFC ");
+        srl->trace(this->id);
+        srl->trace(" Neue Rampe: ");
+        srl->trace(startValue);
+        srl->trace(" -> ");
+        srl->trace(endValue);
+        srl->trace(", ");
+        srl->trace(time);
+        srl->trace(" + ");
+        srl->trace(duration);
+        srl->trace(" ms, Schritt ");
+        srl->traceln(step);
+
+        return this->eventList.push(newEvent);
+    }
+
+    bool MfcCtrl::setRepeat(unsigned long count, unsigned long period) {
+        return this->eventList.pushRepeat(count, period);
+    }
+
+    bool MfcCtrl::endRepeat() {
+        return this->eventList.pushEndRepeat();
+    }
+
+    void MfcCtrl::start(uint64_t startTime) {
         this->startTime = startTime;
         this->ready = true;
+        this->latency.reset();
+    }
+
+    void MfcCtrl::markProgram() {
+        this->program = this->eventList;
+    }
+
+    void MfcCtrl::rewind() {
+        this->eventList = this->program;
+        this->ready   = false;
+        this->hasNext = false;
+        this->ramping = false;
     }
 
     void MfcCtrl::setMainDisplayObjectPointer(io::Main_Display *main_display) {
@@ -68,41 +143,121 @@ namespace control {
         return this->currentValue;
     }
 
+    uint64_t MfcCtrl::getNextEventTime() {
+        return cmn::eventMicros(this->startTime, this->nextEvent.time);
+    }
+
+    eventElement MfcCtrl::getNextEvent() {
+        return this->nextEvent;
+    }
+
+    bool MfcCtrl::hasEvent() {
+        return this->hasNext;
+    }
+
+    void MfcCtrl::setStreaming(bool streaming) {
+        this->streaming = streaming;
+    }
+
+    unsigned long MfcCtrl::getTakenEvents() {
+        return this->eventList.getPopped();
+    }
+
+    int MfcCtrl::getEventBytes() {
+        return this->eventList.getUsed();
+    }
+
+    int MfcCtrl::getFreeEventBytes() {
+        return this->eventList.getCapacity() - this->eventList.getUsed();
+    }
+
+    bool MfcCtrl::loadFirstEvent() {
+        if (!this->hasNext) { //lade erstes Event in nextEvent
+            if (eventList.isEmpty())
+                return false;
+            nextEvent = eventList.pop();
+            this->hasNext = true;
+        }
+        return true;
+    }
+
+    bool MfcCtrl::fireNextEvent() {
+        //Befehl wird nur eingereiht, der Bustreiber sendet ihn ohne diesen Thread aufzuhalten
+        this->mfcBus->setValue(this->id, this->nextEvent.value);
+
+        uint64_t currentTime = cmn::micros64();
+        uint64_t eventTime   = cmn::eventMicros(this->startTime, this->nextEvent.time);
+        long latency = (long)(currentTime - eventTime); //Verzoegerung in us
+        this->latency.record(latency);
+        eventLatency->record(latency);
+
+        srl->trace("MFC\t");
+        srl->trace(this->id);
+        srl->trace(" gesetzt auf: ");
+        srl->trace(this->nextEvent.value);
+        srl->trace("\t\tSchaltzeit:\t");
+        srl->trace((unsigned long)(currentTime / 1000));
+        srl->trace("\terwartet:\t");
+        srl->trace((unsigned long)(eventTime / 1000));
+        srl->trace("\t( Rel.Zeit: ");
+        srl->trace(this->nextEvent.time);
+        srl->trace(" )\t( ");
+        srl->trace(latency);
+        srl->traceln("\tus Verzoegerung )");
+
+        this->main_display->setLastEvent('M', this->id, this->nextEvent.value, this->nextEvent.time);
+        this->currentValue = this->nextEvent.value;
+        currentState->setMfcValue(this->id, this->currentValue);
+
+        //Eine Rampe erzeugt ihre Zwischenwerte, ohne den Eventspeicher zu belegen
+        if (this->nextEvent.rampStep > 0) {
+            this->ramp = this->nextEvent;
+            this->ramping = true;
+        }
+        if (this->ramping && this->nextRampStep())
+            return true;
+
+        if (eventList.isEmpty()) { //alle Events abgearbeitet, im Streaming-Modus laedt loadFirstEvent() die naechsten
+            this->hasNext = false;
+            return this->streaming;
+        }
+        nextEvent = eventList.pop();
+        return true;
+    }
+
+    bool MfcCtrl::nextRampStep() {
+        unsigned long stepTime = this->nextEvent.time + this->ramp.rampStep;
+        unsigned long endTime  = this->ramp.time + this->ramp.rampDuration;
+        if ((long)(this->nextEvent.time - endTime) >= 0
+                || (!this->eventList.isEmpty() && (long)(this->eventList.peek().time - stepTime) <= 0)) {
+            this->ramping = false;
+            return false;
+        }
+
+        if ((long)(stepTime - endTime) >= 0) { //letzter Schritt trifft den Zielwert genau
+            stepTime = endTime;
+            this->nextEvent.value = this->ramp.rampValue;
+        } else {
+            long long change = (long long)(this->ramp.rampValue - this->ramp.value) * (stepTime - this->ramp.time);
+            this->nextEvent.value = this->ramp.value + (int)(change / (long long)this->ramp.rampDuration);
+        }
+        this->nextEvent.time     = stepTime;
+        this->nextEvent.rampStep = 0;
+        return true;
+    }
+
+    LatencyStats *MfcCtrl::getLatency() {
+        return &this->latency;
+    }
+
     //HAUPTSCHLEIFE
     bool MfcCtrl::compute() {
         if (this->ready) {
-            if (this->nextEvent.time == -1) { //lade erstes Event in nextEvent
-                if (eventList.isEmpty()) //beende den thread, wenn alle Events abgearbeitet sind
-                    return false;
-                nextEvent = eventList.pop();
-            }
-
-            if (millis() >= this->startTime + this->nextEvent.time) {
-                //TODO: set MFC to this->nextEvent->value
-
-                unsigned long currentTime = millis();
-
-                srl->print('D', "MFC\t");
-                srl->print('D', this->id);
-                srl->print('D', " gesetzt auf: ");
-                srl->print('D', this->nextEvent.value);
-                srl->print('D', "\t\tSchaltzeit:\t");
-                srl->print('D', currentTime);
-                srl->print('D', "\terwartet:\t");
-                srl->print('D', this->startTime + this->nextEvent.time);
-                srl->print('D', "\t( Rel.Zeit: ");
-                srl->print('D', this->nextEvent.time);
-                srl->print('D', " )\t( ");
-                srl->print('D', currentTime - (this->startTime + this->nextEvent.time));
-                srl->println('D', "\tms Verzoegerung )");
-
-                this->main_display->setLastEvent('M', this->id, this->nextEvent.value, this->nextEvent.time);
-                this->currentValue = this->nextEvent.value;
-
-                if (eventList.isEmpty()) //beende den thread, wenn alle Events abgearbeitet sind
-                    return false;
-                nextEvent = eventList.pop();
-            }
+            if (!this->loadFirstEvent()) //beende den thread, wenn alle Events abgearbeitet sind
+                return this->streaming;  //im Streaming-Modus wird auf weitere Events gewartet
+
+            if (cmn::micros64() >= cmn::eventMicros(this->startTime, this->nextEvent.time))
+                return this->fireNextEvent();
         }
         return true;
     }
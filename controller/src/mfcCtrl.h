@@ -4,11 +4,15 @@
 #include <Arduino.h>
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
-#include <QueueList.h>
 
 #include "ownlibs/serialCommunication.h"
+#include "ownlibs/common.h"
 #include "eventElement.h"
+#include "eventBuffer.h"
 #include "main_display.h"
+#include "stateSnapshot.h"
+#include "ownlibs/latencyStats.h"
+#include "mfcBus.h"
 
 namespace control {
     // Dies ist die Klasse fuer die MFCs. Jeder MFC bekommt seine eigene Instanz
@@ -17,37 +21,94 @@ namespace control {
     // auch wieder geloescht.
     class MfcCtrl {
     public:
-        //Defaultconstructor
-        MfcCtrl(int id);
+        //Defaultconstructor, 'eventBytes' Bytes ab 'eventMemory' sind der Eventspeicher
+        MfcCtrl(int id, uint8_t eventMemory[], int eventBytes);
         //Destructor
         ~MfcCtrl();
         //Es gibt zwei verschiedene Typen von MFCs, der Typ muss vorher gesetzt werden
         void setType(char type[]);
+        //Gibt den Typ des MFCs zurueck
+        const char *getType();
         //Jeder MFC hat seine eigene Adresse, die gesetzt werden muss
         void setAdress(char adress[]);
+        //Gibt die Adresse des MFCs am Bus zurueck
+        const char *getAdress();
+        //Gebe Adresse des Bustreibers an diesen MFC, ueber ihn werden die Soll-Werte gesendet
+        void setMfcBusObjectPointer(control::MfcBus *mfcBus);
         //Stellwerte fuer die MFCs koennen als Pseudoevents gesetzt werden. Die Ereignisse
-        //werden in einer Queue gespeichert und bei gegebenen Zeitpunkt ausgefuehrt
-        void setEvent(int value, unsigned long time);
+        //werden in einem Ringpuffer gespeichert und bei gegebenen Zeitpunkt ausgefuehrt.
+        //Gibt false zurueck, wenn der Eventspeicher voll ist
+        bool setEvent(int value, unsigned long time);
+        //Rampe als ein Event: ab 'time' alle 'step' ms ein Zwischenwert, linear von 'startValue'
+        //bis 'endValue' nach 'duration' ms. Die Zwischenwerte entstehen erst beim Ausfuehren,
+        //ein frueheres Event der Liste beendet die Rampe. Gibt false zurueck, wenn der Eventspeicher voll ist
+        bool setRamp(int startValue, int endValue, unsigned long time, unsigned long duration, unsigned int step);
+        //Beginnt bzw. schliesst einen Wiederholungsblock (siehe EventBuffer::pushRepeat()),
+        //gibt false zurueck, wenn der Eventspeicher voll ist
+        bool setRepeat(unsigned long count, unsigned long period);
+        bool endRepeat();
         //sobald diese Funktion ausgefuehrt wird, beginnt das Programm mit der Ansteuerung
-        void start(unsigned long startTime);
+        //(startTime in cmn::micros64())
+        void start(uint64_t startTime);
+        //Merkt sich die vollstaendig uebertragene Eventliste (<end>), bevor das erste Event
+        //entnommen wird
+        void markProgram();
+        //Haelt die Ansteuerung an und setzt die Eventliste auf den Stand von markProgram()
+        //zurueck, danach kann wieder gestartet werden
+        void rewind();
         //Gebe Adresse des Displayobjektes an diesen MFC, um zu kommunizieren
         void setMainDisplayObjectPointer(io::Main_Display *main_display);
         //Gibt den aktuellen Soll-Wert des MFCs zurueck
         int getCurrentValue();
+        //Gibt den Zeitpunkt (cmn::micros64()) des naechsten Events zurueck, gueltig sobald compute()
+        //einmal nach dem Start aufgerufen wurde
+        uint64_t getNextEventTime();
+        //Gibt das naechste anstehende Event zurueck (Zeit relativ zum Start)
+        eventElement getNextEvent();
+        //Gibt an, ob ein Event ansteht. Im Streaming-Modus kann der Eventspeicher zwischendurch
+        //leer sein, bis LabView weitere Events nachlaedt
+        bool hasEvent();
+        //Streaming-Modus (<stream>): ein leerer Eventspeicher beendet die Eventliste nicht, erst
+        //nach setStreaming(false) (<end> waehrend der Messung)
+        void setStreaming(bool streaming);
+        //Anzahl der bisher aus dem Eventspeicher entnommenen Events (siehe EventBuffer::getPopped())
+        unsigned long getTakenEvents();
+        //Belegte bzw. noch freie Bytes des Eventspeichers
+        int getEventBytes();
+        int getFreeEventBytes();
+        //Laedt das erste Event aus dem Eventspeicher, gibt false zurueck, wenn keine Events vorhanden sind
+        bool loadFirstEvent();
+        //Fuehrt das anstehende Event sofort aus und laedt das naechste (bzw. den naechsten
+        //Zwischenwert einer Rampe). Gibt false zurueck, wenn alle Events abgearbeitet sind
+        //(im Streaming-Modus nie)
+        bool fireNextEvent();
+        //Schaltverzoegerung der Events seit dem Start
+        LatencyStats *getLatency();
         //Die compute()-Function wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
         bool compute();
     private:
+        //Setzt nextEvent auf den naechsten Zwischenwert der laufenden Rampe. Gibt false zurueck,
+        //wenn sie abgeschlossen ist oder das naechste Event der Liste vorher faellig wird
+        bool nextRampStep();
+
         int id; //kontunierliche MFC-Id
         char type[16];
         char adress[16];
-        QueueList <eventElement> eventList;
+        EventBuffer eventList;
+        EventBuffer program; //Eventliste bei markProgram(), teilt den Speicher mit eventList
         bool ready;
-        unsigned long startTime;
+        bool streaming;
+        uint64_t startTime; //cmn::micros64()
         int currentValue;
 
         eventElement nextEvent;
+        bool hasNext; //nextEvent ist geladen und noch nicht ausgefuehrt
+        eventElement ramp; //laufende Rampe, solange ramping gesetzt ist
+        bool ramping;
+        LatencyStats latency;
 
         io::Main_Display *main_display;
+        control::MfcBus *mfcBus;
     };
 }
 
@@ -0,0 +1,79 @@
+#include "arena.h"
+#include "common.h"
+#include "sampleFilter.h"
+#include "../mfcCtrl.h"
+#include "../valveCtrl.h"
+
+//Bytes einer Anforderung einschliesslich des hoechsten Verschnitts durch die Ausrichtung
+#define ARENA_BLOCK(size) ((size) + ARENA_ALIGN - 1)
+//Die Eventspeicher aller Kanaele zusammen belegen hoechstens EVENT_STORE_BYTES, dazu je MFC
+//das Objekt und der Filter des Durchflusses, je Ventil das Objekt
+#define ARENA_BYTES (EVENT_STORE_BYTES \
+    + MAX_AMOUNT_MFC * (ARENA_BLOCK(sizeof(control::MfcCtrl)) + ARENA_BLOCK(0) \
+        + ARENA_BLOCK(sizeof(SampleFilter)) + ARENA_BLOCK(SAMPLE_FILTER_STATE(1) * sizeof(float))) \
+    + MAX_AMOUNT_VALVE * (ARENA_BLOCK(sizeof(control::ValveCtrl)) + ARENA_BLOCK(0)))
+
+Arena::Arena(uint8_t memory[], size_t capacity) {
+    this->memory   = memory;
+    this->capacity = capacity;
+    this->used     = 0;
+    this->peak     = 0;
+    this->failed   = 0;
+}
+Arena::~Arena() {
+
+}
+
+void *Arena::allocate(size_t size) {
+    //die Adresse wird ausgerichtet, 'memory' selbst muss es nicht sein
+    size_t start = this->used + (-(uintptr_t)(this->memory + this->used) & (ARENA_ALIGN - 1));
+    if (start + size > this->capacity) {
+        this->failed++;
+        return NULL;
+    }
+
+    this->used = start + size;
+    if (this->used > this->peak)
+        this->peak = this->used;
+    return this->memory + start;
+}
+
+void Arena::reset() {
+    this->used = 0;
+}
+
+size_t Arena::getCapacity() const {
+    return this->capacity;
+}
+
+size_t Arena::getUsed() const {
+    return this->used;
+}
+
+size_t Arena::getFree() const {
+    return this->capacity - this->used;
+}
+
+size_t Arena::getPeak() const {
+    return this->peak;
+}
+
+unsigned long Arena::getFailed() const {
+    return this->failed;
+}
+
+char *Arena::format(char out[]) const {
+    memcpy(out, "memory,", 7);
+    out = cmn::formatInt(&out[7], this->used, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->getFree(), 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->peak, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->failed, 0);
+    *out++ = '\n';
+    return out;
+}
+
+static uint8_t arenaMemory[ARENA_BYTES] __attribute__((aligned(ARENA_ALIGN)));
+Arena *arena = new Arena(arenaMemory, sizeof(arenaMemory));
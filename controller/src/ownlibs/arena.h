@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+#include <new> //new mit Speicheradresse
+#include "../config.h"
+
+// Statischer Speicher fuer die Objekte, die beim Header angelegt werden (MFCs, Ventile, ihre
+// Eventspeicher und Filter). Die Groesse steht beim Uebersetzen fest (ARENA_BYTES), es wird
+// nur hinten angehaengt und nichts einzeln freigegeben, nur alles auf einmal (<rearm>). So kann
+// der Heap waehrend einer Messung nicht zerstueckeln, und ob ein Programm passt, steht vor dem
+// Start fest.
+class Arena {
+public:
+    //Verwaltet 'capacity' Bytes ab 'memory'
+    Arena(uint8_t memory[], size_t capacity);
+    //Destructor
+    ~Arena();
+    //Reserviert 'size' Bytes (auf ARENA_ALIGN ausgerichtet), gibt NULL zurueck, wenn sie
+    //nicht mehr passen
+    void *allocate(size_t size);
+    //Legt ein Objekt im Speicher an, gibt NULL zurueck, wenn es nicht mehr passt. Das Objekt
+    //wird nie mit delete geloescht
+    template <class T, class... Args>
+    T *create(Args... args) {
+        void *memory = this->allocate(sizeof(T));
+        return memory == NULL ? NULL : new (memory) T(args...);
+    }
+    //Gibt den ganzen Speicher frei, die Objekte darin muessen vorher zerstoert sein. Der
+    //Hoechststand bleibt erhalten
+    void reset();
+    size_t getCapacity() const;
+    //Belegte und freie Bytes
+    size_t getUsed() const;
+    size_t getFree() const;
+    //Hoechststand der belegten Bytes
+    size_t getPeak() const;
+    //Anzahl der Anforderungen, die nicht mehr gepasst haben
+    unsigned long getFailed() const;
+    //Schreibt "memory,Belegt,Frei,Hoechststand,Fehlschlaege" mit '\n' nach out (hoechstens
+    //ARENA_LINE_SIZE Zeichen, ohne '\0'), gibt einen Zeiger dahinter zurueck
+    char *format(char out[]) const;
+private:
+    uint8_t *memory;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+    unsigned long failed;
+};
+
+//Speicher fuer alle Controller-Objekte
+extern Arena *arena;
+
+#endif
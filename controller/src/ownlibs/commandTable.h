@@ -0,0 +1,101 @@
+#ifndef COMMANDTABLE_H
+#define COMMANDTABLE_H
+
+#include "Arduino.h"
+#include <ctype.h>
+
+//Anzahl der Startwerte, die buildCommandSlots() fuer eine kollisionsfreie Verteilung probiert
+#define COMMAND_HASH_SEEDS 64
+
+// Befehlstabelle fuer Textzeilen (<Befehl,Argument,...>). Die Befehle stehen in einer konstanten
+// Liste, beim Uebersetzen wird daraus eine Hashtabelle ohne Kollisionen gebaut (perfekter Hash):
+// der Startwert wird so gewaehlt, dass jeder Befehl einen eigenen Platz hat. Das Nachschlagen
+// kostet einen Hash ueber den Befehl und einen Vergleich, unabhaengig von der Anzahl der Befehle.
+// Jeder Eintrag beschreibt seine Argumente (Anzahl der Eintraege, Zahlen), geprueft wird vor dem
+// Aufruf des Handlers mit checkCommandFields().
+
+//Ein Befehl der Tabelle. 'states' ist eine Bitmaske der Zustaende, in denen er gilt (vom
+//Besitzer der Tabelle festgelegt), die Anzahl der Eintraege zaehlt den Befehl selbst mit. Ohne
+//Befehl (Zeile aus Zahlen) beschreibt ein Eintrag mit Bit 0 in 'numericFields' auch den ersten Eintrag
+template<typename Handler>
+struct CommandEntry {
+    const char *name;
+    uint16_t states;
+    uint8_t minFields;
+    uint8_t maxFields;
+    uint8_t numericFields; //Bit i: Eintrag i ist eine Ganzzahl (dezimal, 0x hexadezimal), optionale duerfen leer sein
+    Handler handler;
+};
+
+//Plaetze der Hashtabelle: Index in der Befehlsliste, -1 ist frei
+template<int SLOTS>
+struct CommandSlots {
+    uint32_t seed; //COMMAND_HASH_SEEDS: keine kollisionsfreie Verteilung gefunden
+    int8_t index[SLOTS];
+};
+
+//FNV-1a ueber den Befehl, beginnend mit 'seed'
+constexpr uint32_t commandHash(const char name[], uint32_t seed) {
+    uint32_t hash = 2166136261UL ^ (seed * 16777619UL);
+    for (int i = 0; name[i] != '\0'; i++)
+        hash = (hash ^ (uint8_t)name[i]) * 16777619UL;
+    return hash;
+}
+
+//Verteilt die Befehle auf SLOTS Plaetze. Wird als constexpr ausgewertet, mit static_assert auf
+//'seed' pruefen, dass die Verteilung kollisionsfrei ist
+template<int SLOTS, typename Entry, int COMMANDS>
+constexpr CommandSlots<SLOTS> buildCommandSlots(const Entry (&commands)[COMMANDS]) {
+    CommandSlots<SLOTS> slots = {};
+    for (uint32_t seed = 0; seed < COMMAND_HASH_SEEDS; seed++) {
+        slots.seed = seed;
+        for (int s = 0; s < SLOTS; s++)
+            slots.index[s] = -1;
+
+        bool perfect = true;
+        for (int i = 0; i < COMMANDS && perfect; i++) {
+            int s = commandHash(commands[i].name, seed) % SLOTS;
+            perfect = slots.index[s] < 0;
+            slots.index[s] = i;
+        }
+        if (perfect)
+            return slots;
+    }
+    slots.seed = COMMAND_HASH_SEEDS;
+    return slots;
+}
+
+//Sucht 'name' in der Tabelle, gibt NULL zurueck, wenn es kein Befehl ist
+template<int SLOTS, typename Entry, int COMMANDS>
+const Entry *findCommand(const Entry (&commands)[COMMANDS], const CommandSlots<SLOTS> &slots, const char name[]) {
+    int index = slots.index[commandHash(name, slots.seed) % SLOTS];
+    if (index < 0 || strcmp(commands[index].name, name) != 0)
+        return NULL;
+    return &commands[index];
+}
+
+//Prueft die zerlegte Zeile gegen die Beschreibung der Argumente des Befehls
+template<typename Entry>
+bool checkCommandFields(const Entry *command, char *fields[], int fieldAmount) {
+    if (fieldAmount < command->minFields || fieldAmount > command->maxFields)
+        return false;
+    for (int i = 0; i < fieldAmount; i++) {
+        if (!((command->numericFields >> i) & 1) || (fields[i][0] == '\0' && i >= command->minFields))
+            continue;
+        const char *c = fields[i];
+        if (*c == '-' || *c == '+')
+            c++;
+        bool hex = c[0] == '0' && (c[1] == 'x' || c[1] == 'X');
+        if (hex)
+            c += 2;
+        if (*c == '\0')
+            return false;
+        for (; *c != '\0'; c++) {
+            if (!(hex ? isxdigit(*c) : isdigit(*c)))
+                return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -1,6 +1,38 @@
 #include "common.h"
 
+#include <newdel.h>
+#include <mthread.h> //MTHREAD_MAX_WAIT
+#if SYNC_MODE == SYNC_MODE_SLAVE
+#include "syncPulse.h"
+#endif
+
 namespace cmn {
+    uint64_t micros64() {
+        static uint32_t lastMicros = 0;
+        static uint32_t overflows  = 0;
+
+        uint32_t now = micros();
+        if (now < lastMicros)
+            overflows++;
+        lastMicros = now;
+        return ((uint64_t)overflows << 32) | now;
+    }
+
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    int64_t syncOffset(uint64_t elapsed) {
+        return syncPulse->getOffset(elapsed);
+    }
+#endif
+
+    unsigned long wakeMicros(uint64_t time) {
+        uint64_t now = micros64();
+        if (time <= now)
+            return (unsigned long)now;
+        if (time - now > MTHREAD_MAX_WAIT)
+            return (unsigned long)(now + MTHREAD_MAX_WAIT);
+        return (unsigned long)time;
+    }
+
     void trim (char string[]) {
         char buffer[256];
 
@@ -33,8 +65,87 @@ namespace cmn {
 
         int seconds = time / 1000;
 
-        char timeString_temp[12];
-        sprintf(timeString_temp, "%02d:%02d:%02d:%02d\0", days, hours, minutes, seconds);
-        strcpy(timeString_out, timeString_temp);
+        //ohne sprintf, wird vom Display jede Sekunde aufgerufen
+        char *out = formatZeroPadded(timeString_out, days, 2);
+        *out++ = ':';
+        out = formatZeroPadded(out, hours, 2);
+        *out++ = ':';
+        out = formatZeroPadded(out, minutes, 2);
+        *out++ = ':';
+        out = formatZeroPadded(out, seconds, 2);
+        *out = '\0';
+    }
+
+    uint16_t crc16(uint16_t crc, uint8_t data) {
+        crc ^= (uint16_t)data << 8;
+        for (int i = 0; i < 8; i++) {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ 0x1021;
+            else
+                crc = crc << 1;
+        }
+        return crc;
+    }
+
+    int finishFrame(char frame[], uint8_t type, int payloadLength) {
+        frame[0] = SERIAL_BINARY_SYNC;
+        frame[1] = type;
+        frame[2] = payloadLength;
+        frame[3] = payloadLength >> 8;
+
+        uint16_t crc = 0xFFFF;
+        for (int i = 1; i < 4 + payloadLength; i++) //Sync zaehlt nicht zur CRC
+            crc = crc16(crc, frame[i]);
+        putLittleEndian(&frame[4 + payloadLength], crc, 2);
+        return 4 + payloadLength + 2;
+    }
+
+    char *putLittleEndian(char out[], uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            *out++ = value;
+            value >>= 8;
+        }
+        return out;
+    }
+
+    char *formatInt(char out[], long value, int width) {
+        //Ziffern rueckwaerts in einen Zwischenspeicher, ohne sprintf. Platz fuer jede Breite von long
+        //(auf dem PC 64 Bit) samt Vorzeichen
+        char digits[3 * sizeof(long) + 1];
+        int amount = 0;
+        unsigned long rest = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+        do {
+            digits[amount++] = '0' + rest % 10;
+            rest /= 10;
+        } while (rest > 0);
+        if (value < 0)
+            digits[amount++] = '-';
+
+        for (int i = amount; i < width; i++)
+            *out++ = ' ';
+        while (amount > 0)
+            *out++ = digits[--amount];
+        return out;
+    }
+
+    char *formatZeroPadded(char out[], long value, int width) {
+        char digits[3 * sizeof(long) + 1];
+        int amount = 0;
+        unsigned long rest = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+        do {
+            digits[amount++] = '0' + rest % 10;
+            rest /= 10;
+        } while (rest > 0);
+
+        //Vorzeichen zaehlt zur Breite, wie bei %0*ld
+        if (value < 0) {
+            *out++ = '-';
+            width--;
+        }
+        for (int i = amount; i < width; i++)
+            *out++ = '0';
+        while (amount > 0)
+            *out++ = digits[--amount];
+        return out;
     }
 };
@@ -2,12 +2,53 @@
 #define COMMON_H
 
 #include "Arduino.h"
+#include "../config.h"
+
+//Verhindert, dass der Compiler Speicherzugriffe ueber diese Stelle hinweg verschiebt.
+//Der Cortex-M4 hat nur einen Kern, eine Hardware-Barriere ist nicht noetig
+#define COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
 
 namespace cmn {
+    //Fortlaufende Zeit in us seit dem Booten, ohne Ueberlauf. Erweitert micros() um die Anzahl
+    //seiner Ueberlaeufe und muss daher mindestens alle 71 Minuten aufgerufen werden (die Threads
+    //tun das mit MTHREAD_MAX_WAIT). Nicht im Interrupt aufrufen
+    uint64_t micros64();
+    //Weckzeit fuer Thread::sleep_until_micro(): 'time' (micros64()) als micros(), hoechstens
+    //MTHREAD_MAX_WAIT in der Zukunft, damit der Vergleich ueber die Differenz gueltig bleibt
+    unsigned long wakeMicros(uint64_t time);
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    //Abweichung der eigenen Uhr von der des Masters 'elapsed' us nach dem Nullpunkt (ownlibs/syncPulse.h)
+    int64_t syncOffset(uint64_t elapsed);
+#endif
+    //Zeitpunkt (micros64()) 'elapsed' us Programmzeit nach 'startTime', beim Slave auf die Uhr des Masters nachgefuehrt
+    inline uint64_t programMicros(uint64_t startTime, uint64_t elapsed) {
+#if SYNC_MODE == SYNC_MODE_SLAVE
+        return startTime + elapsed + syncOffset(elapsed);
+#else
+        return startTime + elapsed;
+#endif
+    }
+    //Zeitpunkt (micros64()) eines Events mit der Zeit 'time' (EVENT_TIME_UNIT) nach 'startTime'
+    inline uint64_t eventMicros(uint64_t startTime, unsigned long time) {
+        return programMicros(startTime, (uint64_t)time * EVENT_TIME_UNIT);
+    }
     //Entfernt Leerzeichen am Anfang und Ende des Strings
     void trim (char string[]);
-    //Gibt eine gegebene Zeit (millisekunden) als DD:HH:MM:SS char[] zurueck
+    //Gibt eine gegebene Zeit (millisekunden) als DD:HH:MM:SS char[] zurueck (mindestens 12 Zeichen)
     void getTimeString(unsigned long time, char timeString_out[]);
+    //Aktualisiert eine CRC16 (CCITT, Polynom 0x1021, Startwert 0xFFFF) um ein Byte
+    uint16_t crc16(uint16_t crc, uint8_t data);
+    //Baut einen Binaerframe (Sync, Typ, Laenge, Nutzdaten, CRC16) um Nutzdaten, die bereits ab
+    //frame[4] stehen. Gibt die Gesamtlaenge des Frames zurueck
+    int finishFrame(char frame[], uint8_t type, int payloadLength);
+    //Schreibt die unteren 'bytes' Bytes eines Wertes little endian nach out, gibt einen Zeiger dahinter zurueck
+    char *putLittleEndian(char out[], uint64_t value, int bytes);
+    //Schreibt eine Ganzzahl rechtsbuendig mit mindestens width Zeichen (links mit Leerzeichen
+    //aufgefuellt, laengere Zahlen werden nicht abgeschnitten) nach out, ohne '\0'.
+    //Gibt einen Zeiger hinter das letzte geschriebene Zeichen zurueck
+    char *formatInt(char out[], long value, int width);
+    //Wie formatInt(), aber links mit Nullen aufgefuellt (wie %0*ld), das Vorzeichen zaehlt zur Breite
+    char *formatZeroPadded(char out[], long value, int width);
 };
 
 #endif
@@ -0,0 +1,213 @@
+#include "i2cBus.h"
+
+#ifndef KINETISK
+#include <Wire.h>
+#endif
+
+//Abschnitte einer Transaktion im Interrupt
+#define PHASE_TX 0         //Adresse (schreibend) bzw. Daten wurden gesendet
+#define PHASE_RX_ADRESS 1  //Adresse (lesend) wurde gesendet
+#define PHASE_RX 2         //ein Byte wurde empfangen
+
+I2cBus::I2cBus() {
+    this->ready = false;
+    this->readIndex[0] = this->readIndex[1] = 0;
+    this->writeIndex[0] = this->writeIndex[1] = 0;
+    this->current = NULL;
+    this->phase = PHASE_TX;
+    this->position = 0;
+    this->errors = 0;
+}
+I2cBus::~I2cBus() {
+
+}
+
+#ifdef KINETISK
+void I2cBus::begin() {
+    if (this->ready)
+        return;
+    this->ready = true;
+
+    SIM_SCGC4 |= SIM_SCGC4_I2C0;
+    I2C0_C1 = 0;
+    //Pin 19 SCL0, Pin 18 SDA0, Open Drain
+    CORE_PIN19_CONFIG = PORT_PCR_MUX(2) | PORT_PCR_ODE | PORT_PCR_SRE | PORT_PCR_DSE;
+    CORE_PIN18_CONFIG = PORT_PCR_MUX(2) | PORT_PCR_ODE | PORT_PCR_SRE | PORT_PCR_DSE;
+
+    //Teiler fuer F_BUS 60 MHz (Teensy 3.6 mit 180 MHz), Werte wie in der Wire-Bibliothek
+#if I2C_BUS_CLOCK >= 400000
+    I2C0_F = 0x1C;
+    I2C0_FLT = 2;
+#else
+    I2C0_F = 0x2C;
+    I2C0_FLT = 4;
+#endif
+    I2C0_C2 = I2C_C2_HDRS;
+    I2C0_C1 = I2C_C1_IICEN;
+
+    //unter dem Ventiltimer, der Vorrang behalten muss
+    NVIC_SET_PRIORITY(IRQ_I2C0, 64);
+    NVIC_ENABLE_IRQ(IRQ_I2C0);
+}
+
+bool I2cBus::submit(i2cTransaction *transaction, bool priority) {
+    int q = priority ? 0 : 1;
+    if (this->writeIndex[q] - this->readIndex[q] >= I2C_BUS_QUEUE_SIZE)
+        return false;
+
+    transaction->status = I2C_PENDING;
+    __disable_irq();
+    this->queue[q][this->writeIndex[q] % I2C_BUS_QUEUE_SIZE] = transaction;
+    this->writeIndex[q]++;
+    if (this->current == NULL)
+        this->startNext();
+    __enable_irq();
+    return true;
+}
+
+void I2cBus::startNext() {
+    int q;
+    if (this->readIndex[0] != this->writeIndex[0])
+        q = 0;
+    else if (this->readIndex[1] != this->writeIndex[1])
+        q = 1;
+    else {
+        this->current = NULL;
+        return;
+    }
+    i2cTransaction *t = this->queue[q][this->readIndex[q] % I2C_BUS_QUEUE_SIZE];
+    this->readIndex[q]++;
+    this->current = t;
+    this->position = 0;
+
+    //das Stop der vorherigen Transaktion dauert wenige us, danach ist der Bus frei
+    for (int i = 0; (I2C0_S & I2C_S_BUSY) && i < 1000; i++) {}
+
+    I2C0_S = I2C_S_IICIF | I2C_S_ARBL;
+    I2C0_C1 = I2C_C1_IICEN | I2C_C1_IICIE | I2C_C1_MST | I2C_C1_TX; //Start
+    if (t->txLength > 0) {
+        this->phase = PHASE_TX;
+        I2C0_D = t->adress << 1;
+    } else {
+        this->phase = PHASE_RX_ADRESS;
+        I2C0_D = (t->adress << 1) | 1;
+    }
+}
+
+void I2cBus::handleInterrupt() {
+    uint8_t status = I2C0_S;
+    I2C0_S = I2C_S_IICIF;
+
+    i2cTransaction *t = this->current;
+    if (t == NULL)
+        return;
+
+    if (status & I2C_S_ARBL) {
+        I2C0_S = I2C_S_ARBL;
+        I2C0_C1 = I2C_C1_IICEN;
+        this->finish(I2C_ERROR);
+        return;
+    }
+
+    switch (this->phase) {
+    case PHASE_TX:
+        if (status & I2C_S_RXAK) {
+            I2C0_C1 = I2C_C1_IICEN; //Stop
+            this->finish(I2C_ERROR);
+        } else if (this->position < t->txLength) {
+            I2C0_D = t->txData[this->position++];
+        } else if (t->rxLength > 0) {
+            I2C0_C1 = I2C_C1_IICEN | I2C_C1_IICIE | I2C_C1_MST | I2C_C1_TX | I2C_C1_RSTA;
+            I2C0_D = (t->adress << 1) | 1;
+            this->phase = PHASE_RX_ADRESS;
+        } else {
+            I2C0_C1 = I2C_C1_IICEN; //Stop
+            this->finish(I2C_DONE);
+        }
+        break;
+    case PHASE_RX_ADRESS:
+        if (status & I2C_S_RXAK) {
+            I2C0_C1 = I2C_C1_IICEN; //Stop
+            this->finish(I2C_ERROR);
+            break;
+        }
+        //auf Empfang umschalten, das letzte Byte wird nicht bestaetigt
+        this->position = 0;
+        this->phase = PHASE_RX;
+        I2C0_C1 = I2C_C1_IICEN | I2C_C1_IICIE | I2C_C1_MST | (t->rxLength == 1 ? I2C_C1_TXAK : 0);
+        (void)I2C0_D; //Lesen startet den Empfang des ersten Bytes
+        break;
+    case PHASE_RX:
+        if (this->position + 1 >= t->rxLength) {
+            //Stop vor dem Lesen, sonst wird ein weiteres Byte empfangen
+            I2C0_C1 = I2C_C1_IICEN;
+            t->rxData[this->position++] = I2C0_D;
+            this->finish(I2C_DONE);
+        } else {
+            if (this->position + 2 == t->rxLength)
+                I2C0_C1 = I2C_C1_IICEN | I2C_C1_IICIE | I2C_C1_MST | I2C_C1_TXAK;
+            t->rxData[this->position++] = I2C0_D;
+        }
+        break;
+    }
+}
+
+void i2c0_isr(void) {
+    i2cBus->handleInterrupt();
+}
+#else
+void I2cBus::begin() {
+    if (this->ready)
+        return;
+    this->ready = true;
+
+    Wire.begin();
+    Wire.setClock(I2C_BUS_CLOCK);
+}
+
+bool I2cBus::submit(i2cTransaction *transaction, bool priority) {
+    //ohne eigenen Interrupt synchron, die Prioritaet spielt keine Rolle
+    transaction->status = I2C_PENDING;
+    this->current = transaction;
+    bool ok = true;
+    if (transaction->txLength > 0) {
+        Wire.beginTransmission(transaction->adress);
+        Wire.write(transaction->txData, transaction->txLength);
+        ok = Wire.endTransmission(transaction->rxLength == 0) == 0;
+    }
+    if (ok && transaction->rxLength > 0) {
+        ok = Wire.requestFrom(transaction->adress, transaction->rxLength) == transaction->rxLength;
+        for (int i = 0; ok && i < transaction->rxLength; i++)
+            transaction->rxData[i] = Wire.read();
+    }
+    this->finish(ok ? I2C_DONE : I2C_ERROR);
+    return true;
+}
+
+void I2cBus::startNext() {
+    this->current = NULL;
+}
+
+void I2cBus::handleInterrupt() {
+
+}
+#endif
+
+void I2cBus::finish(uint8_t status) {
+    i2cTransaction *t = this->current;
+    t->timestamp = micros();
+    t->status = status;
+    if (status == I2C_ERROR)
+        this->errors++;
+    this->startNext();
+}
+
+bool I2cBus::isIdle() {
+    return this->current == NULL;
+}
+
+unsigned long I2cBus::getErrors() {
+    return this->errors;
+}
+
+I2cBus *i2cBus = new I2cBus();
@@ -0,0 +1,68 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+//Zustand einer Transaktion
+#define I2C_IDLE 0    //noch nicht eingereiht oder Ergebnis abgeholt
+#define I2C_PENDING 1 //eingereiht oder in Bearbeitung
+#define I2C_DONE 2
+#define I2C_ERROR 3   //keine Bestaetigung (NACK) oder Bus verloren
+
+// Eine I2C-Transaktion: erst txLength Bytes schreiben, dann (mit wiederholtem Start) rxLength
+// Bytes nach rxData lesen. Der Speicher gehoert dem Aufrufer und darf nicht veraendert werden,
+// solange status I2C_PENDING ist
+struct i2cTransaction {
+    uint8_t adress;
+    uint8_t txData[I2C_BUS_MAX_LENGTH];
+    uint8_t txLength;
+    uint8_t *rxData;
+    uint8_t rxLength;
+    volatile uint8_t status;
+    volatile unsigned long timestamp; //micros() beim Abschluss, im Interrupt erfasst
+};
+
+// Nicht blockierender Treiber fuer den I2C-Bus (Pins 18/19), gemeinsam genutzt von Boschsensor
+// und Display. Transaktionen werden eingereiht und im Interrupt nacheinander abgearbeitet, der
+// aufrufende Thread wartet nicht. Transaktionen mit Vorrang (Sensor) werden vor allen anderen
+// gestartet, sie warten hoechstens auf die gerade laufende Transaktion. Innerhalb einer
+// Prioritaet bleibt die Reihenfolge erhalten.
+// Ohne Teensy 3.x (KINETISK) wird synchron ueber Wire uebertragen.
+class I2cBus {
+public:
+    //Defaultconstructor
+    I2cBus();
+    //Destructor
+    ~I2cBus();
+    //Initialisiert den Bus, weitere Aufrufe haben keine Wirkung
+    void begin();
+    //Reiht eine Transaktion ein. Gibt false zurueck, wenn die Warteschlange voll ist
+    bool submit(i2cTransaction *transaction, bool priority);
+    //Gibt an, ob keine Transaktion mehr wartet oder laeuft
+    bool isIdle();
+    //Anzahl fehlgeschlagener Transaktionen
+    unsigned long getErrors();
+    //Wird vom I2C-Interrupt aufgerufen
+    void handleInterrupt();
+private:
+    //Startet die naechste Transaktion, Vorrang zuerst. Nur mit gesperrten Interrupts aufrufen
+    void startNext();
+    //Beendet die laufende Transaktion mit Zeitstempel
+    void finish(uint8_t status);
+
+    bool ready;
+    //Je Prioritaet ein Ring, Indizes laufen frei und werden modulo I2C_BUS_QUEUE_SIZE verwendet
+    i2cTransaction *queue[2][I2C_BUS_QUEUE_SIZE];
+    volatile unsigned int readIndex[2];
+    volatile unsigned int writeIndex[2];
+
+    i2cTransaction * volatile current;
+    volatile uint8_t phase;
+    volatile uint8_t position;
+    volatile unsigned long errors;
+};
+
+extern I2cBus *i2cBus;
+
+#endif
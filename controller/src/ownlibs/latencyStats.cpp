@@ -0,0 +1,99 @@
+#include "latencyStats.h"
+
+LatencyStats::LatencyStats() {
+    this->reset();
+}
+LatencyStats::~LatencyStats() {
+
+}
+
+void LatencyStats::reset() {
+    this->count = 0;
+    this->first = 0;
+    this->min = 0;
+    this->max = 0;
+    this->sum = 0;
+    memset(this->buckets, 0, sizeof(this->buckets));
+}
+
+void LatencyStats::record(long latency) {
+    if (this->count == 0)
+        this->first = latency;
+    if (this->count == 0 || latency < this->min)
+        this->min = latency;
+    if (this->count == 0 || latency > this->max)
+        this->max = latency;
+    this->count++;
+    this->sum += latency;
+
+    //Fach ist die Anzahl der Binaerstellen, 1 us -> 1, 2..3 us -> 2, 4..7 us -> 3, ...
+    int index = 0;
+    if (latency > 0)
+        index = 32 - __builtin_clz((unsigned long)latency);
+    if (index >= LATENCY_BUCKETS)
+        index = LATENCY_BUCKETS - 1;
+    this->buckets[index]++;
+}
+
+unsigned long LatencyStats::getCount() {
+    return this->count;
+}
+
+long LatencyStats::getFirst() {
+    return this->first;
+}
+
+long LatencyStats::getMin() {
+    return this->min;
+}
+
+long LatencyStats::getMax() {
+    return this->max;
+}
+
+long LatencyStats::getMean() {
+    if (this->count == 0)
+        return 0;
+    return this->sum / (long long)this->count;
+}
+
+unsigned long LatencyStats::getBucket(int index) {
+    return this->buckets[index];
+}
+
+char *LatencyStats::serialize(char out[], char type, int id) {
+    out = cmn::putLittleEndian(out, type, 1);
+    out = cmn::putLittleEndian(out, id, 1);
+    out = cmn::putLittleEndian(out, LATENCY_BUCKETS, 2);
+    out = cmn::putLittleEndian(out, this->count, 4);
+    out = cmn::putLittleEndian(out, this->min, 4);
+    out = cmn::putLittleEndian(out, this->max, 4);
+    out = cmn::putLittleEndian(out, this->getMean(), 4);
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        out = cmn::putLittleEndian(out, this->buckets[i], 4);
+    return out;
+}
+
+char *LatencyStats::format(char out[], char type, int id) {
+    memcpy(out, "latency,", 8);
+    out += 8;
+    *out++ = type;
+    *out++ = ',';
+    out = cmn::formatInt(out, id, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->count, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->min, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->max, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->getMean(), 0);
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        *out++ = ',';
+        out = cmn::formatInt(out, this->buckets[i], 0);
+    }
+    *out++ = '\n';
+    return out;
+}
+
+LatencyStats *eventLatency = new LatencyStats();
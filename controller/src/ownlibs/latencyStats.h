@@ -0,0 +1,50 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <Arduino.h>
+#include "../config.h"
+#include "common.h"
+
+// Statistik der Schaltverzoegerung (Ist- minus Soll-Zeit in us) eines MFCs/Ventils oder aller
+// Events. Neben Minimum, Maximum und Mittelwert wird ein logarithmisches Histogramm gefuehrt:
+// Fach 0 zaehlt Events unter 1 us (auch zu frueh geschaltete), Fach k die Verzoegerungen von
+// 2^(k-1) bis unter 2^k us, das letzte Fach alle groesseren.
+// Binaerformat (LATENCY_RECORD_SIZE Bytes, little endian), gleich fuer SD-Dateiende und LabView:
+//   uint8 Typ ('G' gesamt, 'M', 'V') | uint8 ID | uint16 Anzahl Faecher | uint32 Anzahl Events |
+//   int32 Minimum | int32 Maximum | int32 Mittelwert | uint32 je Fach
+class LatencyStats {
+public:
+    //Defaultconstructor
+    LatencyStats();
+    //Destructor
+    ~LatencyStats();
+    //Loescht alle Werte, z.B. zu Beginn einer Messung
+    void reset();
+    //Erfasst die Verzoegerung eines Events in us
+    void record(long latency);
+    unsigned long getCount();
+    //Verzoegerung des ersten Events seit reset()
+    long getFirst();
+    long getMin();
+    long getMax();
+    long getMean();
+    //Anzahl Events im Fach index
+    unsigned long getBucket(int index);
+    //Schreibt die Statistik im Binaerformat nach out, gibt einen Zeiger dahinter zurueck
+    char *serialize(char out[], char type, int id);
+    //Schreibt die Statistik als Textzeile "latency,Typ,ID,Anzahl,Min,Max,Mittel,Fach0,..." mit '\n'
+    //nach out (hoechstens LATENCY_LINE_SIZE Zeichen, ohne '\0'), gibt einen Zeiger dahinter zurueck
+    char *format(char out[], char type, int id);
+private:
+    unsigned long count;
+    long first;
+    long min;
+    long max;
+    long long sum;
+    unsigned long buckets[LATENCY_BUCKETS];
+};
+
+//Alle Events von MFCs und Ventilen gemeinsam
+extern LatencyStats *eventLatency;
+
+#endif
@@ -2,6 +2,11 @@
 
 #include "lcd_I2C.h"
 
+//update() schreibt zwei Halbbytes zu je drei Bytes in eine Transaktion
+#if I2C_BUS_MAX_LENGTH < 6
+#error "I2C_BUS_MAX_LENGTH muss mindestens 6 sein"
+#endif
+
 // When the display powers up, it is configured as follows:
 //
 // 1. Display clear
@@ -42,6 +47,18 @@ LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_Addr, const int i_red_pin, cons
   strcpy(last_dm1, "                    ");
   strcpy(last_dm2, "                    ");
   strcpy(last_dm3, "                    ");
+
+  for (int i = 0; i < LCD_I2C_TRANSACTIONS; i++) {
+    transactions[i].adress = _Addr;
+    transactions[i].txLength = 0;
+    transactions[i].rxData = NULL;
+    transactions[i].rxLength = 0;
+    transactions[i].status = I2C_IDLE;
+  }
+  nextTransaction = 0;
+  building = NULL;
+  queueRead = 0;
+  queueWrite = 0;
 }
 
 void LiquidCrystal_I2C::init(){
@@ -50,7 +67,7 @@ void LiquidCrystal_I2C::init(){
 
 void LiquidCrystal_I2C::init_priv()
 {
-	Wire.begin();
+	i2cBus->begin();
 	_displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
 	begin(_cols, _rows);
 }
@@ -72,7 +89,10 @@ void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
 	delayMicroseconds(50000);
 
 	// Now we pull both RS and R/W low to begin commands
+	beginTransaction();
 	expanderWrite(_backlightval);	// reset expanderand turn backlight off (Bit 8 =1)
+	endTransaction();
+	waitIdle();
 	delay(1000);
 
   	//put the LCD into 4 bit mode
@@ -80,19 +100,30 @@ void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
 	// figure 24, pg 46
 
 	// we start in 8bit mode, try to set 4 bit mode
+	beginTransaction();
 	write4bits(0x03);
+	endTransaction();
+	waitIdle();
 	delayMicroseconds(4500); // wait min 4.1ms
 
 	// second try
+	beginTransaction();
 	write4bits(0x03);
+	endTransaction();
+	waitIdle();
 	delayMicroseconds(4500); // wait min 4.1ms
 
 	// third go!
+	beginTransaction();
 	write4bits(0x03);
+	endTransaction();
+	waitIdle();
 	delayMicroseconds(150);
 
 	// finally, set to 4-bit interface
+	beginTransaction();
 	write4bits(0x02);
+	endTransaction();
 
 
 	// set # lines, font size, etc.
@@ -155,9 +186,10 @@ void LiquidCrystal_I2C::backlight_setColor(int r, int g, int b) {
 
 /*
  * Neue Methode zum Update der gesamten Bildmatrix. Diese vergleicht ausserdem den neuen Text mit
- * dem Alten, um nur die Zeichen zu uebertragen, die sich geaendert haben.
+ * dem Alten, um nur die Zeichen zu uebertragen, die sich geaendert haben. Die Zeichen werden nur
+ * eingereiht, update() uebertraegt sie im Hintergrund.
  */
-void LiquidCrystal_I2C::updateDisplayMatrix(char dm0[21], char dm1[21], char dm2[21], char dm3[21]) {
+void LiquidCrystal_I2C::updateDisplayMatrix(const char dm0[21], const char dm1[21], const char dm2[21], const char dm3[21]) {
     changeSingleChars(dm0, last_dm0, 0);
     changeSingleChars(dm1, last_dm1, 1);
     changeSingleChars(dm2, last_dm2, 2);
@@ -165,16 +197,40 @@ void LiquidCrystal_I2C::updateDisplayMatrix(char dm0[21], char dm1[21], char dm2
 }
 
 //privat
-void LiquidCrystal_I2C::changeSingleChars(char new_dm[21], char last_dm[21], int line) {
-    if (strcmp(new_dm, last_dm) != 0) {
-        for (int i = 0; i < 21; i++) {
-            if (new_dm[i] != last_dm[i]) {
-                setCursor(i, line);
-                print(new_dm[i]);
-            }
+void LiquidCrystal_I2C::changeSingleChars(const char new_dm[21], char last_dm[21], int line) {
+    //kurze Texte werden mit Leerzeichen aufgefuellt, damit alte Zeichen verschwinden
+    int cols = _cols < 20 ? _cols : 20;
+    int length = strlen(new_dm);
+    char padded[21];
+    for (int i = 0; i < cols; i++) {
+        padded[i] = i < length ? new_dm[i] : ' ';
+    }
+    padded[cols] = '\0';
+
+    if (strcmp(padded, last_dm) == 0)
+        return;
+
+    //Zusammenhaengende geaenderte Zeichen werden mit einem setCursor() gesendet, das Display
+    //rueckt selbst weiter. Ein einzelnes unveraendertes Zeichen dazwischen kostet so viel wie
+    //ein neuer setCursor() und wird mitgesendet
+    int i = 0;
+    while (i < cols) {
+        if (padded[i] == last_dm[i]) {
+            i++;
+            continue;
+        }
+        int end = i + 1;
+        while (end < cols && (padded[end] != last_dm[end] || (end + 1 < cols && padded[end + 1] != last_dm[end + 1]))) {
+            end++;
+        }
+
+        setCursor(i, line);
+        for (int k = i; k < end; k++) {
+            write(padded[k]);
         }
-        strcpy(last_dm, new_dm);
+        i = end;
     }
+    strcpy(last_dm, padded);
 }
 
 // Ergaenzungen Ende
@@ -184,11 +240,13 @@ void LiquidCrystal_I2C::changeSingleChars(char new_dm[21], char last_dm[21], int
 /********** high level commands, for the user! */
 void LiquidCrystal_I2C::clear(){
 	command(LCD_CLEARDISPLAY);// clear display, set cursor position to zero
+	waitIdle();
 	delayMicroseconds(2000);  // this command takes a long time!
 }
 
 void LiquidCrystal_I2C::home(){
 	command(LCD_RETURNHOME);  // set cursor position to zero
+	waitIdle();
 	delayMicroseconds(2000);  // this command takes a long time!
 }
 
@@ -291,11 +349,15 @@ inline size_t LiquidCrystal_I2C::write(uint8_t value) {
 /************ low level data pushing commands **********/
 
 // write either command or data
+// Ergaenzung: wird nur eingereiht, update() sendet. Gewartet wird nur bei voller Warteschlange
 void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode) {
-	uint8_t highnib=value>>4;
-	uint8_t lownib=value & 0x0F;
-	write4bits((highnib)|mode);
-	write4bits((lownib)|mode);
+	while (queueWrite - queueRead >= LCD_I2C_QUEUE_SIZE) {
+		update();
+	}
+	queuedValues[queueWrite % LCD_I2C_QUEUE_SIZE] = value;
+	queuedModes[queueWrite % LCD_I2C_QUEUE_SIZE] = mode;
+	queueWrite++;
+	update();
 }
 
 void LiquidCrystal_I2C::write4bits(uint8_t value) {
@@ -304,19 +366,65 @@ void LiquidCrystal_I2C::write4bits(uint8_t value) {
 }
 
 void LiquidCrystal_I2C::expanderWrite(uint8_t _data){
-	Wire.beginTransmission(_Addr);
-	Wire.write((int)(_data) | _backlightval);
-	Wire.endTransmission();
+	building->txData[building->txLength++] = _data | _backlightval;
 }
 
+// Jedes Byte belegt den Bus ca. 90us (100 kHz), das ist laenger als der Enable-Puls (>450ns)
+// und die Ausfuehrung eines Befehls (>37us). Zusaetzliche Wartezeiten sind nicht noetig
 void LiquidCrystal_I2C::pulseEnable(uint8_t _data){
 	expanderWrite(_data | En);	// En high
-	delayMicroseconds(1);		// enable pulse must be >450ns
-
 	expanderWrite(_data & ~En);	// En low
-	delayMicroseconds(50);		// commands need > 37us to settle
 }
 
+// Ergaenzungen
+
+bool LiquidCrystal_I2C::update(){
+	//Jedes eingereihte Byte wird eine Transaktion, die Sensorabfragen warten so hoechstens ein Byte ab
+	while (queueRead != queueWrite) {
+		i2cTransaction *t = &transactions[nextTransaction];
+		if (t->status == I2C_PENDING)
+			break;
+
+		uint8_t value = queuedValues[queueRead % LCD_I2C_QUEUE_SIZE];
+		uint8_t mode = queuedModes[queueRead % LCD_I2C_QUEUE_SIZE];
+		building = t;
+		building->txLength = 0;
+		write4bits((value >> 4) | mode);
+		write4bits((value & 0x0F) | mode);
+		if (!i2cBus->submit(building, false))
+			break;
+
+		nextTransaction = (nextTransaction + 1) % LCD_I2C_TRANSACTIONS;
+		queueRead++;
+	}
+
+	if (queueRead != queueWrite)
+		return true;
+	for (int i = 0; i < LCD_I2C_TRANSACTIONS; i++) {
+		if (transactions[i].status == I2C_PENDING)
+			return true;
+	}
+	return false;
+}
+
+void LiquidCrystal_I2C::beginTransaction(){
+	//eingereihte Bytes zuerst, damit die Reihenfolge erhalten bleibt
+	waitIdle();
+	building = &transactions[nextTransaction];
+	building->txLength = 0;
+}
+
+void LiquidCrystal_I2C::endTransaction(){
+	while (!i2cBus->submit(building, false)) {}
+	nextTransaction = (nextTransaction + 1) % LCD_I2C_TRANSACTIONS;
+}
+
+void LiquidCrystal_I2C::waitIdle(){
+	while (update()) {}
+}
+
+// Ergaenzungen Ende
+
 
 // Alias functions
 
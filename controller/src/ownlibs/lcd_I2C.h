@@ -5,7 +5,7 @@
 
 #include <inttypes.h>
 #include "Print.h"
-#include "Wire.h"
+#include "i2cBus.h"
 #include "Arduino.h"
 
 // commands
@@ -88,7 +88,10 @@ public:
 	void backlight_off();
 	void backlight_on();
 	void backlight_setColor(int r, int g, int b);
-    void updateDisplayMatrix(char dm0[21], char dm1[21], char dm2[21], char dm3[21]);
+    void updateDisplayMatrix(const char dm0[21], const char dm1[21], const char dm2[21], const char dm3[21]);
+    //Sendet eingereihte Zeichen und Befehle, soweit Transaktionen frei sind, ohne zu warten.
+    //Gibt true zurueck, solange noch nicht alles uebertragen ist
+    bool update();
 
 	// Ergaenzungen Ende
 
@@ -118,8 +121,13 @@ private:
     void write4bits(uint8_t);
     void expanderWrite(uint8_t);
     void pulseEnable(uint8_t);
+    //Ergaenzung: Bytes an den Portexpander werden gesammelt und als eine Transaktion ueber den
+    //I2C-Bus gesendet, ohne auf das Ende zu warten. Nur fuer die Initialisierung, sonst send()
+    void beginTransaction();
+    void endTransaction();
+    void waitIdle(); //wartet, bis alle eingereihten Bytes und Transaktionen des Displays uebertragen sind
 
-    void changeSingleChars(char new_dm[21], char last_dm[21], int line);
+    void changeSingleChars(const char new_dm[21], char last_dm[21], int line);
 
     uint8_t _Addr;
     uint8_t _displayfunction;
@@ -140,6 +148,15 @@ private:
     char last_dm1[21];
     char last_dm2[21];
     char last_dm3[21];
+
+    i2cTransaction transactions[LCD_I2C_TRANSACTIONS];
+    int nextTransaction;
+    i2cTransaction *building; //Transaktion, an die expanderWrite() anhaengt
+    //Warteschlange fuer send(), Indizes laufen frei und werden modulo LCD_I2C_QUEUE_SIZE verwendet
+    uint8_t queuedValues[LCD_I2C_QUEUE_SIZE];
+    uint8_t queuedModes[LCD_I2C_QUEUE_SIZE];
+    unsigned int queueRead;
+    unsigned int queueWrite;
 };
 
 #endif
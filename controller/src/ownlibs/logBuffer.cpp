@@ -0,0 +1,74 @@
+#include "logBuffer.h"
+
+LogBuffer::LogBuffer() {
+    this->readIndex      = 0;
+    this->committedIndex = 0;
+    this->writeIndex     = 0;
+    this->recordDropped  = false;
+
+    this->droppedRecords         = 0;
+    this->reportedDroppedRecords = 0;
+}
+LogBuffer::~LogBuffer() {
+
+}
+
+size_t LogBuffer::write(uint8_t c) {
+    if (!this->recordDropped) {
+        if (this->writeIndex - this->readIndex >= SERIAL_DEBUG_BUFFER_SIZE) {
+            //Puffer voll, bereits geschriebener Teil des Datensatzes wird zurueckgenommen
+            this->writeIndex    = this->committedIndex;
+            this->recordDropped = true;
+        } else {
+            this->buffer[this->writeIndex % SERIAL_DEBUG_BUFFER_SIZE] = c;
+            this->writeIndex++;
+        }
+    }
+
+    if (c == '\n') { //Datensatz abgeschlossen
+        if (this->recordDropped) {
+            this->droppedRecords++;
+            this->recordDropped = false;
+        } else {
+            this->committedIndex = this->writeIndex;
+        }
+    }
+    return 1;
+}
+
+void LogBuffer::drain(Print *output, unsigned int maxBytes) {
+    //Verworfene Datensaetze werden gemeldet, sobald die Schnittstelle Platz hat
+    if (this->droppedRecords != this->reportedDroppedRecords && output->availableForWrite() >= 48) {
+        output->print("[Debug: ");
+        output->print(this->droppedRecords - this->reportedDroppedRecords);
+        output->println(" Meldungen verworfen]");
+        this->reportedDroppedRecords = this->droppedRecords;
+    }
+
+    while (this->committedIndex != this->readIndex && maxBytes > 0) {
+        unsigned int start  = this->readIndex % SERIAL_DEBUG_BUFFER_SIZE;
+        unsigned int length = this->committedIndex - this->readIndex;
+        if (length > SERIAL_DEBUG_BUFFER_SIZE - start) //bis zum Ende des Puffers, Rest im naechsten Durchlauf
+            length = SERIAL_DEBUG_BUFFER_SIZE - start;
+
+        int space = output->availableForWrite();
+        if (space <= 0)
+            return;
+        if (length > (unsigned int)space)
+            length = space;
+        if (length > maxBytes)
+            length = maxBytes;
+
+        output->write((const uint8_t *)&this->buffer[start], length);
+        this->readIndex += length;
+        maxBytes        -= length;
+    }
+}
+
+bool LogBuffer::isPending() {
+    return this->committedIndex != this->readIndex;
+}
+
+unsigned long LogBuffer::getDroppedRecords() {
+    return this->droppedRecords;
+}
@@ -0,0 +1,38 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Ringpuffer fuer Debugausgaben. Geschrieben wird ueber die Print-Funktionen, ein Datensatz
+// endet mit '\n'. Passt ein Datensatz nicht mehr vollstaendig in den Puffer, wird er komplett
+// verworfen und gezaehlt. drain() gibt nur abgeschlossene Datensaetze weiter und schreibt dabei
+// nur so viel, wie die Schnittstelle ohne Warten annimmt, hoechstens 'maxBytes' je Aufruf.
+class LogBuffer : public Print {
+public:
+    //Defaultconstructor
+    LogBuffer();
+    //Destructor
+    ~LogBuffer();
+    //Haengt ein Zeichen an den aktuellen Datensatz an
+    virtual size_t write(uint8_t c);
+    using Print::write;
+    //Schreibt abgeschlossene Datensaetze auf 'output', ohne zu blockieren, hoechstens 'maxBytes'
+    void drain(Print *output, unsigned int maxBytes);
+    //Gibt an, ob abgeschlossene Datensaetze auf die Ausgabe warten
+    bool isPending();
+    //Anzahl der bisher verworfenen Datensaetze
+    unsigned long getDroppedRecords();
+private:
+    char buffer[SERIAL_DEBUG_BUFFER_SIZE];
+    //Indizes laufen frei und werden modulo Groesse verwendet: readIndex <= committedIndex <= writeIndex
+    unsigned int readIndex;      //naechstes auszugebendes Zeichen
+    unsigned int committedIndex; //Ende des letzten abgeschlossenen Datensatzes
+    unsigned int writeIndex;     //Ende des aktuellen Datensatzes
+    bool recordDropped;          //aktueller Datensatz wird bis '\n' verworfen
+
+    unsigned long droppedRecords;
+    unsigned long reportedDroppedRecords;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "memoryStats.h"
+
+#if defined(KINETISK)
+#include <malloc.h>
+
+//Oberes Ende des RAM (Beginn des Stacks), aus dem Linkerskript des Teensy
+extern unsigned long _estack;
+//Obergrenze des Heaps, von _sbrk() im Core des Teensy fortgeschrieben
+extern "C" char *__brkval;
+#endif
+
+MemoryStats::MemoryStats() {
+    this->paintBegin = NULL;
+    this->heapPeak   = 0;
+}
+MemoryStats::~MemoryStats() {
+
+}
+
+void MemoryStats::paintStack() {
+#if defined(KINETISK)
+    //Die lokale Variable liegt im aktuellen Stackframe, alles darunter ist frei
+    uint8_t marker;
+    uint32_t *word = (uint32_t *)(((uintptr_t)__brkval + 3) & ~3UL);
+    uint32_t *end  = (uint32_t *)(((uintptr_t)&marker - MEMORY_STACK_MARGIN) & ~3UL);
+    this->paintBegin = word;
+    while (word < end) {
+        *word++ = MEMORY_PAINT_PATTERN;
+    }
+#endif
+}
+
+size_t MemoryStats::getHeapUsed() {
+#if defined(KINETISK)
+    return mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+size_t MemoryStats::getHeapPeak() {
+#if defined(KINETISK)
+    //newlib gibt Speicher am Ende des Heaps evtl. zurueck, der Hoechststand wird mitgefuehrt
+    size_t heap = mallinfo().arena;
+    if (heap > this->heapPeak)
+        this->heapPeak = heap;
+#endif
+    return this->heapPeak;
+}
+
+size_t MemoryStats::getStackPeak() {
+#if defined(KINETISK)
+    if (this->paintBegin == NULL)
+        return 0;
+
+    //Ein seitdem gewachsener Heap hat das Muster ueberschrieben oder uebernommen
+    uint32_t *word = (uint32_t *)(((uintptr_t)__brkval + 3) & ~3UL);
+    if (word < this->paintBegin)
+        word = this->paintBegin;
+    while (word < (uint32_t *)&_estack && *word == MEMORY_PAINT_PATTERN) {
+        word++;
+    }
+    return (uintptr_t)&_estack - (uintptr_t)word;
+#else
+    return 0;
+#endif
+}
+
+size_t MemoryStats::getFree() {
+#if defined(KINETISK)
+    uint8_t marker;
+    return ((uintptr_t)&marker - (uintptr_t)__brkval) + mallinfo().fordblks;
+#else
+    return 0;
+#endif
+}
+
+char *MemoryStats::format(char out[]) {
+    memcpy(out, "ram,", 4);
+    out = cmn::formatInt(&out[4], this->getHeapUsed(), 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->getHeapPeak(), 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->getStackPeak(), 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->getFree(), 0);
+    *out++ = '\n';
+    return out;
+}
+
+MemoryStats *memoryStats = new MemoryStats();
@@ -0,0 +1,44 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <Arduino.h>
+#include "../config.h"
+#include "common.h"
+
+// Belegung des RAM fuer <memory>: Heap (belegt, Hoechststand), Stack-Hoechststand und der freie
+// Bereich dazwischen. Alle Threads laufen auf demselben Stack (mthread ruft loop() nur auf), sein
+// Hoechststand wird ueber ein Fuellmuster bestimmt: paintStack() fuellt beim Booten den freien
+// Bereich zwischen Heap und Stack mit MEMORY_PAINT_PATTERN, getStackPeak() sucht von unten das
+// erste ueberschriebene Wort. Nur auf dem Teensy 3.x, sonst (Simulation) liefern alle Werte 0.
+// Textzeile:
+//   ram,Heap-Bytes,Heap-Hoechststand,Stack-Hoechststand,Frei
+class MemoryStats {
+public:
+    //Defaultconstructor
+    MemoryStats();
+    //Destructor
+    ~MemoryStats();
+    //Fuellt den freien Bereich bis MEMORY_STACK_MARGIN Bytes unter den aktuellen Stack mit dem
+    //Muster, moeglichst frueh in setup()
+    void paintStack();
+    //Mit new/malloc belegte Bytes
+    size_t getHeapUsed();
+    //Hoechste Ausdehnung des Heaps in Bytes (freigegebener Speicher bleibt beim Heap)
+    size_t getHeapPeak();
+    //Tiefste Ausdehnung des Stacks seit paintStack() in Bytes. Durchsucht den freien Bereich,
+    //dauert auf dem Teensy 3.6 bis zu 0,5 ms
+    size_t getStackPeak();
+    //Freie Bytes zwischen Heap und Stack, dazu im Heap freigegebene
+    size_t getFree();
+    //Schreibt die Textzeile mit '\n' nach out (hoechstens MEMORY_LINE_SIZE Zeichen, ohne '\0'),
+    //gibt einen Zeiger dahinter zurueck
+    char *format(char out[]);
+private:
+    uint32_t *paintBegin; //erstes gefuelltes Wort, NULL ohne paintStack()
+    size_t heapPeak;
+};
+
+//RAM-Belegung des Controllers
+extern MemoryStats *memoryStats;
+
+#endif
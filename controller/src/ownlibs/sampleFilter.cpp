@@ -0,0 +1,130 @@
+#include "sampleFilter.h"
+
+#if FILTER_MAX_LENGTH < 5
+#error "FILTER_MAX_LENGTH muss mindestens 5 sein (Biquad)"
+#endif
+
+SampleFilter::SampleFilter(int maxBlockSize, float state[]) {
+    this->type = FILTER_NONE;
+    this->length = 1;
+    this->maxBlockSize = maxBlockSize;
+    this->ownState = state == NULL;
+    this->state = this->ownState ? new float[SAMPLE_FILTER_STATE(maxBlockSize)] : state;
+}
+SampleFilter::~SampleFilter() {
+    if (this->ownState)
+        delete[] this->state;
+}
+
+void SampleFilter::begin(int type, int length, float cutoff, float sampleRate) {
+    this->type = type;
+    if (length < 1)
+        length = 1;
+    if (length > FILTER_MAX_LENGTH)
+        length = FILTER_MAX_LENGTH;
+
+    if (type == FILTER_BIQUAD_LOWPASS) {
+        //Butterworth, Q = 1/sqrt(2), Koeffizienten nach dem Audio EQ Cookbook
+        float w0    = 2.0f * PI * cutoff / sampleRate;
+        float cosW0 = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * 0.70710678f);
+        float a0    = 1.0f + alpha;
+        this->coefficients[0] = (1.0f - cosW0) / 2.0f / a0;
+        this->coefficients[1] = (1.0f - cosW0) / a0;
+        this->coefficients[2] = this->coefficients[0];
+        //CMSIS erwartet die Rueckkopplung mit umgekehrtem Vorzeichen
+        this->coefficients[3] = 2.0f * cosW0 / a0;
+        this->coefficients[4] = -(1.0f - alpha) / a0;
+        this->length = 5;
+    } else if (type == FILTER_FIR) {
+        //gefensterter sinc, Summe der Koeffizienten auf 1 normiert (Gleichanteil bleibt erhalten)
+        float fc = cutoff / sampleRate;
+        float sum = 0;
+        for (int n = 0; n < length; n++) {
+            float m = n - (length - 1) / 2.0f;
+            float h = m == 0 ? 2.0f * fc : sinf(2.0f * PI * fc * m) / (PI * m);
+            if (length > 1)
+                h *= 0.54f - 0.46f * cosf(2.0f * PI * n / (length - 1));
+            this->coefficients[n] = h;
+            sum += h;
+        }
+        for (int n = 0; n < length; n++)
+            this->coefficients[n] /= sum;
+        this->length = length;
+    } else {
+        //gleitender Mittelwert, ohne Filter bleibt der Wert unveraendert
+        if (type != FILTER_MOVING_AVERAGE)
+            length = 1;
+        for (int n = 0; n < length; n++)
+            this->coefficients[n] = 1.0f / length;
+        this->length = length;
+    }
+
+#ifdef KINETISK
+    if (this->type == FILTER_BIQUAD_LOWPASS)
+        arm_biquad_cascade_df1_init_f32(&this->biquad, 1, this->coefficients, this->state);
+    else
+        arm_fir_init_f32(&this->fir, this->length, this->coefficients, this->state, this->maxBlockSize);
+#endif
+    this->reset();
+}
+
+void SampleFilter::reset() {
+    memset(this->state, 0, (FILTER_MAX_LENGTH - 1 + this->maxBlockSize) * sizeof(float));
+    this->primed = false;
+}
+
+void SampleFilter::prime(float value) {
+    //Beide Zustaende (FIR: vorherige Eingangswerte, Biquad: x[n-1], x[n-2], y[n-1], y[n-2])
+    //stehen am Anfang von state, wie bei CMSIS. Der Filter verhaelt sich, als laege der Wert schon lange an
+    int history = this->type == FILTER_BIQUAD_LOWPASS ? 4 : this->length - 1;
+    for (int i = 0; i < history; i++)
+        this->state[i] = value;
+    this->primed = true;
+}
+
+void SampleFilter::process(const float in[], float out[], int length) {
+    if (length > this->maxBlockSize)
+        length = this->maxBlockSize;
+    if (length <= 0)
+        return;
+    //ohne Vorgeschichte wuerde der Filter zu Beginn jeder Messung von 0 aus einschwingen
+    if (!this->primed)
+        this->prime(in[0]);
+
+#ifdef KINETISK
+    if (this->type == FILTER_BIQUAD_LOWPASS)
+        arm_biquad_cascade_df1_f32(&this->biquad, (float *)in, out, length);
+    else
+        arm_fir_f32(&this->fir, (float *)in, out, length);
+#else
+    if (this->type == FILTER_BIQUAD_LOWPASS) {
+        //Direktform I, state: x[n-1], x[n-2], y[n-1], y[n-2]
+        float *c = this->coefficients;
+        float *s = this->state;
+        for (int i = 0; i < length; i++) {
+            float y = c[0] * in[i] + c[1] * s[0] + c[2] * s[1] + c[3] * s[2] + c[4] * s[3];
+            s[1] = s[0];
+            s[0] = in[i];
+            s[3] = s[2];
+            s[2] = y;
+            out[i] = y;
+        }
+    } else {
+        //die letzten length - 1 Eingangswerte stehen am Anfang von state, dahinter der neue Block
+        int history = this->length - 1;
+        memcpy(&this->state[history], in, length * sizeof(float));
+        for (int i = 0; i < length; i++) {
+            float y = 0;
+            for (int k = 0; k < this->length; k++)
+                y += this->coefficients[k] * this->state[i + k];
+            out[i] = y;
+        }
+        memmove(this->state, &this->state[length], history * sizeof(float));
+    }
+#endif
+}
+
+bool SampleFilter::isActive() {
+    return this->type != FILTER_NONE;
+}
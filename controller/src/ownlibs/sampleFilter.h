@@ -0,0 +1,54 @@
+#ifndef SAMPLEFILTER_H
+#define SAMPLEFILTER_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+#ifdef KINETISK
+#include <arm_math.h> //CMSIS-DSP, wird mit dem Teensy-Core ausgeliefert
+#endif
+
+//Werte im Zustand eines Filters fuer Bloecke bis maxBlockSize Werte
+#define SAMPLE_FILTER_STATE(maxBlockSize) (FILTER_MAX_LENGTH - 1 + (maxBlockSize))
+
+// Digitaler Filter fuer Messwertstroeme (Boschsensor, Durchfluss der MFCs). Die Werte werden
+// blockweise gefiltert, der Zustand bleibt zwischen den Bloecken erhalten. Auf dem Teensy 3.x
+// rechnen die CMSIS-DSP-Kernel mit der FPU, sonst wird dieselbe Rechnung direkt ausgefuehrt.
+// Filterarten (FILTER_... in config.h):
+//   FILTER_MOVING_AVERAGE: gleitender Mittelwert ueber length Werte (FIR mit gleichen Koeffizienten)
+//   FILTER_BIQUAD_LOWPASS: Tiefpass 2. Ordnung (Butterworth) mit Grenzfrequenz cutoff
+//   FILTER_FIR:            Tiefpass mit length Koeffizienten (gefensterter sinc, Hamming) und Grenzfrequenz cutoff
+class SampleFilter {
+public:
+    //maxBlockSize: Werte, die process() hoechstens auf einmal erhaelt. state: Speicher fuer
+    //SAMPLE_FILTER_STATE(maxBlockSize) Werte (z.B. aus der Arena), bei NULL wird er angelegt
+    SampleFilter(int maxBlockSize, float state[] = NULL);
+    //Destructor
+    ~SampleFilter();
+    //Berechnet die Koeffizienten und loescht den Zustand. cutoff und sampleRate in Hz,
+    //length wird auf FILTER_MAX_LENGTH begrenzt
+    void begin(int type, int length, float cutoff, float sampleRate);
+    //Loescht den Zustand, z.B. zu Beginn einer Messung. Der naechste Wert fuellt ihn wieder auf
+    void reset();
+    //Filtert length Werte von in nach out (in und out duerfen nicht gleich sein)
+    void process(const float in[], float out[], int length);
+    //Gibt an, ob ein Filter eingestellt ist (sonst muss process() nicht aufgerufen werden)
+    bool isActive();
+private:
+    //Fuellt den Zustand mit einem konstanten Wert
+    void prime(float value);
+
+    int type;
+    int length;
+    int maxBlockSize;
+    float coefficients[FILTER_MAX_LENGTH]; //FIR: length Koeffizienten, Biquad: b0, b1, b2, a1, a2
+    float *state; //FIR: length - 1 + maxBlockSize Werte, Biquad: 4 Werte
+    bool primed;  //Zustand enthaelt bereits Messwerte
+    bool ownState; //Zustand wurde im Konstruktor angelegt
+#ifdef KINETISK
+    arm_fir_instance_f32 fir;
+    arm_biquad_casd_df1_inst_f32 biquad;
+#endif
+};
+
+#endif
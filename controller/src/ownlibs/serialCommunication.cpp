@@ -7,23 +7,22 @@ SerialCommunication::~SerialCommunication() {
 
 }
 
-void SerialCommunication::setSerial(HardwareSerial *serial_labView, HardwareSerial *serial_debug, HardwareSerial* serial_uart) {
-    this->serial_labView = serial_labView;
-    this->serial_debug   = serial_debug;
-    this->serial_uart    = serial_uart;
-
-    this->serial_labView->begin(SERIAL_LABVIEW_BAUDRATE);
-    this->serial_debug->begin(SERIAL_DEBUG_BAUDRATE);
+void SerialCommunication::setUart(HardwareSerial *serial_uart) {
+    this->serial_uart = serial_uart;
     this->serial_uart->begin(SERIAL_UART_BAUDRATE);
 }
 
-HardwareSerial *SerialCommunication::getType(char type) {
-    HardwareSerial *this_serial;
+Print *SerialCommunication::getType(char type) {
+    Print *this_serial;
 
     if (type == 'L') {
-        this_serial = this->serial_labView;
+        this_serial = &this->serial_labView;
     } else if (type == 'D') {
+#if SERIAL_DEBUG_BUFFERED
+        this_serial = &this->debugBuffer; //wird von Main_DebugLog ausgegeben
+#else
         this_serial = this->serial_debug;
+#endif
     } else if (type == 'U') {
         this_serial = this->serial_uart;
     } else {
@@ -34,11 +33,19 @@ HardwareSerial *SerialCommunication::getType(char type) {
     return this_serial;
 }
 
-void SerialCommunication::print(char type, String &input) {
+Stream *SerialCommunication::getStream(char type) {
+    if (type == 'L')
+        return &this->serial_labView;
+    if (type != 'U')
+        this->serial_debug->println("ERROR - Falscher Typ gewaehlt");
+    return this->serial_uart;
+}
+
+void SerialCommunication::print(char type, const String &input) {
     this->getType(type)->print(input);
 }
 
-void SerialCommunication::print(char type, char input[]) {
+void SerialCommunication::print(char type, const char input[]) {
     this->getType(type)->print(input);
 }
 
@@ -73,11 +80,11 @@ void SerialCommunication::print(char type, double input) {
 
 
 
-void SerialCommunication::println(char type, String &input) {
+void SerialCommunication::println(char type, const String &input) {
     this->getType(type)->println(input);
 }
 
-void SerialCommunication::println(char type, char input[]) {
+void SerialCommunication::println(char type, const char input[]) {
     this->getType(type)->println(input);
 }
 
@@ -109,5 +116,23 @@ void SerialCommunication::println(char type, double input) {
     this->getType(type)->println(input);
 }
 
+void SerialCommunication::write(char type, const char data[], int length) {
+    this->getType(type)->write((const uint8_t *)data, length);
+}
+
+void SerialCommunication::drainDebug() {
+#if SERIAL_DEBUG_BUFFERED
+    this->debugBuffer.drain(this->serial_debug, SERIAL_DEBUG_DRAIN_SLICE);
+#endif
+}
+
+bool SerialCommunication::isDebugPending() {
+#if SERIAL_DEBUG_BUFFERED
+    return this->debugBuffer.isPending();
+#else
+    return false;
+#endif
+}
+
 // Initialisiere die Serielle Kommunikation
 SerialCommunication *srl = new SerialCommunication();
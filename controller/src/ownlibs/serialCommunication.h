@@ -3,6 +3,11 @@
 
 #include <Arduino.h>
 #include "../config.h"
+#include "logBuffer.h"
+#include "serialLink.h"
+
+//Kennzeichnet zur Compilezeit, ob eine Stufe der Debugausgabe aktiv ist (siehe LOG_LEVEL)
+template <bool enabled> struct LogLevelTag {};
 
 class SerialCommunication {
 public:
@@ -11,11 +16,21 @@ public:
     //Destructor
     ~SerialCommunication();
 
-    void setSerial(HardwareSerial *serial_labView, HardwareSerial *serial_debug, HardwareSerial* serial_uart);
+    //Fuegt eine Schnittstelle zu LabView hinzu (USB und/oder UART, siehe SerialLink)
+    template <class T> void addLabView(T *serial) {
+        this->serial_labView.addPort(serial, SERIAL_LABVIEW_BAUDRATE);
+    }
+    //Setzt die Schnittstelle fuer Debugausgaben, sie darf nicht von LabView verwendet werden (config.h prueft das)
+    template <class T> void setDebug(T *serial) {
+        serial->begin(SERIAL_DEBUG_BAUDRATE);
+        this->serial_debug = serial;
+    }
+    //Setzt den UART zu den MFCs
+    void setUart(HardwareSerial *serial_uart);
 
     //Serial_print Funktionen fuer alle Datentypen
-    void print(char type, String &input);
-    void print(char type, char input[]);
+    void print(char type, const String &input);
+    void print(char type, const char input[]);
     void print(char type, char input);
     void print(char type, unsigned char input);
     void print(char type, int input);
@@ -24,8 +39,8 @@ public:
     void print(char type, unsigned long input);
     void print(char type, double input);
 
-    void println(char type, String &input);
-    void println(char type, char input[]);
+    void println(char type, const String &input);
+    void println(char type, const char input[]);
     void println(char type, char input);
     void println(char type, unsigned char input);
     void println(char type, int input);
@@ -34,10 +49,44 @@ public:
     void println(char type, unsigned long input);
     void println(char type, double input);
 
+    //Gibt length Zeichen unveraendert aus, der Text muss nicht mit '\0' enden
+    void write(char type, const char data[], int length);
+
+    //Debugausgaben mit Stufe. Inaktive Stufen sind leere Inline-Funktionen und werden samt
+    //Text vom Compiler entfernt, es gibt keine Pruefung zur Laufzeit
+    template <typename T> void error(const T &input)   { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_ERROR)>(), input, false); }
+    template <typename T> void errorln(const T &input) { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_ERROR)>(), input, true); }
+    template <typename T> void info(const T &input)    { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_INFO)>(), input, false); }
+    template <typename T> void infoln(const T &input)  { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_INFO)>(), input, true); }
+    template <typename T> void trace(const T &input)   { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_TRACE)>(), input, false); }
+    template <typename T> void traceln(const T &input) { this->log(LogLevelTag<(LOG_LEVEL >= LOG_LEVEL_TRACE)>(), input, true); }
+
+    //Gibt die Schnittstelle eines Typs zurueck, z.B. fuer nicht blockierende Ausgaben mit availableForWrite()
+    Print *getType(char type);
+    //Wie getType(), aber mit Lesezugriff (nur LabView und UART)
+    Stream *getStream(char type);
+
+    //Gibt gepufferte Debugausgaben aus, ohne zu blockieren, hoechstens SERIAL_DEBUG_DRAIN_SLICE
+    //Bytes je Aufruf (wird von Main_DebugLog aufgerufen)
+    void drainDebug();
+    //Gibt an, ob gepufferte Debugausgaben auf die Ausgabe warten
+    bool isDebugPending();
+
 private:
-    HardwareSerial *getType(char type);
-    HardwareSerial *serial_labView;
-    HardwareSerial *serial_debug;
+    //Ausgabe einer aktiven bzw. inaktiven Stufe auf dem Debugport
+    template <typename T> void log(LogLevelTag<true>, const T &input, bool newLine) {
+        if (newLine)
+            this->println('D', input);
+        else
+            this->print('D', input);
+    }
+    template <typename T> void log(LogLevelTag<false>, const T &input, bool newLine) {}
+
+#if SERIAL_DEBUG_BUFFERED
+    LogBuffer debugBuffer;
+#endif
+    SerialLink serial_labView;
+    Print *serial_debug;
     HardwareSerial *serial_uart;
 };
 
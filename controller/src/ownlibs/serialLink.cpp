@@ -0,0 +1,87 @@
+#include "serialLink.h"
+
+SerialLink::SerialLink() {
+    this->amountPorts = 0;
+    this->inputPort = 0;
+    this->heardAny = false;
+}
+SerialLink::~SerialLink() {
+
+}
+
+int SerialLink::getAmountPorts() {
+    return this->amountPorts;
+}
+
+Stream *SerialLink::getPort(int index) {
+    return this->ports[index];
+}
+
+int SerialLink::selectInput() {
+    //Eine begonnene Zeile wird moeglichst von derselben Schnittstelle zuende gelesen
+    for (int i = 0; i < this->amountPorts; i++) {
+        int index = (this->inputPort + i) % this->amountPorts;
+        if (this->ports[index]->available() > 0)
+            return index;
+    }
+    return -1;
+}
+
+bool SerialLink::isOutput(int index) {
+    return !this->heardAny || this->heard[index];
+}
+
+int SerialLink::available() {
+    int amount = 0;
+    for (int i = 0; i < this->amountPorts; i++)
+        amount += this->ports[i]->available();
+    return amount;
+}
+
+int SerialLink::read() {
+    int index = this->selectInput();
+    if (index < 0)
+        return -1;
+    this->inputPort = index;
+    this->heard[index] = true;
+    this->heardAny = true;
+    return this->ports[index]->read();
+}
+
+int SerialLink::peek() {
+    int index = this->selectInput();
+    if (index < 0)
+        return -1;
+    return this->ports[index]->peek();
+}
+
+void SerialLink::flush() {
+    for (int i = 0; i < this->amountPorts; i++) {
+        if (this->isOutput(i))
+            this->ports[i]->flush();
+    }
+}
+
+size_t SerialLink::write(uint8_t c) {
+    return this->write(&c, 1);
+}
+
+size_t SerialLink::write(const uint8_t *buffer, size_t size) {
+    for (int i = 0; i < this->amountPorts; i++) {
+        if (this->isOutput(i))
+            this->ports[i]->write(buffer, size);
+    }
+    return size;
+}
+
+int SerialLink::availableForWrite() {
+    int space = -1;
+    for (int i = 0; i < this->amountPorts; i++) {
+        if (!this->isOutput(i))
+            continue;
+        int portSpace = this->ports[i]->availableForWrite();
+        if (space < 0 || portSpace < space)
+            space = portSpace;
+    }
+    return space < 0 ? 0 : space;
+}
@@ -0,0 +1,52 @@
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Verbindung zu LabView ueber eine oder mehrere Schnittstellen (natives USB, UART). Nach aussen ist
+// sie ein einzelner Stream, Parser und Messzeilen sind daher unabhaengig von der Schnittstelle.
+// Gelesen wird von der Schnittstelle des letzten Zeichens, solange sie Zeichen hat, danach von der
+// naechsten mit Zeichen. Ausgaben gehen an alle Schnittstellen, von denen schon gelesen wurde (vor
+// dem ersten Zeichen an alle), availableForWrite() ist das Minimum dieser Schnittstellen.
+class SerialLink : public Stream {
+public:
+    //Defaultconstructor
+    SerialLink();
+    //Destructor
+    ~SerialLink();
+    //Startet die Schnittstelle (begin(baudrate), bei USB ohne Wirkung) und fuegt sie hinzu,
+    //hoechstens SERIAL_LINK_MAX_PORTS
+    template <class T> void addPort(T *port, unsigned long baudrate) {
+        if (this->amountPorts == SERIAL_LINK_MAX_PORTS)
+            return;
+        port->begin(baudrate);
+        this->ports[this->amountPorts] = port;
+        this->heard[this->amountPorts] = false;
+        this->amountPorts++;
+    }
+    int getAmountPorts();
+    Stream *getPort(int index);
+
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual void flush();
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    virtual int availableForWrite();
+private:
+    //Schnittstelle, von der das naechste Zeichen gelesen wird, -1 wenn keine Zeichen hat
+    int selectInput();
+    //Gibt an, ob Ausgaben an die Schnittstelle gehen
+    bool isOutput(int index);
+
+    Stream *ports[SERIAL_LINK_MAX_PORTS];
+    bool heard[SERIAL_LINK_MAX_PORTS]; //es wurde schon ein Zeichen gelesen
+    bool heardAny;
+    int amountPorts;
+    int inputPort; //Schnittstelle des letzten Zeichens
+};
+
+#endif
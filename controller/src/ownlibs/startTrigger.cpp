@@ -0,0 +1,78 @@
+#include "startTrigger.h"
+
+StartTrigger::StartTrigger() {
+    this->pressed     = false;
+    this->pressTime   = 0;
+    this->source      = '-';
+    this->triggerTime = 0;
+    this->startTime   = 0;
+    this->startedTime = 0;
+}
+StartTrigger::~StartTrigger() {
+
+}
+
+void StartTrigger::begin(int pin) {
+    pinMode(pin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(pin), StartTrigger::isr, FALLING);
+}
+
+void StartTrigger::isr() {
+    //nur die erste Flanke zaehlt, bis sie abgeholt ist
+    if (!startTrigger->pressed) {
+        startTrigger->pressTime = micros();
+        startTrigger->pressed   = true;
+    }
+}
+
+void StartTrigger::clear() {
+    this->pressed = false;
+}
+
+bool StartTrigger::take(uint64_t *time) {
+    if (!this->pressed)
+        return false;
+
+    noInterrupts();
+    uint32_t pressTime = this->pressTime;
+    this->pressed = false;
+    interrupts();
+
+    //Abstand auf der 32-Bit-Uhr, die Flanke liegt hoechstens einen Ueberlauf zurueck
+    uint64_t now = cmn::micros64();
+    *time = now - (uint32_t)((uint32_t)now - pressTime);
+    return true;
+}
+
+uint64_t StartTrigger::trigger(char source, uint64_t time) {
+    this->source      = source;
+    this->triggerTime = time;
+    this->startTime   = time + START_LEAD;
+    this->startedTime = time;
+    return this->startTime;
+}
+
+void StartTrigger::started(uint64_t now) {
+    this->startedTime = now;
+}
+
+bool StartTrigger::isLate() const {
+    return this->startedTime > this->startTime;
+}
+
+char *StartTrigger::format(char out[], bool fired, long firstLatency) const {
+    memcpy(out, "trigger,", 8);
+    out += 8;
+    *out++ = this->source;
+    *out++ = ',';
+    out = cmn::formatInt(out, (long)(this->startTime - this->triggerTime), 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, (long)(this->startedTime - this->triggerTime), 0);
+    *out++ = ',';
+    if (fired)
+        out = cmn::formatInt(out, firstLatency, 0);
+    *out++ = '\n';
+    return out;
+}
+
+StartTrigger *startTrigger = new StartTrigger();
@@ -0,0 +1,57 @@
+#ifndef STARTTRIGGER_H
+#define STARTTRIGGER_H
+
+#include <Arduino.h>
+#include "../config.h"
+#include "common.h"
+
+// Startsignal der Messung und Zeitmessung des Starts, Antwort auf <trigger>. Der Taster
+// (START_BUTTON_PIN, gegen GND) loest einen Interrupt aus, der nur den Zeitpunkt der ersten Flanke
+// festhaelt; Prellen aendert ihn nicht mehr, bis main_labCom ihn mit take() abholt. Der Nullpunkt
+// der Messung liegt START_LEAD us hinter dem Startsignal (Taster, <start>), alles Aufwendige
+// (erste Events, Messdatei) ist vorher erledigt.
+// Textzeile:
+//   trigger,Quelle,Vorlauf-us,Vorbereitung-us,Erstes-Event-us
+// Quelle 'T' Taster, 'L' LabView, 'F' Messprogramm der SD-Karte, 'S' Startpuls des Masters (siehe
+// SyncPulse). Vorbereitung ist die Zeit vom
+// Startsignal bis alle Threads ihren Nullpunkt kennen, Erstes-Event die Schaltverzoegerung des
+// ersten ausgefuehrten Events (leer, solange keines ausgefuehrt ist).
+class StartTrigger {
+public:
+    //Defaultconstructor
+    StartTrigger();
+    //Destructor
+    ~StartTrigger();
+    //Richtet den Pin mit Pullup und den Interrupt auf die fallende Flanke ein
+    void begin(int pin);
+    //Verwirft einen Tasterdruck, der vor der Startbereitschaft kam
+    void clear();
+    //Holt einen Tasterdruck ab, 'time' ist sein Zeitpunkt auf der Uhr von cmn::micros64(). Gibt
+    //false zurueck, wenn der Taster seit dem letzten Aufruf nicht gedrueckt wurde
+    bool take(uint64_t *time);
+    //Startsignal aus 'source' zum Zeitpunkt 'time', gibt den Nullpunkt der Messung zurueck
+    uint64_t trigger(char source, uint64_t time);
+    //Alle Threads kennen den Nullpunkt (Ende von Main_LabCom::start()), Zeit in us
+    void started(uint64_t now);
+    //Gibt an, ob der Start laenger als START_LEAD gedauert hat
+    bool isLate() const;
+    //Schreibt die Textzeile mit '\n' nach out (hoechstens TRIGGER_LINE_SIZE Zeichen, ohne '\0'),
+    //'firstLatency' nur, wenn 'fired'. Gibt einen Zeiger dahinter zurueck
+    char *format(char out[], bool fired, long firstLatency) const;
+private:
+    //Interrupt des Tasters
+    static void isr();
+
+    volatile bool pressed;
+    volatile uint32_t pressTime; //micros() der ersten Flanke
+
+    char source;
+    uint64_t triggerTime;
+    uint64_t startTime;
+    uint64_t startedTime;
+};
+
+//Startsignal, auch fuer den Interrupt des Tasters
+extern StartTrigger *startTrigger;
+
+#endif
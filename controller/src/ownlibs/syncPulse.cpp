@@ -0,0 +1,243 @@
+#include "syncPulse.h"
+
+//Nachkommabits der Drift ('rate')
+#define SYNC_RATE_FRACTION 24
+
+SyncPulse::SyncPulse() {
+#if SYNC_MODE == SYNC_MODE_MASTER && !defined(KINETISK)
+    this->nextPulse     = 0;
+#endif
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    this->riseMicros    = 0;
+    this->startPending  = false;
+    this->startMicros   = 0;
+    this->pulsePending  = false;
+    this->pulseMicros   = 0;
+    this->anchorElapsed = 0;
+    this->anchorOffset  = 0;
+    this->rate          = 0;
+    this->lastIndex     = -1;
+    this->lastPulseTime = 0;
+    this->lost          = false;
+#endif
+    this->running       = false;
+    this->startTime     = 0;
+    this->pulses        = 0;
+    this->lastError     = 0;
+    this->maxError      = 0;
+}
+SyncPulse::~SyncPulse() {
+    this->stop();
+}
+
+void SyncPulse::begin() {
+#if SYNC_MODE == SYNC_MODE_MASTER
+    pinMode(SYNC_PIN, OUTPUT);
+    digitalWrite(SYNC_PIN, LOW);
+#elif SYNC_MODE == SYNC_MODE_SLAVE
+    pinMode(SYNC_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(SYNC_PIN), SyncPulse::edgeIsr, CHANGE);
+#endif
+}
+
+#if SYNC_MODE == SYNC_MODE_MASTER
+void SyncPulse::pulse() {
+    digitalWrite(SYNC_PIN, HIGH);
+    delayMicroseconds(SYNC_PULSE_WIDTH);
+    digitalWrite(SYNC_PIN, LOW);
+    this->pulses++;
+}
+
+#if defined(KINETISK)
+void SyncPulse::timerIsr() {
+    syncPulse->pulse();
+}
+#endif
+#endif
+
+#if SYNC_MODE == SYNC_MODE_SLAVE
+void SyncPulse::edgeIsr() {
+    uint32_t now = micros();
+    if (digitalRead(SYNC_PIN) == HIGH) {
+        syncPulse->riseMicros = now;
+        return;
+    }
+
+    //Die Breite unterscheidet Start- und Taktpuls, es zaehlt die steigende Flanke
+    if (now - syncPulse->riseMicros >= SYNC_START_WIDTH / 2) {
+        if (!syncPulse->startPending) { //nur der erste Startpuls, bis er abgeholt ist
+            syncPulse->startMicros  = syncPulse->riseMicros;
+            syncPulse->startPending = true;
+        }
+    } else {
+        syncPulse->pulseMicros  = syncPulse->riseMicros;
+        syncPulse->pulsePending = true;
+    }
+}
+#endif
+
+void SyncPulse::clear() {
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    this->startPending = false;
+#endif
+}
+
+uint64_t SyncPulse::sendStart() {
+    this->stop();
+    digitalWrite(SYNC_PIN, HIGH);
+    uint64_t time = cmn::micros64();
+    delayMicroseconds(SYNC_START_WIDTH);
+    digitalWrite(SYNC_PIN, LOW);
+    return time;
+}
+
+bool SyncPulse::takeStart(uint64_t *time) {
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    if (!this->startPending)
+        return false;
+
+    noInterrupts();
+    uint32_t startMicros = this->startMicros;
+    this->startPending = false;
+    interrupts();
+
+    //wie StartTrigger::take(), die Flanke liegt hoechstens einen Ueberlauf zurueck
+    uint64_t now = cmn::micros64();
+    *time = now - (uint32_t)((uint32_t)now - startMicros);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SyncPulse::start(uint64_t startTime) {
+    this->startTime = startTime;
+    this->pulses    = 0;
+    this->lastError = 0;
+    this->maxError  = 0;
+    this->running   = true;
+
+#if SYNC_MODE == SYNC_MODE_MASTER && defined(KINETISK)
+    //Der erste Puls liegt auf dem Nullpunkt, danach laedt der Timer SYNC_PERIOD nach
+    uint64_t now = cmn::micros64();
+    this->timer.priority(0); //wie ValveTimer, ein verzoegerter Puls verschiebt die Uhr der Slaves
+    this->timer.begin(SyncPulse::timerIsr, startTime > now ? (unsigned long)(startTime - now) : 1UL);
+    this->timer.update(SYNC_PERIOD);
+#elif SYNC_MODE == SYNC_MODE_MASTER
+    this->nextPulse = startTime;
+#elif SYNC_MODE == SYNC_MODE_SLAVE
+    noInterrupts();
+    this->anchorElapsed = 0;
+    this->anchorOffset  = 0;
+    interrupts();
+    this->pulsePending  = false;
+    this->lastIndex     = -1;
+    this->lastPulseTime = startTime;
+    this->lost          = false;
+#endif
+}
+
+void SyncPulse::stop() {
+#if SYNC_MODE == SYNC_MODE_MASTER && defined(KINETISK)
+    this->timer.end();
+#endif
+    this->running = false;
+}
+
+bool SyncPulse::update() {
+    if (!this->running)
+        return true;
+
+#if SYNC_MODE == SYNC_MODE_MASTER && !defined(KINETISK)
+    //ohne Timer so genau wie der Aufruf
+    if (cmn::micros64() >= this->nextPulse) {
+        this->pulse();
+        this->nextPulse += SYNC_PERIOD;
+    }
+#elif SYNC_MODE == SYNC_MODE_SLAVE
+    uint64_t now = cmn::micros64();
+    if (!this->pulsePending) {
+        if (this->lost || now <= this->lastPulseTime + (uint64_t)SYNC_TIMEOUT_PULSES * SYNC_PERIOD)
+            return true;
+        this->lost = true;
+        return false;
+    }
+
+    noInterrupts();
+    uint32_t pulseMicros = this->pulseMicros;
+    this->pulsePending = false;
+    interrupts();
+    uint64_t edge = now - (uint32_t)((uint32_t)now - pulseMicros);
+
+    //Nummer des Pulses: naechstes Vielfache von SYNC_PERIOD auf der Uhr des Masters. Der Versatz
+    //bleibt weit unter einer halben Periode
+    int64_t local   = (int64_t)(edge - this->startTime);
+    int64_t rounded = local - this->anchorOffset + SYNC_PERIOD / 2;
+    if (rounded < 0 || rounded / SYNC_PERIOD <= this->lastIndex)
+        return true;
+    long index = rounded / SYNC_PERIOD;
+
+    uint64_t elapsed = (uint64_t)index * SYNC_PERIOD;
+    int64_t measured = local - (int64_t)elapsed;
+    int64_t residual = measured - this->getOffset(elapsed);
+
+    //Der Rest seit dem letzten Puls ist die noch nicht erfasste Drift
+    int64_t rate = this->rate;
+    if (this->lastIndex >= 0 && elapsed > this->anchorElapsed) {
+        const int64_t maxRate = ((int64_t)SYNC_MAX_DRIFT << SYNC_RATE_FRACTION) / 1000000;
+        rate += (residual * (1LL << SYNC_RATE_FRACTION) / (int64_t)(elapsed - this->anchorElapsed)) / (1 << SYNC_RATE_GAIN_SHIFT);
+        rate = rate > maxRate ? maxRate : rate < -maxRate ? -maxRate : rate;
+    }
+
+    //Der Interrupt der Ventile rechnet mit diesen Werten
+    noInterrupts();
+    this->anchorElapsed = elapsed;
+    this->anchorOffset  = measured;
+    this->rate          = rate;
+    interrupts();
+
+    this->lastIndex     = index;
+    this->lastPulseTime = edge;
+    this->pulses++;
+    this->lastError = (long)residual;
+    if (labs(this->lastError) > this->maxError)
+        this->maxError = labs(this->lastError);
+
+    bool wasLost = this->lost;
+    this->lost = labs(this->lastError) > SYNC_MAX_ERROR;
+    return !this->lost || wasLost;
+#endif
+    return true;
+}
+
+int64_t SyncPulse::getOffset(uint64_t elapsed) const {
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    //Schieben statt Teilen, im Interrupt der Ventile ohne 64-Bit-Division
+    int64_t delta = (int64_t)(elapsed - this->anchorElapsed);
+    return this->anchorOffset + ((delta * this->rate) >> SYNC_RATE_FRACTION);
+#else
+    return 0;
+#endif
+}
+
+char *SyncPulse::format(char out[]) const {
+    memcpy(out, "sync,", 5);
+    out += 5;
+    *out++ = SYNC_MODE == SYNC_MODE_MASTER ? 'M' : SYNC_MODE == SYNC_MODE_SLAVE ? 'S' : '-';
+    *out++ = ',';
+    out = cmn::formatInt(out, this->pulses, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->lastError, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->maxError, 0);
+    *out++ = ',';
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    out = cmn::formatInt(out, (long)(this->rate * 1000000000LL / (1LL << SYNC_RATE_FRACTION)), 0);
+#else
+    out = cmn::formatInt(out, 0, 0);
+#endif
+    *out++ = '\n';
+    return out;
+}
+
+SyncPulse *syncPulse = new SyncPulse();
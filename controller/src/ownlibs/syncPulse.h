@@ -0,0 +1,93 @@
+#ifndef SYNCPULSE_H
+#define SYNCPULSE_H
+
+#include <Arduino.h>
+#include "../config.h"
+#include "common.h"
+
+// Gemeinsame Zeitbasis mehrerer Steuerungen ueber eine Leitung am SYNC_PIN (SYNC_MODE). Der Master
+// gibt beim Start einen Startpuls (SYNC_START_WIDTH) aus, der Nullpunkt aller Steuerungen liegt
+// START_LEAD us hinter seiner steigenden Flanke. Ab dem Nullpunkt folgt alle SYNC_PERIOD ein
+// Taktpuls (SYNC_PULSE_WIDTH), beim Teensy aus einem Timer-Interrupt. Der Slave haelt im Interrupt
+// beider Flanken die Zeit der steigenden fest und unterscheidet Start- und Taktpuls an der Breite.
+// Aus den Taktpulsen fuehrt er Versatz und Drift seiner Uhr gegenueber der des Masters nach,
+// cmn::programMicros() rechnet damit jede Programmzeit auf die eigene Uhr um: der Versatz wird mit
+// jedem Puls neu gesetzt, dazwischen mit der Drift fortgeschrieben. micros64() selbst bleibt
+// unveraendert, die Threads planen weiter mit der eigenen Uhr.
+// Textzeile:
+//   sync,Modus,Pulse,Abweichung-us,Groesste-us,Drift-ppb
+// Modus 'M' Master, 'S' Slave, '-' aus. Abweichung ist die des letzten Taktpulses von der
+// nachgefuehrten Uhr, Drift die geschaetzte Abweichung der eigenen Uhr (nur beim Slave).
+class SyncPulse {
+public:
+    //Defaultconstructor
+    SyncPulse();
+    //Destructor
+    ~SyncPulse();
+    //Richtet den SYNC_PIN ein: Ausgang beim Master, Eingang mit Interrupt auf beide Flanken beim Slave
+    void begin();
+    //Verwirft einen Startpuls, der vor der Startbereitschaft kam (Slave)
+    void clear();
+    //Beendet einen laufenden Takt und gibt den Startpuls aus (Master, blockiert SYNC_START_WIDTH us).
+    //Gibt den Zeitpunkt der steigenden Flanke auf der Uhr von cmn::micros64() zurueck
+    uint64_t sendStart();
+    //Holt einen Startpuls ab, 'time' ist seine steigende Flanke (cmn::micros64()). Gibt false zurueck,
+    //wenn seit dem letzten Aufruf keiner kam (Slave)
+    bool takeStart(uint64_t *time);
+    //Nullpunkt der Messung: der Master beginnt den Takt, der Slave wertet ab hier Taktpulse aus. Die
+    //Drift des Slaves bleibt von der vorherigen Messung erhalten
+    void start(uint64_t startTime);
+    //Beendet Takt bzw. Auswertung, die zuletzt nachgefuehrte Uhr gilt weiter
+    void stop();
+    //Aus Main_LabCom, mindestens alle SERIAL_POLL_INTERVALL: der Slave wertet einen neuen Taktpuls
+    //aus, ohne KINETISK gibt hier der Master den Takt aus. Gibt false zurueck, wenn die
+    //Synchronisation gerade verloren ging (Abweichung ueber SYNC_MAX_ERROR oder SYNC_TIMEOUT_PULSES
+    //Taktpulse ausgeblieben), gemeldet wird erst wieder nach einem gueltigen Puls
+    bool update();
+    //Abweichung (us) der eigenen Uhr von der des Masters 'elapsed' us nach dem Nullpunkt (Slave, sonst 0).
+    //Auch im Interrupt, update() aendert die Werte nur mit gesperrten Interrupts
+    int64_t getOffset(uint64_t elapsed) const;
+    //Schreibt die Textzeile mit '\n' nach out (hoechstens SYNC_LINE_SIZE Zeichen, ohne '\0'),
+    //gibt einen Zeiger dahinter zurueck
+    char *format(char out[]) const;
+private:
+#if SYNC_MODE == SYNC_MODE_MASTER
+    //Gibt einen Taktpuls aus
+    void pulse();
+#if defined(KINETISK)
+    //Interrupt des Timers, ein Taktpuls
+    static void timerIsr();
+    IntervalTimer timer;
+#else
+    uint64_t nextPulse; //Zeitpunkt des naechsten Taktpulses (cmn::micros64())
+#endif
+#endif
+#if SYNC_MODE == SYNC_MODE_SLAVE
+    //Interrupt beider Flanken am SYNC_PIN
+    static void edgeIsr();
+    volatile uint32_t riseMicros;  //micros() der letzten steigenden Flanke
+    volatile bool startPending;
+    volatile uint32_t startMicros; //steigende Flanke des Startpulses, bis er abgeholt ist
+    volatile bool pulsePending;
+    volatile uint32_t pulseMicros; //steigende Flanke des letzten Taktpulses
+
+    //Nachgefuehrte Uhr: Versatz 'anchorOffset' beim Taktpuls 'anchorElapsed' (us nach dem Nullpunkt),
+    //danach 'rate' us je us (Festkomma mit 24 Nachkommabits)
+    uint64_t anchorElapsed;
+    int64_t anchorOffset;
+    int64_t rate;
+    long lastIndex;         //Nummer des letzten ausgewerteten Taktpulses, -1 keiner
+    uint64_t lastPulseTime; //seine steigende Flanke, anfangs der Nullpunkt
+    bool lost;
+#endif
+    bool running;
+    uint64_t startTime;
+    volatile unsigned long pulses; //ausgegebene (Master) bzw. ausgewertete (Slave) Taktpulse
+    long lastError;
+    long maxError;
+};
+
+//Synchronisation mit anderen Steuerungen, auch fuer den Interrupt
+extern SyncPulse *syncPulse;
+
+#endif
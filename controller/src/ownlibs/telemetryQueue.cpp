@@ -0,0 +1,93 @@
+#include "telemetryQueue.h"
+
+TelemetryQueue::TelemetryQueue() {
+    this->readIndex       = 0;
+    this->writeIndex      = 0;
+    this->sendOffset      = 0;
+    this->decimateCounter = 0;
+
+    this->dropped   = 0;
+    this->decimated = 0;
+}
+TelemetryQueue::~TelemetryQueue() {
+
+}
+
+bool TelemetryQueue::push(const char data[], int length) {
+    if (length > STRINGBUILDER_LINE_SIZE)
+        length = STRINGBUILDER_LINE_SIZE;
+
+    unsigned int fill = this->writeIndex - this->readIndex;
+
+#if TELEMETRY_POLICY == TELEMETRY_DECIMATE
+    //Ab halbvoller Warteschlange wird nur noch jede TELEMETRY_DECIMATE_FACTOR-te Zeile uebernommen
+    if (fill >= TELEMETRY_QUEUE_SIZE / 2) {
+        this->decimateCounter++;
+        if (this->decimateCounter < TELEMETRY_DECIMATE_FACTOR) {
+            this->decimated++;
+            return false;
+        }
+    }
+    this->decimateCounter = 0;
+#endif
+
+    if (fill >= TELEMETRY_QUEUE_SIZE) {
+#if TELEMETRY_POLICY == TELEMETRY_DROP_OLDEST
+        //Die aelteste Zeile weicht. Wird sie gerade ausgegeben, ersetzt sie stattdessen die zweitaelteste
+        if (this->sendOffset > 0) {
+            unsigned int current = this->readIndex % TELEMETRY_QUEUE_SIZE;
+            unsigned int next    = (this->readIndex + 1) % TELEMETRY_QUEUE_SIZE;
+            memcpy(this->lines[next], this->lines[current], this->lengths[current]);
+            this->lengths[next] = this->lengths[current];
+        }
+        this->readIndex++;
+        this->dropped++;
+#else
+        this->dropped++;
+        return false;
+#endif
+    }
+
+    unsigned int slot = this->writeIndex % TELEMETRY_QUEUE_SIZE;
+    memcpy(this->lines[slot], data, length);
+    this->lengths[slot] = length;
+    this->writeIndex++;
+    return true;
+}
+
+void TelemetryQueue::drain(Print *output) {
+    while (this->readIndex != this->writeIndex) {
+        unsigned int slot = this->readIndex % TELEMETRY_QUEUE_SIZE;
+        int length = this->lengths[slot] - this->sendOffset;
+
+        int space = output->availableForWrite();
+        if (space <= 0)
+            return;
+        if (length > space)
+            length = space;
+
+        output->write((const uint8_t *)&this->lines[slot][this->sendOffset], length);
+        this->sendOffset += length;
+
+        if (this->sendOffset < this->lengths[slot]) //Rest im naechsten Durchlauf
+            return;
+        this->sendOffset = 0;
+        this->readIndex++;
+    }
+}
+
+bool TelemetryQueue::isPending() {
+    return this->readIndex != this->writeIndex;
+}
+
+bool TelemetryQueue::isInLine() {
+    return this->sendOffset != 0;
+}
+
+unsigned long TelemetryQueue::getDropped() {
+    return this->dropped;
+}
+
+unsigned long TelemetryQueue::getDecimated() {
+    return this->decimated;
+}
@@ -0,0 +1,41 @@
+#ifndef TELEMETRYQUEUE_H
+#define TELEMETRYQUEUE_H
+
+#include <Arduino.h>
+#include "../config.h"
+
+// Begrenzte Warteschlange fuer Messzeilen an LabView. Jede Zeile belegt einen Platz, ist die
+// Warteschlange voll, entscheidet TELEMETRY_POLICY, welche Zeile verworfen wird. drain() schreibt
+// nur so viel, wie die Schnittstelle ohne Warten annimmt. Eine begonnene Zeile wird immer
+// vollstaendig ausgegeben, damit LabView keine abgeschnittenen Zeilen erhaelt.
+class TelemetryQueue {
+public:
+    //Defaultconstructor
+    TelemetryQueue();
+    //Destructor
+    ~TelemetryQueue();
+    //Kopiert eine Zeile in die Warteschlange. Gibt false zurueck, wenn die Zeile verworfen wurde
+    bool push(const char data[], int length);
+    //Schreibt wartende Zeilen auf 'output', ohne zu blockieren
+    void drain(Print *output);
+    //Gibt an, ob Zeilen auf die Ausgabe warten
+    bool isPending();
+    //Gibt an, ob gerade eine Zeile zum Teil ausgegeben ist (andere Ausgaben muessen warten)
+    bool isInLine();
+    //Zaehler fuer die Meldung an LabView
+    unsigned long getDropped();   //wegen voller Warteschlange verworfene Zeilen
+    unsigned long getDecimated(); //bei TELEMETRY_DECIMATE ausgelassene Zeilen
+private:
+    char lines[TELEMETRY_QUEUE_SIZE][STRINGBUILDER_LINE_SIZE];
+    int lengths[TELEMETRY_QUEUE_SIZE];
+    //Indizes laufen frei und werden modulo Groesse verwendet
+    unsigned int readIndex;  //aelteste Zeile, wird gerade ausgegeben
+    unsigned int writeIndex; //naechster freier Platz
+    int sendOffset;          //bereits ausgegebene Zeichen der aeltesten Zeile
+    unsigned int decimateCounter;
+
+    unsigned long dropped;
+    unsigned long decimated;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "uploadStats.h"
+
+UploadStats::UploadStats() {
+    this->begin(0);
+}
+UploadStats::~UploadStats() {
+
+}
+
+void UploadStats::begin(unsigned long now) {
+    this->startTime = now;
+    for (int i = 0; i < UPLOAD_PHASES; i++) {
+        this->phaseEnd[i] = now;
+        this->phaseFinished[i] = false;
+    }
+    this->lines = 0;
+    this->events = 0;
+    this->bytes = 0;
+    this->busy = 0;
+}
+
+void UploadStats::addInput(unsigned long bytes, unsigned long duration) {
+    this->bytes += bytes;
+    this->busy += duration;
+}
+
+void UploadStats::addLine() {
+    this->lines++;
+}
+
+void UploadStats::addEvents(unsigned long events) {
+    this->events += events;
+}
+
+void UploadStats::finishPhase(int phase, unsigned long now) {
+    for (int i = 0; i <= phase; i++) {
+        if (!this->phaseFinished[i]) {
+            this->phaseEnd[i] = now;
+            this->phaseFinished[i] = true;
+        }
+    }
+}
+
+unsigned long UploadStats::getPhaseTime(int phase) {
+    if (phase > 0 && !this->phaseFinished[phase - 1])
+        return 0;
+    unsigned long begin = (phase == 0) ? this->startTime : this->phaseEnd[phase - 1];
+    unsigned long end = this->phaseFinished[phase] ? this->phaseEnd[phase] : micros();
+    return end - begin;
+}
+
+char *UploadStats::format(char out[]) {
+    unsigned long eventTime = this->getPhaseTime(UPLOAD_EVENTS);
+    unsigned long totalTime = 0;
+    for (int i = 0; i < UPLOAD_PHASES; i++)
+        totalTime += this->getPhaseTime(i);
+
+    memcpy(out, "upload,", 7);
+    out += 7;
+    out = cmn::formatInt(out, this->lines, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->events, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->bytes, 0);
+    for (int i = 0; i < UPLOAD_PHASES; i++) {
+        *out++ = ',';
+        out = cmn::formatInt(out, this->getPhaseTime(i), 0);
+    }
+    *out++ = ',';
+    out = cmn::formatInt(out, this->busy, 0);
+    //Raten mit 64 bit, damit lange Uebertragungen nicht ueberlaufen
+    *out++ = ',';
+    out = cmn::formatInt(out, eventTime > 0 ? (long)(this->events * 1000000ULL / eventTime) : 0, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, totalTime > 0 ? (long)(this->bytes * 1000000ULL / totalTime) : 0, 0);
+    *out++ = ',';
+    out = cmn::formatInt(out, this->lines > 0 ? (long)((this->busy + this->lines / 2) / this->lines) : 0, 0);
+    *out++ = '\n';
+    return out;
+}
@@ -0,0 +1,51 @@
+#ifndef UPLOADSTATS_H
+#define UPLOADSTATS_H
+
+#include <Arduino.h>
+#include "../config.h"
+#include "common.h"
+
+// Zeitmessung beim Einlesen eines Messprogramms, Antwort auf <upload>. Erfasst werden je Abschnitt
+// (Header bis <begin>, Eventliste bis <end>, Abschluss durch <end>) die vergangene Zeit, dazu die
+// Rechenzeit fuer das Lesen und Verarbeiten, die empfangenen Bytes, Zeilen bzw. Frames und Events.
+// Textzeile:
+//   upload,Zeilen,Events,Bytes,Header-us,Events-us,Ende-us,Rechenzeit-us,Events/s,Bytes/s,us/Zeile
+// Events/s bezieht sich auf die Eventliste, Bytes/s auf die gesamte Uebertragung, us/Zeile ist die
+// mittlere Rechenzeit je Zeile (ohne das Warten auf Zeichen).
+class UploadStats {
+public:
+    //Abschnitte der Uebertragung
+    enum phases {UPLOAD_HEADER, UPLOAD_EVENTS, UPLOAD_END, UPLOAD_PHASES};
+
+    //Defaultconstructor
+    UploadStats();
+    //Destructor
+    ~UploadStats();
+    //Beginnt eine neue Messung mit dem ersten empfangenen Zeichen (Zeit in us)
+    void begin(unsigned long now);
+    //Empfangene Bytes und die Rechenzeit in us, die ihr Lesen und Verarbeiten gekostet hat
+    void addInput(unsigned long bytes, unsigned long duration);
+    //Vollstaendig verarbeitete Zeile bzw. Frame
+    void addLine();
+    //Gespeicherte Events
+    void addEvents(unsigned long events);
+    //Abschnitt ist beendet (Zeit in us), z.B. UPLOAD_HEADER bei <begin>. Uebersprungene Abschnitte
+    //davor enden zur selben Zeit
+    void finishPhase(int phase, unsigned long now);
+    //Schreibt die Statistik als Textzeile mit '\n' nach out (hoechstens UPLOAD_LINE_SIZE Zeichen,
+    //ohne '\0'), gibt einen Zeiger dahinter zurueck. Der laufende Abschnitt zaehlt bis jetzt
+    char *format(char out[]);
+private:
+    //Vergangene Zeit eines Abschnitts in us, 0 wenn er noch nicht begonnen hat
+    unsigned long getPhaseTime(int phase);
+
+    unsigned long startTime;
+    unsigned long phaseEnd[UPLOAD_PHASES];
+    bool phaseFinished[UPLOAD_PHASES];
+    unsigned long lines;
+    unsigned long events;
+    unsigned long bytes;
+    unsigned long busy; //Rechenzeit in us
+};
+
+#endif
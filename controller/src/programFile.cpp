@@ -0,0 +1,89 @@
+#include "programFile.h"
+
+namespace storage {
+    ProgramFile::ProgramFile() {
+        this->opened   = false;
+        this->finished = true;
+        this->length   = 0;
+        this->position = 0;
+        this->consumed = 0;
+    }
+    ProgramFile::~ProgramFile() {
+        this->close();
+    }
+
+    bool ProgramFile::open(StoreD *storeD, const char name[]) {
+        this->close();
+        if (!storeD->openForReading(&this->file, name))
+            return false;
+
+        this->opened   = true;
+        this->finished = false;
+        this->length   = 0;
+        this->position = 0;
+        this->consumed = 0;
+        return true;
+    }
+
+    void ProgramFile::close() {
+        if (this->opened)
+            this->file.close();
+        this->opened   = false;
+        this->finished = true;
+        this->length   = 0;
+        this->position = 0;
+    }
+
+    bool ProgramFile::isOpen() {
+        return this->opened;
+    }
+
+    bool ProgramFile::isFinished() {
+        return this->finished;
+    }
+
+    unsigned long ProgramFile::getPosition() {
+        return this->consumed + this->position;
+    }
+
+    unsigned long ProgramFile::getSize() {
+        return this->opened ? this->file.fileSize() : 0;
+    }
+
+    bool ProgramFile::fill() {
+        if (this->finished)
+            return false;
+
+        this->consumed += this->length;
+        this->position = 0;
+        int result = this->file.read(this->buffer, SD_BLOCK_SIZE);
+        this->length = (result > 0) ? result : 0;
+        if (result < 0)
+            srl->errorln("ERROR - Messprogramm auf der SD-Karte nicht lesbar");
+        if (this->length == 0)
+            this->finished = true;
+        return this->length > 0;
+    }
+
+    int ProgramFile::available() {
+        if (this->position >= this->length && !this->fill())
+            return 0;
+        return this->length - this->position;
+    }
+
+    int ProgramFile::read() {
+        if (this->available() == 0)
+            return -1;
+        return (unsigned char)this->buffer[this->position++];
+    }
+
+    int ProgramFile::peek() {
+        if (this->available() == 0)
+            return -1;
+        return (unsigned char)this->buffer[this->position];
+    }
+
+    size_t ProgramFile::write(uint8_t c) {
+        return 0;
+    }
+}
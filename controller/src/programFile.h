@@ -0,0 +1,55 @@
+#ifndef PROGRAMFILE_H
+#define PROGRAMFILE_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "config.h"
+#include "StoreD.h"
+
+namespace storage {
+    // Messprogramm auf der SD-Karte (SD_PROGRAM_FILE), gelesen als Stream wie die Verbindung zu
+    // LabView. Die Datei wird nicht vollstaendig geladen: es liegt immer nur ein Block von
+    // SD_BLOCK_SIZE Bytes im Speicher, der naechste wird gelesen, sobald der Block verbraucht ist.
+    // Die Karte gehoert StoreD, geoeffnet wird ueber dessen Hauptverzeichnis.
+    class ProgramFile : public Stream {
+    public:
+        //Defaultconstructor
+        ProgramFile();
+        //Destructor
+        ~ProgramFile();
+        //Oeffnet die Datei ueber die Karte von storeD. Gibt false zurueck, wenn sie nicht vorhanden ist
+        bool open(StoreD *storeD, const char name[]);
+        //Schliesst die Datei, danach liefert available() 0
+        void close();
+        //Die Datei ist geoeffnet (auch wenn schon alles gelesen wurde)
+        bool isOpen();
+        //Alle Zeichen wurden gelesen
+        bool isFinished();
+        //Gelesene Zeichen und Dateigroesse
+        unsigned long getPosition();
+        unsigned long getSize();
+
+        //Laedt den naechsten Block, wenn der aktuelle verbraucht ist. Ein Block wird auf einmal
+        //gelesen, danach kommen die Zeichen aus dem Speicher
+        virtual int available();
+        virtual int read();
+        virtual int peek();
+        //Die Datei wird nur gelesen
+        virtual size_t write(uint8_t c);
+        using Print::write;
+    private:
+        //Liest den naechsten Block, gibt false am Dateiende oder bei einem Lesefehler zurueck
+        bool fill();
+
+        SdFile file;
+        bool opened;
+        bool finished;
+        char buffer[SD_BLOCK_SIZE];
+        int length;   //gueltige Bytes im Puffer
+        int position; //naechstes Byte im Puffer
+        unsigned long consumed; //Bytes vor dem aktuellen Block
+    };
+}
+
+#endif
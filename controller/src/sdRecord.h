@@ -0,0 +1,53 @@
+#ifndef SDRECORD_H
+#define SDRECORD_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+namespace storage {
+    // Binaeres Format der Messdateien (SD_BINARY_RECORDS 1), alle Werte little endian.
+    // Jede Datei beginnt mit einem sdFileHeader, gefolgt von amountMFC Typnamen zu je
+    // SD_RECORD_TYPE_SIZE Zeichen. Danach folgen Datensaetze fester Laenge:
+    //   uint32 Zeit (ms seit Start) | int16 Wert je MFC | Ventile (Bit = Ventil-ID) | int32 Boschsensor
+    // Die Ventile belegen sdValveBytes(amountValve) Bytes, bis 16 Ventile ein uint16.
+    // Bei BOSCH_REDUCE_MINMAX folgt ein zweiter int32 mit dem Maximum, der erste ist das Minimum.
+    // Wird die Messung mit <stop> beendet, folgt am Dateiende die Schaltverzoegerung: je ein Datensatz
+    // mit LATENCY_RECORD_SIZE Bytes (siehe ownlibs/latencyStats.h) fuer alle Events, jeden MFC und jedes
+    // Ventil, abgeschlossen von einem sdFileFooter. Er steht in den letzten 12 Bytes der Datei.
+    // Im Textformat stehen stattdessen Zeilen "latency,..." am Ende.
+    // Das Skript sd_decoder_script/decode_storeD.py wandelt die Datei in die Textdarstellung um.
+    typedef struct sdFileHeaderStruct {
+        char magic[4];          //"MSD", wird mit '\0' abgeschlossen
+        uint8_t version;        //SD_RECORD_VERSION
+        uint8_t amountMFC;
+        uint8_t amountValve;
+        uint8_t boschReduction; //BOSCH_REDUCTION, frueher reserviert (0 = Mittelwert, eine Spalte)
+        uint32_t intervall;     //Messintervall in ms
+        uint32_t startTime;     //millis() beim Start der Messung
+    } sdFileHeader;             //16 Byte, die Reihenfolge vermeidet Fuellbytes
+
+    static_assert(sizeof(sdFileHeader) == 16, "sdFileHeader darf keine Fuellbytes enthalten");
+
+    typedef struct sdFileFooterStruct {
+        uint8_t amountStats;    //Anzahl der Statistiken davor
+        uint8_t reserved;
+        uint16_t recordSize;    //LATENCY_RECORD_SIZE
+        uint32_t length;        //Bytes des Dateiendes einschliesslich sdFileFooter
+        char magic[4];          //"MSF", wird mit '\0' abgeschlossen
+    } sdFileFooter;             //12 Byte
+
+    static_assert(sizeof(sdFileFooter) == 12, "sdFileFooter darf keine Fuellbytes enthalten");
+
+    //Bytes der Ventilmaske im Datensatz (und in den Telemetrieframes), mindestens 2
+    constexpr int sdValveBytes(int amountValve) {
+        return amountValve <= 16 ? 2 : (amountValve + 7) / 8;
+    }
+
+    //Laenge eines Datensatzes bei gegebener Anzahl MFCs und Ventile
+    constexpr int sdRecordSize(int amountMFC, int amountValve) {
+        return 4 + 2 * amountMFC + sdValveBytes(amountValve) + 4 * BOSCH_VALUES;
+    }
+}
+
+#endif
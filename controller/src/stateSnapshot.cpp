@@ -0,0 +1,80 @@
+#include "stateSnapshot.h"
+#include "ownlibs/common.h"
+
+namespace control {
+    StateSnapshot::StateSnapshot() {
+        this->state.sequence    = 0;
+        this->state.amountMFC   = 0;
+        this->state.amountValve = 0;
+        this->state.valveMask   = 0;
+        for (int i = 0; i < MAX_AMOUNT_MFC; i++) {
+            this->state.mfcValues[i] = 0;
+            this->state.mfcFlows[i]  = 0;
+        }
+    }
+    StateSnapshot::~StateSnapshot() {
+
+    }
+
+    void StateSnapshot::beginWrite() {
+        this->state.sequence++;
+        COMPILER_BARRIER();
+    }
+
+    void StateSnapshot::endWrite() {
+        COMPILER_BARRIER();
+        this->state.sequence++;
+    }
+
+    void StateSnapshot::setAmountMFC(int amount) {
+        this->beginWrite();
+        this->state.amountMFC = amount;
+        this->endWrite();
+    }
+
+    void StateSnapshot::setAmountValve(int amount) {
+        this->beginWrite();
+        this->state.amountValve = amount;
+        this->endWrite();
+    }
+
+    void StateSnapshot::setMfcValue(int mfcID, int value) {
+        this->beginWrite();
+        this->state.mfcValues[mfcID] = value;
+        this->endWrite();
+    }
+
+    void StateSnapshot::setMfcFlow(int mfcID, int flow) {
+        this->beginWrite();
+        this->state.mfcFlows[mfcID] = flow;
+        this->endWrite();
+    }
+
+    void StateSnapshot::setValves(valveBits mask, valveBits values) {
+        this->beginWrite();
+        this->state.valveMask = (this->state.valveMask & ~mask) | (values & mask);
+        this->endWrite();
+    }
+
+    void StateSnapshot::read(stateSnapshot *snapshot) {
+        uint32_t sequence;
+        do {
+            sequence = this->state.sequence;
+            COMPILER_BARRIER();
+
+            snapshot->amountMFC   = this->state.amountMFC;
+            snapshot->amountValve = this->state.amountValve;
+            snapshot->valveMask   = this->state.valveMask;
+            for (int i = 0; i < snapshot->amountMFC; i++) {
+                snapshot->mfcValues[i] = this->state.mfcValues[i];
+                snapshot->mfcFlows[i]  = this->state.mfcFlows[i];
+            }
+
+            COMPILER_BARRIER();
+        } while ((sequence & 1) || sequence != this->state.sequence); //waehrend des Kopierens geaendert
+
+        snapshot->sequence = sequence;
+    }
+}
+
+control::StateSnapshot *currentState = new control::StateSnapshot();
@@ -0,0 +1,63 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#include <type_traits>
+
+namespace control {
+    static_assert(MAX_AMOUNT_VALVE <= 64, "Die Ventilmaske hat hoechstens 64 Bit");
+
+    //Bitmaske ueber alle Ventile (Bit = Ventil-ID), so breit wie MAX_AMOUNT_VALVE es verlangt
+    template <int CHANNELS>
+    using channelBits = typename std::conditional<(CHANNELS <= 16), uint16_t,
+                        typename std::conditional<(CHANNELS <= 32), uint32_t, uint64_t>::type>::type;
+    typedef channelBits<MAX_AMOUNT_VALVE> valveBits;
+
+    //Zusammenhaengender Zustand aller MFCs und Ventile zu einem Zeitpunkt
+    typedef struct stateSnapshotStruct {
+        uint32_t sequence;                //gerade Zahl, aendert sich mit jeder Aenderung des Zustands
+        uint8_t amountMFC;
+        uint8_t amountValve;
+        valveBits valveMask;              //Bit = Ventil-ID, 1 = offen
+        int16_t mfcValues[MAX_AMOUNT_MFC]; //Soll-Werte der MFCs
+        int16_t mfcFlows[MAX_AMOUNT_MFC];  //gemessener Durchfluss (MFC_BUS_READBACK)
+    } stateSnapshot;
+
+    // Haelt den aktuellen Zustand und gibt ihn ueber ein Seqlock konsistent heraus. Schreiber
+    // setzen die Sequenznummer vor und nach der Aenderung hoch, ungerade bedeutet "wird gerade
+    // geschrieben". Der Leser kopiert und wiederholt, falls sich die Nummer dabei geaendert hat.
+    // Threads unterbrechen sich nicht gegenseitig (kooperativ), unterbrechen kann nur der
+    // Ventil-Timer, der ausschliesslich die Ventilmaske schreibt. Interrupts werden nie gesperrt.
+    class StateSnapshot {
+    public:
+        //Defaultconstructor
+        StateSnapshot();
+        //Destructor
+        ~StateSnapshot();
+        //Anzahl der MFCs bzw. Ventile, wird beim Erstellen der Objekte gesetzt
+        void setAmountMFC(int amount);
+        void setAmountValve(int amount);
+        //Setzt den Soll-Wert eines MFCs
+        void setMfcValue(int mfcID, int value);
+        //Setzt den gemessenen Durchfluss eines MFCs
+        void setMfcFlow(int mfcID, int flow);
+        //Setzt die Ventile aus 'mask' auf die Werte aus 'values' (Bit = Ventil-ID), auch im Interrupt
+        void setValves(valveBits mask, valveBits values);
+        //Kopiert einen konsistenten Zustand nach 'snapshot'. Nur aus Threads aufrufen, nicht im Interrupt
+        void read(stateSnapshot *snapshot);
+    private:
+        //Beginn und Ende einer Aenderung
+        void beginWrite();
+        void endWrite();
+
+        volatile stateSnapshot state;
+    };
+}
+
+//Gemeinsamer Zustand, geschrieben von MFC/Ventil/Ventil-Timer, gelesen von StringBuilder
+extern control::StateSnapshot *currentState;
+
+#endif
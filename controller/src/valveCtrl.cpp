@@ -1,20 +1,25 @@
 #include "valveCtrl.h"
 
 namespace control {
-    ValveCtrl::ValveCtrl(int id) {
+    ValveCtrl::ValveCtrl(int id, uint8_t eventMemory[], int eventBytes) {
         this->id = id;
 
+        //Eventspeicher wird einmalig uebergeben, danach wird nicht mehr allokiert
+        this->eventList.init(eventMemory, eventBytes, EVENT_VALUE_BITS_VALVE);
+
         //setze defaultwerte für das "nextEvent"
         this->nextEvent.value = -1;
-        this->nextEvent.time  = -1;
+        this->nextEvent.time  = 0;
 
+        this->hasNext = false;
         this->ready = false;
+        this->streaming = false;
 
         this->currentValue = 0;
 
-        srl->print('D', "Ventil ");
-        srl->print('D', this->id);
-        srl->println('D', " erstellt.");
+        srl->info("Ventil ");
+        srl->info(this->id);
+        srl->infoln(" erstellt.");
     }
     ValveCtrl::~ValveCtrl() {
 
@@ -23,32 +28,54 @@ namespace control {
     void ValveCtrl::setPin(int pin) {
         this->pin = pin;
 
-        pinMode(this->pin, OUTPUT);
+        srl->info("Ventil ");
+        srl->info(this->id);
+        srl->info(" Pin: ");
+        srl->infoln(this->pin);
+    }
 
-        srl->print('D', "Ventil ");
-        srl->print('D', this->id);
-        srl->print('D', " Pin: ");
-        srl->println('D', this->pin);
+    int ValveCtrl::getPin() {
+        return this->pin;
     }
 
-    void ValveCtrl::setEvent(int value, unsigned long time) {
+    bool ValveCtrl::setEvent(int value, unsigned long time) {
         eventElement newEvent; //Erstelle neue Datenstruktur
-        newEvent.value = value;
-        newEvent.time  = time;
+        newEvent.value    = value;
+        newEvent.time     = time;
+        newEvent.rampStep = 0;
+
+        srl->trace("Ventil ");
+        srl->trace(this->id);
+        srl->trace(" Neues Event: ");
+        srl->trace(newEvent.value);
+        srl->trace(", ");
+        srl->traceln(newEvent.time);
+
+        return this->eventList.push(newEvent); //Speichere Datenstruktur im Ringpuffer
+    }
 
-        srl->print('D', "Ventil ");
-        srl->print('D', this->id);
-        srl->print('D', " Neues Event: ");
-        srl->print('D', newEvent.value);
-        srl->print('D', ", ");
-        srl->println('D', newEvent.time);
+    bool ValveCtrl::setRepeat(unsigned long count, unsigned long period) {
+        return this->eventList.pushRepeat(count, period);
+    }
 
-        this->eventList.push(newEvent); //Speichere Datenstruktur in einer Liste
+    bool ValveCtrl::endRepeat() {
+        return this->eventList.pushEndRepeat();
     }
 
-    void ValveCtrl::start(unsigned long startTime) {
+    void ValveCtrl::start(uint64_t startTime) {
         this->startTime = startTime;
         this->ready = true;
+        this->latency.reset();
+    }
+
+    void ValveCtrl::markProgram() {
+        this->program = this->eventList;
+    }
+
+    void ValveCtrl::rewind() {
+        this->eventList = this->program;
+        this->ready   = false;
+        this->hasNext = false;
     }
 
     void ValveCtrl::setMainDisplayObjectPointer(io::Main_Display *main_display) {
@@ -59,42 +86,120 @@ namespace control {
         return this->currentValue;
     }
 
-    bool ValveCtrl::compute() {
+    uint64_t ValveCtrl::getNextEventTime() {
+        return cmn::eventMicros(this->startTime, this->nextEvent.time);
+    }
+
+    eventElement ValveCtrl::getNextEvent() {
+        return this->nextEvent;
+    }
+
+    bool ValveCtrl::hasEvent() {
+        return this->hasNext;
+    }
+
+    void ValveCtrl::setStreaming(bool streaming) {
+        this->streaming = streaming;
+    }
+
+    unsigned long ValveCtrl::getTakenEvents() {
+        return this->eventList.getPopped();
+    }
+
+    int ValveCtrl::getEventBytes() {
+        return this->eventList.getUsed();
+    }
+
+    int ValveCtrl::getFreeEventBytes() {
+        return this->eventList.getCapacity() - this->eventList.getUsed();
+    }
+
+    bool ValveCtrl::loadFirstEvent() {
+        if (!this->hasNext) { //lade erstes Event in nextEvent
+            if (eventList.isEmpty())
+                return false;
+            nextEvent = eventList.pop();
+            this->hasNext = true;
+        }
+        return true;
+    }
+
+    bool ValveCtrl::fireNextEvent() {
+        uint64_t currentTime = cmn::micros64();
+        uint64_t eventTime   = cmn::eventMicros(this->startTime, this->nextEvent.time);
+        long latency = (long)(currentTime - eventTime); //Verzoegerung in us
+        this->latency.record(latency);
+        eventLatency->record(latency);
+
+        srl->trace("Ventil\t");
+        srl->trace(this->id);
+        srl->trace(" gesetzt auf: ");
+        srl->trace(this->nextEvent.value);
+        srl->trace("\t\tSchaltzeit:\t");
+        srl->trace((unsigned long)(currentTime / 1000));
+        srl->trace("\terwartet:\t");
+        srl->trace((unsigned long)(eventTime / 1000));
+        srl->trace("\t( Rel.Zeit: ");
+        srl->trace(this->nextEvent.time);
+        srl->trace(" )\t( ");
+        srl->trace(latency);
+        srl->traceln("\tus Verzoegerung )");
+
+        this->main_display->setLastEvent('V', this->id, this->nextEvent.value, this->nextEvent.time);
+        this->currentValue = this->nextEvent.value;
+        currentState->setValves((valveBits)1 << this->id, this->currentValue ? (valveBits)1 << this->id : 0);
+
+        return this->loadNextEvent();
+    }
+
+    bool ValveCtrl::loadNextEvent() {
+        if (eventList.isEmpty()) { //alle Events abgearbeitet, im Streaming-Modus laedt loadFirstEvent() die naechsten
+            this->hasNext = false;
+            return this->streaming;
+        }
+        nextEvent = eventList.pop();
+        return true;
+    }
+
+    void ValveCtrl::eventSwitched(eventElement event, uint64_t switchTime) {
+        uint64_t eventTime = cmn::eventMicros(this->startTime, event.time);
+        long latency = (long)(switchTime - eventTime);
+        this->latency.record(latency);
+        eventLatency->record(latency);
+
+        srl->trace("Ventil\t");
+        srl->trace(this->id);
+        srl->trace(" gesetzt auf: ");
+        srl->trace(event.value);
+        srl->trace("\t\tSchaltzeit:\t");
+        srl->trace((unsigned long)(switchTime / 1000));
+        srl->trace("\terwartet:\t");
+        srl->trace((unsigned long)(eventTime / 1000));
+        srl->trace("\t( Rel.Zeit: ");
+        srl->trace(event.time);
+        srl->trace(" )\t( ");
+        srl->trace(latency);
+        srl->traceln("\tus Verzoegerung )");
+
+        this->main_display->setLastEvent('V', this->id, event.value, event.time);
+        this->currentValue = event.value;
+    }
+
+    LatencyStats *ValveCtrl::getLatency() {
+        return &this->latency;
+    }
+
+    bool ValveCtrl::isDue(uint64_t now) {
+        return this->ready && this->loadFirstEvent() && now >= cmn::eventMicros(this->startTime, this->nextEvent.time);
+    }
+
+    bool ValveCtrl::compute(uint64_t now) {
         if (this->ready) {
-            if (this->nextEvent.time == -1) { //lade erstes Event in nextEvent
-                if (eventList.isEmpty()) //beende den thread, wenn alle Events abgearbeitet sind
-                    return false;
-                nextEvent = eventList.pop();
-            }
-
-
-            if (millis() >= this->startTime + this->nextEvent.time) {
-                //setze Ventil auf this->nextEvent.value
-                digitalWrite(this->pin, this->nextEvent.value);
-
-                unsigned long currentTime = millis();
-
-                srl->print('D', "Ventil\t");
-                srl->print('D', this->id);
-                srl->print('D', " gesetzt auf: ");
-                srl->print('D', this->nextEvent.value);
-                srl->print('D', "\t\tSchaltzeit:\t");
-                srl->print('D', currentTime);
-                srl->print('D', "\terwartet:\t");
-                srl->print('D', this->startTime + this->nextEvent.time);
-                srl->print('D', "\t( Rel.Zeit: ");
-                srl->print('D', this->nextEvent.time);
-                srl->print('D', " )\t( ");
-                srl->print('D', currentTime - (this->startTime + this->nextEvent.time));
-                srl->println('D', "\tms Verzoegerung )");
-
-                this->main_display->setLastEvent('V', this->id, this->nextEvent.value, this->nextEvent.time);
-                this->currentValue = this->nextEvent.value;
-
-                if (eventList.isEmpty()) //beende den thread, wenn alle Events abgearbeitet sind
-                    return false;
-                nextEvent = eventList.pop();
-            }
+            if (!this->loadFirstEvent()) //beende den thread, wenn alle Events abgearbeitet sind
+                return this->streaming;  //im Streaming-Modus wird auf weitere Events gewartet
+
+            if (now >= cmn::eventMicros(this->startTime, this->nextEvent.time))
+                return this->fireNextEvent();
         }
         return true;
     }
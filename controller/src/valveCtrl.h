@@ -4,41 +4,96 @@
 #include <Arduino.h>
 #include <newdel.h> //fügt new und delete hinzu, wird für "mthread" benötigt
 #include <mthread.h>
-#include <QueueList.h>
 
 #include "ownlibs/serialCommunication.h"
+#include "ownlibs/common.h"
 #include "eventElement.h"
+#include "eventBuffer.h"
 #include "main_display.h"
+#include "stateSnapshot.h"
+#include "ownlibs/latencyStats.h"
 
 namespace control {
     class ValveCtrl {
     public:
-        //Defaultconstructor
-        ValveCtrl(int id);
+        //Defaultconstructor, 'eventBytes' Bytes ab 'eventMemory' sind der Eventspeicher
+        ValveCtrl(int id, uint8_t eventMemory[], int eventBytes);
         //Destructor
         ~ValveCtrl();
-        //setzt den Pin des Ventils
+        //setzt den Pin des Ventils (bzw. den Ausgang von Schieberegister/Expander, siehe valveOutput.h)
         void setPin(int pin);
+        //Gibt den Pin des Ventils zurueck
+        int getPin();
         //Stellwerte fuer die Ventile koennen als Pseudoevents gesetzt werden. Die Ereignisse
-        //werden in einer Queue gespeichert und bei gegebenen Zeitpunkt ausgefuehrt
-        void setEvent(int value, unsigned long time);
+        //werden in einem Ringpuffer gespeichert und bei gegebenen Zeitpunkt ausgefuehrt.
+        //Gibt false zurueck, wenn der Eventspeicher voll ist
+        bool setEvent(int value, unsigned long time);
+        //Beginnt bzw. schliesst einen Wiederholungsblock (siehe EventBuffer::pushRepeat()),
+        //gibt false zurueck, wenn der Eventspeicher voll ist
+        bool setRepeat(unsigned long count, unsigned long period);
+        bool endRepeat();
         //sobald diese Funktion ausgefuehrt wird, beginnt das Programm mit der Ansteuerung
-        void start(unsigned long startTime);
+        //(startTime in cmn::micros64())
+        void start(uint64_t startTime);
+        //Merkt sich die vollstaendig uebertragene Eventliste (<end>), bevor das erste Event
+        //entnommen wird
+        void markProgram();
+        //Haelt die Ansteuerung an und setzt die Eventliste auf den Stand von markProgram()
+        //zurueck, danach kann wieder gestartet werden
+        void rewind();
         //Gebe Adresse des Displayobjektes an dieses Ventil, um zu kommunizieren
         void setMainDisplayObjectPointer(io::Main_Display *main_display);
         //Gibt den aktuellen Soll-Wert des Ventils zurueck
         int getCurrentValue();
-        //Die compute()-Function wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt
-        bool compute();
+        //Gibt den Zeitpunkt (cmn::micros64()) des naechsten Events zurueck, gueltig sobald compute()
+        //einmal nach dem Start aufgerufen wurde
+        uint64_t getNextEventTime();
+        //Gibt das naechste anstehende Event zurueck (Zeit relativ zum Start)
+        eventElement getNextEvent();
+        //Gibt an, ob ein Event ansteht. Im Streaming-Modus kann der Eventspeicher zwischendurch
+        //leer sein, bis LabView weitere Events nachlaedt
+        bool hasEvent();
+        //Streaming-Modus (<stream>): ein leerer Eventspeicher beendet die Eventliste nicht, erst
+        //nach setStreaming(false) (<end> waehrend der Messung)
+        void setStreaming(bool streaming);
+        //Anzahl der bisher aus dem Eventspeicher entnommenen Events (siehe EventBuffer::getPopped())
+        unsigned long getTakenEvents();
+        //Belegte bzw. noch freie Bytes des Eventspeichers
+        int getEventBytes();
+        int getFreeEventBytes();
+        //Laedt das erste Event aus dem Eventspeicher, gibt false zurueck, wenn keine Events vorhanden sind
+        bool loadFirstEvent();
+        //Meldet das anstehende Event als ausgefuehrt und laedt das naechste. Geschaltet hat es der
+        //Aufrufer ueber ValveOutput, zusammen mit allen gleichzeitig faelligen Ventilen. Gibt false
+        //zurueck, wenn alle Events abgearbeitet sind (im Streaming-Modus nie)
+        bool fireNextEvent();
+        //Laedt das naechste Event, ohne das anstehende auszufuehren (wird vom Hardware-Timer
+        //geschaltet). Gibt false zurueck, wenn keine Events mehr vorhanden sind (im Streaming-Modus nie)
+        bool loadNextEvent();
+        //Meldet ein vom Hardware-Timer geschaltetes Event (Debugausgabe, Display, aktueller Wert)
+        //switchTime ist die Schaltzeit in cmn::micros64()
+        void eventSwitched(eventElement event, uint64_t switchTime);
+        //Schaltverzoegerung der Events seit dem Start
+        LatencyStats *getLatency();
+        //Gibt an, ob das anstehende Event zum Zeitpunkt 'now' (cmn::micros64()) faellig ist, laedt
+        //dazu nach dem Start das erste Event
+        bool isDue(uint64_t now);
+        //Die compute()-Function wird kontinuierlich aufgerufen und vollstaendig ausgefuehrt. Sie
+        //meldet das Event, wenn isDue(now) gilt
+        bool compute(uint64_t now);
     private:
         int id;
         int pin;
-        QueueList <eventElement> eventList;
+        EventBuffer eventList;
+        EventBuffer program; //Eventliste bei markProgram(), teilt den Speicher mit eventList
         bool ready;
-        unsigned long startTime;
+        bool streaming;
+        uint64_t startTime; //cmn::micros64()
         int currentValue;
 
         eventElement nextEvent;
+        bool hasNext; //nextEvent ist geladen und noch nicht ausgefuehrt
+        LatencyStats latency;
 
         io::Main_Display *main_display;
     };
@@ -0,0 +1,273 @@
+#include "valveOutput.h"
+
+//Register des MCP23017 (IOCON.BANK = 0, die Adresse zaehlt nach jedem Byte weiter)
+#define EXPANDER_IODIRA 0x00
+#define EXPANDER_OLATA 0x14
+
+namespace control {
+    //Gibt das niedrigste gesetzte Bit zurueck und loescht es aus 'bits'
+    static int takeLowestBit(valveBits *bits) {
+        int bit = __builtin_ctzll((uint64_t)*bits);
+        *bits &= *bits - 1;
+        return bit;
+    }
+
+    //Setzt die Ausgaenge 'outputs[i]' der Ventile aus 'mask' in die Worte des Schrittes
+    static void prepareOutputs(const uint8_t outputs[], valveBits mask, valveBits values, valveOutputFrame *frame) {
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++) {
+            frame->set[w]   = 0;
+            frame->clear[w] = 0;
+        }
+        while (mask) {
+            int i = takeLowestBit(&mask);
+            int output = outputs[i];
+            if ((values >> i) & 1)
+                frame->set[output >> 5] |= 1UL << (output & 31);
+            else
+                frame->clear[output >> 5] |= 1UL << (output & 31);
+        }
+    }
+
+    void ValveOutput::write(valveBits mask, valveBits values) {
+        valveOutputFrame frame;
+        this->prepare(mask, values, &frame);
+        this->apply(&frame);
+    }
+
+    //////////////////// GPIO ////////////////////
+
+    GpioValveOutput::GpioValveOutput() {
+        this->clearPins();
+    }
+
+    void GpioValveOutput::begin() {
+
+    }
+
+    bool GpioValveOutput::setPin(int valveID, int pin) {
+        if (pin < 0 || pin >= NUM_DIGITAL_PINS)
+            return false;
+        pinMode(pin, OUTPUT);
+
+#if defined(KINETISK)
+        //Der Teensy 3.x liefert fuer jeden Pin eine Bitband-Adresse im Data-Output-Register
+        //seines Ports (Alias = 0x42000000 + Registeroffset * 32 + Bit * 4). Daraus laesst sich
+        //das 32bit-Register (GPIOx_PDOR) und die Bitposition zurueckrechnen. Set- (PSOR) und
+        //Clear-Register (PCOR) liegen direkt dahinter.
+        uint32_t alias = (uint32_t)(uintptr_t)portOutputRegister(pin) - 0x42000000;
+        volatile uint32_t *dataRegister = (volatile uint32_t *)(0x40000000 + ((alias >> 5) & ~3UL));
+        uint32_t bit = 1UL << ((alias >> 2) & 31);
+
+        int port = 0;
+        while (port < this->portCount && this->setRegister[port] != dataRegister + 1) {
+            port++;
+        }
+        if (port == this->portCount) { //Port wird zum ersten Mal verwendet
+            if (this->portCount >= VALVE_TIMER_MAX_PORTS)
+                return false;
+            this->setRegister[port]   = dataRegister + 1;
+            this->clearRegister[port] = dataRegister + 2;
+            this->portCount++;
+        }
+
+        this->valvePort[valveID] = port;
+        this->valveBit[valveID]  = bit;
+#else
+        this->valvePin[valveID] = pin;
+#endif
+        return true;
+    }
+
+    void GpioValveOutput::clearPins() {
+#if defined(KINETISK)
+        this->portCount = 0;
+#endif
+    }
+
+    void GpioValveOutput::prepare(valveBits mask, valveBits values, valveOutputFrame *frame) {
+#if defined(KINETISK)
+        //Uebersetze Ventilbits in Portbits, damit apply() nur noch Register schreibt
+        for (int port = 0; port < VALVE_OUTPUT_WORDS; port++) {
+            frame->set[port]   = 0;
+            frame->clear[port] = 0;
+        }
+        while (mask) {
+            int i = takeLowestBit(&mask);
+            if ((values >> i) & 1)
+                frame->set[this->valvePort[i]] |= this->valveBit[i];
+            else
+                frame->clear[this->valvePort[i]] |= this->valveBit[i];
+        }
+#else
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++) {
+            frame->set[w]   = w < 2 ? (uint32_t)((uint64_t)(values & mask) >> (32 * w)) : 0;
+            frame->clear[w] = w < 2 ? (uint32_t)((uint64_t)(~values & mask) >> (32 * w)) : 0;
+        }
+#endif
+    }
+
+    void GpioValveOutput::apply(const valveOutputFrame *frame) {
+#if defined(KINETISK)
+        for (int port = 0; port < this->portCount; port++) {
+            if (frame->clear[port])
+                *this->clearRegister[port] = frame->clear[port];
+            if (frame->set[port])
+                *this->setRegister[port] = frame->set[port];
+        }
+#else
+        for (int w = 0; w < 2; w++) {
+            valveBits clear = frame->clear[w];
+            valveBits set   = frame->set[w];
+            while (clear)
+                digitalWrite(this->valvePin[32 * w + takeLowestBit(&clear)], LOW);
+            while (set)
+                digitalWrite(this->valvePin[32 * w + takeLowestBit(&set)], HIGH);
+        }
+#endif
+    }
+
+    //////////////////// SCHIEBEREGISTER ////////////////////
+
+    ShiftRegisterValveOutput::ShiftRegisterValveOutput() {
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++)
+            this->image[w] = 0;
+    }
+
+    void ShiftRegisterValveOutput::begin() {
+        //Die Kette liegt an einem eigenen SPI: die SD-Karte (Sd2Card) haengt am SPI, eine Ausgabe aus
+        //dem Interrupt des Ventil-Timers mitten in einem Block der Karte wuerde beide verfaelschen
+        pinMode(VALVE_SHIFT_LATCH_PIN, OUTPUT);
+        digitalWrite(VALVE_SHIFT_LATCH_PIN, LOW);
+        VALVE_SHIFT_SPI.setMOSI(VALVE_SHIFT_DATA_PIN);
+        VALVE_SHIFT_SPI.setSCK(VALVE_SHIFT_CLOCK_PIN);
+        VALVE_SHIFT_SPI.begin();
+        this->transfer();
+    }
+
+    bool ShiftRegisterValveOutput::setPin(int valveID, int pin) {
+        if (pin < 0 || pin >= 8 * VALVE_SHIFT_REGISTERS)
+            return false;
+        this->valveOutputs[valveID] = pin;
+        return true;
+    }
+
+    void ShiftRegisterValveOutput::clearPins() {
+
+    }
+
+    void ShiftRegisterValveOutput::prepare(valveBits mask, valveBits values, valveOutputFrame *frame) {
+        prepareOutputs(this->valveOutputs, mask, values, frame);
+    }
+
+    void ShiftRegisterValveOutput::apply(const valveOutputFrame *frame) {
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++)
+            this->image[w] = (this->image[w] & ~frame->clear[w]) | frame->set[w];
+        this->transfer();
+    }
+
+    void ShiftRegisterValveOutput::transfer() {
+        //Das zuerst geschobene Byte landet im letzten Baustein der Kette
+        VALVE_SHIFT_SPI.beginTransaction(SPISettings(VALVE_SHIFT_CLOCK, MSBFIRST, SPI_MODE0));
+        for (int r = VALVE_SHIFT_REGISTERS - 1; r >= 0; r--)
+            VALVE_SHIFT_SPI.transfer((uint8_t)(this->image[r / 4] >> (8 * (r % 4))));
+        VALVE_SHIFT_SPI.endTransaction();
+
+        digitalWrite(VALVE_SHIFT_LATCH_PIN, HIGH);
+        digitalWrite(VALVE_SHIFT_LATCH_PIN, LOW);
+    }
+
+    //////////////////// PORTEXPANDER ////////////////////
+
+    ExpanderValveOutput::ExpanderValveOutput() {
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++)
+            this->image[w] = 0;
+        for (int e = 0; e < VALVE_EXPANDERS; e++) {
+            this->dirty[e] = false;
+            this->nextTransaction[e] = 0;
+            for (int t = 0; t < VALVE_EXPANDER_TRANSACTIONS; t++)
+                this->transactions[e][t].status = I2C_IDLE;
+        }
+    }
+
+    void ExpanderValveOutput::begin() {
+        i2cBus->begin();
+        //Ausgaenge zuerst auf 0, dann alle Pins als Ausgang
+        for (int e = 0; e < VALVE_EXPANDERS; e++) {
+            this->dirty[e] = !this->submit(e, EXPANDER_OLATA, 0);
+            if (!this->submit(e, EXPANDER_IODIRA, 0)) {
+                srl->error("ERROR - Expander ");
+                srl->error(e);
+                srl->errorln(": Richtung nicht gesetzt");
+            }
+        }
+    }
+
+    bool ExpanderValveOutput::setPin(int valveID, int pin) {
+        if (pin < 0 || pin >= 16 * VALVE_EXPANDERS)
+            return false;
+        this->valveOutputs[valveID] = pin;
+        return true;
+    }
+
+    void ExpanderValveOutput::clearPins() {
+
+    }
+
+    void ExpanderValveOutput::prepare(valveBits mask, valveBits values, valveOutputFrame *frame) {
+        prepareOutputs(this->valveOutputs, mask, values, frame);
+    }
+
+    void ExpanderValveOutput::apply(const valveOutputFrame *frame) {
+        for (int w = 0; w < VALVE_OUTPUT_WORDS; w++)
+            this->image[w] = (this->image[w] & ~frame->clear[w]) | frame->set[w];
+
+        //nur die Expander mit geaenderten Ausgaengen, ein Wort umfasst zwei Expander
+        for (int e = 0; e < VALVE_EXPANDERS; e++) {
+            int shift = 16 * (e % 2);
+            if (((frame->set[e / 2] | frame->clear[e / 2]) >> shift) & 0xFFFF)
+                this->dirty[e] = true;
+        }
+        this->flush();
+    }
+
+    bool ExpanderValveOutput::flush() {
+        bool flushed = true;
+        for (int e = 0; e < VALVE_EXPANDERS; e++) {
+            if (this->dirty[e]) {
+                this->dirty[e] = !this->submit(e, EXPANDER_OLATA, this->image[e / 2] >> (16 * (e % 2)));
+                flushed &= !this->dirty[e];
+            }
+        }
+        return flushed;
+    }
+
+    bool ExpanderValveOutput::submit(int expander, uint8_t reg, uint16_t value) {
+        //Transaktionen werden der Reihe nach abgearbeitet, ist die naechste belegt, sind es alle
+        i2cTransaction *transaction = &this->transactions[expander][this->nextTransaction[expander]];
+        if (transaction->status == I2C_PENDING)
+            return false;
+
+        transaction->adress    = VALVE_EXPANDER_ADDRESS + expander;
+        transaction->txData[0] = reg;
+        transaction->txData[1] = value;      //Port A
+        transaction->txData[2] = value >> 8; //Port B
+        transaction->txLength  = 3;
+        transaction->rxData    = NULL;
+        transaction->rxLength  = 0;
+        if (!i2cBus->submit(transaction, true))
+            return false;
+
+        this->nextTransaction[expander] = (this->nextTransaction[expander] + 1) % VALVE_EXPANDER_TRANSACTIONS;
+        return true;
+    }
+
+    ValveOutput *createValveOutput() {
+#if VALVE_OUTPUT == VALVE_OUTPUT_SHIFT_REGISTER
+        return new ShiftRegisterValveOutput();
+#elif VALVE_OUTPUT == VALVE_OUTPUT_EXPANDER
+        return new ExpanderValveOutput();
+#else
+        return new GpioValveOutput();
+#endif
+    }
+}
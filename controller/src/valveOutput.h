@@ -0,0 +1,129 @@
+#ifndef VALVEOUTPUT_H
+#define VALVEOUTPUT_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#include "config.h"
+#include "stateSnapshot.h"
+#include "ownlibs/i2cBus.h"
+#include "ownlibs/serialCommunication.h"
+
+//Worte eines Schaltschrittes: je GPIO-Port bzw. je 32 Ausgaenge der Kette (die Ventilmaske hat hoechstens 64 Bit)
+#define VALVE_OUTPUT_WORDS (VALVE_TIMER_MAX_PORTS > 2 ? VALVE_TIMER_MAX_PORTS : 2)
+//Bausteine der Kette bzw. Expander, so viele wie MAX_AMOUNT_VALVE Ausgaenge brauchen
+#define VALVE_SHIFT_REGISTERS ((MAX_AMOUNT_VALVE + 7) / 8)
+#define VALVE_EXPANDERS ((MAX_AMOUNT_VALVE + 15) / 16)
+
+namespace control {
+    //Ein Schaltschritt im Format des Ausgangs: zu setzende und zu loeschende Bits je Wort
+    typedef struct valveOutputFrameStruct {
+        uint32_t set[VALVE_OUTPUT_WORDS];
+        uint32_t clear[VALVE_OUTPUT_WORDS];
+    } valveOutputFrame;
+
+    // Gibt die Stellwerte der Ventile aus (VALVE_OUTPUT). Ein Schaltschritt enthaelt alle Ventile,
+    // die zum selben Zeitpunkt schalten. prepare() rechnet ihn im Thread in das Format des
+    // Ausgangs um, apply() gibt ihn danach mit einer Uebertragung aus (Portregister, ein Burst
+    // ueber SPI bzw. eine Transaktion je Expander), auch aus dem Interrupt des Ventil-Timers.
+    // Die Pins aus dem Header sind bei Schieberegistern und Expandern die Nummern der Ausgaenge.
+    class ValveOutput {
+    public:
+        //Destructor
+        virtual ~ValveOutput() {}
+        //Richtet die Schnittstelle ein, alle Ausgaenge sind danach aus
+        virtual void begin() = 0;
+        //Ordnet einem Ventil den Ausgang 'pin' zu. Gibt false zurueck, wenn es ihn nicht gibt
+        virtual bool setPin(int valveID, int pin) = 0;
+        //Verwirft die Zuordnung der Pins (neuer Header nach <rearm>)
+        virtual void clearPins() = 0;
+        //Rechnet die Ventile aus 'mask' mit den Werten aus 'values' (Bit = Ventil-ID) in einen Schritt um
+        virtual void prepare(valveBits mask, valveBits values, valveOutputFrame *frame) = 0;
+        //Gibt einen mit prepare() berechneten Schritt aus
+        virtual void apply(const valveOutputFrame *frame) = 0;
+        //Wiederholt Ausgaben, die nicht sofort uebertragen werden konnten. Gibt false zurueck,
+        //wenn noch welche warten
+        virtual bool flush() { return true; }
+        //prepare() und apply() in einem, fuer das Schalten aus dem Thread
+        void write(valveBits mask, valveBits values);
+    };
+
+    // Jedes Ventil an einem eigenen Pin des Teensy. Auf dem Teensy 3.x wird je GPIO-Port mit einem
+    // Zugriff auf das Set- und Clear-Register geschaltet, sonst mit digitalWrite()
+    class GpioValveOutput : public ValveOutput {
+    public:
+        //Defaultconstructor
+        GpioValveOutput();
+        void begin();
+        bool setPin(int valveID, int pin);
+        void clearPins();
+        void prepare(valveBits mask, valveBits values, valveOutputFrame *frame);
+        void apply(const valveOutputFrame *frame);
+    private:
+#if defined(KINETISK)
+        //Set- und Clear-Register der belegten Ports
+        volatile uint32_t *setRegister[VALVE_TIMER_MAX_PORTS];
+        volatile uint32_t *clearRegister[VALVE_TIMER_MAX_PORTS];
+        int portCount;
+        //Port und Bitmaske jedes Ventils
+        uint8_t valvePort[MAX_AMOUNT_VALVE];
+        uint32_t valveBit[MAX_AMOUNT_VALVE];
+#else
+        //Die Worte des Schrittes sind die Ventilmaske
+        uint8_t valvePin[MAX_AMOUNT_VALVE];
+#endif
+    };
+
+    // Kette aus 74HC595 an VALVE_SHIFT_SPI, nicht am SPI der SD-Karte. Ausgang 0 ist Q0 des ersten
+    // Bausteins (am Teensy). Jeder Schritt schiebt das ganze Ausgangsbild mit VALVE_SHIFT_CLOCK
+    // hinaus und uebernimmt es mit einem Puls an VALVE_SHIFT_LATCH_PIN, alle Ausgaenge schalten
+    // gleichzeitig
+    class ShiftRegisterValveOutput : public ValveOutput {
+    public:
+        //Defaultconstructor
+        ShiftRegisterValveOutput();
+        void begin();
+        bool setPin(int valveID, int pin);
+        void clearPins();
+        void prepare(valveBits mask, valveBits values, valveOutputFrame *frame);
+        void apply(const valveOutputFrame *frame);
+    private:
+        //Schiebt das Ausgangsbild hinaus und uebernimmt es
+        void transfer();
+
+        uint8_t valveOutputs[MAX_AMOUNT_VALVE]; //Ausgang jedes Ventils
+        uint32_t image[VALVE_OUTPUT_WORDS];     //aktueller Zustand der Ausgaenge
+    };
+
+    // MCP23017 am gemeinsamen I2C-Bus (ownlibs/i2cBus.h) mit 16 Ausgaengen je Baustein, ab
+    // VALVE_EXPANDER_ADDRESS. Ein Schritt schreibt beide Ausgangsregister der betroffenen
+    // Expander in je einer Transaktion mit Vorrang. Die Uebertragung laeuft erst nach apply(),
+    // daher wird aus dem Thread geschaltet (ohne Hardware-Timer). Sind alle Transaktionen eines
+    // Expanders noch unterwegs, schreibt flush() sein Bild nach
+    class ExpanderValveOutput : public ValveOutput {
+    public:
+        //Defaultconstructor
+        ExpanderValveOutput();
+        void begin();
+        bool setPin(int valveID, int pin);
+        void clearPins();
+        void prepare(valveBits mask, valveBits values, valveOutputFrame *frame);
+        void apply(const valveOutputFrame *frame);
+        bool flush();
+    private:
+        //Reiht das Bild eines Expanders ab Register 'reg' ein, gibt false zurueck, wenn keine
+        //Transaktion frei ist
+        bool submit(int expander, uint8_t reg, uint16_t value);
+
+        uint8_t valveOutputs[MAX_AMOUNT_VALVE];
+        uint32_t image[VALVE_OUTPUT_WORDS];
+        bool dirty[VALVE_EXPANDERS]; //Bild konnte noch nicht eingereiht werden
+        i2cTransaction transactions[VALVE_EXPANDERS][VALVE_EXPANDER_TRANSACTIONS];
+        int nextTransaction[VALVE_EXPANDERS];
+    };
+
+    //Erstellt den mit VALVE_OUTPUT gewaehlten Ausgang
+    ValveOutput *createValveOutput();
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "valveTimer.h"
+
+#if VALVE_HARDWARE_TIMER
+
+namespace control {
+    ValveTimer *ValveTimer::activeTimer = NULL;
+
+    ValveTimer::ValveTimer() {
+        this->output    = NULL;
+        this->pushed    = 0;
+        this->executed  = 0;
+        this->reported  = 0;
+        this->startTime  = 0;
+        this->lastMicros = 0;
+        this->overflows  = 0;
+    }
+    ValveTimer::~ValveTimer() {
+        this->stop();
+    }
+
+    void ValveTimer::setOutput(ValveOutput *output) {
+        this->output = output;
+    }
+
+    bool ValveTimer::isFull() {
+        return this->pushed - this->reported >= VALVE_TIMER_QUEUE_SIZE;
+    }
+
+    bool ValveTimer::isEmpty() {
+        return this->reported == this->pushed;
+    }
+
+    void ValveTimer::push(unsigned long time, valveBits valveMask, valveBits valveValues) {
+        valveStep *step = &this->steps[this->pushed % VALVE_TIMER_QUEUE_SIZE];
+
+        step->time        = time;
+        step->valveMask   = valveMask;
+        step->valveValues = valveValues;
+        step->switchTime  = 0;
+
+        //Uebersetze Ventilbits fuer den Ausgang, damit der Interrupt nur noch ausgibt
+        this->output->prepare(valveMask, valveValues, &step->frame);
+
+        //Schritt erst freigeben, wenn er vollstaendig geschrieben ist
+        COMPILER_BARRIER();
+        this->pushed++;
+    }
+
+    bool ValveTimer::popExecuted(valveStep *step) {
+        if (this->reported == this->executed)
+            return false;
+
+        *step = this->steps[this->reported % VALVE_TIMER_QUEUE_SIZE];
+        this->reported++;
+        return true;
+    }
+
+    bool ValveTimer::getNextStepTime(unsigned long *time) {
+        if (this->executed == this->pushed)
+            return false;
+
+        *time = this->steps[this->executed % VALVE_TIMER_QUEUE_SIZE].time;
+        return true;
+    }
+
+    void ValveTimer::start(uint64_t startTime) {
+        this->startTime = startTime;
+
+        //now() setzt die Zeit von cmn::micros64() fort
+        uint64_t current = cmn::micros64();
+        this->lastMicros = (uint32_t)current;
+        this->overflows  = (uint32_t)(current >> 32);
+
+        activeTimer = this;
+        this->timer.priority(0); //hoechste Prioritaet, Schalten soll nicht verzoegert werden
+        this->timer.begin(ValveTimer::isr, VALVE_TIMER_INTERVALL);
+    }
+
+    void ValveTimer::stop() {
+        this->timer.end();
+        if (activeTimer == this)
+            activeTimer = NULL;
+    }
+
+    void ValveTimer::clear() {
+        this->pushed   = 0;
+        this->executed = 0;
+        this->reported = 0;
+    }
+
+    void ValveTimer::isr() {
+        if (activeTimer != NULL)
+            activeTimer->execute();
+    }
+
+    uint64_t ValveTimer::now() {
+        uint32_t current = micros();
+        if (current < this->lastMicros)
+            this->overflows++;
+        this->lastMicros = current;
+        return ((uint64_t)this->overflows << 32) | current;
+    }
+
+    void ValveTimer::execute() {
+        uint64_t current = this->now();
+        while (this->executed != this->pushed) {
+            valveStep *step = &this->steps[this->executed % VALVE_TIMER_QUEUE_SIZE];
+            if (current < cmn::eventMicros(this->startTime, step->time))
+                return;
+
+            this->output->apply(&step->frame);
+
+            step->switchTime = this->now();
+            currentState->setValves(step->valveMask, step->valveValues); //Zustand gilt ab dem Schalten, nicht erst ab der Meldung
+            this->executed++;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef VALVETIMER_H
+#define VALVETIMER_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "stateSnapshot.h"
+#include "valveOutput.h"
+#include "ownlibs/common.h"
+
+#if VALVE_HARDWARE_TIMER
+
+namespace control {
+    //Vorberechneter Schaltschritt: alle Ventile, die zum selben Zeitpunkt schalten
+    typedef struct valveStepStruct {
+        unsigned long time;                        //Schaltzeitpunkt relativ zum Start (EVENT_TIME_UNIT)
+        valveBits valveMask;                       //betroffene Ventile, Bit = Ventil-ID
+        valveBits valveValues;                     //neue Werte der betroffenen Ventile
+        valveOutputFrame frame;                    //Schritt im Format des Ausgangs (ValveOutput::prepare())
+        uint64_t switchTime;                       //tatsaechliche Schaltzeit (cmn::micros64()), vom Interrupt gesetzt
+    } valveStep;
+
+    // Schaltet die Ventile aus einem Timer-Interrupt (PIT ueber IntervalTimer) statt aus dem
+    // kooperativen Scheduler. Main_ValveCtrl rechnet die Events vorab in Schaltschritte um, die
+    // der Ausgang (ValveOutput) schon beim Einreihen in sein Format uebersetzt. Der Interrupt
+    // gibt einen faelligen Schritt mit einer Uebertragung aus (ein Registerzugriff pro Port bzw.
+    // ein Burst an die Schieberegister), gleichzeitige Events schalten so exakt gleichzeitig. Die Warteschlange hat genau einen Schreiber (Thread) und
+    // einen Leser (Interrupt) und kommt daher ohne Sperren aus.
+    class ValveTimer {
+    public:
+        //Defaultconstructor
+        ValveTimer();
+        //Destructor
+        ~ValveTimer();
+        //Setzt den Ausgang, ueber den geschaltet wird
+        void setOutput(ValveOutput *output);
+        //Gibt an, ob ein weiterer Schritt in die Warteschlange passt
+        bool isFull();
+        //Gibt an, ob alle Schritte ausgefuehrt und gemeldet wurden
+        bool isEmpty();
+        //Haengt einen Schaltschritt an. valveMask/valveValues werden hier fuer den Ausgang uebersetzt
+        void push(unsigned long time, valveBits valveMask, valveBits valveValues);
+        //Kopiert den aeltesten ausgefuehrten, aber noch nicht gemeldeten Schritt. Gibt false
+        //zurueck, wenn kein solcher Schritt vorhanden ist
+        bool popExecuted(valveStep *step);
+        //Liefert den Zeitpunkt (relativ zum Start) des naechsten noch nicht ausgefuehrten Schrittes
+        bool getNextStepTime(unsigned long *time);
+        //Setzt den Nullpunkt (cmn::micros64()) und startet den Timer-Interrupt
+        void start(uint64_t startTime);
+        //Stoppt den Timer-Interrupt
+        void stop();
+        //Verwirft alle Schritte der Warteschlange, nur bei gestopptem Timer
+        void clear();
+    private:
+        //Interrupt-Einsprung, ruft execute() des aktiven Objektes auf
+        static void isr();
+        //Fuehrt alle faelligen Schritte aus, laeuft im Interrupt
+        void execute();
+        //Zeit wie cmn::micros64(), mit eigenem Ueberlaufzaehler, da cmn::micros64() nicht
+        //unterbrochen werden darf. Nur im Interrupt aufrufen, der mindestens jede ms laeuft
+        uint64_t now();
+
+        static ValveTimer *activeTimer;
+        IntervalTimer timer;
+        ValveOutput *output;
+
+        //Warteschlange, Indizes laufen frei und werden modulo Groesse verwendet:
+        //reported <= executed <= pushed
+        valveStep steps[VALVE_TIMER_QUEUE_SIZE];
+        volatile unsigned int pushed;   //vom Thread geschrieben
+        volatile unsigned int executed; //vom Interrupt geschrieben
+        volatile unsigned int reported; //vom Thread geschrieben
+
+        uint64_t startTime; //vor dem Timer gesetzt
+        uint32_t lastMicros; //Ueberlaufzaehler von now(), nur im Interrupt veraendert
+        uint32_t overflows;
+    };
+}
+
+#endif
+
+#endif
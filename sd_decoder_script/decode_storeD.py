@@ -0,0 +1,94 @@
+from __future__ import print_function
+import struct, sys
+
+# Converts a binary measurement file written by StoreD (SD_BINARY_RECORDS 1, see
+# controller/src/sdRecord.h) into the text layout of controller/example_StoreD.txt.
+#
+# usage: python decode_storeD.py LOG00001.BIN [output.txt]
+
+HEADER = struct.Struct('<4sBBBBII') #magic, version, amountMFC, amountValve, boschReduction, intervall, startTime
+TYPE_SIZE = 16 #SD_RECORD_TYPE_SIZE
+VERSION = 1 #SD_RECORD_VERSION
+REDUCE_MINMAX = 1 #BOSCH_REDUCE_MINMAX, two Bosch columns (min, max)
+FOOTER = struct.Struct('<BBHI4s') #amountStats, reserved, recordSize, length, magic
+LATENCY = struct.Struct('<BBHIiii') #type, id, buckets, count, min, max, mean, followed by the buckets
+
+def split_footer(data):
+    #switching latency written on <stop>, ends with an sdFileFooter (see sdRecord.h)
+    if len(data) < FOOTER.size:
+        return data, []
+    amount, reserved, record_size, length, magic = FOOTER.unpack_from(data, len(data) - FOOTER.size)
+    if magic != b'MSF\0' or length != amount * record_size + FOOTER.size or length > len(data):
+        return data, []
+    stats = []
+    offset = len(data) - length
+    for i in range(amount):
+        kind, id, buckets, count, minimum, maximum, mean = LATENCY.unpack_from(data, offset + i * record_size)
+        histogram = struct.unpack_from('<%dI' % buckets, data, offset + i * record_size + LATENCY.size)
+        stats.append((chr(kind), id, count, minimum, maximum, mean, histogram))
+    return data[:offset], stats
+
+def write_latency(stats, out):
+    #bucket 0: below 1 us, bucket k: 2^(k-1) up to 2^k us, the last one takes all larger delays
+    out.write("Schaltverzoegerung [us]:\n")
+    for kind, id, count, minimum, maximum, mean, histogram in stats:
+        name = "Gesamt" if kind == 'G' else ("MFC%d" % (id + 1) if kind == 'M' else "Ven%d" % (id + 1))
+        out.write("%s\tAnzahl: %d\tMin: %d\tMax: %d\tMittel: %d\n" % (name, count, minimum, maximum, mean))
+        limits = ["<1"] + ["<%d" % (1 << k) for k in range(1, len(histogram) - 1)] + [">=%d" % (1 << (len(histogram) - 2))]
+        out.write("\t" + "\t".join("%s: %d" % (l, n) for l, n in zip(limits, histogram) if n > 0) + "\n")
+
+def decode(data, out):
+    data, stats = split_footer(data)
+    offset = 0
+    while offset + HEADER.size <= len(data):
+        magic, version, amount_mfc, amount_valve, bosch_reduction, intervall, start_time = HEADER.unpack_from(data, offset)
+        if magic != b'MSD\0' or version != VERSION:
+            raise ValueError("no valid header at byte %d" % offset)
+        offset += HEADER.size
+
+        types = []
+        for i in range(amount_mfc):
+            types.append(data[offset:offset + TYPE_SIZE].split(b'\0')[0].decode('ascii', 'replace'))
+            offset += TYPE_SIZE
+
+        out.write("Startzeit: %d\n" % start_time)
+        out.write("Messintervall: %d\n" % intervall)
+        out.write("Anzahl MFC: %d\n" % amount_mfc)
+        out.write("Anzahl Ventile: %d\n\n" % amount_valve)
+        out.write(", ".join("MFC%d: %s" % (i + 1, t) for i, t in enumerate(types)) + "\n\n")
+
+        bosch_columns = ["BoschMin", "BoschMax"] if bosch_reduction == REDUCE_MINMAX else ["Bosch"]
+        columns = ["Time:"] + ["MFC%d" % (i + 1) for i in range(amount_mfc)] + ["Ven%d" % (i + 1) for i in range(amount_valve)] + bosch_columns
+        out.write("\t".join(columns) + "\n")
+
+        amount_bosch = len(bosch_columns)
+        valve_bytes = 2 if amount_valve <= 16 else (amount_valve + 7) // 8 #sdValveBytes()
+        record = struct.Struct('<I%dh%ds%di' % (amount_mfc, valve_bytes, amount_bosch))
+        while offset + record.size <= len(data):
+            if data[offset:offset + 4] == b'MSD\0': #file was appended by a new measurement
+                break
+            values = record.unpack_from(data, offset)
+            offset += record.size
+
+            time, mfcs, valves, bosch = values[0], values[1:1 + amount_mfc], values[1 + amount_mfc], values[2 + amount_mfc:]
+            valves = sum(b << (8 * i) for i, b in enumerate(bytearray(valves))) #little endian
+            row = [time] + list(mfcs) + [(valves >> i) & 1 for i in range(amount_valve)] + list(bosch)
+            out.write("\t".join(str(v) for v in row) + "\n")
+        out.write("\n")
+
+    if stats:
+        write_latency(stats, out)
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print("usage: python decode_storeD.py <binary file> [output file]")
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], 'w') as out:
+            decode(data, out)
+    else:
+        decode(data, sys.stdout)
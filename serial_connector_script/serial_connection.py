@@ -1,5 +1,5 @@
 from __future__ import print_function
-import serial, platform, glob, sys, threading
+import serial, platform, glob, sys, threading, struct, binascii, collections, os
 from time import *
 
 serialConnection = None #global variable for connection
@@ -8,6 +8,24 @@ i = 0
 counter = 0
 
 port = "COM4" #Mac: /dev/cu.usbmodem1421, Linux: /dev/tty_xxx
+binary = False #True: events are sent as binary frames (see README, Binaerprotokoll)
+
+#benchmark mode: uploads a generated program, waits for every "ok" and prints the upload times of
+#both ends (see README, <upload>). The program is not started
+benchmark = False
+bench_events = 10000 #events in total, spread evenly over all channels
+bench_mfc = 4
+bench_valves = 8
+bench_spacing = 10 #ms between two events of one channel
+bench_window = 0 #>0: sliding window (<window,N>), the controller acknowledges every N lines, 0: "ok" per line
+bench_stream = False #True: streaming mode (<stream>), the program is started and topped up while it runs (text lines only)
+bench_capacity = 0 #>0: events per channel the script keeps in stock while streaming, 0: "capacity,N" of the controller
+
+#download mode: lists the files on the SD card (<ls>) and copies every measurement file into
+#download_dir (<get>). Files that are already there are continued from their size
+download = False
+download_dir = "."
+download_prefix = "LOG" #SD_FILE_PREFIX
 
 data = [
     '<4,7>',
@@ -88,6 +106,290 @@ data = [
     '<start>'
 ]
 
+BINARY_SYNC = 0xA5
+BINARY_EVENTS = 0x01
+BINARY_END = 0x02
+BINARY_FILE = 0x15
+BINARY_MAX_PAYLOAD = 512 #SERIAL_READ_MAX_LINE_SIZE
+
+def binary_frame(frame_type, payload):
+    body = struct.pack('<BH', frame_type, len(payload)) + payload
+    crc = binascii.crc_hqx(body, 0xFFFF) #CRC16 CCITT
+    return struct.pack('<B', BINARY_SYNC) + body + struct.pack('<H', crc)
+
+def to_binary(lines):
+    #keeps header and <start> as text, packs the events between <begin> and <end> into frames
+    begin = lines.index('<begin>') + 1
+    end = lines.index('<end>')
+    records = []
+    for line in lines[begin:end]:
+        kind, id, value, time = line[1:-1].split(',')
+        records.append(struct.pack('<cBhI', kind.encode(), int(id), int(value), int(time)))
+
+    per_frame = BINARY_MAX_PAYLOAD // 8
+    frames = [binary_frame(BINARY_EVENTS, b''.join(records[i:i + per_frame])) for i in range(0, len(records), per_frame)]
+    frames.append(binary_frame(BINARY_END, b''))
+
+    return [line + "\n" for line in lines[:begin]] + ["<binary>\n"] + frames + [line + "\n" for line in lines[end + 1:]]
+
+def synthetic_program(events, mfcs, valves, spacing):
+    lines = ['<%d,%d>' % (mfcs, valves),
+             '<' + ','.join('adresse%d' % i for i in range(mfcs)) + '>',
+             '<' + ','.join('buerkert' for i in range(mfcs)) + '>',
+             '<' + ','.join(str(26 + 2 * i) for i in range(valves)) + '>',
+             '<25>',
+             '<begin>']
+    channels = mfcs + valves
+    for i in range(events):
+        channel = i % channels
+        step = i // channels
+        event_time = 1000 + step * spacing
+        if (channel < mfcs):
+            lines.append('<M,%d,%d,%d>' % (channel, (step * 37) % 1000, event_time))
+        else:
+            lines.append('<V,%d,%d,%d>' % (channel - mfcs, step % 2, event_time))
+    lines.append('<end>')
+    return lines
+
+def to_bytes(line):
+    return line if isinstance(line, bytes) else line.encode()
+
+def wait_reply():
+    #skips other lines (e.g. "capacity,N"), returns "ok" or the error code
+    while (True):
+        reply = serialConnection.readline().decode(errors='replace').strip()
+        if (reply == 'ok' or reply.isdigit()):
+            return reply
+
+def read_reply():
+    return serialConnection.readline().decode(errors='replace').strip()
+
+def send_windowed(lines, ack_every):
+    #every line gets a sequence number (frames are counted), at most window_bytes are unacknowledged
+    serialConnection.write(to_bytes('<window,%d>\n' % ack_every))
+    reply = read_reply()
+    while (not reply.startswith('window,')):
+        reply = read_reply()
+    window_bytes = int(reply.split(',')[2])
+
+    in_flight = collections.deque() #(sequence, bytes)
+    state = {'bytes': 0, 'errors': 0}
+    def handle(reply):
+        if (reply.startswith('ack,') or reply.startswith('nak,')):
+            fields = reply.split(',')
+            if (fields[0] == 'nak'):
+                print("Line %s rejected with error %s" % (fields[1], fields[2]))
+                state['errors'] += 1
+            while (in_flight and in_flight[0][0] <= int(fields[1])):
+                state['bytes'] -= in_flight.popleft()[1]
+
+    sequence = 0
+    total_bytes = 0
+    for line in lines:
+        line = to_bytes(line)
+        sequence += 1
+        if (line[:1] == b'<'):
+            line = b'<' + str(sequence).encode() + b',' + line[1:]
+        while (in_flight and state['bytes'] + len(line) > window_bytes):
+            handle(read_reply())
+        serialConnection.write(line)
+        in_flight.append((sequence, len(line)))
+        state['bytes'] += len(line)
+        total_bytes += len(line)
+    while (in_flight):
+        handle(read_reply())
+    return total_bytes, state['errors']
+
+def send_header(lines):
+    #sends the lines up to <begin>, returns "capacity,N" and the number of errors
+    capacity = 0
+    errors = 0
+    for line in lines:
+        serialConnection.write(to_bytes(line))
+        while (True):
+            reply = read_reply()
+            if (reply.startswith('capacity,')):
+                capacity = int(reply.split(',')[1])
+            elif (reply == 'ok' or reply.isdigit()):
+                break
+        if (reply != 'ok'):
+            errors += 1
+        if (line == '<begin>\n'):
+            break
+    return capacity, errors
+
+def run_stream(lines):
+    #the controller reports "stream,rejected,taken per MFC,taken per valve". A channel has room for
+    #capacity - (sent - taken) further events
+    capacity, errors = send_header(lines)
+    if (bench_capacity > 0):
+        capacity = min(capacity, bench_capacity)
+    begin = lines.index('<begin>\n') + 1
+    events = lines[begin:lines.index('<end>\n')]
+    def channel(line):
+        kind, id = line[1:].split(',')[0:2]
+        return int(id) if kind == 'M' else bench_mfc + int(id)
+    sent = [0] * (bench_mfc + bench_valves)
+    taken = [0] * (bench_mfc + bench_valves)
+    state = {'next': 0, 'rejected': 0, 'reports': 0, 'started': False, 'ended': False}
+    def top_up():
+        while (state['next'] < len(events)):
+            line = events[state['next']]
+            if (sent[channel(line)] - taken[channel(line)] >= capacity):
+                return
+            serialConnection.write(to_bytes(line))
+            sent[channel(line)] += 1
+            state['next'] += 1
+        if (state['started'] and not state['ended']): #all events sent, the channels may finish
+            serialConnection.write(b'<end>\n')
+            state['ended'] = True
+
+    top_up()
+    before_start = state['next']
+    for line in ('<stream>\n', '<start>\n'):
+        serialConnection.write(to_bytes(line))
+        if (wait_reply() != 'ok'):
+            errors += 1
+    state['started'] = True
+    top_up()
+    start = time()
+    while (sum(taken) < len(events)):
+        reply = read_reply()
+        if (reply.startswith('stream,')):
+            fields = [int(field) for field in reply.split(',')[1:]]
+            state['rejected'] = fields[0]
+            taken[:] = fields[1:]
+            state['reports'] += 1
+            top_up()
+    duration = time() - start
+    serialConnection.write(b'<stop>\n')
+    while (read_reply() != 'stopped'):
+        pass
+
+    print("Script:   %d events, %d before <start>, at most %d per channel in stock, %d header errors" % (len(events), before_start, capacity, errors))
+    print("          %.1f s until all events were taken, %d reports, %d rejected" % (duration, state['reports'], state['rejected']))
+
+def run_benchmark(lines):
+    if (bench_stream):
+        run_stream(lines)
+        return
+    if (bench_window > 0):
+        start = time()
+        total_bytes, errors = send_windowed(lines, bench_window)
+        duration = time() - start
+        print("Script:   %d lines/frames, %d bytes, %d errors, window (ack every %d lines)" % (len(lines), total_bytes, errors, bench_window))
+        print("          %.1f ms in total" % (duration * 1e3))
+        print("          %.0f events/s, %.0f bytes/s, %.0f us per line" % (bench_events / duration, total_bytes / duration, duration * 1e6 / len(lines)))
+        print_upload(('<%d,upload>\n' % (len(lines) + 1)).encode())
+        return
+
+    phases = {'header': 0.0, 'events': 0.0, 'end': 0.0}
+    phase = 'header'
+    errors = 0
+    total_bytes = 0
+    start = time()
+    phase_start = start
+    for line in lines:
+        if (line in ('<end>\n', binary_frame(BINARY_END, b''))):
+            phases[phase] += time() - phase_start
+            phase, phase_start = 'end', time()
+        serialConnection.write(to_bytes(line))
+        total_bytes += len(line)
+        if (wait_reply() != 'ok'):
+            errors += 1
+        if (line == '<begin>\n'):
+            phases[phase] += time() - phase_start
+            phase, phase_start = 'events', time()
+    phases[phase] += time() - phase_start
+    duration = time() - start
+
+    print("Script:   %d lines/frames, %d bytes, %d errors" % (len(lines), total_bytes, errors))
+    print("          header %.1f ms, events %.1f ms, <end> %.1f ms" % (phases['header'] * 1e3, phases['events'] * 1e3, phases['end'] * 1e3))
+    print("          %.0f events/s, %.0f bytes/s, %.0f us per line" % (bench_events / phases['events'] if phases['events'] > 0 else 0,
+        total_bytes / duration, duration * 1e6 / len(lines)))
+
+    print_upload(b'<upload>\n')
+
+def print_upload(command):
+    serialConnection.write(command)
+    while (True):
+        reply = serialConnection.readline().decode(errors='replace').strip()
+        if (reply.startswith('upload,')):
+            break
+    fields = [int(field) for field in reply.split(',')[1:]]
+    print("Firmware: %d lines/frames, %d events, %d bytes" % tuple(fields[0:3]))
+    print("          header %.1f ms, events %.1f ms, <end> %.1f ms, busy %.1f ms" % tuple(field / 1e3 for field in fields[3:7]))
+    print("          %d events/s, %d bytes/s, %d us per line" % tuple(fields[7:10]))
+
+def list_files():
+    #"file,NAME,size" per file, then "files,N"
+    serialConnection.write(b'<ls>\n')
+    files = []
+    while (True):
+        reply = read_reply()
+        if (reply.startswith('file,')):
+            name, size = reply.split(',')[1:3]
+            files.append((name, int(size)))
+        elif (reply.startswith('files,') or reply.isdigit() or reply == ''): #'' after the timeout
+            return files
+
+def read_file_frame():
+    #returns (offset, data) of the next file frame, None after a timeout, a broken frame or an error code
+    while (True):
+        first = bytearray(serialConnection.read(1))
+        if (len(first) == 0):
+            return None
+        if (first[0] != BINARY_SYNC):
+            reply = (bytes(first) + serialConnection.readline()).decode(errors='replace').strip()
+            if (reply.isdigit()):
+                return None
+            continue
+        header = serialConnection.read(3)
+        if (len(header) < 3):
+            return None
+        frame_type, length = struct.unpack('<BH', header)
+        rest = serialConnection.read(length + 2)
+        if (len(rest) < length + 2 or binascii.crc_hqx(header + rest[:-2], 0xFFFF) != struct.unpack('<H', rest[-2:])[0]):
+            return None
+        if (frame_type == BINARY_FILE):
+            return struct.unpack('<I', rest[:4])[0], rest[4:-2]
+
+def download_file(name, target, retries=5):
+    #continues with <get,NAME,offset> after a timeout, frames of an earlier <get> are skipped
+    received = os.path.getsize(target) if os.path.exists(target) else 0
+    start = time()
+    with open(target, 'ab') as out:
+        serialConnection.write(('<get,%s,%d>\n' % (name, received)).encode())
+        while (True):
+            frame = read_file_frame()
+            if (frame == None):
+                retries -= 1
+                if (retries < 0):
+                    return False
+                serialConnection.write(('<get,%s,%d>\n' % (name, received)).encode())
+                continue
+            offset, chunk = frame
+            if (offset != received):
+                continue
+            if (len(chunk) == 0):
+                break
+            out.write(chunk)
+            received += len(chunk)
+    duration = time() - start
+    print("%s: %d bytes, %.0f bytes/s" % (name, received, received / duration if duration > 0 else 0))
+    return True
+
+def run_download():
+    serialConnection.timeout = 2
+    for name, size in list_files():
+        target = os.path.join(download_dir, name)
+        if (not name.startswith(download_prefix)):
+            continue
+        if (os.path.exists(target) and os.path.getsize(target) >= size):
+            print("%s: already there" % name)
+        elif (not download_file(name, target)):
+            print("%s: download failed" % name)
+
 readline_running = True
 class readline (threading.Thread):
     def run (self):
@@ -111,15 +413,35 @@ try:
     serialConnection = serial.Serial(port=port, baudrate=115200, stopbits=serial.STOPBITS_ONE, parity=serial.PARITY_NONE)
     serialConnection.flushInput()
 
+    if (benchmark == True):
+        data = synthetic_program(bench_events, bench_mfc, bench_valves, bench_spacing)
+        data = to_binary(data) if binary and not bench_stream else [line + "\n" for line in data]
+        sleep(2)
+        serialConnection.flushInput()
+        run_benchmark(data)
+        end_program()
+        sys.exit(0)
+    if (download == True):
+        sleep(2)
+        serialConnection.flushInput()
+        run_download()
+        end_program()
+        sys.exit(0)
+
     read.setDaemon(True) #Daemon - thread stops after exiting main-thread
     read.start()
+
+    if (binary == True):
+        data = to_binary(data)
+    else:
+        data = [line + "\n" for line in data] #add '\n' (new line) to symbolize line ending
     # MAINLOOP
     while (True):
         if (toWrite == True):
             if (counter == 0):
                 sleep(2)
 
-            serialConnection.write(data[i] + "\n") #add '\n' (new line) to symbolize line ending
+            serialConnection.write(data[i])
             i+=1
             if (i == len(data)):
                 toWrite = False